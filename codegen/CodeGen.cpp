@@ -0,0 +1,653 @@
+#include "codegen/include/CodeGen.hpp"
+#include "runtime/include/TensorFile.hpp"
+#include "support/include/Format.hpp"
+#include "support/include/Statistics.hpp"
+#include "support/include/ThreadPool.hpp"
+#include "support/include/Trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef TOY_CXX_COMPILER
+#define TOY_CXX_COMPILER "c++"
+#endif
+
+namespace toy::codegen {
+
+// number of elements backing a value, empty tensors still get one element
+static int getArraySize(const Shape &aShape) {
+  return std::max(1, opt::getNumElements(aShape));
+}
+
+// element of an operand inside a loop over i, scalars broadcast
+static std::string getElement(const std::string &aName, const Shape &aShape) {
+  return aName + (aShape.empty() ? "[0]" : "[i]");
+}
+
+// the elements are printed so they read back exactly. a float literal gets
+// the f suffix, so the C++ compiler rounds it to float only once
+std::string CodeGen::toLiteral(double aValue) const {
+  if (fElementType == runtime::ElementType::Float64) {
+    return support::formatNumber(aValue);
+  }
+  auto text = support::formatNumber(static_cast<float>(aValue));
+  if (text.find_first_of(".e") == std::string::npos) {
+    text += ".";
+  }
+  return text + "f";
+}
+
+bool CodeGen::emit(const opt::ShapeInference &aShapes, std::ostream &aOs,
+                   support::ThreadPool *aPool) {
+  support::PhaseScope scope("codegen");
+  fOs = &aOs;
+  fFailed = false;
+  if (!aShapes.getEntry()) {
+    std::cout << "Codegen error: shapes were not inferred\n";
+    return false;
+  }
+
+  emitPrelude();
+  // every specialization is emitted on its own, possibly concurrently, and
+  // the results are joined in order. callees come first, so no declarations
+  // are needed
+  auto &specs = aShapes.getSpecializations();
+  std::vector<std::stringstream> code(specs.size());
+  std::vector<std::stringstream> errors(specs.size());
+  std::vector<char> emitted(specs.size());
+  support::runTaskGraph(
+      aPool, std::vector<std::vector<size_t>>(specs.size()),
+      [&](size_t aIndex) {
+        support::PhaseScope scope("codegen");
+        CodeGen gen(fElementType);
+        gen.fOs = &code[aIndex];
+        gen.fErr = &errors[aIndex];
+        emitted[aIndex] = gen.emitFunction(*specs[aIndex]);
+      });
+  for (size_t i = 0; i < specs.size(); ++i) {
+    if (!emitted[i]) {
+      std::cout << errors[i].str();
+      return false;
+    }
+    aOs << code[i].str();
+  }
+
+  aOs << "extern \"C\" void toy_run() { "
+      << getFunctionName(*aShapes.getEntry()) << "(); }\n\n"
+      << "#ifndef TOY_NO_MAIN\n"
+      << "int main() {\n"
+      << "  toy_run();\n"
+      << "  return 0;\n"
+      << "}\n"
+      << "#endif\n";
+  return true;
+}
+
+void CodeGen::emitPrelude() {
+  // same format as the print of the runtime
+  *fOs << "// generated by toy-compiler\n"
+       << "#include <charconv>\n"
+       << "#include <cstdint>\n"
+       << "#include <cstdlib>\n"
+       << "#include <cstring>\n"
+       << "#include <fcntl.h>\n"
+       << "#include <iostream>\n"
+       << "#include <sys/mman.h>\n"
+       << "#include <sys/stat.h>\n"
+       << "#include <unistd.h>\n\n"
+       << "typedef "
+       << (fElementType == runtime::ElementType::Float32 ? "float" : "double")
+       << " toy_t;\n\n"
+       << "static void toy_print_number(toy_t value) {\n"
+       << "  char text[32];\n"
+       << "  std::cout.write(text, std::to_chars(text, text + 32, value).ptr - "
+          "text);\n"
+       << "}\n\n"
+       << "static void toy_print(const toy_t *data, const int *dims, "
+          "int rank) {\n"
+       << "  if (rank == 0) {\n"
+       << "    toy_print_number(data[0]);\n"
+       << "    std::cout << \"\\n\";\n"
+       << "    return;\n"
+       << "  }\n"
+       << "  int index[16] = {0};\n"
+       << "  long size = 1;\n"
+       << "  for (int i = 0; i < rank; ++i) {\n"
+       << "    size *= dims[i];\n"
+       << "    std::cout << \"[\";\n"
+       << "  }\n"
+       << "  for (long n = 0; n < size; ++n) {\n"
+       << "    toy_print_number(data[n]);\n"
+       << "    int closed = 0;\n"
+       << "    for (int i = rank - 1; i >= 0; --i) {\n"
+       << "      if (++index[i] < dims[i]) {\n"
+       << "        break;\n"
+       << "      }\n"
+       << "      index[i] = 0;\n"
+       << "      ++closed;\n"
+       << "    }\n"
+       << "    for (int i = 0; i < closed; ++i) {\n"
+       << "      std::cout << \"]\";\n"
+       << "    }\n"
+       << "    if (n + 1 < size) {\n"
+       << "      std::cout << \", \";\n"
+       << "      for (int i = 0; i < closed; ++i) {\n"
+       << "        std::cout << \"[\";\n"
+       << "      }\n"
+       << "    }\n"
+       << "  }\n"
+       << "  if (size == 0) {\n"
+       << "    for (int i = 0; i < rank; ++i) {\n"
+       << "      std::cout << \"]\";\n"
+       << "    }\n"
+       << "  }\n"
+       << "  std::cout << \"\\n\";\n"
+       << "}\n\n"
+       // a sparse literal expanded once, the rows as in runtime::CSR
+       << "static const toy_t *toy_scatter(int rows, int cols, "
+          "const int *starts,\n"
+       << "                                 const int *indices, "
+          "const toy_t *values) {\n"
+       << "  toy_t *data = new toy_t[(long)rows * cols]();\n"
+       << "  for (int row = 0; row < rows; ++row) {\n"
+       << "    for (int i = starts[row]; i < starts[row + 1]; ++i) {\n"
+       << "      data[(long)row * cols + indices[i]] = values[i];\n"
+       << "    }\n"
+       << "  }\n"
+       << "  return data;\n"
+       << "}\n\n"
+       // a slab too large for the stack, freed when the function returns
+       << "struct toy_heap_slab {\n"
+       << "  toy_t *data;\n"
+       << "  explicit toy_heap_slab(size_t bytes)\n"
+       << "      : data((toy_t *)std::aligned_alloc("
+       << opt::BufferPlanner::kAlignment << ", bytes)) {\n"
+       << "    if (!data) {\n"
+       << "      std::cerr << \"toy: out of memory\\n\";\n"
+       << "      std::exit(1);\n"
+       << "    }\n"
+       << "  }\n"
+       << "  ~toy_heap_slab() { std::free(data); }\n"
+       << "};\n\n"
+       // same file format as runtime/include/TensorFile.hpp, the shape was
+       // checked at compile time but the file may have changed since
+       << "static const toy_t *toy_load(const char *path, const int *dims, "
+          "int rank) {\n"
+       << "  struct { char magic[4]; uint32_t dtype, rank, offset; } header;\n"
+       << "  int fd = open(path, O_RDONLY);\n"
+       << "  struct stat info;\n"
+       << "  bool ok = fd >= 0 && fstat(fd, &info) == 0 &&\n"
+       << "            pread(fd, &header, sizeof(header), 0) == "
+          "sizeof(header) &&\n"
+       << "            std::memcmp(header.magic, \"TOYT\", 4) == 0 &&\n"
+       << "            header.dtype == (sizeof(toy_t) == 4 ? 1u : 0u) &&\n"
+       << "            header.rank == (uint32_t)rank;\n"
+       << "  long size = 1;\n"
+       << "  for (int i = 0; ok && i < rank; ++i) {\n"
+       << "    int64_t dim = 0;\n"
+       << "    ok = pread(fd, &dim, 8, sizeof(header) + 8 * i) == 8 && "
+          "dim == dims[i];\n"
+       << "    size *= dims[i];\n"
+       << "  }\n"
+       << "  size = header.offset + size * sizeof(toy_t);\n"
+       << "  void *data = ok && info.st_size == size\n"
+       << "                 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, "
+          "0)\n"
+       << "                 : MAP_FAILED;\n"
+       << "  if (fd >= 0) {\n"
+       << "    close(fd);\n"
+       << "  }\n"
+       << "  if (data == MAP_FAILED) {\n"
+       << "    std::cerr << \"toy: cannot load tensor file \" << path << "
+          "\"\\n\";\n"
+       << "    std::exit(1);\n"
+       << "  }\n"
+       << "  return (const toy_t *)((const char *)data + header.offset);\n"
+       << "}\n\n";
+}
+
+std::string CodeGen::getFunctionName(const opt::FunctionShapes &aShapes) {
+  return "toy_" + aShapes.getMangledName();
+}
+
+bool CodeGen::emitFunction(const opt::FunctionShapes &aShapes) {
+  TOY_TRACE_SCOPE("emit function", aShapes.function->getPrototype()->getName());
+  fShapes = &aShapes;
+  fEnv.clear();
+  fNextTemp = 0;
+
+  auto &os = *fOs;
+  os << "static void " << getFunctionName(aShapes) << "(";
+  bool first = true;
+  if (aShapes.returnShape) {
+    os << "toy_t *ret";
+    first = false;
+  }
+  auto &params = aShapes.function->getPrototype()->getArgs();
+  for (size_t i = 0; i < params.size(); ++i) {
+    auto name = "arg_" + params[i]->getName();
+    os << (first ? "" : ", ") << "const toy_t *" << name;
+    first = false;
+    fEnv[params[i]->getName()] = Value{name, aShapes.argShapes[i]};
+  }
+  os << ") {\n";
+
+  auto plan = opt::BufferPlanner(fElementType).plan(aShapes);
+  fBuffers.clear();
+  for (auto &buffer : plan.buffers) {
+    fBuffers.emplace(buffer.value, buffer);
+  }
+  if (plan.slabSize > kMaxStackSlab) {
+    // the planner rounds every buffer to the alignment, as aligned_alloc needs
+    os << "  toy_heap_slab slab_memory(" << plan.slabSize << ");\n"
+       << "  toy_t *slab = slab_memory.data;\n";
+    support::addCount("codegen.heapSlabBytes", plan.slabSize);
+  } else if (plan.slabSize) {
+    os << "  alignas(" << opt::BufferPlanner::kAlignment << ") toy_t slab["
+       << plan.slabSize / runtime::getElementSize(fElementType) << "];\n";
+  }
+  support::addCount("codegen.slabBytes", plan.slabSize);
+  support::addCount("codegen.naiveBytes", plan.naiveBytes);
+
+  for (auto &expr : *aShapes.function->getBody()) {
+    if (!emitStatement(expr.get())) {
+      return false;
+    }
+    if (dynamic_cast<ReturnExpr *>(expr.get())) {
+      break;
+    }
+  }
+  os << "}\n\n";
+  return true;
+}
+
+bool CodeGen::emitStatement(Expr *aExpr) {
+  auto &os = *fOs;
+
+  if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    auto value = emitExpr(decl->getInitValue());
+    if (fFailed) {
+      return false;
+    }
+    // arrays are never written after they are computed, a variable aliases
+    // its value and a declared type only changes the shape
+    auto &declared = decl->getType().shape;
+    if (!declared.empty()) {
+      value.shape = declared;
+    }
+    fEnv[decl->getName()] = value;
+    return true;
+  }
+
+  if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (!ret->getExpr().has_value()) {
+      os << "  return;\n";
+      return true;
+    }
+    auto value = emitExpr(*ret->getExpr());
+    if (fFailed) {
+      return false;
+    }
+    os << "  std::memcpy(ret, " << value.name << ", sizeof(toy_t) * "
+       << getArraySize(value.shape) << ");\n"
+       << "  return;\n";
+    return true;
+  }
+
+  if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+    auto value = emitExpr(print->getArg());
+    if (fFailed) {
+      return false;
+    }
+    if (value.shape.empty()) {
+      os << "  toy_print(" << value.name << ", nullptr, 0);\n";
+      return true;
+    }
+    os << "  {\n    static const int dims[] = {";
+    for (size_t i = 0; i < value.shape.size(); ++i) {
+      os << (i ? ", " : "") << value.shape[i];
+    }
+    os << "};\n    toy_print(" << value.name << ", dims, "
+       << value.shape.size() << ");\n  }\n";
+    return true;
+  }
+
+  // expression statement, the value is dropped
+  emitExpr(aExpr);
+  return !fFailed;
+}
+
+CodeGen::Value CodeGen::declare(const Shape &aShape, Expr *aProducer) {
+  Value value{"t" + std::to_string(fNextTemp++), aShape};
+  size_t elementSize = runtime::getElementSize(fElementType);
+  auto it = fBuffers.find(aProducer);
+  // an empty tensor still writes one element
+  if (it != fBuffers.end() &&
+      it->second.size >= getArraySize(aShape) * elementSize) {
+    *fOs << "  toy_t *" << value.name << " = slab + "
+         << it->second.offset / elementSize << ";\n";
+    return value;
+  }
+  *fOs << "  toy_t " << value.name << "[" << getArraySize(aShape) << "];\n";
+  support::addCount("codegen.unplannedBytes",
+                    getArraySize(aShape) * elementSize);
+  return value;
+}
+
+CodeGen::Value CodeGen::emitExpr(Expr *aExpr) {
+  auto &os = *fOs;
+  if (aExpr == nullptr) {
+    fFailed = true;
+    return Value();
+  }
+
+  auto shapeIt = fShapes->shapes.find(aExpr);
+  Shape shape = shapeIt == fShapes->shapes.end() ? Shape() : shapeIt->second;
+
+  if (auto *num = dynamic_cast<NumberExpr *>(aExpr)) {
+    Value value{"t" + std::to_string(fNextTemp++), Shape()};
+    os << "  const toy_t " << value.name << "[1] = {"
+       << toLiteral(num->getValue()) << "};\n";
+    return value;
+  }
+
+  if (auto *lit = dynamic_cast<LiteralExpr *>(aExpr)) {
+    Value value{"t" + std::to_string(fNextTemp++), lit->getDims()};
+    os << "  static const toy_t " << value.name << "["
+       << getArraySize(value.shape) << "] = {";
+    bool first = true;
+    std::function<void(Expr *)> flatten = [&](Expr *aElem) {
+      if (auto *elem = dynamic_cast<NumberExpr *>(aElem)) {
+        os << (first ? "" : ", ") << toLiteral(elem->getValue());
+        first = false;
+        return;
+      }
+      for (auto &val : static_cast<LiteralExpr *>(aElem)->getValues()) {
+        flatten(val.get());
+      }
+    };
+    flatten(lit);
+    os << "};\n";
+    return value;
+  }
+
+  if (auto *lit = dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+    // the source holds only the nonzeros, scattered into a dense array on
+    // the first run of the function
+    Value value{"t" + std::to_string(fNextTemp++), lit->getDims()};
+    if (lit->getValues().empty()) {
+      os << "  static const toy_t " << value.name << "["
+         << getArraySize(value.shape) << "] = {};\n";
+      return value;
+    }
+    auto indices = [&](const std::string &aName,
+                       const std::vector<int> &aList) {
+      os << "  static const int " << aName << "[] = {";
+      for (size_t i = 0; i < aList.size(); ++i) {
+        os << (i ? ", " : "") << aList[i];
+      }
+      os << "};\n";
+    };
+    indices(value.name + "_starts", lit->getRowStarts());
+    indices(value.name + "_cols", lit->getCols());
+    os << "  static const toy_t " << value.name << "_values[] = {";
+    for (size_t i = 0; i < lit->getValues().size(); ++i) {
+      os << (i ? ", " : "") << toLiteral(lit->getValues()[i]);
+    }
+    os << "};\n";
+    int cols = value.shape.back();
+    os << "  static const toy_t *" << value.name << " = toy_scatter("
+       << getArraySize(value.shape) / cols << ", " << cols << ", "
+       << value.name << "_starts, " << value.name << "_cols, " << value.name
+       << "_values);\n";
+    return value;
+  }
+
+  if (auto *load = dynamic_cast<LoadExpr *>(aExpr)) {
+    // mapped on the first run of the function and kept for the process
+    runtime::Dims fileDims;
+    runtime::ElementType type;
+    std::string message;
+    if (!runtime::readTensorFileHeader(load->getPath(), fileDims, type,
+                                       message)) {
+      error(aExpr, message);
+      return Value();
+    }
+    if (type != fElementType) {
+      error(aExpr, "'" + load->getPath() + "' holds " +
+                       runtime::getElementTypeName(type) +
+                       " elements, the program uses " +
+                       runtime::getElementTypeName(fElementType));
+      return Value();
+    }
+    Value value{"t" + std::to_string(fNextTemp++), shape};
+    std::string dims = "nullptr";
+    if (!shape.empty()) {
+      dims = value.name + "_dims";
+      os << "  static const int " << dims << "[] = {";
+      for (size_t i = 0; i < shape.size(); ++i) {
+        os << (i ? ", " : "") << shape[i];
+      }
+      os << "};\n";
+    }
+    os << "  static const toy_t *" << value.name << " = toy_load(\"";
+    for (char c : load->getPath()) {
+      os << (c == '\\' ? "\\\\" : std::string(1, c));
+    }
+    os << "\", " << dims << ", " << shape.size() << ");\n";
+    return value;
+  }
+
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    auto it = fEnv.find(var->getName());
+    if (it == fEnv.end()) {
+      error(aExpr, "unknown variable '" + var->getName() + "'");
+      return Value();
+    }
+    return it->second;
+  }
+
+  if (auto *bin = dynamic_cast<BinaryExpr *>(aExpr)) {
+    auto lhs = emitExpr(bin->getLHS());
+    auto rhs = emitExpr(bin->getRHS());
+    if (fFailed) {
+      return Value();
+    }
+    auto value = declare(shape, aExpr);
+    os << "  for (int i = 0; i < " << getArraySize(shape) << "; ++i) {\n"
+       << "    " << value.name << "[i] = " << getElement(lhs.name, lhs.shape)
+       << " " << bin->getOp() << " " << getElement(rhs.name, rhs.shape)
+       << ";\n  }\n";
+    return value;
+  }
+
+  if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    std::vector<Value> inputs;
+    for (auto &input : fused->getInputs()) {
+      inputs.push_back(emitExpr(input.get()));
+    }
+    if (fFailed) {
+      return Value();
+    }
+    // rebuild the infix expression from the postfix program
+    std::vector<std::string> stack;
+    for (auto &op : fused->getProgram()) {
+      if (!op.op) {
+        auto &input = inputs[op.input];
+        stack.push_back(getElement(input.name, input.shape));
+        continue;
+      }
+      auto rhs = std::move(stack.back());
+      stack.pop_back();
+      stack.back() = "(" + stack.back() + " " + op.op + " " + rhs + ")";
+    }
+    auto value = declare(shape, aExpr);
+    os << "  for (int i = 0; i < " << getArraySize(shape) << "; ++i) {\n"
+       << "    " << value.name << "[i] = " << stack.back() << ";\n  }\n";
+    return value;
+  }
+
+  if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    std::vector<Value> args;
+    for (auto &arg : call->getArgs()) {
+      args.push_back(emitExpr(arg.get()));
+    }
+    if (fFailed) {
+      return Value();
+    }
+
+    if (call->getCallee() == "transpose") {
+      if (args.size() != 1) {
+        error(aExpr, "transpose takes a single argument");
+        return Value();
+      }
+      // nothing moves for a scalar or a vector
+      if (args[0].shape.size() < 2) {
+        return Value{args[0].name, shape};
+      }
+      auto value = declare(shape, aExpr);
+      int rank = shape.size();
+      // strides of the result and of the operand along the result dims
+      std::vector<long> outStrides(rank, 1), inStrides(rank, 1);
+      for (int i = rank - 2; i >= 0; --i) {
+        outStrides[i] = outStrides[i + 1] * shape[i + 1];
+      }
+      for (int i = 1; i < rank; ++i) {
+        inStrides[i] = inStrides[i - 1] * shape[i - 1];
+      }
+      std::string out = value.name + "[", in = args[0].name + "[";
+      for (int i = 0; i < rank; ++i) {
+        auto index = "i" + std::to_string(i);
+        os << std::string(2 * i + 2, ' ') << "for (int " << index << " = 0; "
+           << index << " < " << shape[i] << "; ++" << index << ")\n";
+        out += (i ? " + " : "") + index + " * " +
+               std::to_string(outStrides[i]);
+        in += (i ? " + " : "") + index + " * " + std::to_string(inStrides[i]);
+      }
+      os << std::string(2 * rank + 2, ' ') << out << "] = " << in << "];\n";
+      return value;
+    }
+
+    auto calleeIt = fShapes->callees.find(call);
+    if (calleeIt == fShapes->callees.end()) {
+      error(aExpr, "unknown function '" + call->getCallee() + "'");
+      return Value();
+    }
+    auto *callee = calleeIt->second;
+    Value value;
+    std::string argList;
+    if (callee->returnShape) {
+      value = declare(*callee->returnShape, aExpr);
+      argList = value.name;
+    }
+    for (auto &arg : args) {
+      argList += (argList.empty() ? "" : ", ") + arg.name;
+    }
+    os << "  " << getFunctionName(*callee) << "(" << argList << ");\n";
+    return value;
+  }
+
+  error(aExpr, "expression does not produce a value");
+  return Value();
+}
+
+bool CodeGen::error(Expr *aExpr, const std::string &aMsg) {
+  auto &loc = aExpr->getLoc();
+  *fErr << "Codegen error (" << loc.line << ", " << loc.col << "): " << aMsg
+        << "\n";
+  fFailed = true;
+  return false;
+}
+
+// writes aSource to a fresh file in the temporary directory, the compiler
+// needs the .cpp suffix to pick the language
+static std::string writeTempSource(const std::string &aSource) {
+  const char *dir = std::getenv("TMPDIR");
+  std::string path = std::string(dir && *dir ? dir : "/tmp") +
+                     "/toy-native-XXXXXX.cpp";
+  int fd = ::mkstemps(path.data(), 4);
+  if (fd < 0) {
+    return "";
+  }
+  const char *data = aSource.data();
+  size_t left = aSource.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd, data, left);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      ::close(fd);
+      std::remove(path.c_str());
+      return "";
+    }
+    data += n;
+    left -= n;
+  }
+  ::close(fd);
+  return path;
+}
+
+// runs aArgs without a shell and returns whether it exited successfully
+static bool runProgram(const std::vector<std::string> &aArgs) {
+  std::vector<char *> argv;
+  for (auto &arg : aArgs) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  pid_t pid;
+  if (::posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(),
+                     environ) != 0) {
+    return false;
+  }
+  int status;
+  while (::waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool compileNative(const std::string &aSource, const std::string &aOutput,
+                   const NativeOptions &aOptions) {
+  support::PhaseScope scope("native-compile");
+  std::string sourceFile = writeTempSource(aSource);
+  if (sourceFile.empty()) {
+    std::cout << "Codegen error: cannot write a temporary source file\n";
+    return false;
+  }
+
+  std::vector<std::string> args = {
+      aOptions.compiler.empty() ? TOY_CXX_COMPILER : aOptions.compiler,
+      "-std=c++17"};
+  if (!aOptions.optLevel.empty()) {
+    args.push_back(aOptions.optLevel);
+  }
+  if (aOptions.sharedObject) {
+    args.insert(args.end(), {"-shared", "-fPIC", "-DTOY_NO_MAIN"});
+  }
+  args.insert(args.end(), {sourceFile, "-o", aOutput});
+
+  bool ok = runProgram(args);
+  std::remove(sourceFile.c_str());
+  if (!ok) {
+    std::cout << "Codegen error: '" << args[0] << "' failed to build '"
+              << aOutput << "'\n";
+    return false;
+  }
+  return true;
+}
+
+} // namespace toy::codegen
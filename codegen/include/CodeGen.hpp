@@ -0,0 +1,93 @@
+/*
+ *
+ * Ahead of time C++ code generation.
+ *
+ * Every specialization found by shape inference becomes a C++ function over
+ * fixed size arrays of toy_t, double or float as selected by the element type.
+ * Shapes are known, so every operation is a simple counted loop the C++
+ * compiler can unroll and vectorize. The temporaries of a function share one
+ * slab laid out by the buffer planner, a buffer is reused once the value it
+ * held is dead. Slabs up to kMaxStackSlab bytes live on the stack, larger
+ * ones are heap allocated for the duration of the call so big tensors cannot
+ * overflow the stack. The emitted translation unit only depends on the
+ * standard library.
+ *
+ */
+
+#pragma once
+
+#include "opt/include/BufferPlanner.hpp"
+#include "opt/include/ShapeInference.hpp"
+#include "runtime/include/Tensor.hpp"
+
+#include <iostream>
+#include <string>
+
+namespace toy::support {
+class ThreadPool;
+} // namespace toy::support
+
+namespace toy::codegen {
+
+struct NativeOptions {
+  // C++ compiler to invoke, the configured compiler if empty
+  std::string compiler;
+  // build a shared object exporting toy_run() instead of an executable
+  bool sharedObject = false;
+  std::string optLevel = "-O2";
+};
+
+class CodeGen {
+public:
+  // largest slab placed on the stack, in bytes
+  static constexpr size_t kMaxStackSlab = 64 << 10;
+
+  explicit CodeGen(
+      runtime::ElementType aElementType = runtime::ElementType::Float64)
+      : fElementType(aElementType) {}
+
+  // emit a translation unit for every specialization of aShapes, prints the
+  // error and returns false on failure. the functions are emitted
+  // concurrently on aPool if there is one
+  bool emit(const opt::ShapeInference &aShapes, std::ostream &aOs,
+            support::ThreadPool *aPool = nullptr);
+
+private:
+  // array holding a value and its shape
+  struct Value {
+    std::string name;
+    Shape shape;
+  };
+
+  void emitPrelude();
+  bool emitFunction(const opt::FunctionShapes &aShapes);
+  bool emitStatement(Expr *aExpr);
+  // emit the code computing aExpr, returns the array holding its value or an
+  // empty name if it produces none
+  Value emitExpr(Expr *aExpr);
+  // declare the array for the value of aShape produced by aProducer, in its
+  // planned slab buffer if it has one
+  Value declare(const Shape &aShape, Expr *aProducer);
+  std::string getFunctionName(const opt::FunctionShapes &aShapes);
+  bool error(Expr *aExpr, const std::string &aMsg);
+  // aValue as a literal of the element type
+  std::string toLiteral(double aValue) const;
+
+  runtime::ElementType fElementType;
+  std::ostream *fOs = nullptr;
+  // where errors are reported
+  std::ostream *fErr = &std::cout;
+  const opt::FunctionShapes *fShapes = nullptr;
+  std::map<std::string, Value> fEnv;
+  // slab buffer of each planned value
+  std::map<Expr *, opt::BufferAssignment> fBuffers;
+  int fNextTemp = 0;
+  bool fFailed = false;
+};
+
+// compile aSource with the C++ compiler into aOutput, prints the error and
+// returns false on failure
+bool compileNative(const std::string &aSource, const std::string &aOutput,
+                   const NativeOptions &aOptions = NativeOptions());
+
+} // namespace toy::codegen
@@ -0,0 +1,234 @@
+#include "codegen/include/CodeGen.hpp"
+#include "lexer/include/Lexer.hpp"
+#include "opt/include/Fusion.hpp"
+#include "parser/include/Parser.hpp"
+#include "runtime/include/TensorFile.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace toy;
+
+// utility to parse a module from a string
+static std::unique_ptr<Module> parse(const char *aCode) {
+  auto lexer = std::make_unique<lexer::Lexer>(std::stringstream(aCode));
+  parser::Parser parser(std::move(lexer));
+  return parser.parseModule();
+}
+
+// utility to run a command and return what it printed
+static std::string capture(const std::string &aCommand) {
+  std::string out;
+  FILE *pipe = popen(aCommand.c_str(), "r");
+  if (!pipe) {
+    return out;
+  }
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), pipe)) {
+    out += buffer;
+  }
+  pclose(pipe);
+  return out;
+}
+
+static const char *kTutorial = R"(
+  def multiply_transpose(a, b) {
+    return transpose(a) * transpose(b);
+  }
+
+  def main() {
+    var a = [[1, 2, 3], [4, 5, 6]];
+    var b<2, 3> = [1, 2, 3, 4, 5, 6];
+    var c = multiply_transpose(a, b);
+    var d = multiply_transpose(b, a);
+    var e = multiply_transpose(c, d);
+    print(e);
+    print(e * 0.5 + 1);
+  }
+)";
+
+TEST(CodeGen, EmitsSpecializations) {
+  auto module = parse(kTutorial);
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+  auto code = source.str();
+  EXPECT_NE(code.find("static void toy_multiply_transpose_2x3_2x3("),
+            std::string::npos);
+  EXPECT_NE(code.find("static void toy_multiply_transpose_3x2_3x2("),
+            std::string::npos);
+  EXPECT_NE(code.find("int main()"), std::string::npos);
+}
+
+TEST(CodeGen, NativeExecutable) {
+  auto module = parse(kTutorial);
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  opt::Fusion().run(*module, &shapes);
+  ASSERT_TRUE(shapes.run(*module));
+
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+  std::string exe = testing::TempDir() + "toy-codegen-test";
+  ASSERT_TRUE(codegen::compileNative(source.str(), exe));
+  EXPECT_EQ(capture(exe), "[[1, 16, 81], [256, 625, 1296]]\n"
+                          "[[1.5, 9, 41.5], [129, 313.5, 649]]\n");
+  std::remove(exe.c_str());
+}
+
+TEST(CodeGen, TemporariesShareTheSlab) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2, 3, 4, 5, 6, 7, 8];
+      var b = a * a;
+      var c = b + b;
+      var d = c - a;
+      print(d * d);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  // a, b and c take 64 bytes each, d and its square reuse the buffer of b
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+  auto code = source.str();
+  EXPECT_NE(code.find("alignas(64) toy_t slab[24];"), std::string::npos);
+  EXPECT_NE(code.find("toy_t *t3 = slab + 8;"), std::string::npos);
+  std::string exe = testing::TempDir() + "toy-codegen-slab";
+  ASSERT_TRUE(codegen::compileNative(code, exe));
+  EXPECT_EQ(capture(exe), "[1, 36, 225, 784, 2025, 4356, 8281, 14400]\n");
+  std::remove(exe.c_str());
+}
+
+TEST(CodeGen, NativeOutputPath) {
+  auto module = parse("def main() { print([1, 2]); }");
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+
+  // the path reaches the compiler as is and a neighbouring .cpp survives
+  std::string exe = testing::TempDir() + "it's toy";
+  std::ofstream(exe + ".cpp") << "keep";
+  ASSERT_TRUE(codegen::compileNative(source.str(), exe));
+  EXPECT_EQ(capture("\"" + exe + "\""), "[1, 2]\n");
+  std::ifstream kept(exe + ".cpp");
+  EXPECT_EQ(std::string(std::istreambuf_iterator<char>(kept), {}), "keep");
+  std::remove(exe.c_str());
+  std::remove((exe + ".cpp").c_str());
+
+  // a failing compiler is reported
+  testing::internal::CaptureStdout();
+  EXPECT_FALSE(codegen::compileNative("not c++", exe));
+  EXPECT_NE(testing::internal::GetCapturedStdout().find("failed"),
+            std::string::npos);
+}
+
+TEST(CodeGen, LoadsTensorFile) {
+  std::string path = testing::TempDir() + "codegen.toyt";
+  ASSERT_TRUE(runtime::writeTensorFile(
+      path, runtime::Tensor({2, 2}, {1, 2, 3, 4})));
+  std::string code = "def main() { var w<2, 2> = load(\"" + path +
+                     "\"); print(w * transpose(w)); }";
+  auto module = parse(code.c_str());
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+  std::string exe = testing::TempDir() + "toy-codegen-load";
+  ASSERT_TRUE(codegen::compileNative(source.str(), exe));
+  EXPECT_EQ(capture(exe), "[[1, 6], [6, 16]]\n");
+
+  // the file is mapped when the program runs, a different shape is fatal
+  ASSERT_TRUE(runtime::writeTensorFile(path, runtime::Tensor({4})));
+  EXPECT_EQ(capture(exe + " 2>&1"), "toy: cannot load tensor file " + path +
+                                        "\n");
+  std::remove(exe.c_str());
+}
+
+TEST(CodeGen, HeapSlab) {
+  // every temporary of 100x100 doubles is larger than a stack slab
+  std::string path = testing::TempDir() + "codegen-large.toyt";
+  ASSERT_TRUE(runtime::writeTensorFile(
+      path, runtime::Tensor({100, 100}, std::vector<double>(10000, 2))));
+  std::string code = "def main() { var w<100, 100> = load(\"" + path +
+                     "\"); var p = w * w + w; print(p - w); }";
+  auto module = parse(code.c_str());
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+  EXPECT_NE(source.str().find("toy_heap_slab slab_memory("),
+            std::string::npos);
+  EXPECT_EQ(source.str().find("toy_t slab["), std::string::npos);
+  std::string exe = testing::TempDir() + "toy-codegen-heap-slab";
+  ASSERT_TRUE(codegen::compileNative(source.str(), exe));
+  EXPECT_EQ(capture(exe).substr(0, 10), "[[4, 4, 4,");
+  std::remove(exe.c_str());
+}
+
+TEST(CodeGen, Float32) {
+  auto module = parse(R"(
+    def main() {
+      var a = [[0.1, 1], [2, 3]];
+      print(transpose(a) * a + 0.2);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen(runtime::ElementType::Float32)
+                  .emit(shapes, source));
+  auto code = source.str();
+  EXPECT_NE(code.find("typedef float toy_t;"), std::string::npos);
+  EXPECT_NE(code.find("{0.1f, 1.f, 2.f, 3.f}"), std::string::npos);
+  std::string exe = testing::TempDir() + "toy-codegen-float32";
+  ASSERT_TRUE(codegen::compileNative(code, exe));
+  // the same as the VM computing in float
+  EXPECT_EQ(capture(exe), "[[0.21000001, 2.2], [2.2, 9.2]]\n");
+  std::remove(exe.c_str());
+}
+
+TEST(CodeGen, SparseLiteral) {
+  std::string rows;
+  for (int row = 0; row < 8; ++row) {
+    rows += row ? ", [" : "[";
+    for (int col = 0; col < 8; ++col) {
+      rows += (col ? ", " : "") + std::to_string(col == 7 - row ? row : 0);
+    }
+    rows += "]";
+  }
+  std::string code = "def main() { var a = [" + rows +
+                     "]; print(a + transpose(a)); }";
+  auto module = parse(code.c_str());
+  ASSERT_NE(module, nullptr);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  // only the nonzeros are in the source
+  std::stringstream source;
+  ASSERT_TRUE(codegen::CodeGen().emit(shapes, source));
+  EXPECT_NE(source.str().find("_values[] = {1, 2, 3, 4, 5, 6, 7};"),
+            std::string::npos);
+  std::string exe = testing::TempDir() + "toy-codegen-sparse";
+  ASSERT_TRUE(codegen::compileNative(source.str(), exe));
+  auto out = capture(exe);
+  EXPECT_EQ(out.substr(0, 28), "[[0, 0, 0, 0, 0, 0, 0, 7], [");
+  EXPECT_NE(out.find("[7, 0, 0, 0, 0, 0, 0, 0]]\n"), std::string::npos);
+  std::remove(exe.c_str());
+}
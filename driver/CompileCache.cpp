@@ -0,0 +1,86 @@
+#include "driver/include/CompileCache.hpp"
+
+namespace toy::driver {
+
+uint64_t hashSource(const std::string &aSource) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : aSource) {
+    hash = (hash ^ c) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+CompileCache::Entry *CompileCache::find(const std::string &aSource) {
+  auto it = fEntries.find(hashSource(aSource));
+  // a colliding source is a miss
+  if (it == fEntries.end() || it->second.source != aSource) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+CompileCache::Entry &CompileCache::insert(const std::string &aSource) {
+  uint64_t hash = hashSource(aSource);
+  auto it = fEntries.find(hash);
+  if (it != fEntries.end()) {
+    if (it->second.source != aSource) {
+      it->second = Entry{aSource, nullptr, {}};
+    }
+    return it->second;
+  }
+
+  while (!fOrder.empty() && fEntries.size() >= fMaxEntries) {
+    fEntries.erase(fOrder.front());
+    fOrder.pop_front();
+  }
+  fOrder.push_back(hash);
+  return fEntries[hash] = Entry{aSource, nullptr, {}};
+}
+
+std::shared_ptr<Module> CompileCache::getModule(const std::string &aSource) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  auto *entry = find(aSource);
+  if (!entry || !entry->module) {
+    ++fStats.misses;
+    return nullptr;
+  }
+  ++fStats.moduleHits;
+  return entry->module;
+}
+
+void CompileCache::putModule(const std::string &aSource,
+                             std::shared_ptr<Module> aModule) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  insert(aSource).module = std::move(aModule);
+}
+
+std::optional<FileResult> CompileCache::getResult(const std::string &aSource,
+                                                  Action aAction,
+                                                  bool aOptimize,
+                                                  bool aFloat32) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  auto *entry = find(aSource);
+  if (!entry) {
+    return std::nullopt;
+  }
+  auto it = entry->results.find({aAction, aOptimize, aFloat32});
+  if (it == entry->results.end()) {
+    return std::nullopt;
+  }
+  ++fStats.resultHits;
+  return it->second;
+}
+
+void CompileCache::putResult(const std::string &aSource, Action aAction,
+                             bool aOptimize, bool aFloat32,
+                             const FileResult &aResult) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  insert(aSource).results[{aAction, aOptimize, aFloat32}] = aResult;
+}
+
+CompileCache::Stats CompileCache::getStats() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fStats;
+}
+
+} // namespace toy::driver
@@ -0,0 +1,234 @@
+#include "driver/include/DiskCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <link.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace toy::driver {
+
+// version of the entry layout, bumped when it changes
+static const char *const kHeader = "toy-cache 3\n";
+
+static uint64_t hashBytes(uint64_t aHash, const std::string &aData) {
+  for (unsigned char c : aData) {
+    aHash = (aHash ^ c) * 0x100000001b3ull;
+  }
+  return aHash;
+}
+
+static bool readFile(const std::string &aPath, std::string &aData) {
+  std::ifstream file(aPath, std::ios::binary);
+  std::stringstream data;
+  if (!file || !(data << file.rdbuf())) {
+    return false;
+  }
+  aData = data.str();
+  return true;
+}
+
+// hex of the NT_GNU_BUILD_ID note of the executable, empty if it has none
+static std::string readBuildId() {
+  std::string id;
+  dl_iterate_phdr(
+      [](dl_phdr_info *aInfo, size_t, void *aId) {
+        for (int i = 0; i < aInfo->dlpi_phnum; ++i) {
+          auto &segment = aInfo->dlpi_phdr[i];
+          if (segment.p_type != PT_NOTE) {
+            continue;
+          }
+          size_t align = segment.p_align == 8 ? 8 : 4;
+          auto pad = [&](size_t aSize) {
+            return (aSize + align - 1) & ~(align - 1);
+          };
+          auto *note = reinterpret_cast<const char *>(aInfo->dlpi_addr +
+                                                      segment.p_vaddr);
+          auto *end = note + segment.p_memsz;
+          while (note + sizeof(ElfW(Nhdr)) <= end) {
+            auto *header = reinterpret_cast<const ElfW(Nhdr) *>(note);
+            auto *name = note + sizeof(ElfW(Nhdr));
+            auto *desc = reinterpret_cast<const unsigned char *>(
+                name + pad(header->n_namesz));
+            if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 &&
+                std::memcmp(name, "GNU", 4) == 0) {
+              auto &id = *static_cast<std::string *>(aId);
+              for (size_t b = 0; b < header->n_descsz; ++b) {
+                char hex[3];
+                std::snprintf(hex, sizeof(hex), "%02x", desc[b]);
+                id += hex;
+              }
+              return 1;
+            }
+            note = reinterpret_cast<const char *>(desc) +
+                   pad(header->n_descsz);
+          }
+        }
+        // the executable comes first, shared libraries do not matter
+        return 1;
+      },
+      &id);
+  return id;
+}
+
+const std::string &getCompilerId() {
+  static const std::string sId = [] {
+    std::string id = readBuildId();
+    return id.empty() ? std::string(__DATE__ " " __TIME__) : id;
+  }();
+  return sId;
+}
+
+DiskCache::DiskCache(std::string aDir, uint64_t aMaxBytes)
+    : fDir(std::move(aDir)), fMaxBytes(aMaxBytes) {
+  std::error_code ec;
+  fs::create_directories(fDir, ec);
+}
+
+DiskCache::Key DiskCache::makeKey(const std::string &aPath,
+                                  const std::string &aSource, Action aAction,
+                                  bool aOptimize, bool aFloat32) {
+  Key key;
+  key.material = getCompilerId();
+  key.material += '\0';
+  key.material += aPath;
+  key.material += '\0';
+  key.material += char('0' + int(aAction));
+  key.material += aOptimize ? '1' : '0';
+  key.material += aFloat32 ? '1' : '0';
+  key.material += aSource;
+  // the name only spreads entries, a hit is confirmed against the material
+  uint64_t seeds[] = {0xcbf29ce484222325ull, 0x84222325cbf29ce4ull};
+  for (uint64_t seed : seeds) {
+    char part[17];
+    std::snprintf(part, sizeof(part), "%016llx",
+                  (unsigned long long)hashBytes(seed, key.material));
+    key.name += part;
+  }
+  return key;
+}
+
+std::string DiskCache::getPath(const Key &aKey) const {
+  // entries are spread over subdirectories to keep directories small
+  return fDir + "/" + aKey.name.substr(0, 2) + "/" + aKey.name.substr(2);
+}
+
+bool DiskCache::get(const Key &aKey, FileResult &aResult,
+                    std::string *aArtifact) {
+  std::string path = getPath(aKey);
+  std::string data;
+  size_t header = std::char_traits<char>::length(kHeader);
+  if (!readFile(path, data) || data.compare(0, header, kHeader) != 0) {
+    ++fMisses;
+    return false;
+  }
+
+  // <status> <key size> <output size> <diagnostics size> <artifact size>\n
+  // <key material><output><diagnostics><artifact>
+  int status = 0;
+  size_t keySize = 0, outputSize = 0, diagnosticsSize = 0, artifactSize = 0;
+  auto end = data.find('\n', header);
+  if (end == std::string::npos ||
+      std::sscanf(data.c_str() + header, "%d %zu %zu %zu %zu", &status,
+                  &keySize, &outputSize, &diagnosticsSize,
+                  &artifactSize) != 5 ||
+      data.size() - end - 1 !=
+          keySize + outputSize + diagnosticsSize + artifactSize ||
+      data.compare(end + 1, keySize, aKey.material) != 0) {
+    ++fMisses;
+    return false;
+  }
+  size_t start = end + 1 + keySize;
+  aResult.status = FileStatus(status);
+  aResult.output = data.substr(start, outputSize);
+  aResult.diagnostics = data.substr(start + outputSize, diagnosticsSize);
+  if (aArtifact) {
+    *aArtifact = data.substr(start + outputSize + diagnosticsSize);
+  }
+
+  // a hit makes the entry the most recently used
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  ++fHits;
+  return true;
+}
+
+void DiskCache::put(const Key &aKey, const FileResult &aResult,
+                    const std::string &aArtifact) {
+  std::string path = getPath(aKey);
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+
+  std::stringstream data;
+  data << kHeader << int(aResult.status) << " " << aKey.material.size() << " "
+       << aResult.output.size() << " " << aResult.diagnostics.size() << " "
+       << aArtifact.size() << "\n"
+       << aKey.material << aResult.output << aResult.diagnostics << aArtifact;
+  // a failed store only costs a later miss
+  writeFileAtomic(path, data.str());
+}
+
+void DiskCache::trim() {
+  struct File {
+    fs::path path;
+    uint64_t size;
+    fs::file_time_type time;
+  };
+  std::vector<File> files;
+  uint64_t total = 0;
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(fDir, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    std::error_code fileEc;
+    if (!it->is_regular_file(fileEc)) {
+      continue;
+    }
+    File file{it->path(), it->file_size(fileEc), it->last_write_time(fileEc)};
+    if (!fileEc) {
+      total += file.size;
+      files.push_back(std::move(file));
+    }
+  }
+  if (total <= fMaxBytes) {
+    return;
+  }
+
+  std::sort(files.begin(), files.end(),
+            [](const File &aL, const File &aR) { return aL.time < aR.time; });
+  for (auto &file : files) {
+    if (total <= fMaxBytes) {
+      break;
+    }
+    // another compiler may have removed it already
+    if (fs::remove(file.path, ec)) {
+      ++fEvictions;
+    }
+    total -= file.size;
+  }
+}
+
+bool writeFileAtomic(const std::string &aPath, const std::string &aData) {
+  static std::atomic<unsigned> sCounter{0};
+  std::string temp = aPath + ".tmp." + std::to_string(getpid()) + "." +
+                     std::to_string(sCounter++);
+  {
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(aData.data(), aData.size()) || !file.flush()) {
+      std::remove(temp.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temp.c_str(), aPath.c_str()) != 0) {
+    std::remove(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace toy::driver
@@ -0,0 +1,596 @@
+#include "driver/include/Driver.hpp"
+
+#include "codegen/include/CodeGen.hpp"
+#include "driver/include/CompileCache.hpp"
+#include "driver/include/DiskCache.hpp"
+#include "driver/include/OutputCapture.hpp"
+#include "lexer/include/Lexer.hpp"
+#include "lexer/include/ThreadedLexer.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "opt/include/PassManager.hpp"
+#include "parser/include/Parser.hpp"
+#include "support/include/Profile.hpp"
+#include "support/include/Statistics.hpp"
+#include "support/include/ThreadPool.hpp"
+#include "support/include/Trace.hpp"
+#include "vm/include/Compiler.hpp"
+#include "vm/include/VM.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace toy::driver {
+
+const char *getStatusName(FileStatus aStatus) {
+  switch (aStatus) {
+  case FileStatus::Ok:
+    return "ok";
+  case FileStatus::ReadError:
+    return "cannot read file";
+  case FileStatus::ParseError:
+    return "parse failed";
+  case FileStatus::CompileError:
+    return "compilation failed";
+  case FileStatus::RuntimeError:
+    return "execution failed";
+  }
+  return "unknown";
+}
+
+std::string resolvePath(const std::string &aDir, const std::string &aPath) {
+  if (aDir.empty() || aPath.empty() || aPath[0] == '/') {
+    return aPath;
+  }
+  return aDir + "/" + aPath;
+}
+
+// read the next whitespace separated argument of a response file into aArg,
+// quotes keep whitespace and a backslash escapes the next character
+static bool readResponseArg(std::istream &aIs, std::string &aArg) {
+  aArg.clear();
+  aIs >> std::ws;
+  if (aIs.peek() == EOF) {
+    return false;
+  }
+  char quote = 0;
+  for (int c = aIs.get(); c != EOF; c = aIs.get()) {
+    if (c == '\\' && quote != '\'') {
+      c = aIs.get();
+      if (c == EOF) {
+        break;
+      }
+    } else if (quote && c == quote) {
+      quote = 0;
+      continue;
+    } else if (!quote && (c == '"' || c == '\'')) {
+      quote = c;
+      continue;
+    } else if (!quote && std::isspace(c)) {
+      break;
+    }
+    aArg += c;
+  }
+  return true;
+}
+
+// append the arguments of a response file, nested response files are expanded
+static bool readResponseFile(const std::string &aPath,
+                             const std::string &aDir,
+                             std::vector<std::string> &aArgs, int aDepth,
+                             std::ostream &aErr) {
+  std::ifstream file(resolvePath(aDir, aPath));
+  if (!file) {
+    aErr << "toy-compiler: cannot read response file '" << aPath << "'\n";
+    return false;
+  }
+  if (aDepth > 16) {
+    aErr << "toy-compiler: response files nested too deeply\n";
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  std::string arg;
+  while (readResponseArg(text, arg)) {
+    if (!arg.empty() && arg[0] == '@') {
+      if (!readResponseFile(arg.substr(1), aDir, aArgs, aDepth + 1, aErr)) {
+        return false;
+      }
+      continue;
+    }
+    aArgs.push_back(arg);
+  }
+  return true;
+}
+
+bool parseArgs(const std::vector<std::string> &aArgs, Options &aOptions,
+               std::ostream &aErr) {
+  std::vector<std::string> args;
+  for (auto &arg : aArgs) {
+    if (!arg.empty() && arg[0] == '@') {
+      if (!readResponseFile(arg.substr(1), aOptions.workingDir, args, 0, aErr)) {
+        return false;
+      }
+      continue;
+    }
+    args.push_back(arg);
+  }
+
+  for (size_t i = 0; i < args.size(); ++i) {
+    auto &arg = args[i];
+    if (arg == "-dump") {
+      aOptions.action = Action::Dump;
+    } else if (arg == "-opt") {
+      aOptions.action = Action::Optimize;
+    } else if (arg == "-bytecode") {
+      aOptions.action = Action::Bytecode;
+    } else if (arg == "-run") {
+      aOptions.action = Action::Run;
+    } else if (arg == "-emit-cpp") {
+      aOptions.action = Action::EmitCpp;
+    } else if (arg == "-native") {
+      aOptions.action = Action::Native;
+    } else if (arg == "-ftime-report") {
+      aOptions.timeReport = TimeReport::Table;
+    } else if (arg == "-ftime-report=json") {
+      aOptions.timeReport = TimeReport::Json;
+    } else if (arg == "-ftrack-allocations") {
+      aOptions.trackAllocations = true;
+    } else if (arg == "-fprofile-report") {
+      aOptions.profileReport = true;
+    } else if (arg.rfind("-fprofile-generate=", 0) == 0 ||
+               arg.rfind("-fprofile-use=", 0) == 0) {
+      auto value = arg.substr(arg.find('=') + 1);
+      if (value.empty()) {
+        aErr << "toy-compiler: " << arg << " expects a file\n";
+        return false;
+      }
+      bool generate = arg.rfind("-fprofile-generate=", 0) == 0;
+      (generate ? aOptions.profileGenerate : aOptions.profileUse) =
+          resolvePath(aOptions.workingDir, value);
+    } else if (arg == "-lexer-thread") {
+      aOptions.lexerThread = true;
+    } else if (arg == "-O0") {
+      aOptions.optimize = false;
+    } else if (arg == "-O1") {
+      aOptions.optimize = true;
+    } else if (arg == "-float32") {
+      aOptions.float32 = true;
+    } else if (arg.rfind("-j", 0) == 0) {
+      std::string count = arg.size() > 2 ? arg.substr(2) : "";
+      if (count.empty() && i + 1 < args.size()) {
+        count = args[++i];
+      }
+      if (count.empty() || count.size() > 6 ||
+          count.find_first_not_of("0123456789") != std::string::npos) {
+        aErr << "toy-compiler: -j expects a number of jobs\n";
+        return false;
+      }
+      aOptions.jobs = std::stoul(count);
+    } else if (arg == "-trace") {
+      if (i + 1 == args.size()) {
+        aErr << "toy-compiler: -trace expects a file\n";
+        return false;
+      }
+      aOptions.traceFile = resolvePath(aOptions.workingDir, args[++i]);
+    } else if (arg == "-cache-dir" || arg == "-cache-size") {
+      if (i + 1 == args.size()) {
+        aErr << "toy-compiler: " << arg << " expects a value\n";
+        return false;
+      }
+      auto &value = args[++i];
+      if (arg == "-cache-dir") {
+        aOptions.cacheDir = resolvePath(aOptions.workingDir, value);
+      } else if (value.empty() || value.size() > 12 ||
+                 value.find_first_not_of("0123456789") != std::string::npos) {
+        aErr << "toy-compiler: -cache-size expects a number of megabytes\n";
+        return false;
+      } else {
+        aOptions.cacheSize = std::stoull(value) << 20;
+      }
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      aErr << "toy-compiler: unknown option '" << arg << "'\n";
+      return false;
+    } else {
+      aOptions.inputs.push_back(arg);
+    }
+  }
+
+  if (aOptions.trackAllocations && aOptions.timeReport == TimeReport::None) {
+    aOptions.timeReport = TimeReport::Table;
+  }
+  if (aOptions.inputs.empty()) {
+    aErr << "toy-compiler: no input files\n";
+    return false;
+  }
+  return true;
+}
+
+void printUsage(std::ostream &aOs) {
+  aOs << "usage: toy-compiler [options] <file.toy | @response-file | ->...\n"
+      << "  -dump       print the AST\n"
+      << "  -opt        print the AST after optimization\n"
+      << "  -bytecode   print the bytecode\n"
+      << "  -run        run main on the VM (default)\n"
+      << "  -emit-cpp   print the generated C++\n"
+      << "  -native     build a native executable next to each input\n"
+      << "  -O0         disable optimizations\n"
+      << "  -O1         enable optimizations (default)\n"
+      << "  -float32    compute with float rather than double elements\n"
+      << "  -lexer-thread\n"
+      << "              lex each file on its own thread, ahead of the parser\n"
+      << "  -j N        process N files at a time, one per core by default\n"
+      << "  -ftime-report[=json]\n"
+      << "              print the time of every phase and some counters\n"
+      << "  -ftrack-allocations\n"
+      << "              count allocations by phase and AST node kind\n"
+      << "  -fprofile-generate=<file>\n"
+      << "              write the calls, time and bytes of every function,\n"
+      << "              call site and kernel run on the VM to file\n"
+      << "  -fprofile-report\n"
+      << "              print the hot spots of the programs run on the VM\n"
+      << "  -fprofile-use=<file>\n"
+      << "              inline by the profile of an earlier run\n"
+      << "  -trace <file>\n"
+      << "              write a chrome trace of the phases and kernels\n"
+      << "  -cache-dir <dir>\n"
+      << "              reuse the results of unchanged sources stored in dir\n"
+      << "  -cache-size <MB>\n"
+      << "              size limit of the cache directory, 256 by default\n"
+      << "\n"
+      << "       toy-compiler --server <socket> [-j N]\n"
+      << "  stay resident and serve requests on a Unix domain socket\n"
+      << "       toy-compiler --client <socket> [options] <file.toy>...\n"
+      << "  send the request to a server, --shutdown stops it\n";
+}
+
+// element type of the tensors of a program
+static runtime::ElementType getElementType(const Options &aOptions) {
+  return aOptions.float32 ? runtime::ElementType::Float32
+                          : runtime::ElementType::Float64;
+}
+
+// executable built for an input, the path without its extension
+static std::string getNativeOutput(const std::string &aPath) {
+  if (aPath == "-") {
+    return "a.out";
+  }
+  auto dot = aPath.rfind('.');
+  auto slash = aPath.rfind('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return aPath + ".out";
+  }
+  return aPath.substr(0, dot);
+}
+
+Driver::Driver(Options aOptions, CompileCache *aCache)
+    : fOptions(std::move(aOptions)), fCache(aCache),
+      fCollected(std::make_unique<support::Profile>()) {
+  if (!fOptions.cacheDir.empty()) {
+    fDiskCache = std::make_unique<DiskCache>(fOptions.cacheDir,
+                                             fOptions.cacheSize);
+  }
+  if (!fOptions.profileUse.empty()) {
+    fProfile = std::make_unique<support::Profile>();
+    if (!support::readProfile(fOptions.profileUse, *fProfile,
+                              fProfileError)) {
+      fProfile.reset();
+    }
+  }
+}
+
+bool Driver::isProfiling() const {
+  return !fOptions.profileGenerate.empty() || fOptions.profileReport;
+}
+
+Driver::~Driver() = default;
+
+FileResult Driver::processFile(const std::string &aPath) const {
+  TOY_TRACE_SCOPE("file", aPath);
+  // stdin is lexed as it arrives, it is never held in memory or cached
+  if (aPath == "-") {
+    return compile(aPath, nullptr);
+  }
+  std::ifstream file(resolvePath(fOptions.workingDir, aPath));
+  std::stringstream source;
+  if (!file || !(source << file.rdbuf())) {
+    return FileResult{"", FileStatus::ReadError};
+  }
+  return processSource(aPath, source.str());
+}
+
+// locations name the file, so a cached source is only reused for its path
+static std::string getCacheKey(const std::string &aPath,
+                               const std::string &aSource) {
+  std::string key = aPath;
+  key += '\0';
+  key += aSource;
+  return key;
+}
+
+FileResult Driver::processSource(const std::string &aPath,
+                                 const std::string &aSource) const {
+  // a native build writes a file and a profiled run must run, they are never
+  // skipped. the result of a profile guided build depends on the profile
+  bool cacheable = fCache && fOptions.action != Action::Native &&
+                   !isProfiling() && !fProfile;
+  auto key = cacheable ? getCacheKey(aPath, aSource) : std::string();
+  if (cacheable) {
+    if (auto result = fCache->getResult(key, fOptions.action,
+                                        fOptions.optimize, fOptions.float32)) {
+      return *result;
+    }
+  }
+  auto result = compileCached(aPath, aSource);
+  if (cacheable && result.cacheable) {
+    fCache->putResult(key, fOptions.action, fOptions.optimize,
+                      fOptions.float32, result);
+  }
+  return result;
+}
+
+FileResult Driver::compileCached(const std::string &aPath,
+                                 const std::string &aSource) const {
+  if (!fDiskCache || isProfiling() || fProfile) {
+    return compile(aPath, &aSource);
+  }
+  // the executable of a native build is the artifact of its entry
+  bool native = fOptions.action == Action::Native;
+  std::string output =
+      native ? getNativeOutput(resolvePath(fOptions.workingDir, aPath)) : "";
+  auto key = DiskCache::makeKey(aPath, aSource, fOptions.action,
+                                fOptions.optimize, fOptions.float32);
+  FileResult result;
+  std::string artifact;
+  if (fDiskCache->get(key, result, native ? &artifact : nullptr)) {
+    if (!native || result.status != FileStatus::Ok ||
+        (writeFileAtomic(output, artifact) &&
+         chmod(output.c_str(), 0755) == 0)) {
+      return result;
+    }
+  }
+
+  result = compile(aPath, &aSource);
+  if (!result.cacheable) {
+    return result;
+  }
+  artifact.clear();
+  if (native && result.status == FileStatus::Ok) {
+    std::ifstream file(output, std::ios::binary);
+    std::stringstream data;
+    if (!file || !(data << file.rdbuf())) {
+      return result;
+    }
+    artifact = data.str();
+  }
+  fDiskCache->put(key, result, artifact);
+  return result;
+}
+
+// resolve the paths of the tensor files aExpr loads against aDir, returns
+// the number of loads
+static int resolveLoads(Expr *aExpr, const std::string &aDir) {
+  if (auto *load = dynamic_cast<LoadExpr *>(aExpr)) {
+    load->getMutablePath() = resolvePath(aDir, load->getPath());
+    return 1;
+  }
+  int count = 0;
+  opt::forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    count += resolveLoads(aChild.get(), aDir);
+  });
+  return count;
+}
+
+FileResult Driver::compile(const std::string &aPath,
+                           const std::string *aSource) const {
+  std::stringstream out;
+  // the libraries report their errors on std::cout
+  std::stringstream diagnostics;
+  CaptureScope scope(diagnostics);
+  // a program loading tensor files gives a different result when they change
+  bool cacheable = true;
+  auto finish = [&](FileStatus aStatus) {
+    return FileResult{out.str(), aStatus, cacheable, diagnostics.str()};
+  };
+
+  std::unique_ptr<Module> module;
+  auto moduleKey =
+      fCache && aSource ? getCacheKey(aPath, *aSource) : std::string();
+  auto cached = fCache && aSource ? fCache->getModule(moduleKey) : nullptr;
+  if (cached) {
+    module = clone(*cached);
+  } else {
+    std::unique_ptr<lexer::AbstractLexer> lexer;
+    if (aSource) {
+      lexer = std::make_unique<lexer::Lexer>(std::stringstream(*aSource), 1,
+                                             aPath);
+    } else {
+      lexer = std::make_unique<lexer::Lexer>(STDIN_FILENO, "<stdin>");
+    }
+    if (fOptions.lexerThread) {
+      lexer = std::make_unique<lexer::ThreadedLexer>(std::move(lexer));
+    }
+    parser::Parser parser(std::move(lexer));
+    module = parser.parseModule();
+    if (!module) {
+      return finish(FileStatus::ParseError);
+    }
+    if (fCache && aSource) {
+      fCache->putModule(moduleKey, clone(*module));
+    }
+  }
+
+  if (fOptions.action == Action::Dump) {
+    dump(*module, out);
+    return finish(FileStatus::Ok);
+  }
+
+  for (auto &func : *module) {
+    for (auto &expr : *func->getBody()) {
+      if (resolveLoads(expr.get(), fOptions.workingDir)) {
+        cacheable = false;
+      }
+    }
+  }
+
+  opt::InlinerOptions inlinerOptions;
+  inlinerOptions.profile = fProfile.get();
+  if (fOptions.optimize &&
+      !opt::PassManager(fPool, inlinerOptions).run(*module)) {
+    return finish(FileStatus::CompileError);
+  }
+
+  switch (fOptions.action) {
+  case Action::Dump:
+  case Action::Optimize:
+    dump(*module, out);
+    return finish(FileStatus::Ok);
+
+  case Action::Bytecode:
+  case Action::Run: {
+    auto program = vm::Compiler(getElementType(fOptions)).compile(*module);
+    if (!program) {
+      return finish(FileStatus::CompileError);
+    }
+    if (fOptions.action == Action::Bytecode) {
+      program->dump(out);
+      return finish(FileStatus::Ok);
+    }
+    if (!isProfiling()) {
+      bool ok = vm::VM(*program, out, diagnostics).run();
+      return finish(ok ? FileStatus::Ok : FileStatus::RuntimeError);
+    }
+    vm::Profiler profiler(*program);
+    bool ok = vm::VM(*program, out, diagnostics, &profiler).run();
+    {
+      std::lock_guard<std::mutex> lock(fCollectedMutex);
+      fCollected->merge(profiler.getProfile());
+    }
+    return finish(ok ? FileStatus::Ok : FileStatus::RuntimeError);
+  }
+
+  case Action::EmitCpp:
+  case Action::Native: {
+    opt::ShapeInference shapes;
+    std::stringstream code;
+    codegen::CodeGen gen(getElementType(fOptions));
+    if (!shapes.run(*module) || !gen.emit(shapes, code, fPool)) {
+      return finish(FileStatus::CompileError);
+    }
+    if (fOptions.action == Action::EmitCpp) {
+      out << code.str();
+      return finish(FileStatus::Ok);
+    }
+    bool ok = codegen::compileNative(
+        code.str(), getNativeOutput(resolvePath(fOptions.workingDir, aPath)));
+    return finish(ok ? FileStatus::Ok : FileStatus::CompileError);
+  }
+  }
+  return finish(FileStatus::Ok);
+}
+
+int Driver::run(std::ostream &aOut, std::ostream &aErr,
+                support::ThreadPool *aPool) {
+  if (!fProfileError.empty()) {
+    aErr << "toy-compiler: " << fProfileError << "\n";
+    return 1;
+  }
+  if (fOptions.timeReport != TimeReport::None) {
+    support::setAllocationTracking(fOptions.trackAllocations);
+    support::resetReport();
+    support::setReportEnabled(true);
+  }
+  if (!fOptions.traceFile.empty()) {
+    support::startTrace();
+  }
+
+  auto &inputs = fOptions.inputs;
+  std::vector<FileResult> results(inputs.size());
+  std::vector<bool> done(inputs.size(), false);
+  std::mutex mutex;
+  std::condition_variable finished;
+
+  OutputCapture capture;
+  unsigned jobs = fOptions.jobs ? fOptions.jobs
+                                : std::max(1u, std::thread::hardware_concurrency());
+  // the pool also optimizes and emits the functions of a file concurrently,
+  // so a single input keeps every worker busy too
+  std::unique_ptr<support::ThreadPool> ownPool;
+  if (!aPool) {
+    ownPool = std::make_unique<support::ThreadPool>(jobs);
+    aPool = ownPool.get();
+  }
+  fPool = aPool;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    aPool->submit([&, i] {
+      FileResult result;
+      // a bug in one file fails that file, not the batch or the server
+      try {
+        result = processFile(inputs[i]);
+      } catch (const std::exception &aError) {
+        result = FileResult{"", FileStatus::CompileError, false,
+                            std::string("toy-compiler: internal error: ") +
+                                aError.what() + "\n"};
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      results[i] = std::move(result);
+      done[i] = true;
+      finished.notify_all();
+    });
+  }
+
+  // write each file as soon as the ones before it are written
+  int exitCode = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    FileResult result;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      finished.wait(lock, [&] { return done[i]; });
+      result = std::move(results[i]);
+    }
+    aOut << result.output;
+    aOut.flush();
+    aErr << result.diagnostics;
+    if (result.status != FileStatus::Ok) {
+      aErr << "toy-compiler: " << inputs[i] << ": "
+           << getStatusName(result.status) << "\n";
+      exitCode = 1;
+    }
+  }
+  if (fDiskCache) {
+    fDiskCache->trim();
+  }
+  if (!fOptions.traceFile.empty() && !support::writeTrace(fOptions.traceFile)) {
+    aErr << "toy-compiler: cannot write trace '" << fOptions.traceFile << "'\n";
+    exitCode = 1;
+  }
+  if (!fOptions.profileGenerate.empty() &&
+      !support::writeProfile(*fCollected, fOptions.profileGenerate)) {
+    aErr << "toy-compiler: cannot write profile '" << fOptions.profileGenerate
+         << "'\n";
+    exitCode = 1;
+  }
+  if (fOptions.profileReport) {
+    support::printProfile(*fCollected, aErr);
+  }
+  if (fOptions.timeReport != TimeReport::None) {
+    support::setReportEnabled(false);
+    support::setAllocationTracking(false);
+    if (fOptions.timeReport == TimeReport::Json) {
+      support::printReportJson(support::getReport(), aErr);
+    } else {
+      support::printReport(support::getReport(), aErr);
+    }
+  }
+  fPool = nullptr;
+  // every task is done with the locals once its result is taken
+  return exitCode;
+}
+
+} // namespace toy::driver
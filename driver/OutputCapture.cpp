@@ -0,0 +1,65 @@
+#include "driver/include/OutputCapture.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+
+namespace toy::driver {
+
+// buffer receiving the std::cout writes of this thread, if any
+static thread_local std::streambuf *tTarget = nullptr;
+
+namespace {
+
+// forwards to the buffer of the current thread, the original one outside a
+// scope
+class RoutingBuf : public std::streambuf {
+public:
+  std::streambuf *fFallback = nullptr;
+
+protected:
+  int overflow(int aChar) override {
+    if (aChar == traits_type::eof()) {
+      return traits_type::not_eof(aChar);
+    }
+    return getTarget()->sputc(traits_type::to_char_type(aChar));
+  }
+
+  std::streamsize xsputn(const char *aData, std::streamsize aCount) override {
+    return getTarget()->sputn(aData, aCount);
+  }
+
+  int sync() override { return getTarget()->pubsync(); }
+
+private:
+  std::streambuf *getTarget() const { return tTarget ? tTarget : fFallback; }
+};
+
+} // namespace
+
+static std::mutex sMutex;
+static RoutingBuf sBuf;
+static int sCaptures = 0;
+
+OutputCapture::OutputCapture() {
+  std::lock_guard<std::mutex> lock(sMutex);
+  if (sCaptures++ == 0) {
+    std::cout.flush();
+    sBuf.fFallback = std::cout.rdbuf(&sBuf);
+  }
+}
+
+OutputCapture::~OutputCapture() {
+  std::lock_guard<std::mutex> lock(sMutex);
+  if (--sCaptures == 0) {
+    std::cout.rdbuf(sBuf.fFallback);
+  }
+}
+
+CaptureScope::CaptureScope(std::ostream &aTarget) : fPrevious(tTarget) {
+  tTarget = aTarget.rdbuf();
+}
+
+CaptureScope::~CaptureScope() { tTarget = fPrevious; }
+
+} // namespace toy::driver
@@ -0,0 +1,249 @@
+#include "driver/include/Server.hpp"
+
+#include "driver/include/OutputCapture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace toy::driver {
+
+// a request is a working dir and a command line, a reply may hold the
+// output of a whole batch
+static constexpr uint32_t kMaxRequestFrame = 1u << 20;
+static constexpr uint32_t kMaxReplyFrame = 1u << 30;
+
+// a peer that went away is an error, not a SIGPIPE
+static bool writeAll(int aFd, const void *aData, size_t aSize) {
+  auto *data = static_cast<const char *>(aData);
+  while (aSize > 0) {
+    ssize_t written = ::send(aFd, data, aSize, MSG_NOSIGNAL);
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    aSize -= written;
+  }
+  return true;
+}
+
+static bool readAll(int aFd, void *aData, size_t aSize) {
+  auto *data = static_cast<char *>(aData);
+  while (aSize > 0) {
+    ssize_t count = ::read(aFd, data, aSize);
+    if (count <= 0) {
+      return false;
+    }
+    data += count;
+    aSize -= count;
+  }
+  return true;
+}
+
+// a frame is a 32 bit length followed by the bytes
+static bool writeFrame(int aFd, const std::string &aData) {
+  uint32_t size = aData.size();
+  return writeAll(aFd, &size, sizeof(size)) &&
+         writeAll(aFd, aData.data(), aData.size());
+}
+
+// false for a frame longer than aMaxSize
+static bool readFrame(int aFd, std::string &aData, uint32_t aMaxSize) {
+  uint32_t size;
+  if (!readAll(aFd, &size, sizeof(size)) || size > aMaxSize) {
+    return false;
+  }
+  aData.resize(size);
+  return readAll(aFd, aData.data(), size);
+}
+
+// a socket address for the path, false if the path is too long
+static bool getAddress(const std::string &aPath, sockaddr_un &aAddr) {
+  std::memset(&aAddr, 0, sizeof(aAddr));
+  aAddr.sun_family = AF_UNIX;
+  if (aPath.size() >= sizeof(aAddr.sun_path)) {
+    std::cerr << "toy-compiler: socket path '" << aPath << "' is too long\n";
+    return false;
+  }
+  std::strcpy(aAddr.sun_path, aPath.c_str());
+  return true;
+}
+
+Server::Server(std::string aSocketPath, unsigned aJobs)
+    : fSocketPath(std::move(aSocketPath)),
+      fPool(aJobs ? aJobs : std::thread::hardware_concurrency()) {}
+
+// true if a server accepts connections on the socket at aAddr
+static bool isListening(const sockaddr_un &aAddr) {
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return false;
+  }
+  bool connected = ::connect(fd, reinterpret_cast<const sockaddr *>(&aAddr),
+                             sizeof(aAddr)) == 0;
+  ::close(fd);
+  return connected;
+}
+
+bool Server::run() {
+  sockaddr_un addr;
+  if (!getAddress(fSocketPath, addr)) {
+    return false;
+  }
+  // only the socket file of a server that is gone is replaced
+  if (isListening(addr)) {
+    std::cerr << "toy-compiler: a server is already listening on '"
+              << fSocketPath << "'\n";
+    return false;
+  }
+  fListenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(fSocketPath.c_str());
+  if (fListenFd < 0 ||
+      ::bind(fListenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+          0 ||
+      ::listen(fListenFd, 64) < 0) {
+    std::cerr << "toy-compiler: cannot listen on '" << fSocketPath
+              << "': " << std::strerror(errno) << "\n";
+    if (fListenFd >= 0) {
+      ::close(fListenFd);
+    }
+    return false;
+  }
+
+  // requests run concurrently, their output is routed per thread
+  OutputCapture capture;
+  while (!fStopping) {
+    int fd = ::accept(fListenFd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    {
+      // further clients wait in the listen backlog
+      std::unique_lock<std::mutex> lock(fMutex);
+      fIdle.wait(lock, [this] { return fActive < kMaxConnections; });
+      ++fActive;
+    }
+    std::thread([this, fd] {
+      serve(fd);
+      std::lock_guard<std::mutex> lock(fMutex);
+      --fActive;
+      fIdle.notify_all();
+    }).detach();
+  }
+
+  // let the requests in flight finish
+  std::unique_lock<std::mutex> lock(fMutex);
+  fIdle.wait(lock, [this] { return fActive == 0; });
+  ::close(fListenFd);
+  ::unlink(fSocketPath.c_str());
+  return true;
+}
+
+void Server::serve(int aFd) {
+  // request: working dir, number of args, args
+  std::string workingDir, count;
+  std::vector<std::string> args;
+  bool ok = readFrame(aFd, workingDir, kMaxRequestFrame) &&
+            readFrame(aFd, count, kMaxRequestFrame) && !count.empty() &&
+            count.size() < 6 &&
+            count.find_first_not_of("0123456789") == std::string::npos;
+  for (size_t i = 0; ok && i < std::stoul(count); ++i) {
+    args.emplace_back();
+    ok = readFrame(aFd, args.back(), kMaxRequestFrame);
+  }
+  if (!ok) {
+    ::close(aFd);
+    return;
+  }
+
+  std::stringstream out, err;
+  int exitCode = 0;
+  // a failing request must not take the server down with it
+  try {
+    exitCode = handle(workingDir, args, out, err);
+  } catch (const std::exception &aError) {
+    err << "toy-compiler: internal error: " << aError.what() << "\n";
+    exitCode = 1;
+  }
+
+  // response: output, diagnostics, exit code
+  writeFrame(aFd, out.str()) && writeFrame(aFd, err.str()) &&
+      writeFrame(aFd, std::to_string(exitCode));
+  ::close(aFd);
+}
+
+int Server::handle(const std::string &aWorkingDir,
+                   const std::vector<std::string> &aArgs, std::ostream &aOut,
+                   std::ostream &aErr) {
+  if (aArgs.size() == 1 && aArgs[0] == "--shutdown") {
+    fStopping = true;
+    // wakes up the accept of the server loop
+    ::shutdown(fListenFd, SHUT_RDWR);
+    return 0;
+  }
+  Options options;
+  options.workingDir = aWorkingDir;
+  // diagnostics of the command line go back to the client
+  if (!parseArgs(aArgs, options, aErr)) {
+    printUsage(aErr);
+    return 1;
+  }
+  if (std::count(options.inputs.begin(), options.inputs.end(), "-")) {
+    // the stdin of the server is not the one of the client
+    aErr << "toy-compiler: stdin cannot be read through the server\n";
+    return 1;
+  }
+  return Driver(std::move(options), &fCache).run(aOut, aErr, &fPool);
+}
+
+int runClient(const std::string &aSocketPath,
+              const std::vector<std::string> &aArgs, std::ostream &aOut,
+              std::ostream &aErr) {
+  sockaddr_un addr;
+  if (!getAddress(aSocketPath, addr)) {
+    return 1;
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 ||
+      ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    aErr << "toy-compiler: cannot connect to '" << aSocketPath
+         << "': " << std::strerror(errno) << "\n";
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    return 1;
+  }
+
+  char cwd[4096];
+  std::string workingDir = ::getcwd(cwd, sizeof(cwd)) ? cwd : "";
+  bool ok = writeFrame(fd, workingDir) &&
+            writeFrame(fd, std::to_string(aArgs.size()));
+  for (size_t i = 0; ok && i < aArgs.size(); ++i) {
+    ok = writeFrame(fd, aArgs[i]);
+  }
+
+  std::string out, err, exitCode;
+  ok = ok && readFrame(fd, out, kMaxReplyFrame) &&
+       readFrame(fd, err, kMaxReplyFrame) &&
+       readFrame(fd, exitCode, kMaxRequestFrame) && !exitCode.empty() &&
+       exitCode.size() < 4 &&
+       exitCode.find_first_not_of("0123456789") == std::string::npos;
+  ::close(fd);
+  if (!ok) {
+    aErr << "toy-compiler: lost the connection to the server\n";
+    return 1;
+  }
+  aOut << out;
+  aErr << err;
+  return std::stoi(exitCode);
+}
+
+} // namespace toy::driver
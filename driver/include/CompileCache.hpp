@@ -0,0 +1,74 @@
+/*
+ *
+ * In memory cache of compilation results keyed by source content. The driver
+ * adds the path to the key, since locations name the file.
+ *
+ * The parsed module of a source is kept so a changed action skips lexing and
+ * parsing, and the result of every action is kept so an unchanged file is not
+ * processed again. Entries are evicted oldest first.
+ *
+ */
+
+#pragma once
+
+#include "driver/include/Driver.hpp"
+#include "parser/include/AST.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+
+namespace toy::driver {
+
+// 64 bit FNV-1a hash of the source
+uint64_t hashSource(const std::string &aSource);
+
+class CompileCache {
+public:
+  struct Stats {
+    size_t moduleHits = 0;
+    size_t resultHits = 0;
+    size_t misses = 0;
+  };
+
+  explicit CompileCache(size_t aMaxEntries = 4096) : fMaxEntries(aMaxEntries) {}
+
+  // the parsed module of the source, nullptr if it is not cached. the module
+  // is shared and must be cloned before it is changed
+  std::shared_ptr<Module> getModule(const std::string &aSource);
+  void putModule(const std::string &aSource, std::shared_ptr<Module> aModule);
+
+  std::optional<FileResult> getResult(const std::string &aSource,
+                                      Action aAction, bool aOptimize,
+                                      bool aFloat32);
+  void putResult(const std::string &aSource, Action aAction, bool aOptimize,
+                 bool aFloat32, const FileResult &aResult);
+
+  Stats getStats() const;
+
+private:
+  struct Entry {
+    std::string source;
+    std::shared_ptr<Module> module;
+    std::map<std::tuple<Action, bool, bool>, FileResult> results;
+  };
+
+  // entry of the source, nullptr if there is none
+  Entry *find(const std::string &aSource);
+  // entry of the source, created if needed
+  Entry &insert(const std::string &aSource);
+
+  size_t fMaxEntries;
+  mutable std::mutex fMutex;
+  std::unordered_map<uint64_t, Entry> fEntries;
+  // hashes in insertion order, for eviction
+  std::deque<uint64_t> fOrder;
+  Stats fStats;
+};
+
+} // namespace toy::driver
@@ -0,0 +1,80 @@
+/*
+ *
+ * Content addressed on-disk cache of compilation results.
+ *
+ * An entry is named by a hash of the path and source, the options and the
+ * build id of the compiler binary, so a hit costs a hash and a file read and
+ * a rebuilt compiler never sees results of an older one. The entry also
+ * stores what was hashed and a hit compares it, so a hash collision is a miss
+ * and never the result of another file. Entries are written to a
+ * temporary file and renamed into place, so concurrent compilers sharing the
+ * directory only ever read complete entries. Reading an entry refreshes its
+ * modification time and trim() removes the least recently used entries until
+ * the directory fits its size limit.
+ *
+ */
+
+#pragma once
+
+#include "driver/include/Driver.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace toy::driver {
+
+// GNU build id of the running compiler binary, identifies the code producing
+// results. falls back to the build time if the binary was linked without one
+const std::string &getCompilerId();
+
+class DiskCache {
+public:
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  // entries are kept below aDir, created if needed
+  DiskCache(std::string aDir, uint64_t aMaxBytes = 256ull << 20);
+
+  struct Key {
+    // hash naming the entry file
+    std::string name;
+    // everything the result depends on, compared on a hit
+    std::string material;
+  };
+
+  // key of the entry holding the result of aAction on the source of aPath.
+  // locations name the file, so the path is part of the key
+  static Key makeKey(const std::string &aPath, const std::string &aSource,
+                     Action aAction, bool aOptimize, bool aFloat32);
+
+  // the cached result, and the file the action produced in aArtifact if it is
+  // not nullptr. false if there is no readable entry
+  bool get(const Key &aKey, FileResult &aResult,
+           std::string *aArtifact = nullptr);
+  void put(const Key &aKey, const FileResult &aResult,
+           const std::string &aArtifact = "");
+
+  // remove the least recently used entries until the cache fits its limit
+  void trim();
+
+  const std::string &getDir() const { return fDir; }
+  Stats getStats() const { return {fHits, fMisses, fEvictions}; }
+
+private:
+  std::string getPath(const Key &aKey) const;
+
+  std::string fDir;
+  uint64_t fMaxBytes;
+  std::atomic<size_t> fHits{0};
+  std::atomic<size_t> fMisses{0};
+  std::atomic<size_t> fEvictions{0};
+};
+
+// write aData to aPath through a temporary file renamed into place
+bool writeFileAtomic(const std::string &aPath, const std::string &aData);
+
+} // namespace toy::driver
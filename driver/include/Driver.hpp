@@ -0,0 +1,159 @@
+/*
+ *
+ * The toy-compiler command line driver.
+ *
+ * Every input file goes through lex, parse and the requested action as one
+ * task on a thread pool. The output of each file is buffered and written in
+ * the order of the inputs, so it does not depend on the scheduling. What the
+ * program or action prints goes to the output stream, the diagnostics of the
+ * lexer, parser, passes and VM to the error stream.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace toy::support {
+struct Profile;
+class ThreadPool;
+} // namespace toy::support
+
+namespace toy::driver {
+
+enum class Action {
+  // print the AST
+  Dump,
+  // print the AST after optimization
+  Optimize,
+  // print the bytecode
+  Bytecode,
+  // execute main on the VM
+  Run,
+  // print the generated C++
+  EmitCpp,
+  // build a native executable next to the input
+  Native,
+};
+
+// format of the per phase timing report
+enum class TimeReport { None, Table, Json };
+
+struct Options {
+  std::vector<std::string> inputs;
+  Action action = Action::Run;
+  bool optimize = true;
+  // tensors hold float rather than double elements, in the VM and in the
+  // generated code
+  bool float32 = false;
+  // lex every file on a thread of its own, ahead of the parser
+  bool lexerThread = false;
+  // worker threads, 0 for one per core
+  unsigned jobs = 0;
+  // directory relative paths are resolved against, the current one if empty
+  std::string workingDir;
+  // directory of the on-disk result cache, no cache if empty
+  std::string cacheDir;
+  // size the on-disk cache is trimmed to after a run
+  uint64_t cacheSize = 256ull << 20;
+  // timing and counters of the run, printed to the error stream. they are
+  // recorded process wide, so a server reports its concurrent requests too
+  TimeReport timeReport = TimeReport::None;
+  // add the allocations of every phase and AST node kind to the report
+  bool trackAllocations = false;
+  // chrome trace of the run written to this file, no trace if empty
+  std::string traceFile;
+  // execution profile of the programs run on the VM written to this file, no
+  // profile if empty
+  std::string profileGenerate;
+  // print the hot spots of the programs run on the VM to the error stream
+  bool profileReport = false;
+  // profile of an earlier run guiding the optimizations, none if empty
+  std::string profileUse;
+};
+
+// outcome of one input file, in pipeline order
+enum class FileStatus { Ok, ReadError, ParseError, CompileError, RuntimeError };
+
+// text of the status for diagnostics
+const char *getStatusName(FileStatus aStatus);
+
+struct FileResult {
+  std::string output;
+  FileStatus status = FileStatus::Ok;
+  // false if the output depends on more than the source, e.g. a tensor file
+  bool cacheable = true;
+  // errors reported while processing the file
+  std::string diagnostics;
+};
+
+// parse the command line into aOptions, @file arguments are replaced by the
+// whitespace separated arguments of the file, where single or double quotes
+// keep an argument together and a backslash escapes the next character.
+// prints the error and returns false if the command line is invalid
+bool parseArgs(const std::vector<std::string> &aArgs, Options &aOptions,
+               std::ostream &aErr = std::cerr);
+
+// print the command line help
+void printUsage(std::ostream &aOs);
+
+// aPath relative to aDir unless it is absolute or aDir is empty
+std::string resolvePath(const std::string &aDir, const std::string &aPath);
+
+class CompileCache;
+class DiskCache;
+
+class Driver {
+public:
+  // results are looked up in and added to aCache if there is one
+  // the results are also looked up in and added to the on-disk cache of the
+  // options
+  explicit Driver(Options aOptions, CompileCache *aCache = nullptr);
+  ~Driver();
+
+  // process every input, write the outputs in input order to aOut and the
+  // diagnostics with a line per failed file to aErr. the files, and the
+  // functions within them, are processed on aPool, or on a pool of the
+  // configured size if there is none. returns the process exit code
+  int run(std::ostream &aOut, std::ostream &aErr,
+          support::ThreadPool *aPool = nullptr);
+
+  // process a single file, the errors the libraries print are captured in the
+  // diagnostics of the result when an OutputCapture is installed
+  FileResult processFile(const std::string &aPath) const;
+
+  // process source code as if read from aPath
+  FileResult processSource(const std::string &aPath,
+                           const std::string &aSource) const;
+
+private:
+  // run the pipeline on the source, streamed from stdin if it is nullptr
+  FileResult compile(const std::string &aPath,
+                     const std::string *aSource) const;
+
+  // run the pipeline, or reuse the result stored on disk
+  FileResult compileCached(const std::string &aPath,
+                           const std::string &aSource) const;
+
+  // true if the programs run on the VM are profiled
+  bool isProfiling() const;
+
+  Options fOptions;
+  CompileCache *fCache;
+  std::unique_ptr<DiskCache> fDiskCache;
+  // the profile read from Options::profileUse, and why it could not be read
+  std::unique_ptr<support::Profile> fProfile;
+  std::string fProfileError;
+  // profile of the programs run so far
+  std::unique_ptr<support::Profile> fCollected;
+  mutable std::mutex fCollectedMutex;
+  // the pool of the current run, nullptr outside of run()
+  support::ThreadPool *fPool = nullptr;
+};
+
+} // namespace toy::driver
@@ -0,0 +1,41 @@
+/*
+ *
+ * Per thread capture of std::cout.
+ *
+ * The compiler libraries report errors on std::cout. While an OutputCapture
+ * is alive, the writes of a thread inside a CaptureScope go to the stream of
+ * that scope, so files compiled concurrently never interleave their output.
+ *
+ */
+
+#pragma once
+
+#include <ostream>
+
+namespace toy::driver {
+
+// routes std::cout while it lives. captures may nest and overlap, std::cout
+// is restored when the last one ends
+class OutputCapture {
+public:
+  OutputCapture();
+  ~OutputCapture();
+
+  OutputCapture(const OutputCapture &) = delete;
+  OutputCapture &operator=(const OutputCapture &) = delete;
+};
+
+// send the std::cout writes of this thread to aTarget while it lives
+class CaptureScope {
+public:
+  explicit CaptureScope(std::ostream &aTarget);
+  ~CaptureScope();
+
+  CaptureScope(const CaptureScope &) = delete;
+  CaptureScope &operator=(const CaptureScope &) = delete;
+
+private:
+  std::streambuf *fPrevious;
+};
+
+} // namespace toy::driver
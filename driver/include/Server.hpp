@@ -0,0 +1,70 @@
+/*
+ *
+ * Resident compile server over a Unix domain socket.
+ *
+ * A client sends its working directory and command line, the server runs
+ * them through a Driver sharing one thread pool and one CompileCache across
+ * requests, and sends back the output, the diagnostics and the exit code.
+ * Every message is a list of length prefixed frames of bounded size. At most
+ * kMaxConnections requests are served at once, and a request that fails with
+ * an exception gets an error reply rather than ending the server.
+ *
+ * What stays warm is the pool and the cache of parsed modules and results.
+ * There is no symbol table to keep: AST names are strings owned by their
+ * nodes, and a cached module skips the lexing that would intern them.
+ *
+ */
+
+#pragma once
+
+#include "driver/include/CompileCache.hpp"
+#include "support/include/ThreadPool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace toy::driver {
+
+class Server {
+public:
+  // aJobs worker threads, 0 for one per core
+  Server(std::string aSocketPath, unsigned aJobs);
+
+  static constexpr int kMaxConnections = 64;
+
+  // serve requests until a client sends --shutdown, prints the error and
+  // returns false if the socket cannot be opened or another server listens
+  // on it
+  bool run();
+
+  const CompileCache &getCache() const { return fCache; }
+
+private:
+  // answer the request on the connection and close it
+  void serve(int aFd);
+  // run the command line aArgs of a client, returns the exit code
+  int handle(const std::string &aWorkingDir,
+             const std::vector<std::string> &aArgs, std::ostream &aOut,
+             std::ostream &aErr);
+
+  std::string fSocketPath;
+  support::ThreadPool fPool;
+  CompileCache fCache;
+  int fListenFd = -1;
+  std::atomic<bool> fStopping{false};
+  // connections being served
+  std::mutex fMutex;
+  std::condition_variable fIdle;
+  int fActive = 0;
+};
+
+// send the command line to the server at aSocketPath and write its answer,
+// returns the exit code of the request, or 1 if the server cannot be reached
+int runClient(const std::string &aSocketPath,
+              const std::vector<std::string> &aArgs, std::ostream &aOut,
+              std::ostream &aErr);
+
+} // namespace toy::driver
@@ -0,0 +1,102 @@
+#include "driver/include/DiskCache.hpp"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace toy::driver;
+
+static std::string makeDir(const std::string &aName) {
+  std::string dir = testing::TempDir() + aName;
+  std::filesystem::remove_all(dir);
+  return dir;
+}
+
+TEST(DiskCache, StoreAndLoad) {
+  DiskCache cache(makeDir("toy-disk-cache"));
+  const char *code = "def main() {}";
+  auto key = DiskCache::makeKey("a.toy", code, Action::Run, true, false);
+  auto name = [&](auto... aArgs) {
+    return DiskCache::makeKey(aArgs...).name;
+  };
+  EXPECT_EQ(key.name.size(), 32u);
+  EXPECT_NE(key.name, name("a.toy", code, Action::Run, false, false));
+  EXPECT_NE(key.name, name("a.toy", code, Action::Dump, true, false));
+  EXPECT_NE(key.name, name("a.toy", code, Action::Run, true, true));
+  EXPECT_NE(key.name, name("b.toy", code, Action::Run, true, false));
+  // the linker records a sha1 build id
+  EXPECT_EQ(getCompilerId().size(), 40u);
+
+  FileResult result;
+  EXPECT_FALSE(cache.get(key, result));
+  cache.put(key, FileResult{"out\n", FileStatus::RuntimeError}, "exe");
+
+  std::string artifact;
+  ASSERT_TRUE(cache.get(key, result, &artifact));
+  EXPECT_EQ(result.output, "out\n");
+  EXPECT_EQ(result.status, FileStatus::RuntimeError);
+  EXPECT_EQ(artifact, "exe");
+  EXPECT_EQ(cache.getStats().hits, 1u);
+  EXPECT_EQ(cache.getStats().misses, 1u);
+
+  // an entry of the same name for another source is not a hit
+  auto other = DiskCache::makeKey("a.toy", "def main() { print(1); }",
+                                  Action::Run, true, false);
+  other.name = key.name;
+  EXPECT_FALSE(cache.get(other, result));
+}
+
+TEST(DiskCache, EvictsLeastRecentlyUsed) {
+  // three entries of about 100 bytes do not fit in 250
+  DiskCache cache(makeDir("toy-disk-cache-lru"), 250);
+  std::string payload(80, 'x');
+  cache.put(DiskCache::Key{"aa0", "a"}, FileResult{payload, FileStatus::Ok});
+  cache.put(DiskCache::Key{"bb0", "b"}, FileResult{payload, FileStatus::Ok});
+  cache.put(DiskCache::Key{"cc0", "c"}, FileResult{payload, FileStatus::Ok});
+  // age the entries in order, then use the first so the second is the oldest
+  auto now = std::filesystem::file_time_type::clock::now();
+  int hours = 3;
+  for (auto *path : {"/aa/0", "/bb/0", "/cc/0"}) {
+    std::filesystem::last_write_time(cache.getDir() + path,
+                                     now - std::chrono::hours(hours--));
+  }
+  FileResult result;
+  ASSERT_TRUE(cache.get(DiskCache::Key{"aa0", "a"}, result));
+
+  cache.trim();
+  EXPECT_TRUE(cache.get(DiskCache::Key{"aa0", "a"}, result));
+  EXPECT_FALSE(cache.get(DiskCache::Key{"bb0", "b"}, result));
+  EXPECT_TRUE(cache.get(DiskCache::Key{"cc0", "c"}, result));
+  EXPECT_EQ(cache.getStats().evictions, 1u);
+}
+
+TEST(Driver, DiskCacheAcrossRuns) {
+  std::string dir = makeDir("toy-driver-cache");
+  Options options;
+  options.cacheDir = dir;
+  std::string source = "def main() {\n  print([1, 2] * [3, 4]);\n}\n";
+
+  auto first = Driver(options).processSource("cached.toy", source);
+  EXPECT_EQ(first.output, "[3, 8]\n");
+
+  // a new driver, as in a later build, finds the stored entry
+  Driver driver(options);
+  auto key = DiskCache::makeKey("cached.toy", source, Action::Run, true,
+                                false);
+  DiskCache cache(dir);
+  FileResult stored;
+  ASSERT_TRUE(cache.get(key, stored));
+  cache.put(key, FileResult{"from cache\n", FileStatus::Ok});
+  EXPECT_EQ(driver.processSource("cached.toy", source).output, "from cache\n");
+  EXPECT_EQ(driver.processSource("cached.toy", source + "\n").output,
+            "[3, 8]\n");
+
+  Options bad;
+  EXPECT_FALSE(parseArgs({"-cache-size", "big", "a.toy"}, bad));
+  Options parsed;
+  ASSERT_TRUE(parseArgs({"-cache-dir", "c", "-cache-size", "1", "a.toy"},
+                        parsed));
+  EXPECT_EQ(parsed.cacheDir, "c");
+  EXPECT_EQ(parsed.cacheSize, 1u << 20);
+}
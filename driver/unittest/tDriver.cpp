@@ -0,0 +1,318 @@
+#include "driver/include/CompileCache.hpp"
+#include "driver/include/Driver.hpp"
+#include "driver/include/OutputCapture.hpp"
+#include "runtime/include/TensorFile.hpp"
+#include "support/include/Profile.hpp"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace toy::driver;
+
+// utility to write a file in the test temp dir, returns its path
+static std::string writeFile(const std::string &aName,
+                             const std::string &aContent) {
+  std::string path = testing::TempDir() + aName;
+  std::ofstream(path) << aContent;
+  return path;
+}
+
+TEST(Driver, ParseArgs) {
+  auto first = writeFile("first.toy", "");
+  auto response = writeFile("inputs.rsp", first + "\n-j 3\n  second.toy\n");
+
+  Options options;
+  ASSERT_TRUE(parseArgs({"-opt", "@" + response, "-O0", "-float32"}, options));
+  EXPECT_EQ(options.action, Action::Optimize);
+  EXPECT_EQ(options.jobs, 3u);
+  EXPECT_FALSE(options.optimize);
+  EXPECT_TRUE(options.float32);
+  EXPECT_EQ(options.inputs, (std::vector<std::string>{first, "second.toy"}));
+
+  Options jobs;
+  ASSERT_TRUE(parseArgs({"-j8", "a.toy"}, jobs));
+  EXPECT_EQ(jobs.jobs, 8u);
+
+  // quotes keep whitespace, a backslash escapes the next character
+  auto quoted = writeFile("quoted.rsp", "\"my file.toy\" 'it\"s.toy' "
+                                        "it\\'s.toy \"\" -O1\n");
+  Options spaces;
+  ASSERT_TRUE(parseArgs({"@" + quoted}, spaces));
+  EXPECT_EQ(spaces.inputs, (std::vector<std::string>{
+                               "my file.toy", "it\"s.toy", "it's.toy", ""}));
+
+  Options bad;
+  EXPECT_FALSE(parseArgs({"-frobnicate", "a.toy"}, bad));
+  EXPECT_FALSE(parseArgs({"-j"}, bad));
+  EXPECT_FALSE(parseArgs({"@missing.rsp"}, bad));
+  EXPECT_FALSE(parseArgs({"-fprofile-use="}, bad));
+  std::stringstream err;
+  EXPECT_FALSE(parseArgs({"-j99999999999999999999", "a.toy"}, bad, err));
+  EXPECT_FALSE(
+      parseArgs({"-cache-size", "99999999999999999999", "a.toy"}, bad, err));
+
+  Options profile;
+  profile.workingDir = "/work";
+  ASSERT_TRUE(parseArgs({"-fprofile-generate=a.prof", "-fprofile-use=/b.prof",
+                         "-fprofile-report", "a.toy"},
+                        profile));
+  EXPECT_EQ(profile.profileGenerate, "/work/a.prof");
+  EXPECT_EQ(profile.profileUse, "/b.prof");
+  EXPECT_TRUE(profile.profileReport);
+}
+
+TEST(Driver, ProcessSource) {
+  Options options;
+  options.inputs = {"test.toy"};
+  Driver driver(options);
+  OutputCapture capture;
+
+  auto result = driver.processSource("test.toy", R"(
+    def main() {
+      var a = [1, 2];
+      print(a * a + 1);
+    }
+  )");
+  EXPECT_EQ(result.status, FileStatus::Ok);
+  EXPECT_EQ(result.output, "[2, 5]\n");
+
+  // errors of the libraries end up in the diagnostics of the result
+  result = driver.processSource("test.toy", R"(
+    def main() {
+      print([1, 2] + [1, 2, 3]);
+    }
+  )");
+  EXPECT_EQ(result.status, FileStatus::CompileError);
+  EXPECT_EQ(result.output, "");
+  EXPECT_NE(result.diagnostics.find("Shape error"), std::string::npos);
+
+  result = driver.processSource("test.toy", "def main( {");
+  EXPECT_EQ(result.status, FileStatus::ParseError);
+  EXPECT_NE(result.diagnostics.find("Parse error"), std::string::npos);
+
+  // a malformed literal is a parse error wherever it appears
+  result = driver.processSource("test.toy",
+                                "def main() { var a = [[1, 2], [3]]; }");
+  EXPECT_EQ(result.status, FileStatus::ParseError);
+
+  // the program output is kept apart from its runtime error
+  options.optimize = false;
+  result = Driver(options).processSource("test.toy", R"(
+    def main() {
+      var a = [1, 2];
+      print(a);
+      print(a + [1, 2, 3]);
+    }
+  )");
+  EXPECT_EQ(result.status, FileStatus::RuntimeError);
+  EXPECT_EQ(result.output, "[1, 2]\n");
+  EXPECT_NE(result.diagnostics.find("Runtime error"), std::string::npos);
+
+  EXPECT_EQ(driver.processFile("missing.toy").status, FileStatus::ReadError);
+}
+
+TEST(Driver, LocationsNameTheFile) {
+  CompileCache cache;
+  Options options;
+  options.action = Action::Dump;
+  Driver driver(options, &cache);
+  OutputCapture capture;
+
+  // the same source under two paths is cached apart
+  const char *code = "def main() { print(1); }";
+  auto first = driver.processSource("first.toy", code);
+  auto second = driver.processSource("second.toy", code);
+  EXPECT_NE(first.output.find("@first.toy:1:"), std::string::npos);
+  EXPECT_NE(second.output.find("@second.toy:1:"), std::string::npos);
+  EXPECT_EQ(second.output.find("first.toy"), std::string::npos);
+}
+
+TEST(Driver, LoadTensorFile) {
+  using toy::runtime::Tensor;
+  ASSERT_TRUE(toy::runtime::writeTensorFile(testing::TempDir() + "w.toyt",
+                                            Tensor({2, 2}, {1, 2, 3, 4})));
+  CompileCache cache;
+  Options options;
+  // relative to the working directory, as the inputs are
+  options.workingDir = testing::TempDir();
+  Driver driver(options, &cache);
+  OutputCapture capture;
+
+  const char *code = R"(
+    def main() {
+      var w<2, 2> = load("w.toyt");
+      print(w + transpose(w));
+    }
+  )";
+  auto result = driver.processSource("test.toy", code);
+  EXPECT_EQ(result.status, FileStatus::Ok);
+  EXPECT_EQ(result.output, "[[2, 5], [5, 8]]\n");
+  EXPECT_FALSE(result.cacheable);
+
+  // the same source sees the new contents of the file
+  ASSERT_TRUE(toy::runtime::writeTensorFile(testing::TempDir() + "w.toyt",
+                                            Tensor({2, 2}, {0, 0, 0, 1})));
+  result = driver.processSource("test.toy", code);
+  EXPECT_EQ(result.output, "[[0, 0], [0, 2]]\n");
+
+  // a declared shape must match the file exactly
+  result = driver.processSource("test.toy", R"(
+    def main() {
+      var w<4> = load("w.toyt");
+      print(w);
+    }
+  )");
+  EXPECT_EQ(result.status, FileStatus::CompileError);
+  EXPECT_NE(
+      result.diagnostics.find("declared shape <4> does not match <2,2>"),
+      std::string::npos);
+
+  result = driver.processSource("test.toy", R"(
+    def main() {
+      print(load("missing.toyt"));
+    }
+  )");
+  EXPECT_EQ(result.status, FileStatus::CompileError);
+  EXPECT_NE(result.diagnostics.find("cannot open"), std::string::npos);
+}
+
+TEST(Driver, Float32) {
+  using toy::runtime::Tensor;
+  ASSERT_TRUE(toy::runtime::writeTensorFile(testing::TempDir() + "f64.toyt",
+                                            Tensor({2}, {1, 2})));
+  CompileCache cache;
+  Options options;
+  options.workingDir = testing::TempDir();
+  Driver doubles(options, &cache);
+  options.float32 = true;
+  Driver floats(options, &cache);
+  OutputCapture capture;
+
+  // the results of the two element types are cached apart
+  const char *code = "def main() { print(0.1 + 0.2); }";
+  EXPECT_EQ(doubles.processSource("test.toy", code).output,
+            "0.30000000000000004\n");
+  EXPECT_EQ(floats.processSource("test.toy", code).output, "0.3\n");
+  EXPECT_EQ(cache.getStats().resultHits, 0u);
+
+  // a tensor file must hold the elements the program computes with
+  auto result = floats.processSource(
+      "test.toy", "def main() { print(load(\"f64.toyt\")); }");
+  EXPECT_EQ(result.status, FileStatus::CompileError);
+  EXPECT_NE(result.diagnostics.find("holds float64 elements, the program "
+                                    "uses float32"),
+            std::string::npos);
+}
+
+TEST(Driver, Profile) {
+  Options options;
+  options.inputs = {writeFile("profiled.toy", R"(
+    def square(x) {
+      return x * x;
+    }
+
+    def main() {
+      print(square([1, 2]));
+      print(square([3, 4]));
+    }
+  )")};
+  // unoptimized, so square is not inlined away
+  options.optimize = false;
+  options.profileGenerate = testing::TempDir() + "profiled.prof";
+  options.profileReport = true;
+  std::stringstream out, err;
+  ASSERT_EQ(Driver(options).run(out, err), 0);
+  EXPECT_EQ(out.str(), "[1, 4]\n[9, 16]\n");
+  EXPECT_NE(err.str().find("call site"), std::string::npos);
+
+  toy::support::Profile profile;
+  std::string error;
+  ASSERT_TRUE(toy::support::readProfile(options.profileGenerate, profile,
+                                        error));
+  EXPECT_EQ(profile.functions["square"].calls, 2u);
+  EXPECT_EQ(profile.kernels["Mul"].calls, 2u);
+
+  // the profile guides the next build
+  Options use;
+  use.inputs = options.inputs;
+  use.profileUse = options.profileGenerate;
+  out.str("");
+  EXPECT_EQ(Driver(use).run(out, err), 0);
+  EXPECT_EQ(out.str(), "[1, 4]\n[9, 16]\n");
+
+  use.profileUse = testing::TempDir() + "missing.prof";
+  err.str("");
+  EXPECT_EQ(Driver(use).run(out, err), 1);
+  EXPECT_NE(err.str().find("cannot open"), std::string::npos);
+}
+
+TEST(Driver, LexerThread) {
+  Options options;
+  options.lexerThread = true;
+  Driver driver(options);
+  OutputCapture capture;
+
+  auto result = driver.processSource("test.toy", R"(
+    def main() {
+      print([1, 2] * [3, 4]);
+    }
+  )");
+  EXPECT_EQ(result.status, FileStatus::Ok);
+  EXPECT_EQ(result.output, "[3, 8]\n");
+
+  // the parser gives up before the lexer reaches the end
+  result = driver.processSource("test.toy", "def main( {\n" +
+                                                std::string(10000, '+'));
+  EXPECT_EQ(result.status, FileStatus::ParseError);
+}
+
+TEST(Driver, TraceHasOneLexSpanPerFile) {
+  Options options;
+  std::string code = "def main() {\n";
+  for (int i = 0; i < 500; ++i) {
+    code += "  print(1);\n";
+  }
+  code += "}\n";
+  options.inputs = {writeFile("traced1.toy", code),
+                    writeFile("traced2.toy", code)};
+  options.lexerThread = true;
+  options.traceFile = testing::TempDir() + "lex-trace.json";
+  std::stringstream out, err;
+  ASSERT_EQ(Driver(options).run(out, err), 0);
+
+  std::ifstream file(options.traceFile);
+  std::string trace((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+  auto count = [&](const std::string &aText) {
+    size_t count = 0;
+    for (auto pos = trace.find(aText); pos != std::string::npos;
+         pos = trace.find(aText, pos + 1)) {
+      ++count;
+    }
+    return count;
+  };
+  // a begin and an end event for each file, whatever its number of tokens
+  EXPECT_EQ(count("\"lex\""), 4u);
+  EXPECT_NE(trace.find(options.inputs[1]), std::string::npos);
+}
+
+TEST(Driver, BatchOutputIsInInputOrder) {
+  Options options;
+  for (int i = 0; i < 32; ++i) {
+    options.inputs.push_back(writeFile(
+        "batch" + std::to_string(i) + ".toy",
+        "def main() { print(" + std::to_string(i) + "); }\n"));
+  }
+  options.inputs.push_back(writeFile("broken.toy", "def main() {\n"));
+  options.jobs = 4;
+
+  std::stringstream out, err;
+  EXPECT_EQ(Driver(options).run(out, err), 1);
+  std::string expected;
+  for (int i = 0; i < 32; ++i) {
+    expected += std::to_string(i) + "\n";
+  }
+  EXPECT_EQ(out.str().substr(0, expected.size()), expected);
+  EXPECT_NE(err.str().find("broken.toy: parse failed"), std::string::npos);
+}
@@ -0,0 +1,116 @@
+#include "driver/include/Server.hpp"
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace toy::driver;
+
+TEST(CompileCache, KeyedByContent) {
+  CompileCache cache(2);
+  EXPECT_EQ(cache.getModule("a"), nullptr);
+  cache.putModule("a", std::make_shared<toy::Module>(
+                           std::vector<std::unique_ptr<toy::Function>>()));
+  EXPECT_NE(cache.getModule("a"), nullptr);
+
+  cache.putResult("a", Action::Run, true, false,
+                  FileResult{"1\n", FileStatus::Ok});
+  EXPECT_EQ(cache.getResult("a", Action::Run, true, false)->output, "1\n");
+  EXPECT_FALSE(cache.getResult("a", Action::Run, false, false).has_value());
+  EXPECT_FALSE(cache.getResult("a", Action::Run, true, true).has_value());
+  EXPECT_FALSE(cache.getResult("b", Action::Run, true, false).has_value());
+
+  // the oldest source is evicted first
+  cache.putResult("b", Action::Dump, true, false, FileResult());
+  cache.putResult("c", Action::Dump, true, false, FileResult());
+  EXPECT_EQ(cache.getModule("a"), nullptr);
+  EXPECT_TRUE(cache.getResult("c", Action::Dump, true, false).has_value());
+
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.moduleHits, 1u);
+  EXPECT_EQ(stats.resultHits, 2u);
+}
+
+// utility to connect to the socket and send aData, returns the connection
+static int sendRaw(const std::string &aSocket, const std::string &aData) {
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, aSocket.c_str());
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+            0);
+  EXPECT_EQ(::write(fd, aData.data(), aData.size()), ssize_t(aData.size()));
+  return fd;
+}
+
+// utility to frame aData as the client does
+static std::string frame(const std::string &aData) {
+  uint32_t size = aData.size();
+  return std::string(reinterpret_cast<char *>(&size), sizeof(size)) + aData;
+}
+
+TEST(Server, WarmRequests) {
+  std::string dir = testing::TempDir();
+  std::string socket = dir + "toy-server-test.sock";
+  std::ofstream(dir + "server.toy")
+      << "def main() {\n  var a = [1, 2];\n  print(a * a);\n}\n";
+
+  Server server(socket, 2);
+  std::thread thread([&] { EXPECT_TRUE(server.run()); });
+
+  // wait for the socket to appear
+  std::stringstream out, err;
+  int status = 1;
+  for (int i = 0; i < 200 && status != 0; ++i) {
+    out.str("");
+    err.str("");
+    status = runClient(socket, {dir + "server.toy"}, out, err);
+    if (status != 0) {
+      usleep(10000);
+    }
+  }
+  EXPECT_EQ(status, 0) << err.str();
+  EXPECT_EQ(out.str(), "[1, 4]\n");
+
+  // the same content is answered from the cache
+  std::stringstream out2, err2;
+  EXPECT_EQ(runClient(socket, {dir + "server.toy"}, out2, err2), 0);
+  EXPECT_EQ(out2.str(), "[1, 4]\n");
+  EXPECT_EQ(server.getCache().getStats().resultHits, 1u);
+
+  // a new action reuses the parsed module
+  std::stringstream dump, err3;
+  EXPECT_EQ(runClient(socket, {"-dump", dir + "server.toy"}, dump, err3), 0);
+  EXPECT_NE(dump.str().find("Proto 'main'"), std::string::npos);
+  EXPECT_EQ(server.getCache().getStats().moduleHits, 1u);
+
+  // errors of the command line go back to the client
+  std::stringstream none, bad;
+  EXPECT_EQ(runClient(socket, {"-frobnicate"}, none, bad), 1);
+  EXPECT_NE(bad.str().find("unknown option"), std::string::npos);
+
+  // a second server leaves the socket of the running one alone
+  EXPECT_FALSE(Server(socket, 1).run());
+
+  // an oversized frame is refused, a client gone before the reply is not
+  // fatal
+  char reply;
+  int fd = sendRaw(socket, std::string(4, '\xff'));
+  EXPECT_EQ(::read(fd, &reply, 1), 0);
+  ::close(fd);
+  ::close(sendRaw(socket, frame(dir) + frame("1") + frame(dir + "server.toy")));
+
+  std::stringstream out4, err4;
+  EXPECT_EQ(runClient(socket, {dir + "server.toy"}, out4, err4), 0);
+  EXPECT_EQ(out4.str(), "[1, 4]\n");
+
+  std::stringstream ignored;
+  EXPECT_EQ(runClient(socket, {"--shutdown"}, ignored, ignored), 0);
+  thread.join();
+}
@@ -1,37 +1,62 @@
 #include "lexer/include/Lexer.hpp"
+#include "support/include/Statistics.hpp"
 #include <cctype>
+#include <cerrno>
 #include <cstdio>
-#include <fstream>
+#include <fcntl.h>
 #include <iostream>
 #include <cassert>
+#include <unistd.h>
 
 namespace toy::lexer {
 
 Lexer::Lexer(const std::string &aFileName) : fCurrToken(Token::tok_sof) {
-  fFileName = std::make_shared<std::string>(std::move(aFileName));
+  fFileName = std::make_shared<std::string>(aFileName);
   fCurrLocation.file = fFileName;
-  // read file contents
-  std::ifstream code_file(aFileName);
-  if (!code_file.is_open()) {
+  // the file is streamed like any other descriptor
+  fFd = open(aFileName.c_str(), O_RDONLY);
+  if (fFd < 0) {
     std::cerr << "Invalid input file : " << aFileName << "." << std::endl;
   }
-  // store contents of file into a stream
-  fStream << code_file.rdbuf();
-  getNextLine();
+  fOwnsFd = fFd >= 0;
+  fBuffer.resize(kDefaultBufferSize);
 }
 
-Lexer::Lexer(std::stringstream aStrStream) : fCurrToken(Token::tok_sof) {
-  fFileName = std::make_shared<std::string>("buffer");
+Lexer::Lexer(int aFd, const std::string &aName, size_t aBufferSize)
+    : fFd(aFd), fCurrToken(Token::tok_sof) {
+  fFileName = std::make_shared<std::string>(aName);
   fCurrLocation.file = fFileName;
-  fStream << aStrStream.rdbuf();
-  getNextLine();
+  fBuffer.resize(aBufferSize ? aBufferSize : 1);
+}
+
+Lexer::Lexer(std::stringstream aStrStream, int aFirstLine,
+             const std::string &aName)
+    : fCurrToken(Token::tok_sof), fCurrLine(aFirstLine - 1) {
+  fFileName = std::make_shared<std::string>(aName);
+  fCurrLocation.file = fFileName;
+  fBuffer = aStrStream.str();
+  fEnd = fBuffer.size();
 }
 
 // return the current token in the stream
 Token Lexer::getCurrentToken() { return fCurrToken; }
 
 // move to the next token in the stream and return it
-Token Lexer::getNextToken() { return fCurrToken = getToken(); }
+Token Lexer::getNextToken() {
+  fCurrToken = getToken();
+  ++fNumTokens;
+  if (fCurrToken == Token::tok_eof) {
+    flushTokenCount();
+  }
+  return fCurrToken;
+}
+
+void Lexer::flushTokenCount() {
+  if (fNumTokens) {
+    support::addCount("tokens", fNumTokens);
+    fNumTokens = 0;
+  }
+}
 
 // return the literal for the current token
 std::string Lexer::getLiteral() {
@@ -41,10 +66,7 @@ std::string Lexer::getLiteral() {
 }
 
 // return the start location of the current token
-Location Lexer::getCurrentLocation() {
-  auto loc = Location();
-  return loc;
-}
+Location Lexer::getCurrentLocation() { return fCurrLocation; }
 
 void Lexer::consume(Token aTok) {
   assert(aTok == fCurrToken && "consume Token mismatch");
@@ -53,10 +75,13 @@ void Lexer::consume(Token aTok) {
 
 Token Lexer::getToken() {
   // skip whitespace and end of lines
-  while (isspace(fCurrChar) || ((fCurrChar == EOF) && !fStream.eof())) {
+  while (isspace(fCurrChar)) {
     fCurrChar = getNextChar();
   }
 
+  // drop the literal of the previous token, even if it was never read
+  fCurrLiteral.clear();
+
   // get the location of the current token start
   fCurrLocation.line = fCurrLine;
   fCurrLocation.col = fCurrCol;
@@ -113,19 +138,29 @@ Token Lexer::getToken() {
     return Token::tok_number;
   }
 
+  // check for string "..." on a single line, without escapes
+  if (fCurrChar == '"') {
+    while ((fCurrChar = getNextChar()) != '"') {
+      if (fCurrChar == EOF || fCurrChar == '\n') {
+        // unterminated, the parser reports the stray quote
+        fCurrLiteral.clear();
+        return Token('"');
+      }
+      fCurrLiteral += (char)fCurrChar;
+    }
+    fCurrChar = getNextChar();
+    return Token::tok_string;
+  }
+
   // check for comment #
   if (fCurrChar == '#') {
     // comment lasts until end of line
-    auto currLine = fCurrLine;
-    while (((fCurrChar = getNextChar()) != EOF) && !fStream.eof() &&
-           !fLineStream.eof() && (currLine == fCurrLine)) {
+    while ((fCurrChar = getNextChar()) != EOF && fCurrChar != '\n') {
       // do nothing
     }
 
     // do over
-    // if (fCurrChar != EOF) {
     return getToken();
-    // }
   }
 
   // check for EOF
@@ -145,32 +180,50 @@ Token Lexer::getToken() {
   return ch;
 }
 
-void Lexer::getNextLine() {
-  if (!fStream.eof()) {
-    ++fCurrLine;
-    std::string line;
-    std::getline(fStream, line);
-    fLineStream.clear();
-    fLineStream.str("");
-    fLineStream << line;
-  } else {
-    fLineStream << "";
+bool Lexer::refill() {
+  if (fFd < 0) {
+    return false;
   }
+  ssize_t count;
+  do {
+    count = read(fFd, &fBuffer[0], fBuffer.size());
+  } while (count < 0 && errno == EINTR);
+  if (count <= 0) {
+    // a read error ends the source like its end does
+    if (fOwnsFd) {
+      close(fFd);
+    }
+    fFd = -1;
+    return false;
+  }
+  fPos = 0;
+  fEnd = count;
+  return true;
 }
 
 int Lexer::getNextChar() {
-  // check if stream is empty
-  if (fLineStream.eof()) {
+  if (fAtLineStart) {
+    ++fCurrLine;
+    fCurrCol = 0;
+    fAtLineStart = false;
+  }
+  if (fPos == fEnd && !refill()) {
     return EOF;
   }
   ++fCurrCol;
-  auto nextChar = fLineStream.get();
-  if (fLineStream.eof()) {
-    getNextLine();
+  unsigned char nextChar = fBuffer[fPos++];
+  if (nextChar == '\n') {
+    fAtLineStart = true;
   }
   return nextChar;
 }
 
-Lexer::~Lexer() {}
+Lexer::~Lexer() {
+  // the parser may give up before the end of the source
+  flushTokenCount();
+  if (fOwnsFd && fFd >= 0) {
+    close(fFd);
+  }
+}
 
 }; // namespace toy::lexer
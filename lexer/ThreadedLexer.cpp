@@ -0,0 +1,73 @@
+#include "lexer/include/ThreadedLexer.hpp"
+#include "support/include/Statistics.hpp"
+
+#include <cassert>
+
+namespace toy::lexer {
+
+// spin a little before giving up the core, a token is usually close
+static void backoff(unsigned &aSpins) {
+  if (++aSpins > 64) {
+    std::this_thread::yield();
+  }
+}
+
+ThreadedLexer::ThreadedLexer(std::unique_ptr<AbstractLexer> aLexer,
+                             size_t aCapacity)
+    : fLexer(std::move(aLexer)), fRing(aCapacity) {
+  fCurrent.location = fLexer->getCurrentLocation();
+  fThread = std::thread([this] { produce(); });
+}
+
+void ThreadedLexer::produce() {
+  // the whole source is one lexing phase of this thread
+  auto file = fLexer->getCurrentLocation().file;
+  support::PhaseScope scope("lex", file ? *file : std::string());
+  Token tok;
+  do {
+    tok = fLexer->getNextToken();
+    Item item{tok, fLexer->getLiteral(), fLexer->getCurrentLocation()};
+    unsigned spins = 0;
+    while (!fRing.tryPush(item)) {
+      if (fStop.load(std::memory_order_relaxed)) {
+        return;
+      }
+      backoff(spins);
+    }
+  } while (tok != Token::tok_eof);
+}
+
+Token ThreadedLexer::getCurrentToken() { return fCurrent.tok; }
+
+Token ThreadedLexer::getNextToken() {
+  // the end of the source stays the current token
+  if (fCurrent.tok == Token::tok_eof) {
+    return fCurrent.tok;
+  }
+  unsigned spins = 0;
+  while (!fRing.tryPop(fCurrent)) {
+    backoff(spins);
+  }
+  return fCurrent.tok;
+}
+
+std::string ThreadedLexer::getLiteral() {
+  // the literal is read once, as with Lexer
+  std::string literal = std::move(fCurrent.literal);
+  fCurrent.literal.clear();
+  return literal;
+}
+
+Location ThreadedLexer::getCurrentLocation() { return fCurrent.location; }
+
+void ThreadedLexer::consume(Token aTok) {
+  assert(aTok == fCurrent.tok && "consume Token mismatch");
+  getNextToken();
+}
+
+ThreadedLexer::~ThreadedLexer() {
+  fStop = true;
+  fThread.join();
+}
+
+} // namespace toy::lexer
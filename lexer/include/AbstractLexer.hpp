@@ -47,6 +47,8 @@ enum Token : int {
   tok_sof = -7,
   tok_print = -8,
   tok_transpose = -9,
+  // a "quoted" string, the literal holds the text between the quotes
+  tok_string = -10,
 };
 
 struct TokWithLieral {
@@ -3,11 +3,17 @@
  * A simple handcoded lexer for the toy language described in
  * https://mlir.llvm.org/docs/Tutorials/Toy/Ch-1/
  *
+ * Files and file descriptors are read through a fixed size buffer refilled
+ * as the tokens are consumed, so a source of any size, such as a pipe, is
+ * lexed in constant memory. Tokens straddling two reads are assembled one
+ * character at a time like any other.
+ *
  * */
 
 #pragma once
 
 #include "lexer/include/AbstractLexer.hpp"
+#include <cstdint>
 #include <sstream>
 
 namespace toy::lexer {
@@ -18,10 +24,18 @@ public:
   // provide source code file name
   Lexer(const std::string &aFileName);
 
+  // read the source from aFd until end of file, such as stdin or a pipe. the
+  // descriptor is not closed, aName is the file of the locations
+  Lexer(int aFd, const std::string &aName,
+        size_t aBufferSize = kDefaultBufferSize);
+
   // provide a string stream that contains source code
   // the steam is passed by value as we need out own copy
   // the assumption here is that the code is not large
-  Lexer(std::stringstream aStrStream);
+  // aFirstLine is the line number of the first line of the stream, for code
+  // cut out of a larger source, and aName is the file of the locations
+  Lexer(std::stringstream aStrStream, int aFirstLine = 1,
+        const std::string &aName = "buffer");
 
   // return the current token in the stream
   Token getCurrentToken() override;
@@ -39,20 +53,30 @@ public:
 
   ~Lexer() override;
 
+  static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
 private:
   // get the next token
   Token getToken();
-  // get the next line
-  void getNextLine();
+  // read the next chunk of a descriptor into the buffer, false at its end
+  bool refill();
   // get next char from the buffer
   int getNextChar();
+  // add the tokens lexed so far to the "tokens" counter, once per source
+  // rather than once per token
+  void flushTokenCount();
 
   // source code file name
   std::shared_ptr<std::string> fFileName;
-  // the string stream that contains the code
-  std::stringstream fStream;
-  // current line in the stream
-  std::stringstream fLineStream;
+  // descriptor read from, -1 once it is done or for in memory code
+  int fFd = -1;
+  bool fOwnsFd = false;
+  // the code, all of it or the part of the descriptor read last
+  std::string fBuffer;
+  size_t fPos = 0;
+  size_t fEnd = 0;
+  // the next char starts a line
+  bool fAtLineStart = true;
   // the current token
   Token fCurrToken;
   // current line
@@ -65,5 +89,7 @@ private:
   Location fCurrLocation;
   // current literal string
   std::string fCurrLiteral = "";
+  // tokens not yet added to the counter
+  uint64_t fNumTokens = 0;
 };
 }; // namespace toy::lexer
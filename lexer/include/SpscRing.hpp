@@ -0,0 +1,77 @@
+/*
+ *
+ * Bounded lock free ring buffer for one producer and one consumer thread.
+ *
+ * The producer owns the tail and the consumer the head, each published with
+ * a release store and read with an acquire load by the other side. Both keep
+ * a cached copy of the other index, so the shared cache lines are only read
+ * when the ring looks full or empty.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace toy::lexer {
+
+template <typename T> class SpscRing {
+public:
+  // the capacity is rounded up to a power of two
+  explicit SpscRing(size_t aCapacity) {
+    size_t capacity = 2;
+    while (capacity < aCapacity) {
+      capacity *= 2;
+    }
+    fSlots.resize(capacity);
+    fMask = capacity - 1;
+  }
+
+  size_t getCapacity() const { return fSlots.size(); }
+
+  // move aItem into the ring, false if it is full. producer only
+  bool tryPush(T &aItem) {
+    size_t tail = fTail.load(std::memory_order_relaxed);
+    if (tail - fCachedHead == fSlots.size()) {
+      fCachedHead = fHead.load(std::memory_order_acquire);
+      if (tail - fCachedHead == fSlots.size()) {
+        return false;
+      }
+    }
+    fSlots[tail & fMask] = std::move(aItem);
+    fTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // move the oldest item into aItem, false if the ring is empty. consumer
+  // only
+  bool tryPop(T &aItem) {
+    size_t head = fHead.load(std::memory_order_relaxed);
+    if (head == fCachedTail) {
+      fCachedTail = fTail.load(std::memory_order_acquire);
+      if (head == fCachedTail) {
+        return false;
+      }
+    }
+    aItem = std::move(fSlots[head & fMask]);
+    fHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> fSlots;
+  size_t fMask;
+  // next slot to pop, written by the consumer
+  alignas(64) std::atomic<size_t> fHead{0};
+  // tail as last seen by the consumer
+  size_t fCachedTail = 0;
+  // next slot to push, written by the producer
+  alignas(64) std::atomic<size_t> fTail{0};
+  // head as last seen by the producer
+  size_t fCachedHead = 0;
+};
+
+} // namespace toy::lexer
@@ -0,0 +1,62 @@
+/*
+ *
+ * A lexer running on its own thread, ahead of the parser.
+ *
+ * The wrapped lexer is driven by a producer thread that pushes every token,
+ * with its literal and location, into a bounded ring the parser pops from.
+ * Lexing overlaps with building the AST, and the ring keeps the number of
+ * tokens in flight, and so the memory, bounded whatever the size of the
+ * source.
+ *
+ */
+
+#pragma once
+
+#include "lexer/include/AbstractLexer.hpp"
+#include "lexer/include/SpscRing.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace toy::lexer {
+
+class ThreadedLexer : public AbstractLexer {
+public:
+  // start lexing aLexer on a new thread, at most aCapacity tokens ahead of
+  // the consumer
+  explicit ThreadedLexer(std::unique_ptr<AbstractLexer> aLexer,
+                         size_t aCapacity = 1024);
+
+  Token getCurrentToken() override;
+
+  Token getNextToken() override;
+
+  std::string getLiteral() override;
+
+  Location getCurrentLocation() override;
+
+  void consume(Token aTok) override;
+
+  // stops the producer if the parser gave up before the end of the source
+  ~ThreadedLexer() override;
+
+private:
+  struct Item {
+    Token tok = Token::tok_sof;
+    std::string literal;
+    Location location;
+  };
+
+  // body of the producer thread
+  void produce();
+
+  std::unique_ptr<AbstractLexer> fLexer;
+  SpscRing<Item> fRing;
+  // the token the parser is at
+  Item fCurrent;
+  std::atomic<bool> fStop{false};
+  std::thread fThread;
+};
+
+} // namespace toy::lexer
@@ -43,6 +43,8 @@ inline std::string tokToString(const Token &tok) {
     return "tok_identifier";
   case Token::tok_number:
     return "tok_number";
+  case Token::tok_string:
+    return "tok_string";
   case Token::tok_plus:
     return "tok_plus";
   case Token::tok_minus:
@@ -67,14 +69,15 @@ inline std::string tokToString(const Token &tok) {
 }
 
 // utility to get tokens from the leer
-inline std::vector<TokType> getToksFromLexer(Lexer &aLexer) {
+inline std::vector<TokType> getToksFromLexer(AbstractLexer &aLexer) {
   Token tok;
   std::string literal;
 
   std::vector<TokType> actual_toks;
 
   while ((tok = aLexer.getNextToken()) != Token::tok_eof) {
-    if (tok == Token::tok_identifier || tok == Token::tok_number) {
+    if (tok == Token::tok_identifier || tok == Token::tok_number ||
+        tok == Token::tok_string) {
       literal = aLexer.getLiteral();
       actual_toks.push_back(TokWithLieral{tok, literal});
     } else {
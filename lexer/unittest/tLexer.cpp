@@ -2,6 +2,9 @@
 #include "lexer/include/Lexer.hpp"
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <unistd.h>
+
 using namespace toy::lexer;
 
 TEST(Lexer, SimpleMain) {
@@ -140,4 +143,55 @@ TEST(Lexer, Comment) {
 
   // check if equal
   EXPECT_TRUE(areToksEqual(actual_toks, expected_toks));
-}
\ No newline at end of file
+}
+TEST(Lexer, StreamsFromDescriptor) {
+  std::string code;
+  for (int i = 0; i < 500; ++i) {
+    code += "var identifier_" + std::to_string(i) + " = 12345.678; # note\n";
+  }
+  // no newline at the end, the last token is still lexed
+  code += "print(last)";
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  std::thread writer([&] {
+    // small writes so reads end in the middle of tokens
+    for (size_t i = 0; i < code.size(); i += 7) {
+      auto size = std::min<size_t>(7, code.size() - i);
+      ASSERT_EQ(write(fds[1], code.data() + i, size), ssize_t(size));
+    }
+    close(fds[1]);
+  });
+
+  Lexer expected{std::stringstream(code)};
+  // a buffer smaller than most tokens
+  Lexer streamed(fds[0], "<pipe>", 5);
+  auto tokens = getToksFromLexer(streamed);
+  writer.join();
+  close(fds[0]);
+
+  EXPECT_TRUE(areToksEqual(tokens, getToksFromLexer(expected)));
+  ASSERT_EQ(tokens.size(), 500u * 5 + 4);
+  EXPECT_TRUE(areToksEqual({tokens.back()}, {Token::tok_paren_close}));
+  EXPECT_EQ(streamed.getCurrentLocation().line, 501);
+  EXPECT_EQ(*streamed.getCurrentLocation().file, "<pipe>");
+}
+
+TEST(Lexer, String) {
+  Lexer lex{std::stringstream("var w = load(\"weights/w 1.bin\");\n\"open\n;")};
+
+  std::vector<TokType> expected_toks = {
+      Token::tok_var,
+      TokWithLieral{Token::tok_identifier, "w"},
+      Token::tok_equals,
+      TokWithLieral{Token::tok_identifier, "load"},
+      Token::tok_paren_open,
+      TokWithLieral{Token::tok_string, "weights/w 1.bin"},
+      Token::tok_paren_close,
+      Token::tok_semicolon,
+      // a string never spans lines
+      Token('"'),
+      Token::tok_semicolon};
+
+  EXPECT_TRUE(areToksEqual(getToksFromLexer(lex), expected_toks));
+}
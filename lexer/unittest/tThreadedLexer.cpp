@@ -0,0 +1,73 @@
+#include "LexerTestHelper.hpp"
+#include "lexer/include/SpscRing.hpp"
+#include "lexer/include/ThreadedLexer.hpp"
+#include "support/include/Statistics.hpp"
+#include <gtest/gtest.h>
+
+#include <thread>
+
+TEST(SpscRing, PassesItemsInOrder) {
+  SpscRing<int> ring(3);
+  EXPECT_EQ(ring.getCapacity(), 4u);
+
+  const int count = 100000;
+  std::thread producer([&] {
+    for (int i = 0; i < count; ++i) {
+      int item = i;
+      while (!ring.tryPush(item)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int item = -1;
+  for (int i = 0; i < count; ++i) {
+    while (!ring.tryPop(item)) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(item, i);
+  }
+  producer.join();
+  EXPECT_FALSE(ring.tryPop(item));
+}
+
+TEST(ThreadedLexer, SameTokensAsLexer) {
+  std::string code;
+  for (int i = 0; i < 200; ++i) {
+    code += "def f" + std::to_string(i) + "(a) {\n  # comment\n"
+            "  var b<2, 2> = [[1, 2.5], [3, 4]];\n  return a * b;\n}\n";
+  }
+
+  Lexer lexer{std::stringstream(code)};
+  auto expected = getToksFromLexer(lexer);
+  // a small ring makes the producer wait on the consumer
+  ThreadedLexer threaded(std::make_unique<Lexer>(std::stringstream(code)), 4);
+  EXPECT_TRUE(areToksEqual(getToksFromLexer(threaded), expected));
+  EXPECT_EQ(threaded.getNextToken(), Token::tok_eof);
+  EXPECT_EQ(threaded.getCurrentLocation().line, 1001);
+}
+
+TEST(ThreadedLexer, StopsWhenAbandoned) {
+  std::string code(100000, '+');
+  ThreadedLexer threaded(std::make_unique<Lexer>(std::stringstream(code)), 8);
+  EXPECT_EQ(threaded.getNextToken(), Token::tok_plus);
+  EXPECT_EQ(threaded.getCurrentLocation().col, 1);
+  // the destructor stops the producer blocked on the full ring
+}
+
+TEST(ThreadedLexer, OnePhasePerSource) {
+  std::string code = "def main() { print([1, 2] * 3); }";
+  toy::support::resetReport();
+  toy::support::setReportEnabled(true);
+  {
+    Lexer lexer{std::stringstream(code)};
+    getToksFromLexer(lexer);
+    ThreadedLexer threaded(std::make_unique<Lexer>(std::stringstream(code)));
+    getToksFromLexer(threaded);
+  }
+  toy::support::setReportEnabled(false);
+
+  // the lexer on the calling thread is timed by its caller
+  auto report = toy::support::getReport();
+  EXPECT_EQ(report.phases["lex"].calls, 1u);
+  EXPECT_EQ(report.counters["tokens"], 2 * 18u);
+}
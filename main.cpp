@@ -1,9 +1,40 @@
-#include "lexer/include/Lexer.hpp"
+#include "driver/include/Driver.hpp"
+#include "driver/include/Server.hpp"
 #include <iostream>
 
 int main(int argc, char *argv[]) {
-  std::stringstream code("return");
-  toy::lexer::Lexer lex(std::move(code));
-  std::cout << lex.getNextToken() << " : " << lex.getLiteral() << std::endl;
-  return 0;
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (args.empty() || args[0] == "-h" || args[0] == "--help") {
+    toy::driver::printUsage(args.empty() ? std::cerr : std::cout);
+    return args.empty();
+  }
+
+  // toy-compiler --server <socket> [-j N]
+  if (args[0] == "--server" && (args.size() == 2 || args.size() == 4)) {
+    unsigned jobs = 0;
+    if (args.size() == 4) {
+      toy::driver::Options options;
+      if (args[2] != "-j" ||
+          !toy::driver::parseArgs({"-j", args[3], "-"}, options)) {
+        toy::driver::printUsage(std::cerr);
+        return 1;
+      }
+      jobs = options.jobs;
+    }
+    return toy::driver::Server(args[1], jobs).run() ? 0 : 1;
+  }
+
+  // toy-compiler --client <socket> <options and files>
+  if (args[0] == "--client" && args.size() >= 3) {
+    return toy::driver::runClient(
+        args[1], std::vector<std::string>(args.begin() + 2, args.end()),
+        std::cout, std::cerr);
+  }
+
+  toy::driver::Options options;
+  if (!toy::driver::parseArgs(args, options)) {
+    toy::driver::printUsage(std::cerr);
+    return 1;
+  }
+  return toy::driver::Driver(std::move(options)).run(std::cout, std::cerr);
 }
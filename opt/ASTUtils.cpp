@@ -0,0 +1,139 @@
+#include "opt/include/ASTUtils.hpp"
+
+#include <map>
+
+namespace toy::opt {
+
+void forEachChild(Expr *aExpr,
+                  const std::function<void(std::unique_ptr<Expr> &)> &aFn) {
+  if (auto *expr = dynamic_cast<LiteralExpr *>(aExpr)) {
+    for (auto &val : expr->getMutableValues()) {
+      aFn(val);
+    }
+  } else if (auto *expr = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    aFn(expr->getMutableInitValue());
+  } else if (auto *expr = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (expr->getMutableExpr().has_value()) {
+      aFn(*expr->getMutableExpr());
+    }
+  } else if (auto *expr = dynamic_cast<BinaryExpr *>(aExpr)) {
+    aFn(expr->getMutableLHS());
+    aFn(expr->getMutableRHS());
+  } else if (auto *expr = dynamic_cast<CallExpr *>(aExpr)) {
+    for (auto &arg : expr->getMutableArgs()) {
+      aFn(arg);
+    }
+  } else if (auto *expr = dynamic_cast<PrintExpr *>(aExpr)) {
+    aFn(expr->getMutableArg());
+  } else if (auto *expr = dynamic_cast<FusedExpr *>(aExpr)) {
+    for (auto &input : expr->getMutableInputs()) {
+      aFn(input);
+    }
+  }
+}
+
+int countNodes(Expr *aExpr) {
+  if (aExpr == nullptr) {
+    return 0;
+  }
+  int count = 1;
+  forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    count += countNodes(aChild.get());
+  });
+  return count;
+}
+
+int countNodes(Function *aFunction) {
+  int count = 0;
+  for (auto &expr : *aFunction->getBody()) {
+    count += countNodes(expr.get());
+  }
+  return count;
+}
+
+void collectCallees(Expr *aExpr, std::vector<std::string> &aCallees) {
+  forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    collectCallees(aChild.get(), aCallees);
+  });
+  if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    aCallees.push_back(call->getCallee());
+  }
+}
+
+bool containsPrint(Expr *aExpr) {
+  if (dynamic_cast<PrintExpr *>(aExpr)) {
+    return true;
+  }
+  bool found = false;
+  forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    found = found || containsPrint(aChild.get());
+  });
+  return found;
+}
+
+std::set<std::string> getPrintingFunctions(Module &aModule) {
+  std::set<std::string> printing;
+  std::map<std::string, std::vector<std::string>> callees;
+  for (auto &func : aModule) {
+    auto &name = func->getPrototype()->getName();
+    auto &edges = callees[name];
+    for (auto &expr : *func->getBody()) {
+      collectCallees(expr.get(), edges);
+      if (containsPrint(expr.get())) {
+        printing.insert(name);
+      }
+    }
+  }
+
+  // propagate the print effect from callees to callers
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto &[caller, edges] : callees) {
+      if (printing.count(caller)) {
+        continue;
+      }
+      for (auto &callee : edges) {
+        if (printing.count(callee)) {
+          printing.insert(caller);
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+  return printing;
+}
+
+static void collectNames(Expr *aExpr, std::set<std::string> &aNames) {
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    aNames.insert(var->getName());
+  } else if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    aNames.insert(decl->getName());
+  }
+  forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    collectNames(aChild.get(), aNames);
+  });
+}
+
+std::set<std::string> collectNames(Function *aFunction) {
+  std::set<std::string> names;
+  for (auto &arg : aFunction->getPrototype()->getArgs()) {
+    names.insert(arg->getName());
+  }
+  for (auto &expr : *aFunction->getBody()) {
+    collectNames(expr.get(), names);
+  }
+  return names;
+}
+
+Function *findFunction(Module &aModule, const std::string &aName) {
+  for (auto &func : aModule) {
+    if (func->getPrototype()->getName() == aName) {
+      return func.get();
+    }
+  }
+  return nullptr;
+}
+
+} // namespace toy::opt
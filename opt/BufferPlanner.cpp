@@ -0,0 +1,228 @@
+#include "opt/include/BufferPlanner.hpp"
+
+#include <algorithm>
+
+namespace toy::opt {
+
+void MemoryPlan::print(std::ostream &aOs) const {
+  aOs << "buffers: " << buffers.size() << "\n"
+      << "slab bytes: " << slabSize << "\n"
+      << "peak live bytes: " << peakLiveBytes << "\n"
+      << "naive bytes: " << naiveBytes << "\n"
+      << "returned bytes: " << escapingBytes << "\n";
+}
+
+MemoryPlan BufferPlanner::plan(const FunctionShapes &aShapes) {
+  fShapes = &aShapes;
+  fValues.clear();
+  fEnv.clear();
+  fPos = 0;
+
+  for (auto &expr : *aShapes.function->getBody()) {
+    visit(expr.get());
+    if (dynamic_cast<ReturnExpr *>(expr.get())) {
+      break;
+    }
+  }
+
+  MemoryPlan plan;
+
+  std::vector<int> order;
+  for (size_t i = 0; i < fValues.size(); ++i) {
+    auto &value = fValues[i];
+    plan.naiveBytes += value.size;
+    if (value.escapes) {
+      plan.escapingBytes += value.size;
+    } else {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int aLHS, int aRHS) {
+    return fValues[aLHS].begin < fValues[aRHS].begin;
+  });
+
+  // free blocks of the slab, offset to size
+  std::map<size_t, size_t> freeBlocks;
+  auto release = [&](size_t aOffset, size_t aSize) {
+    auto next = freeBlocks.lower_bound(aOffset);
+    if (next != freeBlocks.end() && aOffset + aSize == next->first) {
+      aSize += next->second;
+      next = freeBlocks.erase(next);
+    }
+    if (next != freeBlocks.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == aOffset) {
+        prev->second += aSize;
+        return;
+      }
+    }
+    freeBlocks[aOffset] = aSize;
+  };
+
+  // buffers still live, in order of their last use
+  std::multimap<int, BufferAssignment *> live;
+  size_t liveBytes = 0;
+  plan.buffers.reserve(order.size());
+
+  for (int id : order) {
+    auto &value = fValues[id];
+
+    // buffers whose last use came before this definition can be reused
+    while (!live.empty() && live.begin()->first < value.begin) {
+      auto *done = live.begin()->second;
+      release(done->offset, done->size);
+      liveBytes -= done->size;
+      live.erase(live.begin());
+    }
+
+    // best fit, the smallest free block that is large enough
+    auto best = freeBlocks.end();
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+      if (it->second >= value.size &&
+          (best == freeBlocks.end() || it->second < best->second)) {
+        best = it;
+      }
+    }
+
+    size_t offset;
+    if (best != freeBlocks.end()) {
+      offset = best->first;
+      size_t remaining = best->second - value.size;
+      freeBlocks.erase(best);
+      if (remaining) {
+        freeBlocks[offset + value.size] = remaining;
+      }
+    } else {
+      // grow the slab, reusing a free block at its end if there is one
+      offset = plan.slabSize;
+      if (!freeBlocks.empty()) {
+        auto last = std::prev(freeBlocks.end());
+        if (last->first + last->second == plan.slabSize) {
+          offset = last->first;
+          freeBlocks.erase(last);
+        }
+      }
+      plan.slabSize = offset + value.size;
+    }
+
+    plan.buffers.push_back(
+        BufferAssignment{value.producer, value.begin, value.end, offset,
+                         value.size});
+    live.emplace(value.end, &plan.buffers.back());
+    liveBytes += value.size;
+    plan.peakLiveBytes = std::max(plan.peakLiveBytes, liveBytes);
+  }
+
+  return plan;
+}
+
+int BufferPlanner::define(Expr *aExpr) {
+  auto it = fShapes->shapes.find(aExpr);
+  if (it == fShapes->shapes.end()) {
+    return -1;
+  }
+  size_t bytes =
+      getNumElements(it->second) * runtime::getElementSize(fElementType);
+  size_t size = (bytes + kAlignment - 1) / kAlignment * kAlignment;
+  fValues.push_back(Value{aExpr, size, fPos, fPos, false});
+  return fValues.size() - 1;
+}
+
+void BufferPlanner::use(int aValue) {
+  if (aValue >= 0) {
+    fValues[aValue].end = std::max(fValues[aValue].end, fPos);
+  }
+}
+
+int BufferPlanner::visit(Expr *aExpr) {
+  if (dynamic_cast<NumberExpr *>(aExpr)) {
+    // constants are immediates, not buffers
+    return -1;
+  }
+
+  if (dynamic_cast<LoadExpr *>(aExpr)) {
+    // loaded tensors live in the mapped file
+    return -1;
+  }
+
+  if (dynamic_cast<LiteralExpr *>(aExpr) ||
+      dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+    ++fPos;
+    return define(aExpr);
+  }
+
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    // parameters are owned by the caller
+    auto it = fEnv.find(var->getName());
+    return it == fEnv.end() ? -1 : it->second;
+  }
+
+  if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    int value = visit(decl->getInitValue());
+    // reshaping a strided view copies it
+    auto *call = dynamic_cast<CallExpr *>(decl->getInitValue());
+    if (!decl->getType().shape.empty() && call &&
+        call->getCallee() == "transpose") {
+      ++fPos;
+      use(value);
+      value = define(decl->getInitValue());
+    }
+    fEnv[decl->getName()] = value;
+    return -1;
+  }
+
+  if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (ret->getExpr().has_value()) {
+      int value = visit(*ret->getExpr());
+      ++fPos;
+      use(value);
+      if (value >= 0) {
+        fValues[value].escapes = true;
+      }
+    }
+    return -1;
+  }
+
+  if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+    int value = visit(print->getArg());
+    ++fPos;
+    use(value);
+    return -1;
+  }
+
+  if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    std::vector<int> args;
+    for (auto &arg : call->getArgs()) {
+      args.push_back(visit(arg.get()));
+    }
+    // a transpose is a view of its operand
+    if (call->getCallee() == "transpose") {
+      return args[0];
+    }
+    ++fPos;
+    for (int arg : args) {
+      use(arg);
+    }
+    return define(aExpr);
+  }
+
+  // binary and fused operations
+  std::vector<int> operands;
+  if (auto *bin = dynamic_cast<BinaryExpr *>(aExpr)) {
+    operands.push_back(visit(bin->getLHS()));
+    operands.push_back(visit(bin->getRHS()));
+  } else if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    for (auto &input : fused->getInputs()) {
+      operands.push_back(visit(input.get()));
+    }
+  } else {
+    return -1;
+  }
+  ++fPos;
+  for (int operand : operands) {
+    use(operand);
+  }
+  return define(aExpr);
+}
+
+} // namespace toy::opt
@@ -0,0 +1,141 @@
+#include "opt/include/CSE.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "support/include/Statistics.hpp"
+
+namespace toy::opt {
+
+// variables and numbers are already as cheap as a variable reference. loads
+// stay in place so the shape check of their declaration still sees them
+static bool isTrivial(Expr *aExpr) {
+  return dynamic_cast<VarExpr *>(aExpr) || dynamic_cast<NumberExpr *>(aExpr) ||
+         dynamic_cast<LoadExpr *>(aExpr);
+}
+
+int CSE::run(Module &aModule) {
+  support::PhaseScope scope("cse");
+  auto impure = getPrintingFunctions(aModule);
+  int count = 0;
+  for (auto &func : aModule) {
+    count += run(func.get(), impure);
+  }
+  return count;
+}
+
+int CSE::run(Function *aFunction, const std::set<std::string> &aImpureCallees) {
+  fDAG = std::make_unique<ExprDAG>(aImpureCallees);
+  fUses.clear();
+  fAvailable.clear();
+  fHeldBy.clear();
+  fNames = collectNames(aFunction);
+  fNumEliminated = 0;
+
+  // number the values and count how often each one is computed
+  std::map<std::string, int> bindings;
+  for (auto &expr : *aFunction->getBody()) {
+    fDAG->build(expr.get(), bindings);
+    countUses(expr.get());
+    if (auto *decl = dynamic_cast<VarDeclExpr *>(expr.get())) {
+      bindings[decl->getName()] = getDeclaredNode(decl);
+    }
+  }
+
+  // compute repeated values once and reuse them afterwards
+  ExprList body;
+  for (auto &expr : *aFunction->getBody()) {
+    ExprList hoisted;
+    auto *decl = dynamic_cast<VarDeclExpr *>(expr.get());
+    int declNode = decl ? getDeclaredNode(decl) : -1;
+    rewrite(expr, false, hoisted);
+    for (auto &hoistedExpr : hoisted) {
+      body.push_back(std::move(hoistedExpr));
+    }
+    if (decl) {
+      bind(decl->getName(), declNode);
+    }
+    body.push_back(std::move(expr));
+  }
+  *aFunction->getBody() = std::move(body);
+
+  return fNumEliminated;
+}
+
+int CSE::getDeclaredNode(VarDeclExpr *aDecl) {
+  int id = fDAG->getNodeId(aDecl->getInitValue());
+  auto &shape = aDecl->getType().shape;
+  if (id < 0 || shape.empty()) {
+    return id;
+  }
+  return fDAG->reshape(id, shape);
+}
+
+void CSE::countUses(Expr *aExpr) {
+  int id = fDAG->getNodeId(aExpr);
+  if (id >= 0 && !isTrivial(aExpr) && fUses[id]++ > 0) {
+    return;
+  }
+  forEachChild(aExpr,
+               [&](std::unique_ptr<Expr> &aChild) { countUses(aChild.get()); });
+}
+
+void CSE::rewrite(std::unique_ptr<Expr> &aSlot, bool aIsDeclInit,
+                  ExprList &aHoisted) {
+  Expr *expr = aSlot.get();
+  int id = fDAG->getNodeId(expr);
+  bool trivial = isTrivial(expr);
+  // occurrences still to come after this one
+  int remaining = (id >= 0 && !trivial) ? --fUses[id] : 0;
+
+  // already computed, refer to the variable holding it
+  if (id >= 0 && !trivial) {
+    auto it = fAvailable.find(id);
+    if (it != fAvailable.end()) {
+      aSlot = std::make_unique<VarExpr>(it->second, expr->getLoc());
+      ++fNumEliminated;
+      return;
+    }
+  }
+
+  bool isDecl = dynamic_cast<VarDeclExpr *>(expr) != nullptr;
+  forEachChild(expr, [&](std::unique_ptr<Expr> &aChild) {
+    rewrite(aChild, isDecl, aHoisted);
+  });
+
+  // a declaration already names its value
+  if (id < 0 || trivial || aIsDeclInit || remaining < 1) {
+    return;
+  }
+
+  auto name = getFreshName();
+  auto loc = expr->getLoc();
+  aHoisted.push_back(
+      std::make_unique<VarDeclExpr>(name, VarType(), std::move(aSlot), loc));
+  aSlot = std::make_unique<VarExpr>(name, std::move(loc));
+  bind(name, id);
+}
+
+void CSE::bind(const std::string &aName, int aNode) {
+  auto held = fHeldBy.find(aName);
+  if (held != fHeldBy.end()) {
+    auto it = fAvailable.find(held->second);
+    if (it != fAvailable.end() && it->second == aName) {
+      fAvailable.erase(it);
+    }
+  }
+  if (aNode < 0) {
+    fHeldBy.erase(aName);
+    return;
+  }
+  fHeldBy[aName] = aNode;
+  fAvailable.emplace(aNode, aName);
+}
+
+std::string CSE::getFreshName() {
+  std::string name;
+  do {
+    name = "cse" + std::to_string(fNextId++);
+  } while (fNames.count(name));
+  fNames.insert(name);
+  return name;
+}
+
+} // namespace toy::opt
@@ -0,0 +1,95 @@
+#include "opt/include/CallGraph.hpp"
+#include "opt/include/ASTUtils.hpp"
+
+#include <algorithm>
+
+namespace toy::opt {
+
+CallGraph::CallGraph(Module &aModule) {
+  for (auto &func : aModule) {
+    fFunctions[func->getPrototype()->getName()] = func.get();
+  }
+
+  for (auto &func : aModule) {
+    std::vector<std::string> names;
+    for (auto &expr : *func->getBody()) {
+      collectCallees(expr.get(), names);
+    }
+    auto &callees = fNodes[func.get()].callees;
+    for (auto &name : names) {
+      auto *callee = getFunction(name);
+      if (!callee) {
+        continue;
+      }
+      ++fNodes[callee].numCallSites;
+      if (std::find(callees.begin(), callees.end(), callee) == callees.end()) {
+        callees.push_back(callee);
+      }
+    }
+  }
+
+  Visit state;
+  for (auto &func : aModule) {
+    if (!state.index.count(func.get())) {
+      visit(func.get(), state);
+    }
+  }
+}
+
+void CallGraph::visit(Function *aFunction, Visit &aVisit) {
+  int index = aVisit.index.size();
+  aVisit.index[aFunction] = aVisit.lowLink[aFunction] = index;
+  aVisit.stack.push_back(aFunction);
+  aVisit.onStack.insert(aFunction);
+  auto &node = fNodes[aFunction];
+  for (auto *callee : node.callees) {
+    auto &lowLink = aVisit.lowLink[aFunction];
+    if (!aVisit.index.count(callee)) {
+      visit(callee, aVisit);
+      lowLink = std::min(lowLink, aVisit.lowLink[callee]);
+    } else if (aVisit.onStack.count(callee)) {
+      lowLink = std::min(lowLink, aVisit.index[callee]);
+    }
+  }
+  if (aVisit.lowLink[aFunction] != index) {
+    return;
+  }
+
+  std::vector<Function *> scc;
+  do {
+    scc.push_back(aVisit.stack.back());
+    aVisit.onStack.erase(scc.back());
+    aVisit.stack.pop_back();
+  } while (scc.back() != aFunction);
+  bool selfCall = std::find(node.callees.begin(), node.callees.end(),
+                            aFunction) != node.callees.end();
+  for (auto *member : scc) {
+    fNodes[member].recursive = scc.size() > 1 || selfCall;
+    fNodes[member].scc = fSCCs.size();
+  }
+  fSCCs.push_back(std::move(scc));
+}
+
+Function *CallGraph::getFunction(const std::string &aName) const {
+  auto it = fFunctions.find(aName);
+  return it == fFunctions.end() ? nullptr : it->second;
+}
+
+const std::vector<Function *> &
+CallGraph::getCallees(Function *aFunction) const {
+  return fNodes.at(aFunction).callees;
+}
+
+int CallGraph::getNumCallSites(Function *aFunction) const {
+  return fNodes.at(aFunction).numCallSites;
+}
+
+bool CallGraph::isRecursive(Function *aFunction) const {
+  return fNodes.at(aFunction).recursive;
+}
+
+size_t CallGraph::getSCCIndex(Function *aFunction) const {
+  return fNodes.at(aFunction).scc;
+}
+
+} // namespace toy::opt
@@ -0,0 +1,88 @@
+#include "opt/include/DCE.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "support/include/Statistics.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace toy::opt {
+
+// collect the names of the variables read by the tree
+static void collectUses(Expr *aExpr, std::set<std::string> &aUses) {
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    aUses.insert(var->getName());
+    return;
+  }
+  forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    collectUses(aChild.get(), aUses);
+  });
+}
+
+// true if evaluating the tree may print
+static bool hasEffect(Expr *aExpr, const std::set<std::string> &aImpureCallees) {
+  if (containsPrint(aExpr)) {
+    return true;
+  }
+  std::vector<std::string> callees;
+  collectCallees(aExpr, callees);
+  return std::any_of(callees.begin(), callees.end(),
+                     [&](const std::string &aCallee) {
+                       return aImpureCallees.count(aCallee) != 0;
+                     });
+}
+
+int DeadCodeElim::run(Module &aModule) {
+  support::PhaseScope scope("dce");
+  auto impure = getPrintingFunctions(aModule);
+  int count = 0;
+  for (auto &func : aModule) {
+    count += run(func.get(), impure);
+  }
+  return count;
+}
+
+int DeadCodeElim::run(Function *aFunction,
+                      const std::set<std::string> &aImpureCallees) {
+  auto *body = aFunction->getBody();
+  size_t origSize = body->size();
+
+  // nothing after the first return is ever executed
+  auto ret = std::find_if(body->begin(), body->end(),
+                          [](const std::unique_ptr<Expr> &aExpr) {
+                            return dynamic_cast<ReturnExpr *>(aExpr.get());
+                          });
+  if (ret != body->end()) {
+    body->erase(ret + 1, body->end());
+  }
+
+  // walk backwards, tracking the variables that are still needed
+  std::set<std::string> live;
+  std::vector<bool> keep(body->size(), false);
+  for (size_t i = body->size(); i-- > 0;) {
+    Expr *expr = (*body)[i].get();
+    if (auto *decl = dynamic_cast<VarDeclExpr *>(expr)) {
+      bool needed = live.erase(decl->getName()) != 0;
+      if (!needed && !hasEffect(decl->getInitValue(), aImpureCallees)) {
+        continue;
+      }
+    } else if (!dynamic_cast<PrintExpr *>(expr) &&
+               !dynamic_cast<ReturnExpr *>(expr) &&
+               !hasEffect(expr, aImpureCallees)) {
+      continue;
+    }
+    keep[i] = true;
+    collectUses(expr, live);
+  }
+
+  ExprList newBody;
+  for (size_t i = 0; i < body->size(); ++i) {
+    if (keep[i]) {
+      newBody.push_back(std::move((*body)[i]));
+    }
+  }
+  *body = std::move(newBody);
+
+  return origSize - body->size();
+}
+
+} // namespace toy::opt
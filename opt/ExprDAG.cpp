@@ -0,0 +1,125 @@
+#include "opt/include/ExprDAG.hpp"
+
+#include <functional>
+
+namespace toy::opt {
+
+bool DAGNode::operator==(const DAGNode &aOther) const {
+  return kind == aOther.kind && op == aOther.op && name == aOther.name &&
+         value == aOther.value && operands == aOther.operands &&
+         dims == aOther.dims && serial == aOther.serial;
+}
+
+size_t DAGNodeHash::operator()(const DAGNode &aNode) const {
+  size_t hash = std::hash<int>()(aNode.kind);
+  auto combine = [&hash](size_t aValue) {
+    hash ^= aValue + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  };
+  combine(std::hash<char>()(aNode.op));
+  combine(std::hash<std::string>()(aNode.name));
+  combine(std::hash<double>()(aNode.value));
+  for (auto operand : aNode.operands) {
+    combine(std::hash<int>()(operand));
+  }
+  for (auto dim : aNode.dims) {
+    combine(std::hash<int>()(dim));
+  }
+  combine(std::hash<int>()(aNode.serial));
+  return hash;
+}
+
+ExprDAG::ExprDAG(std::set<std::string> aImpureCallees)
+    : fImpureCallees(std::move(aImpureCallees)) {}
+
+int ExprDAG::build(Expr *aExpr, const std::map<std::string, int> &aBindings) {
+  DAGNode node;
+
+  if (auto *num = dynamic_cast<NumberExpr *>(aExpr)) {
+    node.kind = DAGNode::Number;
+    node.value = num->getValue();
+  } else if (auto *lit = dynamic_cast<LiteralExpr *>(aExpr)) {
+    node.kind = DAGNode::Literal;
+    node.dims = lit->getDims();
+    for (auto &val : lit->getValues()) {
+      node.operands.push_back(build(val.get(), aBindings));
+    }
+  } else if (auto *lit = dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+    // not compared element by element, each sparse literal stays distinct
+    node.kind = DAGNode::Literal;
+    node.dims = lit->getDims();
+    node.serial = fNextSerial++;
+  } else if (auto *load = dynamic_cast<LoadExpr *>(aExpr)) {
+    node.kind = DAGNode::Load;
+    node.name = load->getPath();
+  } else if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    auto it = aBindings.find(var->getName());
+    if (it != aBindings.end()) {
+      return fExprNodes[aExpr] = it->second;
+    }
+    node.kind = DAGNode::Input;
+    node.name = var->getName();
+  } else if (auto *bin = dynamic_cast<BinaryExpr *>(aExpr)) {
+    node.kind = DAGNode::Binary;
+    node.op = bin->getOp();
+    node.operands.push_back(build(bin->getLHS(), aBindings));
+    node.operands.push_back(build(bin->getRHS(), aBindings));
+  } else if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    node.kind = DAGNode::Call;
+    node.name = call->getCallee();
+    for (auto &arg : call->getArgs()) {
+      node.operands.push_back(build(arg.get(), aBindings));
+    }
+    if (fImpureCallees.count(node.name)) {
+      node.serial = fNextSerial++;
+    }
+  } else if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    node.kind = DAGNode::Fused;
+    for (auto &op : fused->getProgram()) {
+      node.name += op.op == 0 ? std::to_string(op.input) + " "
+                              : std::string(1, op.op) + " ";
+    }
+    for (auto &input : fused->getInputs()) {
+      node.operands.push_back(build(input.get(), aBindings));
+    }
+  } else {
+    // statements do not produce a value, but their operands do
+    if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+      build(decl->getInitValue(), aBindings);
+    } else if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+      if (ret->getExpr().has_value()) {
+        build(*ret->getExpr(), aBindings);
+      }
+    } else if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+      build(print->getArg(), aBindings);
+    }
+    return -1;
+  }
+
+  return fExprNodes[aExpr] = intern(std::move(node));
+}
+
+int ExprDAG::reshape(int aOperand, const Shape &aDims) {
+  DAGNode node;
+  node.kind = DAGNode::Reshape;
+  node.operands.push_back(aOperand);
+  node.dims = aDims;
+  return intern(std::move(node));
+}
+
+int ExprDAG::getNodeId(Expr *aExpr) const {
+  auto it = fExprNodes.find(aExpr);
+  return it == fExprNodes.end() ? -1 : it->second;
+}
+
+int ExprDAG::intern(DAGNode aNode) {
+  auto it = fTable.find(aNode);
+  if (it != fTable.end()) {
+    return it->second;
+  }
+  int id = fNodes.size();
+  fNodes.push_back(aNode);
+  fTable.emplace(std::move(aNode), id);
+  return id;
+}
+
+} // namespace toy::opt
@@ -0,0 +1,95 @@
+#include "opt/include/Fusion.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "support/include/Statistics.hpp"
+
+namespace toy::opt {
+
+static bool isElementwise(Expr *aExpr) {
+  auto *bin = dynamic_cast<BinaryExpr *>(aExpr);
+  return bin && (bin->getOp() == '+' || bin->getOp() == '-' ||
+                 bin->getOp() == '*');
+}
+
+int Fusion::run(Module &aModule, const ShapeInference *aShapes) {
+  support::PhaseScope scope("fusion");
+  int count = 0;
+  for (auto &func : aModule) {
+    count += run(func.get(), aShapes);
+  }
+  return count;
+}
+
+int Fusion::run(Function *aFunction, const ShapeInference *aShapes) {
+  fNumFused = 0;
+  fSpecs.clear();
+  if (aShapes) {
+    fSpecs = aShapes->getSpecializations(aFunction);
+  }
+  for (auto &expr : *aFunction->getBody()) {
+    fuse(expr);
+  }
+  return fNumFused;
+}
+
+void Fusion::fuse(std::unique_ptr<Expr> &aSlot) {
+  auto *bin = dynamic_cast<BinaryExpr *>(aSlot.get());
+  // a single operation gains nothing from fusion
+  bool isChain = isElementwise(bin) && (isElementwise(bin->getLHS()) ||
+                                        isElementwise(bin->getRHS()));
+  if (!isChain || isScalarOnly(bin)) {
+    forEachChild(aSlot.get(),
+                 [&](std::unique_ptr<Expr> &aChild) { fuse(aChild); });
+    return;
+  }
+
+  ExprList inputs;
+  std::vector<FusedOp> program;
+  std::map<std::string, int> varInputs;
+  collect(aSlot, inputs, program, varInputs);
+  auto loc = aSlot->getLoc();
+  aSlot = std::make_unique<FusedExpr>(std::move(inputs), std::move(program),
+                                      std::move(loc));
+  ++fNumFused;
+}
+
+void Fusion::collect(std::unique_ptr<Expr> &aSlot, ExprList &aInputs,
+                     std::vector<FusedOp> &aProgram,
+                     std::map<std::string, int> &aVarInputs) {
+  if (isElementwise(aSlot.get())) {
+    auto *bin = static_cast<BinaryExpr *>(aSlot.get());
+    collect(bin->getMutableLHS(), aInputs, aProgram, aVarInputs);
+    collect(bin->getMutableRHS(), aInputs, aProgram, aVarInputs);
+    aProgram.push_back(FusedOp{bin->getOp(), 0});
+    return;
+  }
+
+  // a variable used several times in the chain is loaded from one input
+  if (auto *var = dynamic_cast<VarExpr *>(aSlot.get())) {
+    auto it = aVarInputs.find(var->getName());
+    if (it != aVarInputs.end()) {
+      aProgram.push_back(FusedOp{0, it->second});
+      return;
+    }
+    aVarInputs[var->getName()] = aInputs.size();
+  }
+
+  // leaves may hold chains of their own, e.g. call arguments
+  fuse(aSlot);
+  aProgram.push_back(FusedOp{0, static_cast<int>(aInputs.size())});
+  aInputs.push_back(std::move(aSlot));
+}
+
+bool Fusion::isScalarOnly(Expr *aExpr) {
+  if (fSpecs.empty()) {
+    return false;
+  }
+  for (auto *spec : fSpecs) {
+    auto it = spec->shapes.find(aExpr);
+    if (it == spec->shapes.end() || !it->second.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace toy::opt
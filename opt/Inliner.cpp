@@ -0,0 +1,250 @@
+#include "opt/include/Inliner.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "support/include/Statistics.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace toy::opt {
+
+static bool hasReturnValue(Function *aFunction) {
+  for (auto &expr : *aFunction->getBody()) {
+    if (auto *ret = dynamic_cast<ReturnExpr *>(expr.get())) {
+      return ret->getExpr().has_value();
+    }
+  }
+  return false;
+}
+
+// replace uses of renamed variables in the tree rooted at aSlot
+static void renameUses(std::unique_ptr<Expr> &aSlot,
+                       const std::map<std::string, std::string> &aRenames) {
+  if (auto *var = dynamic_cast<VarExpr *>(aSlot.get())) {
+    auto it = aRenames.find(var->getName());
+    if (it != aRenames.end()) {
+      aSlot = std::make_unique<VarExpr>(it->second, var->getLoc());
+    }
+    return;
+  }
+  forEachChild(aSlot.get(), [&](std::unique_ptr<Expr> &aChild) {
+    renameUses(aChild, aRenames);
+  });
+}
+
+Inliner::Inliner(InlinerOptions aOptions) : fOptions(aOptions) {}
+
+int Inliner::run(Module &aModule) {
+  support::PhaseScope scope("inline");
+  CallGraph graph(aModule);
+  prepare(aModule, graph);
+  int count = 0;
+  for (auto &scc : graph.getSCCs()) {
+    for (auto *func : scc) {
+      count += inlineCalls(func);
+    }
+  }
+  if (fOptions.removeDeadFunctions) {
+    removeDeadFunctions(aModule);
+  }
+  return count;
+}
+
+void Inliner::prepare(Module &aModule, const CallGraph &aGraph) {
+  fGraph = &aGraph;
+  fMayPrint = getPrintingFunctions(aModule);
+  fProfileNs = fOptions.profile ? fOptions.profile->getTotalNs() : 0;
+}
+
+void Inliner::removeDeadFunctions(Module &aModule) const {
+  auto &functions = aModule.getFunctions();
+  while (true) {
+    std::map<std::string, int> callSites;
+    for (auto &func : functions) {
+      std::vector<std::string> edges;
+      for (auto &expr : *func->getBody()) {
+        collectCallees(expr.get(), edges);
+      }
+      for (auto &callee : edges) {
+        if (callee != func->getPrototype()->getName()) {
+          ++callSites[callee];
+        }
+      }
+    }
+    auto dead = std::remove_if(
+        functions.begin(), functions.end(),
+        [&](const std::unique_ptr<Function> &aFunc) {
+          auto &name = aFunc->getPrototype()->getName();
+          return name != "main" && fGraph->getNumCallSites(aFunc.get()) > 0 &&
+                 callSites[name] == 0;
+        });
+    if (dead == functions.end()) {
+      break;
+    }
+    functions.erase(dead, functions.end());
+  }
+}
+
+int Inliner::inlineCalls(Function *aFunction) const {
+  Caller caller{aFunction, collectNames(aFunction)};
+
+  ExprList body;
+  for (auto &expr : *aFunction->getBody()) {
+    ExprList hoisted;
+    caller.sawOpaqueEffect = false;
+    bool keep = inlineCalls(expr, true, hoisted, caller);
+    for (auto &hoistedExpr : hoisted) {
+      body.push_back(std::move(hoistedExpr));
+    }
+    if (keep) {
+      body.push_back(std::move(expr));
+    }
+  }
+  *aFunction->getBody() = std::move(body);
+  return caller.numInlined;
+}
+
+bool Inliner::inlineCalls(std::unique_ptr<Expr> &aSlot, bool aIsStatement,
+                          ExprList &aHoisted, Caller &aCaller) const {
+  bool sawOpaqueEffect = aCaller.sawOpaqueEffect;
+  // operands are evaluated before the node itself
+  forEachChild(aSlot.get(), [&](std::unique_ptr<Expr> &aChild) {
+    inlineCalls(aChild, false, aHoisted, aCaller);
+  });
+
+  auto *call = dynamic_cast<CallExpr *>(aSlot.get());
+  if (!call) {
+    return true;
+  }
+
+  Function *callee = fGraph->getFunction(call->getCallee());
+  if (!callee) {
+    // builtin
+    return true;
+  }
+
+  bool mayPrint = fMayPrint.count(call->getCallee()) != 0;
+  // arguments are hoisted too, ahead of calls left earlier in the statement
+  auto &args = call->getArgs();
+  bool argsMayPrint =
+      std::any_of(args.begin(), args.end(),
+                  [&](const std::unique_ptr<Expr> &aArg) {
+                    return isPrinting(aArg.get());
+                  });
+  bool eligible =
+      callee != aCaller.function && !fGraph->isRecursive(callee) &&
+      args.size() == callee->getPrototype()->getArgs().size() &&
+      (aIsStatement || hasReturnValue(callee)) &&
+      // hoisting the body must not move a print ahead of a call that stays
+      !(mayPrint && aCaller.sawOpaqueEffect) &&
+      !(argsMayPrint && sawOpaqueEffect) && shouldInline(callee, call);
+
+  if (!eligible) {
+    aCaller.sawOpaqueEffect = aCaller.sawOpaqueEffect || mayPrint;
+    return true;
+  }
+
+  return inlineCall(aSlot, callee, aHoisted, aCaller);
+}
+
+bool Inliner::inlineCall(std::unique_ptr<Expr> &aSlot, Function *aCallee,
+                         ExprList &aHoisted, Caller &aCaller) const {
+  auto *call = static_cast<CallExpr *>(aSlot.get());
+  auto &params = aCallee->getPrototype()->getArgs();
+  auto &args = call->getMutableArgs();
+
+  // bind the parameters
+  std::map<std::string, std::string> renames;
+  for (size_t i = 0; i < params.size(); ++i) {
+    // variables are immutable, so a variable argument is used directly
+    if (auto *var = dynamic_cast<VarExpr *>(args[i].get())) {
+      renames[params[i]->getName()] = var->getName();
+      continue;
+    }
+    auto name = getFreshName(params[i]->getName(), aCaller);
+    renames[params[i]->getName()] = name;
+    auto loc = args[i]->getLoc();
+    aHoisted.push_back(std::make_unique<VarDeclExpr>(
+        name, VarType(), std::move(args[i]), std::move(loc)));
+  }
+
+  // copy the body up to the return, renaming the callee locals
+  std::unique_ptr<Expr> result;
+  for (auto &expr : *aCallee->getBody()) {
+    if (auto *ret = dynamic_cast<ReturnExpr *>(expr.get())) {
+      if (ret->getExpr().has_value()) {
+        result = clone(*ret->getExpr());
+        renameUses(result, renames);
+      }
+      break;
+    }
+    auto copy = clone(expr.get());
+    renameUses(copy, renames);
+    if (auto *decl = dynamic_cast<VarDeclExpr *>(copy.get())) {
+      auto name = getFreshName(decl->getName(), aCaller);
+      renames[decl->getName()] = name;
+      copy = std::make_unique<VarDeclExpr>(
+          name, decl->getType(), std::move(decl->getMutableInitValue()),
+          decl->getLoc());
+    }
+    aHoisted.push_back(std::move(copy));
+  }
+
+  ++aCaller.numInlined;
+
+  if (!result) {
+    // a call to a function without a return value is only valid as a
+    // statement, which now disappears
+    aSlot = nullptr;
+    return false;
+  }
+
+  aSlot = std::move(result);
+  return true;
+}
+
+bool Inliner::isPrinting(Expr *aExpr) const {
+  if (containsPrint(aExpr)) {
+    return true;
+  }
+  std::vector<std::string> callees;
+  collectCallees(aExpr, callees);
+  return std::any_of(callees.begin(), callees.end(),
+                     [&](const std::string &aCallee) {
+                       return fMayPrint.count(aCallee) != 0;
+                     });
+}
+
+bool Inliner::shouldInline(Function *aCallee, CallExpr *aCall) const {
+  int size = countNodes(aCallee);
+  int callSites = fGraph->getNumCallSites(aCallee);
+  // a single call site never grows the code once the callee is dropped
+  if (size <= fOptions.alwaysInlineSize || callSites <= 1) {
+    return true;
+  }
+  auto *profile = fOptions.profile;
+  auto *site = profile ? profile->findCallSite(aCall->getCallee(),
+                                               aCall->getLoc().line,
+                                               aCall->getLoc().col)
+                       : nullptr;
+  if (site && site->calls == 0) {
+    support::addCount("inline.coldSites");
+    return false;
+  }
+  if (site && fProfileNs > 0 &&
+      site->inclusiveNs >= fOptions.hotFraction * fProfileNs) {
+    support::addCount("inline.hotSites");
+    return size * callSites <= fOptions.hotGrowthBudget;
+  }
+  return size * callSites <= fOptions.growthBudget;
+}
+
+std::string Inliner::getFreshName(const std::string &aName, Caller &aCaller) {
+  std::string name;
+  do {
+    name = "inl" + std::to_string(aCaller.nextId++) + "_" + aName;
+  } while (aCaller.names.count(name));
+  aCaller.names.insert(name);
+  return name;
+}
+
+} // namespace toy::opt
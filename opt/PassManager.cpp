@@ -0,0 +1,93 @@
+#include "opt/include/PassManager.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "opt/include/CSE.hpp"
+#include "opt/include/DCE.hpp"
+#include "opt/include/Fusion.hpp"
+#include "opt/include/TransposeElim.hpp"
+#include "support/include/Statistics.hpp"
+#include "support/include/ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace toy::opt {
+
+PassManager::PassManager(support::ThreadPool *aPool,
+                         InlinerOptions aInlinerOptions)
+    : fPool(aPool), fInlinerOptions(aInlinerOptions) {}
+
+bool PassManager::run(Module &aModule) {
+  CallGraph graph(aModule);
+  Inliner inliner(fInlinerOptions);
+  auto impure = getPrintingFunctions(aModule);
+  inliner.prepare(aModule, graph);
+
+  runBottomUp(graph, [&](Function *aFunction) {
+    {
+      support::PhaseScope scope("inline");
+      inliner.inlineCalls(aFunction);
+    }
+    {
+      support::PhaseScope scope("transpose-elim");
+      TransposeElim().run(aFunction);
+    }
+    {
+      support::PhaseScope scope("cse");
+      CSE().run(aFunction, impure);
+    }
+    support::PhaseScope scope("dce");
+    DeadCodeElim().run(aFunction, impure);
+  });
+  if (fInlinerOptions.removeDeadFunctions) {
+    inliner.removeDeadFunctions(aModule);
+  }
+
+  // without an entry point nothing is specialized, fuse everything
+  if (!findFunction(aModule, "main")) {
+    runEach(aModule, [](Function *aFunction) {
+      support::PhaseScope scope("fusion");
+      Fusion().run(aFunction);
+    });
+    return true;
+  }
+  ShapeInference shapes;
+  if (!shapes.run(aModule)) {
+    return false;
+  }
+  runEach(aModule, [&](Function *aFunction) {
+    support::PhaseScope scope("fusion");
+    Fusion().run(aFunction, &shapes);
+  });
+  return true;
+}
+
+void PassManager::runBottomUp(const CallGraph &aGraph,
+                              const std::function<void(Function *)> &aPass) {
+  auto &sccs = aGraph.getSCCs();
+  std::vector<std::vector<size_t>> deps(sccs.size());
+  for (size_t i = 0; i < sccs.size(); ++i) {
+    for (auto *func : sccs[i]) {
+      for (auto *callee : aGraph.getCallees(func)) {
+        size_t dep = aGraph.getSCCIndex(callee);
+        if (dep != i &&
+            std::find(deps[i].begin(), deps[i].end(), dep) == deps[i].end()) {
+          deps[i].push_back(dep);
+        }
+      }
+    }
+  }
+  support::runTaskGraph(fPool, deps, [&](size_t aIndex) {
+    for (auto *func : sccs[aIndex]) {
+      aPass(func);
+    }
+  });
+}
+
+void PassManager::runEach(Module &aModule,
+                          const std::function<void(Function *)> &aPass) {
+  auto &functions = aModule.getFunctions();
+  support::runTaskGraph(
+      fPool, std::vector<std::vector<size_t>>(functions.size()),
+      [&](size_t aIndex) { aPass(functions[aIndex].get()); });
+}
+
+} // namespace toy::opt
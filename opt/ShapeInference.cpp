@@ -0,0 +1,311 @@
+#include "opt/include/ShapeInference.hpp"
+#include "runtime/include/TensorFile.hpp"
+#include "support/include/Statistics.hpp"
+
+#include <iostream>
+
+namespace toy::opt {
+
+std::string FunctionShapes::getMangledName() const {
+  std::string name = function->getPrototype()->getName();
+  for (auto &shape : argShapes) {
+    name += "_";
+    for (size_t i = 0; i < shape.size(); ++i) {
+      name += (i ? "x" : "") + std::to_string(shape[i]);
+    }
+    if (shape.empty()) {
+      name += "s";
+    }
+  }
+  return name;
+}
+
+int getNumElements(const Shape &aShape) {
+  int count = 1;
+  for (auto dim : aShape) {
+    count *= dim;
+  }
+  return count;
+}
+
+// result shape of an elementwise operation, scalars broadcast
+static std::optional<Shape> broadcast(const Shape &aLHS, const Shape &aRHS) {
+  if (aLHS == aRHS || aRHS.empty()) {
+    return aLHS;
+  }
+  if (aLHS.empty()) {
+    return aRHS;
+  }
+  return std::nullopt;
+}
+
+static std::string toString(const Shape &aShape) {
+  std::string str = "<";
+  for (size_t i = 0; i < aShape.size(); ++i) {
+    str += (i ? "," : "") + std::to_string(aShape[i]);
+  }
+  return str + ">";
+}
+
+bool ShapeInference::run(Module &aModule, const std::string &aEntry) {
+  support::PhaseScope scope("shape-inference");
+  fFunctions.clear();
+  fSpecs.clear();
+  fSpecIndex.clear();
+  fEntry = nullptr;
+
+  for (auto &func : aModule) {
+    fFunctions[func->getPrototype()->getName()] = func.get();
+  }
+
+  auto it = fFunctions.find(aEntry);
+  if (it == fFunctions.end()) {
+    std::cout << "Shape error: no entry function '" << aEntry << "'\n";
+    return false;
+  }
+  if (!it->second->getPrototype()->getArgs().empty()) {
+    return error(it->second->getPrototype(), "entry function takes no arguments");
+  }
+
+  fEntry = specialize(it->second, {}, it->second->getPrototype());
+  return fEntry != nullptr;
+}
+
+std::vector<FunctionShapes *>
+ShapeInference::getSpecializations(Function *aFunction) const {
+  std::vector<FunctionShapes *> specs;
+  for (auto &spec : fSpecs) {
+    if (spec->function == aFunction) {
+      specs.push_back(spec.get());
+    }
+  }
+  return specs;
+}
+
+FunctionShapes *ShapeInference::specialize(Function *aFunction,
+                                           const std::vector<Shape> &aArgShapes,
+                                           Expr *aCall) {
+  auto key = std::make_pair(aFunction, aArgShapes);
+  auto found = fSpecIndex.find(key);
+  if (found != fSpecIndex.end()) {
+    if (found->second->inProgress) {
+      error(aCall, "cannot infer shapes of recursive call to '" +
+                       aFunction->getPrototype()->getName() + "'");
+      return nullptr;
+    }
+    return found->second;
+  }
+
+  auto spec = std::make_unique<FunctionShapes>();
+  spec->function = aFunction;
+  spec->argShapes = aArgShapes;
+  spec->inProgress = true;
+  fSpecIndex[key] = spec.get();
+
+  std::map<std::string, Shape> env;
+  auto &params = aFunction->getPrototype()->getArgs();
+  for (size_t i = 0; i < params.size(); ++i) {
+    env[params[i]->getName()] = aArgShapes[i];
+  }
+
+  for (auto &expr : *aFunction->getBody()) {
+    if (!infer(expr.get(), *spec, env)) {
+      fSpecIndex.erase(key);
+      return nullptr;
+    }
+    if (auto *ret = dynamic_cast<ReturnExpr *>(expr.get())) {
+      if (ret->getExpr().has_value()) {
+        spec->returnShape = spec->shapes[*ret->getExpr()];
+      }
+      break;
+    }
+  }
+
+  spec->inProgress = false;
+  fSpecs.push_back(std::move(spec));
+  return fSpecs.back().get();
+}
+
+const Shape *ShapeInference::getOperandShape(Expr *aExpr,
+                                             FunctionShapes &aShapes) {
+  auto it = aShapes.shapes.find(aExpr);
+  if (it == aShapes.shapes.end()) {
+    error(aExpr, "expression does not produce a value");
+    return nullptr;
+  }
+  return &it->second;
+}
+
+bool ShapeInference::infer(Expr *aExpr, FunctionShapes &aShapes,
+                           std::map<std::string, Shape> &aEnv) {
+  if (aExpr == nullptr) {
+    return false;
+  }
+
+  if (dynamic_cast<NumberExpr *>(aExpr)) {
+    aShapes.shapes[aExpr] = Shape();
+    return true;
+  }
+
+  if (auto *lit = dynamic_cast<LiteralExpr *>(aExpr)) {
+    aShapes.shapes[aExpr] = lit->getDims();
+    return true;
+  }
+
+  if (auto *lit = dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+    aShapes.shapes[aExpr] = lit->getDims();
+    return true;
+  }
+
+  if (auto *load = dynamic_cast<LoadExpr *>(aExpr)) {
+    // only the header is read, the elements stay on disk until run time
+    runtime::Dims dims;
+    std::string message;
+    if (!runtime::readTensorFileDims(load->getPath(), dims, message)) {
+      return error(aExpr, message);
+    }
+    aShapes.shapes[aExpr] = Shape(dims.begin(), dims.end());
+    return true;
+  }
+
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    auto it = aEnv.find(var->getName());
+    if (it == aEnv.end()) {
+      return error(aExpr, "unknown variable '" + var->getName() + "'");
+    }
+    aShapes.shapes[aExpr] = it->second;
+    return true;
+  }
+
+  if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    if (!infer(decl->getInitValue(), aShapes, aEnv)) {
+      return false;
+    }
+    auto *shape = getOperandShape(decl->getInitValue(), aShapes);
+    if (!shape) {
+      return false;
+    }
+    auto &declared = decl->getType().shape;
+    if (declared.empty()) {
+      aEnv[decl->getName()] = *shape;
+      return true;
+    }
+    // a loaded tensor is checked against its declared type, not reshaped
+    if (dynamic_cast<LoadExpr *>(decl->getInitValue()) && declared != *shape) {
+      return error(aExpr, "declared shape " + toString(declared) +
+                              " does not match " + toString(*shape) +
+                              " in the tensor file");
+    }
+    // a declared type reshapes the value
+    if (getNumElements(declared) != getNumElements(*shape)) {
+      return error(aExpr, "cannot reshape " + toString(*shape) + " to " +
+                              toString(declared));
+    }
+    aEnv[decl->getName()] = declared;
+    return true;
+  }
+
+  if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (!ret->getExpr().has_value()) {
+      return true;
+    }
+    return infer(*ret->getExpr(), aShapes, aEnv) &&
+           getOperandShape(*ret->getExpr(), aShapes);
+  }
+
+  if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+    return infer(print->getArg(), aShapes, aEnv) &&
+           getOperandShape(print->getArg(), aShapes);
+  }
+
+  if (auto *bin = dynamic_cast<BinaryExpr *>(aExpr)) {
+    if (!infer(bin->getLHS(), aShapes, aEnv) ||
+        !infer(bin->getRHS(), aShapes, aEnv)) {
+      return false;
+    }
+    auto *lhs = getOperandShape(bin->getLHS(), aShapes);
+    auto *rhs = getOperandShape(bin->getRHS(), aShapes);
+    if (!lhs || !rhs) {
+      return false;
+    }
+    auto shape = broadcast(*lhs, *rhs);
+    if (!shape) {
+      return error(aExpr, "incompatible shapes " + toString(*lhs) + " and " +
+                              toString(*rhs) + " for '" + bin->getOp() + "'");
+    }
+    aShapes.shapes[aExpr] = *shape;
+    return true;
+  }
+
+  if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    Shape shape;
+    for (auto &input : fused->getInputs()) {
+      if (!infer(input.get(), aShapes, aEnv)) {
+        return false;
+      }
+      auto *inputShape = getOperandShape(input.get(), aShapes);
+      if (!inputShape) {
+        return false;
+      }
+      auto result = broadcast(shape, *inputShape);
+      if (!result) {
+        return error(aExpr, "incompatible shapes " + toString(shape) + " and " +
+                                toString(*inputShape) + " in fused operation");
+      }
+      shape = *result;
+    }
+    aShapes.shapes[aExpr] = shape;
+    return true;
+  }
+
+  if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    std::vector<Shape> argShapes;
+    for (auto &arg : call->getArgs()) {
+      if (!infer(arg.get(), aShapes, aEnv)) {
+        return false;
+      }
+      auto *shape = getOperandShape(arg.get(), aShapes);
+      if (!shape) {
+        return false;
+      }
+      argShapes.push_back(*shape);
+    }
+
+    if (call->getCallee() == "transpose") {
+      if (argShapes.size() != 1) {
+        return error(aExpr, "transpose takes a single argument");
+      }
+      aShapes.shapes[aExpr] = Shape(argShapes[0].rbegin(), argShapes[0].rend());
+      return true;
+    }
+
+    auto it = fFunctions.find(call->getCallee());
+    if (it == fFunctions.end()) {
+      return error(aExpr, "unknown function '" + call->getCallee() + "'");
+    }
+    if (it->second->getPrototype()->getArgs().size() != argShapes.size()) {
+      return error(aExpr, "wrong number of arguments to '" +
+                              call->getCallee() + "'");
+    }
+    auto *callee = specialize(it->second, argShapes, aExpr);
+    if (!callee) {
+      return false;
+    }
+    aShapes.callees[call] = callee;
+    if (callee->returnShape) {
+      aShapes.shapes[aExpr] = *callee->returnShape;
+    }
+    return true;
+  }
+
+  return error(aExpr, "unknown expression");
+}
+
+bool ShapeInference::error(Expr *aExpr, const std::string &aMsg) {
+  auto &loc = aExpr->getLoc();
+  std::cout << "Shape error (" << loc.line << ", " << loc.col << "): " << aMsg
+            << "\n";
+  return false;
+}
+
+} // namespace toy::opt
@@ -0,0 +1,136 @@
+#include "opt/include/TransposeElim.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "support/include/Statistics.hpp"
+
+namespace toy::opt {
+
+static CallExpr *asTranspose(Expr *aExpr) {
+  auto *call = dynamic_cast<CallExpr *>(aExpr);
+  if (call && call->getCallee() == "transpose" && call->getArgs().size() == 1) {
+    return call;
+  }
+  return nullptr;
+}
+
+static bool isElementwise(BinaryExpr *aExpr) {
+  return aExpr && (aExpr->getOp() == '+' || aExpr->getOp() == '-' ||
+                   aExpr->getOp() == '*');
+}
+
+static std::unique_ptr<Expr> makeTranspose(std::unique_ptr<Expr> aArg,
+                                           lexer::Location aLoc) {
+  ArgList args;
+  args.push_back(std::move(aArg));
+  return std::make_unique<CallExpr>("transpose", std::move(args),
+                                    std::move(aLoc));
+}
+
+int TransposeElim::run(Module &aModule) {
+  support::PhaseScope scope("transpose-elim");
+  int count = 0;
+  for (auto &func : aModule) {
+    count += run(func.get());
+  }
+  return count;
+}
+
+int TransposeElim::run(Function *aFunction) {
+  fVersions.clear();
+  fBindings.clear();
+  fNumRewrites = 0;
+
+  for (auto &expr : *aFunction->getBody()) {
+    simplify(expr);
+
+    auto *decl = dynamic_cast<VarDeclExpr *>(expr.get());
+    if (!decl) {
+      continue;
+    }
+    ++fVersions[decl->getName()];
+    fBindings.erase(decl->getName());
+    // a declared type reshapes the value, it is no longer a plain transpose
+    auto *call = asTranspose(decl->getInitValue());
+    if (!call || !decl->getType().shape.empty()) {
+      continue;
+    }
+    if (auto *var = dynamic_cast<VarExpr *>(call->getArgs()[0].get())) {
+      if (var->getName() != decl->getName()) {
+        fBindings[decl->getName()] = {var->getName(),
+                                      fVersions[var->getName()]};
+      }
+    }
+  }
+
+  return fNumRewrites;
+}
+
+void TransposeElim::simplify(std::unique_ptr<Expr> &aSlot) {
+  forEachChild(aSlot.get(),
+               [&](std::unique_ptr<Expr> &aChild) { simplify(aChild); });
+  while (applyRule(aSlot)) {
+    ++fNumRewrites;
+  }
+}
+
+Expr *TransposeElim::getTransposed(Expr *aExpr) {
+  if (auto *call = asTranspose(aExpr)) {
+    return call->getArgs()[0].get();
+  }
+  return nullptr;
+}
+
+bool TransposeElim::applyRule(std::unique_ptr<Expr> &aSlot) {
+  if (auto *call = asTranspose(aSlot.get())) {
+    auto &arg = call->getMutableArgs()[0];
+
+    // transpose(transpose(x)) -> x
+    if (auto *inner = asTranspose(arg.get())) {
+      auto x = std::move(inner->getMutableArgs()[0]);
+      aSlot = std::move(x);
+      return true;
+    }
+
+    // transpose(t) -> x, where t was declared as transpose(x) and x has not
+    // been redeclared since
+    if (auto *var = dynamic_cast<VarExpr *>(arg.get())) {
+      auto it = fBindings.find(var->getName());
+      if (it != fBindings.end() &&
+          fVersions[it->second.source] == it->second.sourceVersion) {
+        aSlot = std::make_unique<VarExpr>(it->second.source, var->getLoc());
+        return true;
+      }
+    }
+
+    // transposing a scalar does nothing
+    if (dynamic_cast<NumberExpr *>(arg.get())) {
+      aSlot = std::move(arg);
+      return true;
+    }
+    return false;
+  }
+
+  // transpose(a) op transpose(b) -> transpose(a op b)
+  auto *bin = dynamic_cast<BinaryExpr *>(aSlot.get());
+  if (!isElementwise(bin)) {
+    return false;
+  }
+  auto &lhs = bin->getMutableLHS();
+  auto &rhs = bin->getMutableRHS();
+  auto *lhsCall = asTranspose(lhs.get());
+  auto *rhsCall = asTranspose(rhs.get());
+  bool lhsScalar = dynamic_cast<NumberExpr *>(lhs.get()) != nullptr;
+  bool rhsScalar = dynamic_cast<NumberExpr *>(rhs.get()) != nullptr;
+  if (!((lhsCall && (rhsCall || rhsScalar)) || (rhsCall && lhsScalar))) {
+    return false;
+  }
+
+  auto newLHS = lhsCall ? std::move(lhsCall->getMutableArgs()[0]) : std::move(lhs);
+  auto newRHS = rhsCall ? std::move(rhsCall->getMutableArgs()[0]) : std::move(rhs);
+  auto loc = bin->getLoc();
+  auto inner = std::make_unique<BinaryExpr>(bin->getOp(), std::move(newLHS),
+                                            std::move(newRHS), loc);
+  aSlot = makeTranspose(std::move(inner), std::move(loc));
+  return true;
+}
+
+} // namespace toy::opt
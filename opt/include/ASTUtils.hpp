@@ -0,0 +1,43 @@
+/*
+ *
+ * Small helpers shared by the AST level optimization passes
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace toy::opt {
+
+// call aFn on every owning child slot of aExpr, in evaluation order
+void forEachChild(Expr *aExpr,
+                  const std::function<void(std::unique_ptr<Expr> &)> &aFn);
+
+// number of AST nodes in the expression tree
+int countNodes(Expr *aExpr);
+
+// number of AST nodes in a function body
+int countNodes(Function *aFunction);
+
+// collect the callee names of every call in the tree, in evaluation order
+void collectCallees(Expr *aExpr, std::vector<std::string> &aCallees);
+
+// true if the tree contains a print
+bool containsPrint(Expr *aExpr);
+
+// names of the functions that may print, directly or through a callee
+std::set<std::string> getPrintingFunctions(Module &aModule);
+
+// collect every variable name declared or used in the function
+std::set<std::string> collectNames(Function *aFunction);
+
+// return the user function with the given name, nullptr if there is none
+Function *findFunction(Module &aModule, const std::string &aName);
+
+} // namespace toy::opt
@@ -0,0 +1,86 @@
+/*
+ *
+ * Liveness based buffer planning.
+ *
+ * Every tensor value computed by a specialized function gets a live range,
+ * from the operation producing it to its last use. Values are then packed into
+ * one preallocated slab with a greedy best-fit allocator, a buffer being
+ * released after its last use so later values can reuse it. Transposes are
+ * views and only extend the live range of their operand.
+ *
+ */
+
+#pragma once
+
+#include "opt/include/ShapeInference.hpp"
+#include "runtime/include/Tensor.hpp"
+
+#include <ostream>
+#include <vector>
+
+namespace toy::opt {
+
+// slot of one tensor value in the slab
+struct BufferAssignment {
+  // expression producing the value
+  Expr *value;
+  // position of the producing operation and of the last use
+  int begin;
+  int end;
+  // byte offset in the slab and size of the buffer
+  size_t offset;
+  size_t size;
+};
+
+struct MemoryPlan {
+  std::vector<BufferAssignment> buffers;
+  // size of the slab, the planned peak memory
+  size_t slabSize = 0;
+  // largest number of bytes live at the same time, a lower bound for the slab
+  size_t peakLiveBytes = 0;
+  // bytes a fresh allocation per operation would request in total
+  size_t naiveBytes = 0;
+  // bytes of the returned value, owned by the caller and not in the slab
+  size_t escapingBytes = 0;
+
+  // print a short report of the plan
+  void print(std::ostream &aOs) const;
+};
+
+class BufferPlanner {
+public:
+  // buffers are rounded up to this many bytes
+  static constexpr size_t kAlignment = 64;
+
+  explicit BufferPlanner(
+      runtime::ElementType aElementType = runtime::ElementType::Float64)
+      : fElementType(aElementType) {}
+
+  // plan the buffers of one specialization
+  MemoryPlan plan(const FunctionShapes &aShapes);
+
+private:
+  struct Value {
+    Expr *producer;
+    size_t size;
+    int begin;
+    int end;
+    bool escapes;
+  };
+
+  // walk aExpr in evaluation order, returns the value it produces, or -1 if
+  // it produces none or one that is not planned
+  int visit(Expr *aExpr);
+  // create a value produced by aExpr at the current position
+  int define(Expr *aExpr);
+  // record a use of aValue at the current position
+  void use(int aValue);
+
+  runtime::ElementType fElementType;
+  const FunctionShapes *fShapes = nullptr;
+  std::vector<Value> fValues;
+  std::map<std::string, int> fEnv;
+  int fPos = 0;
+};
+
+} // namespace toy::opt
@@ -0,0 +1,53 @@
+/*
+ *
+ * Common subexpression elimination over the expression DAG of a function.
+ *
+ * A value computed more than once is computed a single time into a variable
+ * and later occurrences refer to that variable.
+ *
+ */
+
+#pragma once
+
+#include "opt/include/ExprDAG.hpp"
+
+namespace toy::opt {
+
+class CSE {
+public:
+  // run on every function of the module, returns the number of eliminated
+  // expressions
+  int run(Module &aModule);
+
+  // run on a single function, aImpureCallees are the functions that may print
+  int run(Function *aFunction, const std::set<std::string> &aImpureCallees);
+
+private:
+  // node of the value held by aDecl, its init reshaped if it has a type
+  int getDeclaredNode(VarDeclExpr *aDecl);
+  // count the occurrences of each node, a repeated subtree is only counted
+  // once, not once per enclosing occurrence
+  void countUses(Expr *aExpr);
+  // rewrite repeated subtrees of the tree rooted at aSlot, hoisting the first
+  // occurrence into aHoisted
+  void rewrite(std::unique_ptr<Expr> &aSlot, bool aIsDeclInit,
+               ExprList &aHoisted);
+  // bind aName to aNode, forgetting the previous binding of aName
+  void bind(const std::string &aName, int aNode);
+  // return a fresh variable name that does not clash in the function
+  std::string getFreshName();
+
+  std::unique_ptr<ExprDAG> fDAG;
+  // number of occurrences for each node
+  std::map<int, int> fUses;
+  // variable currently holding the value of a node
+  std::map<int, std::string> fAvailable;
+  // node currently held by each variable
+  std::map<std::string, int> fHeldBy;
+  // names in use in the function
+  std::set<std::string> fNames;
+  int fNextId = 0;
+  int fNumEliminated = 0;
+};
+
+} // namespace toy::opt
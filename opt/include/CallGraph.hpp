@@ -0,0 +1,72 @@
+/*
+ *
+ * Call graph of a module.
+ *
+ * Calls are resolved by callee name to the user functions of the module,
+ * builtins have no node. The strongly connected components are ordered
+ * callees first, so visiting them in order sees every callee outside a
+ * cycle before its callers.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace toy::opt {
+
+class CallGraph {
+public:
+  explicit CallGraph(Module &aModule);
+
+  // user function with the given name, nullptr if there is none
+  Function *getFunction(const std::string &aName) const;
+
+  // distinct user functions called by aFunction, in order of first call
+  const std::vector<Function *> &getCallees(Function *aFunction) const;
+
+  // number of calls to aFunction across the module
+  int getNumCallSites(Function *aFunction) const;
+
+  // true if aFunction is part of a cycle, a self call included
+  bool isRecursive(Function *aFunction) const;
+
+  // the strongly connected components, callees before callers
+  const std::vector<std::vector<Function *>> &getSCCs() const {
+    return fSCCs;
+  }
+
+  // index in getSCCs() of the component holding aFunction
+  size_t getSCCIndex(Function *aFunction) const;
+
+private:
+  struct Node {
+    std::vector<Function *> callees;
+    int numCallSites = 0;
+    bool recursive = false;
+    size_t scc = 0;
+  };
+
+  // state of tarjan's algorithm
+  struct Visit {
+    std::map<Function *, int> index;
+    std::map<Function *, int> lowLink;
+    std::vector<Function *> stack;
+    std::set<Function *> onStack;
+  };
+
+  // tarjan's algorithm, emits the components of everything reachable from
+  // aFunction
+  void visit(Function *aFunction, Visit &aVisit);
+
+  std::map<std::string, Function *> fFunctions;
+  std::map<Function *, Node> fNodes;
+  std::vector<std::vector<Function *>> fSCCs;
+};
+
+} // namespace toy::opt
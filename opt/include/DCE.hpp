@@ -0,0 +1,29 @@
+/*
+ *
+ * Dead code elimination.
+ *
+ * Drops declarations whose value never reaches a print or a return, values
+ * computed only for effect that have none, and everything after a return.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <set>
+#include <string>
+
+namespace toy::opt {
+
+class DeadCodeElim {
+public:
+  // run on every function of the module, returns the number of removed
+  // statements
+  int run(Module &aModule);
+
+  // run on a single function, aImpureCallees are the functions that may print
+  int run(Function *aFunction, const std::set<std::string> &aImpureCallees);
+};
+
+} // namespace toy::opt
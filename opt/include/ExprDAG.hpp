@@ -0,0 +1,78 @@
+/*
+ *
+ * Structurally hashed expression DAG.
+ *
+ * Every value computed by a function body maps to one node, identical
+ * subtrees over the same operands map to the same node. Calls that may print
+ * are never merged.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace toy::opt {
+
+struct DAGNode {
+  enum Kind { Input, Number, Literal, Load, Binary, Call, Fused, Reshape };
+
+  Kind kind;
+  // binary operator
+  char op = 0;
+  // input variable, callee name or loaded path, the program of a fused node
+  std::string name;
+  // number value
+  double value = 0;
+  // operand node ids, the elements for a literal
+  std::vector<int> operands;
+  // literal dims, the dims of a reshape
+  Shape dims;
+  // non zero for nodes that must stay distinct
+  int serial = 0;
+
+  bool operator==(const DAGNode &aOther) const;
+};
+
+struct DAGNodeHash {
+  size_t operator()(const DAGNode &aNode) const;
+};
+
+class ExprDAG {
+public:
+  // aImpureCallees are the functions whose calls are never merged
+  ExprDAG(std::set<std::string> aImpureCallees = {});
+
+  // return the node for aExpr, creating nodes as needed. variables are
+  // resolved through aBindings, unbound ones become input nodes.
+  // returns -1 for expressions that do not produce a value
+  int build(Expr *aExpr, const std::map<std::string, int> &aBindings);
+
+  // node for aOperand reshaped to aDims, as by a declaration with a type
+  int reshape(int aOperand, const Shape &aDims);
+
+  // node id previously built for aExpr, -1 if there is none
+  int getNodeId(Expr *aExpr) const;
+
+  const DAGNode &getNode(int aId) const { return fNodes[aId]; }
+
+  size_t size() const { return fNodes.size(); }
+
+private:
+  // return the id of the unique node equal to aNode
+  int intern(DAGNode aNode);
+
+  std::set<std::string> fImpureCallees;
+  std::vector<DAGNode> fNodes;
+  std::unordered_map<DAGNode, int, DAGNodeHash> fTable;
+  std::unordered_map<Expr *, int> fExprNodes;
+  int fNextSerial = 1;
+};
+
+} // namespace toy::opt
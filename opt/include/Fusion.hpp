@@ -0,0 +1,41 @@
+/*
+ *
+ * Elementwise fusion.
+ *
+ * A tree of elementwise '+', '-' and '*' operations is replaced by a single
+ * FusedExpr, so the whole chain is evaluated by one kernel in one pass over
+ * memory instead of materializing a temporary per operation.
+ *
+ */
+
+#pragma once
+
+#include "opt/include/ShapeInference.hpp"
+
+namespace toy::opt {
+
+class Fusion {
+public:
+  // fuse the chains of every function, returns the number of fused chains.
+  // chains only ever over scalars are left alone when shapes are given
+  int run(Module &aModule, const ShapeInference *aShapes = nullptr);
+
+  // fuse the chains of a single function
+  int run(Function *aFunction, const ShapeInference *aShapes = nullptr);
+
+private:
+  // fuse the chains in the tree rooted at aSlot
+  void fuse(std::unique_ptr<Expr> &aSlot);
+  // append the chain rooted at aSlot to the fused program, moving the leaves
+  // into aInputs
+  void collect(std::unique_ptr<Expr> &aSlot, ExprList &aInputs,
+               std::vector<FusedOp> &aProgram,
+               std::map<std::string, int> &aVarInputs);
+  // true if the value of aExpr is a scalar in every known specialization
+  bool isScalarOnly(Expr *aExpr);
+
+  std::vector<FunctionShapes *> fSpecs;
+  int fNumFused = 0;
+};
+
+} // namespace toy::opt
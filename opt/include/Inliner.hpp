@@ -0,0 +1,95 @@
+/*
+ *
+ * AST level inliner for calls to user defined toy functions.
+ *
+ * Callees are processed bottom-up, so a caller always inlines an already
+ * inlined callee. Functions that take part in recursion are never inlined.
+ * The pass manager inlines into functions of independent components
+ * concurrently.
+ *
+ * Given the profile of an earlier run, calls that never ran keep their call
+ * unless the callee is tiny, and calls taking a large share of the run are
+ * inlined under a larger growth budget.
+ *
+ */
+
+#pragma once
+
+#include "opt/include/CallGraph.hpp"
+#include "support/include/Profile.hpp"
+
+#include <set>
+#include <string>
+
+namespace toy::opt {
+
+struct InlinerOptions {
+  // callees with at most this many AST nodes are always inlined
+  int alwaysInlineSize = 8;
+  // accepted code growth for a callee, measured as body size * call sites
+  int growthBudget = 200;
+  // drop functions that have no callers left after inlining, main is kept
+  bool removeDeadFunctions = true;
+  // execution profile guiding the decisions, none if nullptr
+  const support::Profile *profile = nullptr;
+  // a call site taking at least this fraction of the profiled run is hot
+  double hotFraction = 0.01;
+  // accepted code growth for a callee at a hot call site
+  int hotGrowthBudget = 1000;
+};
+
+class Inliner {
+public:
+  Inliner(InlinerOptions aOptions = InlinerOptions());
+
+  // inline calls across the module, returns the number of inlined call sites
+  int run(Module &aModule);
+
+  // analyze the module for inlineCalls, aGraph must outlive the calls
+  void prepare(Module &aModule, const CallGraph &aGraph);
+
+  // inline eligible calls into aFunction, its callees outside its own
+  // component must be final. functions may be processed concurrently,
+  // returns the number of inlined call sites
+  int inlineCalls(Function *aFunction) const;
+
+  // drop the functions whose callers all went away, this may cascade to
+  // their own callees. main is kept
+  void removeDeadFunctions(Module &aModule) const;
+
+private:
+  // the function being inlined into
+  struct Caller {
+    Function *function;
+    // names in use in the caller
+    std::set<std::string> names;
+    // set once a call that may print was left in the current statement
+    bool sawOpaqueEffect = false;
+    // counter used to build fresh names
+    int nextId = 0;
+    int numInlined = 0;
+  };
+
+  // inline eligible calls in the tree rooted at aSlot, hoisting the callee
+  // bodies into aHoisted, returns false if aSlot was dropped
+  bool inlineCalls(std::unique_ptr<Expr> &aSlot, bool aIsStatement,
+                   ExprList &aHoisted, Caller &aCaller) const;
+  // splice the body of aCallee in place of the call held by aSlot
+  bool inlineCall(std::unique_ptr<Expr> &aSlot, Function *aCallee,
+                  ExprList &aHoisted, Caller &aCaller) const;
+  // true if evaluating aExpr may print
+  bool isPrinting(Expr *aExpr) const;
+  // cost model, true if aCallee should be inlined at aCall
+  bool shouldInline(Function *aCallee, CallExpr *aCall) const;
+  // return a fresh variable name for aName that does not clash in the caller
+  static std::string getFreshName(const std::string &aName, Caller &aCaller);
+
+  InlinerOptions fOptions;
+  const CallGraph *fGraph = nullptr;
+  // functions that may print, directly or through a callee
+  std::set<std::string> fMayPrint;
+  // length of the profiled run
+  uint64_t fProfileNs = 0;
+};
+
+} // namespace toy::opt
@@ -0,0 +1,51 @@
+/*
+ *
+ * The optimization pipeline, run function by function over the call graph.
+ *
+ * Each component of the call graph is inlined into and simplified as one
+ * task, once the components it calls are done, so a caller always inlines
+ * final callees. Components that do not depend on each other run
+ * concurrently on a thread pool. Shape inference flows from callers to
+ * callees and stays serial, fusion then runs on every function at once.
+ * The result does not depend on the number of threads.
+ *
+ */
+
+#pragma once
+
+#include "opt/include/CallGraph.hpp"
+#include "opt/include/Inliner.hpp"
+
+#include <functional>
+
+namespace toy::support {
+class ThreadPool;
+} // namespace toy::support
+
+namespace toy::opt {
+
+class PassManager {
+public:
+  // run the per function work on aPool, or on the calling thread if it is
+  // nullptr
+  explicit PassManager(support::ThreadPool *aPool = nullptr,
+                       InlinerOptions aInlinerOptions = InlinerOptions());
+
+  // inline, simplify, infer shapes and fuse, prints the error and returns
+  // false if the shapes do not agree
+  bool run(Module &aModule);
+
+  // run aPass on every function, the functions of a component after every
+  // component it calls
+  void runBottomUp(const CallGraph &aGraph,
+                   const std::function<void(Function *)> &aPass);
+
+  // run aPass on every function in any order
+  void runEach(Module &aModule, const std::function<void(Function *)> &aPass);
+
+private:
+  support::ThreadPool *fPool;
+  InlinerOptions fInlinerOptions;
+};
+
+} // namespace toy::opt
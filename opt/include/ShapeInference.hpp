@@ -0,0 +1,79 @@
+/*
+ *
+ * Interprocedural shape inference.
+ *
+ * Toy functions are generic over the shapes of their arguments, so every
+ * function reachable from the entry point is specialized for each distinct
+ * list of argument shapes it is called with.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace toy::opt {
+
+// the shapes of one specialization of a function
+struct FunctionShapes {
+  Function *function;
+  std::vector<Shape> argShapes;
+  // shape of every expression that produces a value, scalars have no dims
+  std::map<Expr *, Shape> shapes;
+  // shape of the returned value, empty for functions returning nothing
+  std::optional<Shape> returnShape;
+  // specialization called at each call site
+  std::map<CallExpr *, FunctionShapes *> callees;
+  // set while the body is being inferred, to detect recursion
+  bool inProgress = false;
+
+  // unique name for the specialization, e.g. multiply_transpose_2x3_2x3
+  std::string getMangledName() const;
+};
+
+// number of elements in a tensor of the given shape
+int getNumElements(const Shape &aShape);
+
+class ShapeInference {
+public:
+  // infer shapes for everything reachable from aEntry, prints the error and
+  // returns false if the shapes do not agree
+  bool run(Module &aModule, const std::string &aEntry = "main");
+
+  // the specialization of the entry point
+  FunctionShapes *getEntry() const { return fEntry; }
+
+  // every specialization of aFunction
+  std::vector<FunctionShapes *> getSpecializations(Function *aFunction) const;
+
+  // every specialization, callees before their callers
+  const std::vector<std::unique_ptr<FunctionShapes>> &
+  getSpecializations() const {
+    return fSpecs;
+  }
+
+private:
+  // specialize aFunction for the argument shapes, nullptr on error
+  FunctionShapes *specialize(Function *aFunction,
+                             const std::vector<Shape> &aArgShapes, Expr *aCall);
+  // infer the shape of aExpr and of all its operands
+  bool infer(Expr *aExpr, FunctionShapes &aShapes,
+             std::map<std::string, Shape> &aEnv);
+  // shape of an operand that must produce a value
+  const Shape *getOperandShape(Expr *aExpr, FunctionShapes &aShapes);
+  // print a shape error at the location of aExpr and return false
+  bool error(Expr *aExpr, const std::string &aMsg);
+
+  std::map<std::string, Function *> fFunctions;
+  std::vector<std::unique_ptr<FunctionShapes>> fSpecs;
+  std::map<std::pair<Function *, std::vector<Shape>>, FunctionShapes *>
+      fSpecIndex;
+  FunctionShapes *fEntry = nullptr;
+};
+
+} // namespace toy::opt
@@ -0,0 +1,55 @@
+/*
+ *
+ * Rewrite rules over the transpose builtin.
+ *
+ *   transpose(transpose(x))          -> x
+ *   transpose(<scalar>)              -> <scalar>
+ *   transpose(a) op transpose(b)     -> transpose(a op b)
+ *   transpose(a) op <scalar>         -> transpose(a op <scalar>)
+ *
+ * The first rule also looks through variables bound to a transpose. At run
+ * time the remaining transposes are strided views, so pushing them outwards
+ * keeps the elementwise operations on contiguous data.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <map>
+#include <string>
+
+namespace toy::opt {
+
+class TransposeElim {
+public:
+  // run on every function of the module, returns the number of rewrites
+  int run(Module &aModule);
+
+  // run on a single function
+  int run(Function *aFunction);
+
+private:
+  // simplify the tree rooted at aSlot, operands first
+  void simplify(std::unique_ptr<Expr> &aSlot);
+  // apply a single rule at aSlot, returns false if none matched
+  bool applyRule(std::unique_ptr<Expr> &aSlot);
+  // the operand of a transpose held directly or through a variable, or
+  // nullptr if aExpr is not a transpose
+  Expr *getTransposed(Expr *aExpr);
+
+  // a variable bound to transpose(source)
+  struct TransposeBinding {
+    std::string source;
+    int sourceVersion;
+  };
+
+  // number of times each variable was declared so far
+  std::map<std::string, int> fVersions;
+  // variables currently bound to a transpose of another variable
+  std::map<std::string, TransposeBinding> fBindings;
+  int fNumRewrites = 0;
+};
+
+} // namespace toy::opt
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lexer/include/Lexer.hpp"
+#include "opt/include/ASTUtils.hpp"
+#include "parser/include/Parser.hpp"
+
+#include <sstream>
+#include <string>
+
+using namespace toy;
+
+// utility to parse a module from a string
+inline std::unique_ptr<Module> parse(const char *aCode) {
+  auto lexer = std::make_unique<lexer::Lexer>(std::stringstream(aCode));
+  parser::Parser parser(std::move(lexer));
+  return parser.parseModule();
+}
+
+// utility to count the calls to aCallee in an expression tree
+inline int countCalls(Expr *aExpr, const std::string &aCallee) {
+  int count = 0;
+  if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    count += call->getCallee() == aCallee;
+  }
+  opt::forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+    count += countCalls(aChild.get(), aCallee);
+  });
+  return count;
+}
+
+// utility to count the calls to aCallee in a function
+inline int countCalls(Function *aFunction, const std::string &aCallee) {
+  int count = 0;
+  for (auto &expr : *aFunction->getBody()) {
+    count += countCalls(expr.get(), aCallee);
+  }
+  return count;
+}
+
+// utility to count the binary operations in a function
+inline int countBinOps(Function *aFunction) {
+  int count = 0;
+  std::function<void(Expr *)> visit = [&](Expr *aExpr) {
+    count += dynamic_cast<BinaryExpr *>(aExpr) != nullptr;
+    opt::forEachChild(aExpr, [&](std::unique_ptr<Expr> &aChild) {
+      visit(aChild.get());
+    });
+  };
+  for (auto &expr : *aFunction->getBody()) {
+    visit(expr.get());
+  }
+  return count;
+}
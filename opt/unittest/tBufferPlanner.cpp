@@ -0,0 +1,77 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/BufferPlanner.hpp"
+#include <gtest/gtest.h>
+
+TEST(BufferPlanner, ReuseAfterLastUse) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2, 3, 4, 5, 6, 7, 8];
+      var b = a * a;
+      var c = b + b;
+      var d = c - c;
+      print(d);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  auto plan = opt::BufferPlanner().plan(*shapes.getEntry());
+
+  // four buffers of 64 bytes, never more than two live at once
+  ASSERT_EQ(plan.buffers.size(), 4u);
+  EXPECT_EQ(plan.naiveBytes, 256u);
+  EXPECT_EQ(plan.peakLiveBytes, 128u);
+  EXPECT_EQ(plan.slabSize, 128u);
+
+  // c reuses the buffer of a, d the buffer of b
+  EXPECT_EQ(plan.buffers[2].offset, plan.buffers[0].offset);
+  EXPECT_EQ(plan.buffers[3].offset, plan.buffers[1].offset);
+}
+
+TEST(BufferPlanner, ElementSize) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16];
+      print(a * a);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  EXPECT_EQ(opt::BufferPlanner().plan(*shapes.getEntry()).slabSize, 256u);
+  auto plan = opt::BufferPlanner(runtime::ElementType::Float32)
+                  .plan(*shapes.getEntry());
+  EXPECT_EQ(plan.slabSize, 128u);
+}
+
+TEST(BufferPlanner, ViewsAndReturns) {
+  auto module = parse(R"(
+    def helper(x) {
+      var a = [[1, 2], [3, 4]];
+      var t = transpose(a);
+      var b = x * x;
+      var c = b + t;
+      return c;
+    }
+
+    def main() {
+      print(helper([[1, 2], [3, 4]]));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  auto specs = shapes.getSpecializations(opt::findFunction(*module, "helper"));
+  ASSERT_EQ(specs.size(), 1u);
+  auto plan = opt::BufferPlanner().plan(*specs[0]);
+
+  // the literal lives through the transpose view until c, the returned c
+  // stays out of the slab
+  ASSERT_EQ(plan.buffers.size(), 2u);
+  EXPECT_EQ(plan.escapingBytes, 64u);
+  EXPECT_EQ(plan.slabSize, 128u);
+  EXPECT_EQ(plan.buffers[0].end, plan.buffers[1].end);
+}
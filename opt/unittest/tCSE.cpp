@@ -0,0 +1,139 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/CSE.hpp"
+#include "opt/include/DCE.hpp"
+#include <gtest/gtest.h>
+
+TEST(ExprDAG, HashConsing) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2];
+      var b = a;
+      print(transpose(a) * a + transpose(b) * b);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  auto *body = module->getFunctions()[0]->getBody();
+  opt::ExprDAG dag;
+  std::map<std::string, int> bindings;
+  for (auto &expr : *body) {
+    dag.build(expr.get(), bindings);
+    if (auto *decl = dynamic_cast<VarDeclExpr *>(expr.get())) {
+      bindings[decl->getName()] = dag.getNodeId(decl->getInitValue());
+    }
+  }
+
+  auto *print = dynamic_cast<PrintExpr *>(body->at(2).get());
+  auto *add = dynamic_cast<BinaryExpr *>(print->getArg());
+  ASSERT_NE(add, nullptr);
+  EXPECT_EQ(dag.getNodeId(add->getLHS()), dag.getNodeId(add->getRHS()));
+  // two numbers, the literal, transpose, mul and add
+  EXPECT_EQ(dag.size(), 6u);
+}
+
+TEST(CSE, RepeatedExpressions) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2];
+      var b = [3, 4];
+      var c = a * b + transpose(a);
+      print(a * b + transpose(a));
+      print(a * b);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::CSE().run(*module), 2);
+
+  auto *main = module->getFunctions()[0].get();
+  // a * b is hoisted, c is reused by the first print
+  EXPECT_EQ(countBinOps(main), 2);
+  EXPECT_EQ(countCalls(main, "transpose"), 1);
+  auto *print = dynamic_cast<PrintExpr *>(main->getBody()->at(4).get());
+  ASSERT_NE(print, nullptr);
+  EXPECT_EQ(dynamic_cast<VarExpr *>(print->getArg())->getName(), "c");
+}
+
+TEST(CSE, PrintingCallsAreNotMerged) {
+  auto module = parse(R"(
+    def noisy(x) {
+      print(x);
+      return x;
+    }
+
+    def main() {
+      var a = [1, 2];
+      print(noisy(a) + noisy(a));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::CSE().run(*module), 0);
+  EXPECT_EQ(countCalls(module->getFunctions()[1].get(), "noisy"), 2);
+}
+
+TEST(CSE, Redeclaration) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2];
+      var c = a * a;
+      var c = [5, 6];
+      print(a * a);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::CSE().run(*module);
+  auto *print = dynamic_cast<PrintExpr *>(
+      module->getFunctions()[0]->getBody()->back().get());
+  ASSERT_NE(print, nullptr);
+  EXPECT_NE(dynamic_cast<BinaryExpr *>(print->getArg()), nullptr);
+}
+
+TEST(CSE, DeclaredShapes) {
+  auto module = parse(R"(
+    def main() {
+      var a<2, 3> = [1, 2, 3, 4, 5, 6];
+      var b = [1, 2, 3, 4, 5, 6];
+      var c = a * a;
+      var d<3, 2> = a;
+      print(b);
+      print(d * d + c);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  // a holds the literal reshaped, b and d are other values
+  EXPECT_EQ(opt::CSE().run(*module), 0);
+  auto *main = module->getFunctions()[0].get();
+  auto *b = dynamic_cast<VarDeclExpr *>(main->getBody()->at(1).get());
+  ASSERT_NE(b, nullptr);
+  EXPECT_NE(dynamic_cast<LiteralExpr *>(b->getInitValue()), nullptr);
+  EXPECT_EQ(countBinOps(main), 3);
+}
+
+TEST(DCE, UnusedDeclarations) {
+  auto module = parse(R"(
+    def noisy(x) {
+      print(x);
+      return x;
+    }
+
+    def main() {
+      var a = [1, 2];
+      var unused = a * a;
+      var b = a + a;
+      var kept = noisy(a);
+      a * b;
+      print(b);
+      return;
+      print(a);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::DeadCodeElim().run(*module), 3);
+  auto *body = module->getFunctions()[1]->getBody();
+  ASSERT_EQ(body->size(), 5u);
+  EXPECT_EQ(dynamic_cast<VarDeclExpr *>(body->at(2).get())->getName(), "kept");
+}
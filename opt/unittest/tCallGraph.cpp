@@ -0,0 +1,51 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/CallGraph.hpp"
+#include <gtest/gtest.h>
+
+TEST(CallGraph, ComponentsCalleesFirst) {
+  auto module = parse(R"(
+    def leaf(x) {
+      return transpose(x);
+    }
+
+    def even(x) {
+      return odd(leaf(x));
+    }
+
+    def odd(x) {
+      return even(x);
+    }
+
+    def self(x) {
+      return self(x);
+    }
+
+    def main() {
+      print(even([1, 2]) + leaf([3, 4]) + leaf([5, 6]));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::CallGraph graph(*module);
+  auto *leaf = graph.getFunction("leaf");
+  auto *even = graph.getFunction("even");
+  auto *odd = graph.getFunction("odd");
+  auto *main = graph.getFunction("main");
+  ASSERT_NE(leaf, nullptr);
+  EXPECT_EQ(graph.getFunction("transpose"), nullptr);
+
+  // builtins have no node, repeated callees are listed once
+  EXPECT_EQ(graph.getCallees(leaf).size(), 0u);
+  EXPECT_EQ(graph.getCallees(main), (std::vector<Function *>{even, leaf}));
+  EXPECT_EQ(graph.getNumCallSites(leaf), 3);
+
+  EXPECT_EQ(graph.getSCCIndex(even), graph.getSCCIndex(odd));
+  EXPECT_LT(graph.getSCCIndex(leaf), graph.getSCCIndex(even));
+  EXPECT_LT(graph.getSCCIndex(even), graph.getSCCIndex(main));
+  EXPECT_EQ(graph.getSCCs().size(), 4u);
+
+  EXPECT_TRUE(graph.isRecursive(even));
+  EXPECT_TRUE(graph.isRecursive(graph.getFunction("self")));
+  EXPECT_FALSE(graph.isRecursive(leaf));
+  EXPECT_FALSE(graph.isRecursive(main));
+}
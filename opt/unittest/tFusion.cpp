@@ -0,0 +1,55 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/Fusion.hpp"
+#include <gtest/gtest.h>
+
+TEST(Fusion, ElementwiseChain) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2];
+      var b = [3, 4];
+      var c = [5, 6];
+      var d = [7, 8];
+      print(a * b + c - d * a);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  EXPECT_EQ(opt::Fusion().run(*module, &shapes), 1);
+
+  auto *main = module->getFunctions()[0].get();
+  EXPECT_EQ(countBinOps(main), 0);
+  auto *print = dynamic_cast<PrintExpr *>(main->getBody()->back().get());
+  auto *fused = dynamic_cast<FusedExpr *>(print->getArg());
+  ASSERT_NE(fused, nullptr);
+
+  // a is loaded twice from the same input
+  EXPECT_EQ(fused->getInputs().size(), 4u);
+  std::string program;
+  for (auto &op : fused->getProgram()) {
+    program += op.op ? std::string(1, op.op) : std::to_string(op.input);
+  }
+  EXPECT_EQ(program, "01*2+30*-");
+
+  // the fused module still infers
+  EXPECT_TRUE(opt::ShapeInference().run(*module));
+}
+
+TEST(Fusion, NestedChainsAndScalars) {
+  auto module = parse(R"(
+    def main() {
+      var a = [[1, 2], [3, 4]];
+      var s = 2 * 3 + 1;
+      var b = transpose(a * a + a) * a - a;
+      print(b * s);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  // the scalar chain and the single operation are left alone
+  EXPECT_EQ(opt::Fusion().run(*module, &shapes), 2);
+  EXPECT_EQ(countBinOps(module->getFunctions()[0].get()), 3);
+}
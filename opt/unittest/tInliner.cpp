@@ -0,0 +1,183 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/Inliner.hpp"
+#include <gtest/gtest.h>
+
+TEST(Inliner, SmallHelper) {
+  auto module = parse(R"(
+    def multiply_transpose(a, b) {
+      return transpose(a) * transpose(b);
+    }
+
+    def main() {
+      var a = [[1, 2], [3, 4]];
+      var b = [[5, 6], [7, 8]];
+      var c = multiply_transpose(a, b);
+      var d = multiply_transpose(b, a);
+      print(d);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::Inliner().run(*module), 2);
+
+  // the helper has no callers left and is dropped
+  ASSERT_EQ(module->getFunctions().size(), 1u);
+  auto *main = opt::findFunction(*module, "main");
+  ASSERT_NE(main, nullptr);
+  EXPECT_EQ(countCalls(main, "multiply_transpose"), 0);
+  EXPECT_EQ(countCalls(main, "transpose"), 4);
+}
+
+TEST(Inliner, LocalsAreRenamed) {
+  auto module = parse(R"(
+    def helper(x) {
+      var a = x * x;
+      return a + x;
+    }
+
+    def main() {
+      var a = [1, 2, 3];
+      print(helper(a + a));
+      print(a);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::Inliner().run(*module), 1);
+
+  auto *main = opt::findFunction(*module, "main");
+  auto *body = main->getBody();
+  // argument binding, helper local, then the two prints
+  ASSERT_EQ(body->size(), 5u);
+  auto *param = dynamic_cast<VarDeclExpr *>(body->at(1).get());
+  auto *local = dynamic_cast<VarDeclExpr *>(body->at(2).get());
+  ASSERT_NE(param, nullptr);
+  ASSERT_NE(local, nullptr);
+  EXPECT_NE(param->getName(), "x");
+  EXPECT_NE(local->getName(), "a");
+
+  // the last print still refers to the caller's own variable
+  auto *print = dynamic_cast<PrintExpr *>(body->at(4).get());
+  ASSERT_NE(print, nullptr);
+  EXPECT_EQ(dynamic_cast<VarExpr *>(print->getArg())->getName(), "a");
+}
+
+TEST(Inliner, RecursionIsNotInlined) {
+  auto module = parse(R"(
+    def ping(x) {
+      return pong(x);
+    }
+
+    def pong(x) {
+      return ping(x);
+    }
+
+    def main() {
+      print(ping([1, 2]));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::Inliner().run(*module), 0);
+  EXPECT_EQ(module->getFunctions().size(), 3u);
+}
+
+TEST(Inliner, CostModel) {
+  auto module = parse(R"(
+    def big(x) {
+      var a = x * x + x * x - x;
+      var b = a * a + a * a - a;
+      return b * b + b * b - b;
+    }
+
+    def main() {
+      var a = [1, 2];
+      print(big(a));
+      print(big(a));
+      print(big(a));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::InlinerOptions options;
+  options.growthBudget = 50;
+  EXPECT_EQ(opt::Inliner(options).run(*module), 0);
+  EXPECT_EQ(module->getFunctions().size(), 2u);
+}
+
+TEST(Inliner, ProfileGuided) {
+  auto module = parse(R"(
+    def big(x) {
+      var a = x * x + x * x - x;
+      var b = a * a + a * a - a;
+      return b * b + b * b - b;
+    }
+
+    def main() {
+      var a = [1, 2];
+      print(big(a));
+      print(big(a));
+      print(big(a));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  auto *main = module->getFunctions().back().get();
+
+  // the first call is hot, the others never ran
+  support::Profile profile;
+  profile.functions["main"].exclusiveNs = 1000;
+  int index = 0;
+  for (auto &expr : *main->getBody()) {
+    auto *print = dynamic_cast<PrintExpr *>(expr.get());
+    if (!print) {
+      continue;
+    }
+    auto loc = print->getArg()->getLoc();
+    auto &site = profile.callSites[{"big", loc.line, loc.col}];
+    site.caller = "main";
+    site.calls = index == 0;
+    site.inclusiveNs = index++ == 0 ? 900 : 0;
+  }
+  ASSERT_EQ(index, 3);
+
+  opt::InlinerOptions options;
+  options.growthBudget = 50;
+  options.profile = &profile;
+  EXPECT_EQ(opt::Inliner(options).run(*module), 1);
+  EXPECT_EQ(countCalls(main, "big"), 2);
+}
+
+TEST(Inliner, PrintingArgumentsKeepTheirOrder) {
+  auto module = parse(R"(
+    def h(x) {
+      print(x);
+      return x;
+    }
+
+    def p(x) {
+      print(x + x);
+      return x;
+    }
+
+    def f(x) {
+      return x * x;
+    }
+
+    def main() {
+      var a = [1, 2];
+      var r = h(a) + f(p(a));
+      print(r);
+      print(h(a) + p(a));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  // h and p stay out of line, hoisting p(a) would print it before h(a)
+  opt::InlinerOptions options;
+  options.alwaysInlineSize = 0;
+  options.growthBudget = 2;
+  opt::Inliner(options).run(*module);
+  auto *main = module->getFunctions().back().get();
+  EXPECT_EQ(countCalls(main, "f"), 1);
+  EXPECT_EQ(countCalls(main, "h"), 2);
+}
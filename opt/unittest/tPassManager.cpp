@@ -0,0 +1,66 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/PassManager.hpp"
+#include "support/include/ThreadPool.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+// a chain of helpers, each calling the two before it twice, under main
+static std::string makeChain(int aLength) {
+  std::string code = "def f0(a) {\n  return transpose(a) * a;\n}\n";
+  for (int i = 1; i < aLength; ++i) {
+    auto prev = "f" + std::to_string(i - 1);
+    auto other = "f" + std::to_string(std::max(0, i - 2));
+    code += "def f" + std::to_string(i) + "(a) {\n  var b = " + prev +
+            "(a) + " + other + "(a);\n  var c = " + prev + "(a) + " + other +
+            "(a);\n  return b + c + transpose(transpose(a));\n}\n";
+  }
+  code += "def main() {\n  var x = [[1, 2], [3, 4]];\n  print(f" +
+          std::to_string(aLength - 1) + "(x));\n}\n";
+  return code;
+}
+
+TEST(PassManager, SameResultOnAnyNumberOfThreads) {
+  auto code = makeChain(12);
+  auto serial = parse(code.c_str());
+  auto parallel = parse(code.c_str());
+  ASSERT_NE(serial, nullptr);
+  ASSERT_NE(parallel, nullptr);
+
+  // small budget so the deeper helpers stay calls
+  opt::InlinerOptions options;
+  options.growthBudget = 40;
+  ASSERT_TRUE(opt::PassManager(nullptr, options).run(*serial));
+  support::ThreadPool pool(4);
+  ASSERT_TRUE(opt::PassManager(&pool, options).run(*parallel));
+
+  std::ostringstream serialDump;
+  std::ostringstream parallelDump;
+  dump(*serial, serialDump);
+  dump(*parallel, parallelDump);
+  EXPECT_EQ(serialDump.str(), parallelDump.str());
+  EXPECT_NE(serialDump.str().find("Fused"), std::string::npos);
+}
+
+TEST(PassManager, CalleesFinishBeforeCallers) {
+  auto code = makeChain(30);
+  auto module = parse(code.c_str());
+  ASSERT_NE(module, nullptr);
+  opt::CallGraph graph(*module);
+
+  std::mutex mutex;
+  std::map<Function *, int> finished;
+  std::atomic<bool> ordered{true};
+  support::ThreadPool pool(4);
+  opt::PassManager(&pool).runBottomUp(graph, [&](Function *aFunction) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto *callee : graph.getCallees(aFunction)) {
+      ordered = ordered && finished.count(callee);
+    }
+    finished[aFunction] = finished.size();
+  });
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(finished.size(), module->getFunctions().size());
+}
@@ -0,0 +1,63 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/ShapeInference.hpp"
+#include <gtest/gtest.h>
+
+TEST(ShapeInference, Specialization) {
+  auto module = parse(R"(
+    def multiply_transpose(a, b) {
+      return transpose(a) * transpose(b);
+    }
+
+    def main() {
+      var a<2, 3> = [1, 2, 3, 4, 5, 6];
+      var b<2, 3> = [1, 2, 3, 4, 5, 6];
+      var c = multiply_transpose(a, b);
+      var d = multiply_transpose(transpose(a), transpose(b));
+      print(c * 2);
+      print(d);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+
+  auto *helper = opt::findFunction(*module, "multiply_transpose");
+  auto specs = shapes.getSpecializations(helper);
+  ASSERT_EQ(specs.size(), 2u);
+  EXPECT_EQ(specs[0]->getMangledName(), "multiply_transpose_2x3_2x3");
+  EXPECT_EQ(*specs[0]->returnShape, (Shape{3, 2}));
+  EXPECT_EQ(*specs[1]->returnShape, (Shape{2, 3}));
+
+  // the entry is inferred last
+  EXPECT_EQ(shapes.getSpecializations().back().get(), shapes.getEntry());
+  auto *body = shapes.getEntry()->function->getBody();
+  auto *print = dynamic_cast<PrintExpr *>(body->at(4).get());
+  EXPECT_EQ(shapes.getEntry()->shapes.at(print->getArg()), (Shape{3, 2}));
+}
+
+TEST(ShapeInference, Mismatch) {
+  auto module = parse(R"(
+    def main() {
+      var a = [[1, 2], [3, 4]];
+      var b = [1, 2, 3];
+      print(a + b);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  EXPECT_FALSE(opt::ShapeInference().run(*module));
+}
+
+TEST(ShapeInference, Recursion) {
+  auto module = parse(R"(
+    def loop(a) {
+      return loop(a);
+    }
+
+    def main() {
+      print(loop([1, 2]));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  EXPECT_FALSE(opt::ShapeInference().run(*module));
+}
@@ -0,0 +1,47 @@
+#include "OptTestHelper.hpp"
+#include "opt/include/TransposeElim.hpp"
+#include <gtest/gtest.h>
+
+TEST(TransposeElim, DoubleTranspose) {
+  auto module = parse(R"(
+    def main() {
+      var a = [[1, 2], [3, 4]];
+      var b = [[5, 6], [7, 8]];
+      print(transpose(transpose(a)));
+      print(transpose(transpose(a) * transpose(b)));
+      print(transpose(a) * transpose(b) + 2);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  EXPECT_EQ(opt::TransposeElim().run(*module), 5);
+
+  auto *main = module->getFunctions()[0].get();
+  auto *body = main->getBody();
+  EXPECT_NE(dynamic_cast<VarExpr *>(
+                dynamic_cast<PrintExpr *>(body->at(2).get())->getArg()),
+            nullptr);
+  EXPECT_NE(dynamic_cast<BinaryExpr *>(
+                dynamic_cast<PrintExpr *>(body->at(3).get())->getArg()),
+            nullptr);
+  // the last print is a single transpose of (a * b + 2)
+  EXPECT_EQ(countCalls(body->at(4).get(), "transpose"), 1);
+  EXPECT_EQ(countCalls(main, "transpose"), 1);
+}
+
+TEST(TransposeElim, ThroughVariables) {
+  auto module = parse(R"(
+    def main() {
+      var a = [[1, 2], [3, 4]];
+      var t = transpose(a);
+      print(transpose(t));
+      var a = [[5, 6], [7, 8]];
+      print(transpose(t));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  // the second use sees a redeclared a and is kept
+  EXPECT_EQ(opt::TransposeElim().run(*module), 1);
+  EXPECT_EQ(countCalls(module->getFunctions()[0].get(), "transpose"), 2);
+}
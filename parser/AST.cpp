@@ -1,5 +1,8 @@
 #include "parser/include/AST.hpp"
+#include "support/include/Format.hpp"
+#include "support/include/Statistics.hpp"
 
+#include <iostream>
 #include <sstream>
 #include <string>
 #include <cassert>
@@ -23,16 +26,22 @@ namespace toy {
     public:
       // public API to dump a module
       void dump(Module *aMod);
+
+      // return everything dumped so far
+      std::string str() const { return fOss.str(); }
     
     private:
       void dump(NumberExpr *aNumberExpr);
       void dump(LiteralExpr *aLiteralExpr);
+      void dump(SparseLiteralExpr *aSparseLiteralExpr);
+      void dump(LoadExpr *aLoadExpr);
       void dump(VarExpr *aVarExpr);
       void dump(VarDeclExpr *aVarDeclExpr);
       void dump(ReturnExpr *aReturnExpr);
       void dump(BinaryExpr *aBinaryExpr);
       void dump(CallExpr *aCallExpr);
       void dump(PrintExpr *aPrintExpr);
+      void dump(FusedExpr *aFusedExpr);
       void dump(Prototype *aPrototype);
       void dump(Function *aFunction);
       void dump(ExprList *aExprList);
@@ -43,6 +52,8 @@ namespace toy {
       void indent();
       // literal / num print helper
       void printLitHelper(Expr *aLiteralOrNumExpr);
+      // shortest form that reads back as aValue
+      void printNumber(double aValue);
 
       int fCurrIndent = 0;
       std::ostringstream fOss;
@@ -67,6 +78,12 @@ namespace toy {
     else if (LiteralExpr* expr = dynamic_cast<LiteralExpr*>(aExpr)) {
       ASTDumper::dump(expr);
     }
+    else if (SparseLiteralExpr* expr = dynamic_cast<SparseLiteralExpr*>(aExpr)) {
+      ASTDumper::dump(expr);
+    }
+    else if (LoadExpr* expr = dynamic_cast<LoadExpr*>(aExpr)) {
+      ASTDumper::dump(expr);
+    }
     else if (VarExpr* expr = dynamic_cast<VarExpr*>(aExpr)) {
       ASTDumper::dump(expr);
     }
@@ -85,6 +102,9 @@ namespace toy {
     else if (PrintExpr* expr = dynamic_cast<PrintExpr*>(aExpr)) {
       ASTDumper::dump(expr);
     }
+    else if (FusedExpr* expr = dynamic_cast<FusedExpr*>(aExpr)) {
+      ASTDumper::dump(expr);
+    }
     else if (Prototype* expr = dynamic_cast<Prototype*>(aExpr)) {
       ASTDumper::dump(expr);
     }
@@ -98,7 +118,8 @@ namespace toy {
 
   void ASTDumper::dump(NumberExpr *aNumberExpr) {
     INDENT();
-    fOss << std::to_string(aNumberExpr->getValue()) << " " << getLocStr(aNumberExpr) << std::endl;
+    printNumber(aNumberExpr->getValue());
+    fOss << " " << getLocStr(aNumberExpr) << std::endl;
   }
 
   void ASTDumper::dump(ExprList *aExprList) {
@@ -111,11 +132,16 @@ namespace toy {
     fOss << "// Block" << std::endl;
   }
 
+  void ASTDumper::printNumber(double aValue) {
+    char text[support::kMaxNumberChars];
+    fOss.write(text, support::formatNumber(text, aValue) - text);
+  }
+
   void ASTDumper::printLitHelper(Expr *aLiteralOrNumExpr) {
     // check if number or another literal
     if (auto *numExpr = dynamic_cast<NumberExpr*>(aLiteralOrNumExpr)) {
       // number
-      fOss << numExpr->getValue();
+      printNumber(numExpr->getValue());
       return;
     }
 
@@ -147,6 +173,33 @@ namespace toy {
     fOss << " " << getLocStr(aLiteralExpr) << std::endl;
   }
 
+  void ASTDumper::dump(SparseLiteralExpr *aSparseLiteralExpr) {
+    INDENT();
+    fOss << "SparseLiteral: <";
+    for (auto dim : aSparseLiteralExpr->getDims()) {
+      fOss << dim << ",";
+    }
+    fOss << "> rows[";
+    for (auto start : aSparseLiteralExpr->getRowStarts()) {
+      fOss << start << ",";
+    }
+    fOss << "] cols[";
+    for (auto col : aSparseLiteralExpr->getCols()) {
+      fOss << col << ",";
+    }
+    fOss << "] values[";
+    for (auto value : aSparseLiteralExpr->getValues()) {
+      printNumber(value);
+      fOss << ",";
+    }
+    fOss << "] " << getLocStr(aSparseLiteralExpr) << std::endl;
+  }
+
+  void ASTDumper::dump(LoadExpr *aLoadExpr) {
+    INDENT();
+    fOss << "Load: \"" << aLoadExpr->getPath() << "\" " << getLocStr(aLoadExpr) << std::endl;
+  }
+
   void ASTDumper::dump(VarExpr *aVarExpr) {
     INDENT();
     fOss << "Var: " << aVarExpr->getName() << " " << getLocStr(aVarExpr) << std::endl;
@@ -198,6 +251,25 @@ namespace toy {
     fOss << "]" << std::endl;
   }
 
+  void ASTDumper::dump(FusedExpr *aFusedExpr) {
+    INDENT();
+    fOss << "Fused: ";
+    for (auto &op : aFusedExpr->getProgram()) {
+      if (op.op == 0) {
+        fOss << "%" << op.input << " ";
+      } else {
+        fOss << op.op << " ";
+      }
+    }
+    fOss << "[ " << getLocStr(aFusedExpr) << std::endl;
+    for (auto &input : aFusedExpr->getInputs()) {
+      dump(input.get());
+      fOss << ",";
+    }
+    indent();
+    fOss << "]" << std::endl;
+  }
+
   void ASTDumper::dump(const VarType& aType) {
     fOss << "<";
     for (auto &dim : aType.shape) {
@@ -233,7 +305,94 @@ namespace toy {
   }
 
   void dump(Module &aModule) {
-    ASTDumper().dump(&aModule);
+    dump(aModule, std::cout);
+  }
+
+  void dump(Module &aModule, std::ostream &aOs) {
+    support::PhaseScope scope("dump");
+    ASTDumper dumper;
+    dumper.dump(&aModule);
+    aOs << dumper.str();
+  }
+
+  std::unique_ptr<Expr> clone(Expr *aExpr) {
+    if (aExpr == nullptr) {
+      return nullptr;
+    }
+    if (auto *expr = dynamic_cast<NumberExpr *>(aExpr)) {
+      return std::make_unique<NumberExpr>(expr->getValue(), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+      return std::make_unique<SparseLiteralExpr>(
+          expr->getDims(), expr->getRowStarts(), expr->getCols(),
+          expr->getValues(), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<LoadExpr *>(aExpr)) {
+      return std::make_unique<LoadExpr>(expr->getPath(), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<LiteralExpr *>(aExpr)) {
+      ExprList vals;
+      for (auto &val : expr->getValues()) {
+        vals.push_back(clone(val.get()));
+      }
+      return std::make_unique<LiteralExpr>(std::move(vals), expr->getDims(), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<VarExpr *>(aExpr)) {
+      return std::make_unique<VarExpr>(expr->getName(), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<VarDeclExpr *>(aExpr)) {
+      return std::make_unique<VarDeclExpr>(expr->getName(), expr->getType(),
+                                           clone(expr->getInitValue()), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<ReturnExpr *>(aExpr)) {
+      std::optional<std::unique_ptr<Expr>> val;
+      if (expr->getExpr().has_value()) {
+        val = clone(*expr->getExpr());
+      }
+      return std::make_unique<ReturnExpr>(std::move(val), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<BinaryExpr *>(aExpr)) {
+      return std::make_unique<BinaryExpr>(expr->getOp(), clone(expr->getLHS()),
+                                          clone(expr->getRHS()), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<CallExpr *>(aExpr)) {
+      ArgList args;
+      for (auto &arg : expr->getArgs()) {
+        args.push_back(clone(arg.get()));
+      }
+      return std::make_unique<CallExpr>(expr->getCallee(), std::move(args), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<PrintExpr *>(aExpr)) {
+      return std::make_unique<PrintExpr>(clone(expr->getArg()), expr->getLoc());
+    }
+    if (auto *expr = dynamic_cast<FusedExpr *>(aExpr)) {
+      ExprList inputs;
+      for (auto &input : expr->getInputs()) {
+        inputs.push_back(clone(input.get()));
+      }
+      return std::make_unique<FusedExpr>(std::move(inputs), expr->getProgram(), expr->getLoc());
+    }
+    assert(false && "clone of unknown expr");
+    return nullptr;
+  }
+
+  std::unique_ptr<Module> clone(Module &aModule) {
+    std::vector<std::unique_ptr<Function>> functions;
+    for (auto &func : aModule) {
+      auto *proto = func->getPrototype();
+      ParamList args;
+      for (auto &arg : proto->getArgs()) {
+        args.push_back(std::make_unique<VarExpr>(arg->getName(), arg->getLoc()));
+      }
+      auto body = std::make_unique<ExprList>();
+      for (auto &expr : *func->getBody()) {
+        body->push_back(clone(expr.get()));
+      }
+      functions.push_back(std::make_unique<Function>(
+          std::make_unique<Prototype>(proto->getName(), std::move(args), proto->getLoc()),
+          std::move(body)));
+    }
+    return std::make_unique<Module>(std::move(functions));
   }
  
 } // namespace toy
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "parser/include/Incremental.hpp"
+#include "lexer/include/Lexer.hpp"
+#include "parser/include/Parser.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace toy::parser {
+
+// move every expression of the tree rooted at aExpr aDelta lines
+static void shiftLines(Expr *aExpr, int aDelta) {
+  if (!aExpr) {
+    return;
+  }
+  aExpr->shiftLines(aDelta);
+  if (auto *literal = dynamic_cast<LiteralExpr *>(aExpr)) {
+    for (auto &value : literal->getValues()) {
+      shiftLines(value.get(), aDelta);
+    }
+  } else if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    shiftLines(decl->getInitValue(), aDelta);
+  } else if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (ret->getExpr()) {
+      shiftLines(*ret->getExpr(), aDelta);
+    }
+  } else if (auto *binary = dynamic_cast<BinaryExpr *>(aExpr)) {
+    shiftLines(binary->getLHS(), aDelta);
+    shiftLines(binary->getRHS(), aDelta);
+  } else if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    for (auto &arg : call->getArgs()) {
+      shiftLines(arg.get(), aDelta);
+    }
+  } else if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+    shiftLines(print->getArg(), aDelta);
+  } else if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    for (auto &input : fused->getInputs()) {
+      shiftLines(input.get(), aDelta);
+    }
+  } else if (auto *proto = dynamic_cast<Prototype *>(aExpr)) {
+    for (auto &arg : proto->getArgs()) {
+      shiftLines(arg.get(), aDelta);
+    }
+  }
+}
+
+// parse the functions of aText, whose first line is aFirstLine of the source
+static std::unique_ptr<Module> parseLines(const std::string &aText,
+                                          int aFirstLine) {
+  auto lexer =
+      std::make_unique<lexer::Lexer>(std::stringstream(aText), aFirstLine);
+  return Parser(std::move(lexer)).parseModule();
+}
+
+IncrementalParser::IncrementalParser(std::string aSource)
+    : fSource(std::move(aSource)) {
+  indexLines();
+  fLinesParsed = fLineStarts.size();
+  fModule = parseLines(fSource, 1);
+  if (!fModule) {
+    // everything is pending, on an empty module
+    fModule = std::make_unique<Module>(std::vector<std::unique_ptr<Function>>());
+    fPending = {1, int(fLineStarts.size())};
+    fHasPending = true;
+  }
+}
+
+Module *IncrementalParser::getModule() {
+  return fHasPending ? nullptr : fModule.get();
+}
+
+void IncrementalParser::indexLines() {
+  fLineStarts.assign(1, 0);
+  for (size_t pos = fSource.find('\n'); pos != std::string::npos;
+       pos = fSource.find('\n', pos + 1)) {
+    fLineStarts.push_back(pos + 1);
+  }
+}
+
+int IncrementalParser::getLine(size_t aOffset) const {
+  return std::upper_bound(fLineStarts.begin(), fLineStarts.end(), aOffset) -
+         fLineStarts.begin();
+}
+
+int IncrementalParser::getFirstLine(Function &aFunction) {
+  return aFunction.getPrototype()->getLoc().line;
+}
+
+bool IncrementalParser::applyEdit(size_t aOffset, size_t aLength,
+                                  const std::string &aText) {
+  if (aOffset > fSource.size() || aLength > fSource.size() - aOffset) {
+    std::cout << "Edit error: range " << aOffset << "+" << aLength
+              << " is outside the source of " << fSource.size() << " bytes\n";
+    return false;
+  }
+
+  // lines touched by the edit, and the lines pending from a failed edit
+  int first = getLine(aOffset);
+  int last = getLine(aOffset + aLength);
+  if (fHasPending) {
+    first = std::min(first, fPending.first);
+    last = std::max(last, fPending.second);
+  }
+
+  // the definitions whose lines intersect them, function i covers the lines
+  // from its start to the start of function i + 1
+  auto &functions = fModule->getFunctions();
+  int numLines = fLineStarts.size();
+  size_t begin = 0;
+  while (begin + 1 < functions.size() &&
+         getFirstLine(*functions[begin + 1]) <= first) {
+    ++begin;
+  }
+  size_t end = begin;
+  while (end < functions.size() && getFirstLine(*functions[end]) <= last) {
+    ++end;
+  }
+  int regionFirst = begin == 0 ? 1 : getFirstLine(*functions[begin]);
+  int regionLast =
+      end == functions.size() ? numLines : getFirstLine(*functions[end]) - 1;
+  regionFirst = std::min(regionFirst, first);
+  regionLast = std::max(regionLast, last);
+
+  auto removed = fSource.substr(aOffset, aLength);
+  int delta = std::count(aText.begin(), aText.end(), '\n') -
+              std::count(removed.begin(), removed.end(), '\n');
+  fSource.replace(aOffset, aLength, aText);
+  indexLines();
+  regionLast += delta;
+
+  // lex and parse the lines of the region only
+  size_t from = fLineStarts[regionFirst - 1];
+  size_t to = regionLast < int(fLineStarts.size()) ? fLineStarts[regionLast]
+                                                    : fSource.size();
+  fLinesParsed = regionLast - regionFirst + 1;
+  auto parsed = parseLines(fSource.substr(from, to - from), regionFirst);
+
+  for (size_t i = end; i < functions.size(); ++i) {
+    shiftLines(functions[i]->getPrototype(), delta);
+    for (auto &expr : *functions[i]->getBody()) {
+      shiftLines(expr.get(), delta);
+    }
+  }
+  auto position = functions.erase(functions.begin() + begin,
+                                  functions.begin() + end);
+  if (!parsed) {
+    fPending = {regionFirst, regionLast};
+    fHasPending = true;
+    return false;
+  }
+  auto &added = parsed->getFunctions();
+  functions.insert(position, std::make_move_iterator(added.begin()),
+                   std::make_move_iterator(added.end()));
+  fHasPending = false;
+  return true;
+}
+
+} // namespace toy::parser
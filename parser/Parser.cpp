@@ -1,34 +1,81 @@
 #include <iostream>
 #include <algorithm>
+#include <charconv>
 
 #include "parser/include/Parser.hpp"
+#include "support/include/Statistics.hpp"
 
 namespace toy::parser {
   
   Parser::Parser(std::unique_ptr<lexer::AbstractLexer> aLexer) : fLexer(std::move(aLexer)) {}
 
+  // count the nodes of the tree rooted at aExpr by kind
+  static void countNodes(Expr *aExpr) {
+    if (auto *literal = dynamic_cast<LiteralExpr *>(aExpr)) {
+      support::addCount("ast.LiteralExpr");
+      for (auto &value : literal->getValues()) {
+        countNodes(value.get());
+      }
+    } else if (dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+      support::addCount("ast.SparseLiteralExpr");
+    } else if (dynamic_cast<NumberExpr *>(aExpr)) {
+      support::addCount("ast.NumberExpr");
+    } else if (dynamic_cast<VarExpr *>(aExpr)) {
+      support::addCount("ast.VarExpr");
+    } else if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+      support::addCount("ast.VarDeclExpr");
+      countNodes(decl->getInitValue());
+    } else if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+      support::addCount("ast.ReturnExpr");
+      if (ret->getExpr()) {
+        countNodes(*ret->getExpr());
+      }
+    } else if (auto *binary = dynamic_cast<BinaryExpr *>(aExpr)) {
+      support::addCount("ast.BinaryExpr");
+      countNodes(binary->getLHS());
+      countNodes(binary->getRHS());
+    } else if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+      support::addCount("ast.CallExpr");
+      for (auto &arg : call->getArgs()) {
+        countNodes(arg.get());
+      }
+    } else if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+      support::addCount("ast.PrintExpr");
+      countNodes(print->getArg());
+    }
+  }
+
   std::unique_ptr<Module> Parser::parseModule() {
+    auto file = fLexer->getCurrentLocation().file;
+    support::PhaseScope scope("parse", file ? *file : std::string());
     // prime the lexer
     fLexer->getNextToken();
 
     // parse functions one at a time
     std::vector<std::unique_ptr<Function>> functions;
-    while (auto f = parseDefinition()) {
-      functions.push_back(std::move(f));
-      if (fLexer->getCurrentToken() == lexer::tok_eof) {
-        break;
+    while (fLexer->getCurrentToken() != lexer::tok_eof) {
+      auto f = parseDefinition();
+      // the error was reported, a partial module is never returned
+      if (!f) {
+        return nullptr;
       }
+      functions.push_back(std::move(f));
     }
 
-    if (fLexer->getCurrentToken() != lexer::tok_eof) {
-      return parseError<Module>("nothing", "at end of module");
+    if (support::isReportEnabled()) {
+      for (auto &function : functions) {
+        support::addCount("ast.Function");
+        for (auto &expr : *function->getBody()) {
+          countNodes(expr.get());
+        }
+      }
     }
-
-    return std::make_unique<Module>(functions);
+    return std::make_unique<Module>(std::move(functions));
   }
 
   // definition ::= prototype block
   std::unique_ptr<Function> Parser::parseDefinition() {
+    support::AllocationTag tag("ast.Function");
     auto proto = parsePrototype();
     
     if (!proto) {
@@ -45,6 +92,7 @@ namespace toy::parser {
   // prototype ::= def id '(' decl_list ')'
   // decl_list ::= identifier | identifier, decl_list
   std::unique_ptr<Prototype> Parser::parsePrototype() {
+    support::AllocationTag tag("ast.Prototype");
     auto fcn_loc = fLexer->getCurrentLocation();
 
     // if we do not see def at the start, error
@@ -66,16 +114,19 @@ namespace toy::parser {
     }
     fLexer->consume(lexer::tok_paren_open);
 
-    std::vector<std::unique_ptr<VarExpr>> args;
+    ParamList args;
 
     // check if arguments exist
     if (fLexer->getCurrentToken() != lexer::tok_paren_close) {
       while(true) {
+        if (fLexer->getCurrentToken() != lexer::tok_identifier) {
+          return parseError<Prototype>("identifier", "in function param list");
+        }
         std::string varName = fLexer->getLiteral();
         auto loc = fLexer->getCurrentLocation();
         fLexer->consume(lexer::tok_identifier);
         auto arg = std::make_unique<VarExpr>(varName, loc);
-        args.push_back(arg);
+        args.push_back(std::move(arg));
         
         // check if more args exist
         if (fLexer->getCurrentToken() != lexer::tok_comma) {
@@ -161,6 +212,7 @@ namespace toy::parser {
   }
 
   std::unique_ptr<VarDeclExpr> Parser::parseDeclaration() {
+    support::AllocationTag tag("ast.VarDeclExpr");
     if (fLexer->getCurrentToken() != lexer::tok_var) {
       return parseError<VarDeclExpr>("var", "to begin declaration");
     }
@@ -187,21 +239,25 @@ namespace toy::parser {
     }
     fLexer->consume(lexer::tok_equals);
     auto expr = parseExpression();
-    
+    if (!expr) {
+      return nullptr;
+    }
     return std::make_unique<VarDeclExpr>(name, std::move(*type), std::move(expr), std::move(loc));
   }
 
   std::unique_ptr<ReturnExpr> Parser::parseReturn() {
+    support::AllocationTag tag("ast.ReturnExpr");
     auto loc = fLexer->getCurrentLocation();
     fLexer->consume(lexer::tok_return);
 
     // return takes an optional argument
     std::optional<std::unique_ptr<Expr>> expr;
     if (fLexer->getCurrentToken() != lexer::tok_semicolon) {
-      expr = parseExpression();
-      if (!expr) {
+      auto value = parseExpression();
+      if (!value) {
         return nullptr;
       }
+      expr = std::move(value);
     }
     return std::make_unique<ReturnExpr>(std::move(expr), std::move(loc));
   }
@@ -223,7 +279,11 @@ namespace toy::parser {
     auto type = std::make_unique<VarType>();
 
     while (fLexer->getCurrentToken() == lexer::tok_number) {
-      type->shape.push_back(std::stoi(fLexer->getLiteral()));
+      int dim;
+      if (!parseNumber(dim)) {
+        return nullptr;
+      }
+      type->shape.push_back(dim);
       fLexer->consume(lexer::tok_number);
       if (fLexer->getCurrentToken() == lexer::tok_comma) {
         fLexer->consume(lexer::tok_comma);
@@ -250,13 +310,15 @@ namespace toy::parser {
                    << "' when expecting an expression\n";
       return nullptr;
     case lexer::tok_identifier:
+    case lexer::tok_print:
+    case lexer::tok_transpose:
       return parseIdentifierExpr();
     case lexer::tok_number:
       return parseNumberExpr();
     case lexer::tok_paren_open:
       return parseParenExpr();
     case lexer::tok_sbracket_open:
-      return parseTensorLiteralExpr();
+      return parseLiteralExpr();
     case lexer::tok_semicolon:
       return nullptr;
     case lexer::tok_bracket_close:
@@ -270,6 +332,7 @@ namespace toy::parser {
   // binoprhs ::= ('+' primary)*
   std::unique_ptr<Expr> Parser::parseBinOpRHS(int aExprPrec, std::unique_ptr<Expr> lhs) {
     while (true) {
+      support::AllocationTag tag("ast.BinaryExpr");
       int tokPrec = getTokPrecedence();
 
       // if this is a bunop that binds atleast as tightly as the current one consume it,
@@ -307,17 +370,33 @@ namespace toy::parser {
   //   ::= identifier
   //   ::= identifier '(' expression ')'
   std::unique_ptr<Expr> Parser::parseIdentifierExpr() {
-    std::string name(fLexer->getLiteral());
+    support::AllocationTag tag("ast.VarExpr");
+    // builtins are lexed as keywords and carry no literal
+    auto tok = fLexer->getCurrentToken();
+    std::string name;
+    if (tok == lexer::tok_print) {
+      name = "print";
+    } else if (tok == lexer::tok_transpose) {
+      name = "transpose";
+    } else {
+      name = fLexer->getLiteral();
+    }
 
     auto loc = fLexer->getCurrentLocation();
-    fLexer->consume(lexer::tok_identifier);
+    fLexer->consume(tok);
 
     if (fLexer->getCurrentToken() != lexer::tok_paren_open) // Simple variable ref.
       return std::make_unique<VarExpr>(name, std::move(loc));
 
+    // a tensor file, load("path")
+    if (name == "load") {
+      return parseLoadExpr(std::move(loc));
+    }
+
     // This is a function call.
+    support::AllocationTag callTag("ast.CallExpr");
     fLexer->consume(lexer::tok_paren_open);
-    std::vector<std::unique_ptr<Expr>> args;
+    ArgList args;
     if (fLexer->getCurrentToken() != lexer::tok_paren_close) {
       while (true) {
         if (auto arg = parseExpression())
@@ -350,13 +429,32 @@ namespace toy::parser {
   // Parse a literal number.
   // numberexpr ::= number
   std::unique_ptr<Expr> Parser::parseNumberExpr() {
+    support::AllocationTag tag("ast.NumberExpr");
     auto loc = fLexer->getCurrentLocation();
-    auto result =
-        std::make_unique<NumberExpr>(std::stoi(fLexer->getLiteral()), std::move(loc));
+    double value;
+    if (!parseNumber(value)) {
+      return nullptr;
+    }
+    auto result = std::make_unique<NumberExpr>(value, std::move(loc));
     fLexer->consume(lexer::tok_number);
     return std::move(result);
   }
 
+  // the lexer accepts any run of digits and dots, such as "." or "1.2.3",
+  // and a literal may not fit a double
+  template <typename T> bool Parser::parseNumber(T &aValue) {
+    auto literal = fLexer->getLiteral();
+    auto *end = literal.data() + literal.size();
+    auto [ptr, ec] = std::from_chars(literal.data(), end, aValue);
+    if (ec != std::errc() || ptr != end) {
+      std::cout << "Parse error (" << fLexer->getCurrentLocation().line << ", "
+                << fLexer->getCurrentLocation().col << "): invalid number '"
+                << literal << "'\n";
+      return false;
+    }
+    return true;
+  }
+
   // parenexpr ::= '(' expression ')'
   std::unique_ptr<Expr> Parser::parseParenExpr() {
     fLexer->consume(lexer::tok_paren_open);
@@ -374,13 +472,14 @@ namespace toy::parser {
   // tensorLiteral ::= [ literalList ] | number
   // literalList ::= tensorLiteral | tensorLiteral, literalList
   std::unique_ptr<Expr> Parser::parseTensorLiteralExpr() {
+    support::AllocationTag tag("ast.LiteralExpr");
     auto loc = fLexer->getCurrentLocation();
     fLexer->consume(lexer::tok_sbracket_open);
 
     // Hold the list of values at this nesting level.
     ExprList values;
     // Hold the dimensions for all the nesting inside this level.
-    std::vector<int> dims;
+    Shape dims;
     do {
       // We can have either another nested array or a number literal.
       if (fLexer->getCurrentToken() == lexer::tok_sbracket_open) {
@@ -429,10 +528,8 @@ namespace toy::parser {
       }
 
       // Retrieve and append the nested dimensions to the current level
-      auto firstDims = firstLiteral->getDims();
-      std::vector<int>
-          dims; // Assuming dimensions are represented as vector<int>
-      dims.insert(dims.end(), firstDims.begin(), firstDims.end());
+      auto &firstDims = firstLiteral->getDims();
+      dims.append(firstDims.begin(), firstDims.end());
 
       // Ensure uniformity across all elements
       for (auto &expr : values) {
@@ -452,6 +549,75 @@ namespace toy::parser {
     return std::make_unique<LiteralExpr>(std::move(values), std::move(dims), std::move(loc));
   }
 
+  // collect the numbers of a literal in row major order
+  static void flattenLiteral(Expr *aExpr, std::vector<double> &aValues) {
+    if (auto *num = dynamic_cast<NumberExpr *>(aExpr)) {
+      aValues.push_back(num->getValue());
+      return;
+    }
+    for (auto &val : static_cast<LiteralExpr *>(aExpr)->getValues()) {
+      flattenLiteral(val.get(), aValues);
+    }
+  }
+
+  // A tensor literal, kept in sparse form when it is large and mostly zeros.
+  std::unique_ptr<Expr> Parser::parseLiteralExpr() {
+    auto literal = parseTensorLiteralExpr();
+    if (!literal)
+      return nullptr;
+
+    // small literals are never sparse, they are not even counted
+    auto *dense = static_cast<LiteralExpr *>(literal.get());
+    auto &dims = dense->getDims();
+    size_t size = 1;
+    for (auto dim : dims)
+      size *= dim;
+    if (size < kSparseMinElements)
+      return literal;
+
+    std::vector<double> values;
+    values.reserve(size);
+    flattenLiteral(dense, values);
+    size_t nonZeros = size - std::count(values.begin(), values.end(), 0.0);
+    if (nonZeros > size * kSparseMaxDensity)
+      return literal;
+
+    support::AllocationTag tag("ast.SparseLiteralExpr");
+    size_t cols = dims.back();
+    std::vector<int> rowStarts;
+    std::vector<int> sparseCols;
+    std::vector<double> sparseValues;
+    rowStarts.reserve(values.size() / cols + 1);
+    sparseCols.reserve(nonZeros);
+    sparseValues.reserve(nonZeros);
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (i % cols == 0)
+        rowStarts.push_back(sparseCols.size());
+      if (values[i] != 0) {
+        sparseCols.push_back(i % cols);
+        sparseValues.push_back(values[i]);
+      }
+    }
+    rowStarts.push_back(sparseCols.size());
+    return std::make_unique<SparseLiteralExpr>(
+        dims, std::move(rowStarts), std::move(sparseCols),
+        std::move(sparseValues), dense->getLoc());
+  }
+
+  // loadexpr ::= 'load' '(' string ')'
+  std::unique_ptr<Expr> Parser::parseLoadExpr(lexer::Location aLoc) {
+    support::AllocationTag tag("ast.LoadExpr");
+    fLexer->consume(lexer::tok_paren_open);
+    if (fLexer->getCurrentToken() != lexer::tok_string)
+      return parseError<Expr>("\"path\"", "as argument to load()");
+    auto path = fLexer->getLiteral();
+    fLexer->consume(lexer::tok_string);
+    if (fLexer->getCurrentToken() != lexer::tok_paren_close)
+      return parseError<Expr>(")", "to close load()");
+    fLexer->consume(lexer::tok_paren_close);
+    return std::make_unique<LoadExpr>(path, std::move(aLoc));
+  }
+
   int Parser::getTokPrecedence() {
     if (!isascii(fLexer->getCurrentToken()))
       return -1;
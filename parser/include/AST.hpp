@@ -5,9 +5,11 @@
 #pragma once
 
 #include "lexer/include/AbstractLexer.hpp"
+#include "support/include/SmallVector.hpp"
 
 #include <memory>
 #include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -21,12 +23,17 @@ public:
 
   const lexer::Location &getLoc() { return fLoc; }
 
+  // move the expression aDelta lines down, after lines were added above it
+  void shiftLines(int aDelta) { fLoc.line += aDelta; }
+
 private:
   lexer::Location fLoc;
 };
 
 using ExprList = std::vector<std::unique_ptr<Expr>>;
-using Shape = std::vector<int>;
+// shapes and argument lists rarely exceed four entries, keep those inline
+using Shape = support::SmallVector<int, 4>;
+using ArgList = support::SmallVector<std::unique_ptr<Expr>, 4>;
 struct VarType {
   Shape shape;
 };
@@ -44,16 +51,61 @@ private:
 
 class LiteralExpr : public Expr {
 public:
-  LiteralExpr(ExprList vals,const std::vector<int> &dims, lexer::Location aLoc)
+  LiteralExpr(ExprList vals, Shape dims, lexer::Location aLoc)
       : Expr(std::move(aLoc)), fVals(std::move(vals)), fDims(std::move(dims)) {}
 
   const ExprList &getValues() { return fVals; }
 
-  const std::vector<int> &getDims() { return fDims; }
+  ExprList &getMutableValues() { return fVals; }
+
+  const Shape &getDims() { return fDims; }
 
 private:
   ExprList fVals;
-  std::vector<int> fDims;
+  Shape fDims;
+};
+
+// a literal that is mostly zeros, holding only its nonzero elements in
+// compressed sparse row form. the rows are the positions of all but the last
+// dim, the columns those of the last dim
+class SparseLiteralExpr : public Expr {
+public:
+  SparseLiteralExpr(Shape aDims, std::vector<int> aRowStarts,
+                    std::vector<int> aCols, std::vector<double> aValues,
+                    lexer::Location aLoc)
+      : Expr(std::move(aLoc)), fDims(std::move(aDims)),
+        fRowStarts(std::move(aRowStarts)), fCols(std::move(aCols)),
+        fValues(std::move(aValues)) {}
+
+  const Shape &getDims() { return fDims; }
+
+  // the first nonzero of each row, then the number of nonzeros
+  const std::vector<int> &getRowStarts() { return fRowStarts; }
+
+  // column of each nonzero, ascending within a row
+  const std::vector<int> &getCols() { return fCols; }
+
+  const std::vector<double> &getValues() { return fValues; }
+
+private:
+  Shape fDims;
+  std::vector<int> fRowStarts;
+  std::vector<int> fCols;
+  std::vector<double> fValues;
+};
+
+// a tensor constant stored in a file, written load("weights.bin")
+class LoadExpr : public Expr {
+public:
+  LoadExpr(const std::string &aPath, lexer::Location aLoc)
+      : Expr(std::move(aLoc)), fPath(aPath) {}
+
+  // the file as written in the source, relative to the working directory
+  const std::string &getPath() { return fPath; }
+  std::string &getMutablePath() { return fPath; }
+
+private:
+  std::string fPath;
 };
 
 class VarExpr : public Expr {
@@ -71,7 +123,7 @@ class VarDeclExpr : public Expr {
 public:
   VarDeclExpr(const std::string &aName, VarType aType,
               std::unique_ptr<Expr> aInitVal, lexer::Location aLoc)
-      : Expr(std::move(aLoc)), fName(aName), fType(aType),
+      : Expr(std::move(aLoc)), fName(aName), fType(std::move(aType)),
         fInitVal(std::move(aInitVal)) {}
 
   const std::string &getName() { return fName; }
@@ -80,6 +132,8 @@ public:
 
   Expr *getInitValue() { return fInitVal.get(); }
 
+  std::unique_ptr<Expr> &getMutableInitValue() { return fInitVal; }
+
 private:
   std::string fName;
   VarType fType;
@@ -98,6 +152,8 @@ public:
     return std::nullopt;
   }
 
+  std::optional<std::unique_ptr<Expr>> &getMutableExpr() { return fExpr; }
+
 private:
   std::optional<std::unique_ptr<Expr>> fExpr;
 };
@@ -115,6 +171,10 @@ public:
 
   Expr *getRHS() { return fRHS.get(); }
 
+  std::unique_ptr<Expr> &getMutableLHS() { return fLHS; }
+
+  std::unique_ptr<Expr> &getMutableRHS() { return fRHS; }
+
 private:
   char fOp;
   std::unique_ptr<Expr> fLHS;
@@ -123,16 +183,18 @@ private:
 
 class CallExpr : public Expr {
 public:
-  CallExpr(const std::string &aCallee, ExprList args, lexer::Location aLoc)
+  CallExpr(const std::string &aCallee, ArgList args, lexer::Location aLoc)
       : Expr(std::move(aLoc)), fCallee(aCallee), fArgs(std::move(args)) {}
 
   const std::string &getCallee() { return fCallee; }
 
-  const ExprList &getArgs() { return fArgs; }
+  const ArgList &getArgs() { return fArgs; }
+
+  ArgList &getMutableArgs() { return fArgs; }
 
 private:
   std::string fCallee;
-  ExprList fArgs;
+  ArgList fArgs;
 };
 
 class PrintExpr : public Expr {
@@ -142,22 +204,55 @@ public:
 
   Expr *getArg() { return fArg.get(); }
 
+  std::unique_ptr<Expr> &getMutableArg() { return fArg; }
+
 private:
   std::unique_ptr<Expr> fArg;
 };
 
+// one step of a fused elementwise program, either a load of an input or an
+// operator applied to the two values on top of the stack
+struct FusedOp {
+  // '+', '-', '*', or 0 for a load
+  char op;
+  // index of the loaded input
+  int input;
+};
+
+// a chain of elementwise binary operations evaluated in a single pass, built
+// by the fusion pass. the program is in postfix order over the inputs
+class FusedExpr : public Expr {
+public:
+  FusedExpr(ExprList aInputs, std::vector<FusedOp> aProgram,
+            lexer::Location aLoc)
+      : Expr(std::move(aLoc)), fInputs(std::move(aInputs)),
+        fProgram(std::move(aProgram)) {}
+
+  const ExprList &getInputs() { return fInputs; }
+
+  ExprList &getMutableInputs() { return fInputs; }
+
+  const std::vector<FusedOp> &getProgram() { return fProgram; }
+
+private:
+  ExprList fInputs;
+  std::vector<FusedOp> fProgram;
+};
+
+using ParamList = support::SmallVector<std::unique_ptr<VarExpr>, 4>;
+
 class Prototype : public Expr {
 public:
-  Prototype(const std::string &aName, std::vector<std::unique_ptr<VarExpr>> args, lexer::Location aLoc)
+  Prototype(const std::string &aName, ParamList args, lexer::Location aLoc)
       : Expr(std::move(aLoc)), fName(aName), fArgs(std::move(args)) {}
 
   const std::string &getName() { return fName; }
 
-  const std::vector<std::unique_ptr<VarExpr>> &getArgs() { return fArgs; }
+  const ParamList &getArgs() { return fArgs; }
 
 private:
   std::string fName;
-  std::vector<std::unique_ptr<VarExpr>> fArgs;
+  ParamList fArgs;
 };
 
 class Function {
@@ -184,10 +279,21 @@ class Module {
 
     auto end() { return fFunctions.end();}
 
+    std::vector<std::unique_ptr<Function>> &getFunctions() { return fFunctions; }
+
   private:
     std::vector<std::unique_ptr<Function>> fFunctions;
 };
 
 void dump(Module& aMod);
 
+// dump the module to the given stream instead of stdout
+void dump(Module& aMod, std::ostream& aOs);
+
+// deep copy of an expression tree, locations are preserved
+std::unique_ptr<Expr> clone(Expr *aExpr);
+
+// deep copy of every function of the module
+std::unique_ptr<Module> clone(Module &aModule);
+
 } // namespace toy
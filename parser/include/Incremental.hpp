@@ -0,0 +1,64 @@
+/*
+ *
+ * Incremental parsing of a source under edit.
+ *
+ * Every line of the source belongs to the definition starting on or before
+ * it. An edit lexes and parses again only the lines of the definitions it
+ * touches, splices the new functions into the module and moves the functions
+ * below down or up by the lines the edit added or removed. The other
+ * functions are kept as they are.
+ *
+ * If the edited definitions do not parse, their lines stay pending and are
+ * parsed again along with the next edit, so a typo does not cost a parse of
+ * the whole source once it is fixed.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace toy::parser {
+
+class IncrementalParser {
+public:
+  // parse the whole source
+  explicit IncrementalParser(std::string aSource);
+
+  // the module of the source, nullptr if it does not parse
+  Module *getModule();
+
+  const std::string &getSource() const { return fSource; }
+
+  // replace aLength bytes at aOffset of the source with aText and update the
+  // module. prints the error and returns false if the edited definitions do
+  // not parse or the range is outside the source
+  bool applyEdit(size_t aOffset, size_t aLength, const std::string &aText);
+
+  // number of lines parsed by the last update
+  int getLinesParsed() const { return fLinesParsed; }
+
+private:
+  // recompute the offset of every line
+  void indexLines();
+  // line holding the byte at aOffset, from 1
+  int getLine(size_t aOffset) const;
+  // line a function starts on
+  static int getFirstLine(Function &aFunction);
+
+  std::string fSource;
+  std::unique_ptr<Module> fModule;
+  // offset of the start of every line
+  std::vector<size_t> fLineStarts;
+  // lines that did not parse, their functions are not in the module
+  std::pair<int, int> fPending{0, 0};
+  bool fHasPending = false;
+  int fLinesParsed = 0;
+};
+
+} // namespace toy::parser
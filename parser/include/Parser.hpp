@@ -15,6 +15,11 @@ namespace toy::parser {
       Parser(std::unique_ptr<lexer::AbstractLexer> aLexer);
       std::unique_ptr<Module> parseModule();
 
+      // literals of at least kSparseMinElements elements, at most
+      // kSparseMaxDensity of them nonzero, are kept as a SparseLiteralExpr
+      static constexpr size_t kSparseMinElements = 64;
+      static constexpr double kSparseMaxDensity = 0.25;
+
     private:
       std::unique_ptr<Function> parseDefinition();
       std::unique_ptr<Prototype> parsePrototype();
@@ -28,11 +33,14 @@ namespace toy::parser {
       std::unique_ptr<Expr> parseIdentifierExpr();
       std::unique_ptr<Expr> parseNumberExpr();
       std::unique_ptr<Expr> parseParenExpr();
+      std::unique_ptr<Expr> parseLiteralExpr();
       std::unique_ptr<Expr> parseTensorLiteralExpr();
+      std::unique_ptr<Expr> parseLoadExpr(lexer::Location aLoc);
       int getTokPrecedence();
       
       template <typename R, typename T, typename U = const char *>
       std::unique_ptr<R> parseError(T &&expected, U &&context = "");
+      template <typename T> bool parseNumber(T &aValue);
 
       std::unique_ptr<lexer::AbstractLexer> fLexer;
   };
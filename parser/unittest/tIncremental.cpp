@@ -0,0 +1,93 @@
+#include "lexer/include/Lexer.hpp"
+#include "parser/include/Incremental.hpp"
+#include "parser/include/Parser.hpp"
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace toy;
+
+// dump of the module parsed from scratch
+static std::string dumpFull(const std::string &aSource) {
+  auto lexer = std::make_unique<lexer::Lexer>(std::stringstream(aSource));
+  auto module = parser::Parser(std::move(lexer)).parseModule();
+  std::stringstream os;
+  if (module) {
+    dump(*module, os);
+  }
+  return os.str();
+}
+
+static std::string dumpModule(Module *aModule) {
+  std::stringstream os;
+  if (aModule) {
+    dump(*aModule, os);
+  }
+  return os.str();
+}
+
+static const char *kSource = R"(# three functions
+def first(a) {
+  return a + a;
+}
+
+def second(b) {
+  var c = [1, 2, 3];
+  return b * c;
+}
+
+def main() {
+  print(second(first([4, 5, 6])));
+}
+)";
+
+TEST(Incremental, ReparsesTheEditedDefinition) {
+  parser::IncrementalParser parser(kSource);
+  ASSERT_NE(parser.getModule(), nullptr);
+  auto &functions = parser.getModule()->getFunctions();
+  auto *first = functions[0].get();
+  auto *main = functions[2].get();
+
+  // change a number of second
+  std::string source = kSource;
+  auto offset = source.find("[1, 2, 3]") + 1;
+  ASSERT_TRUE(parser.applyEdit(offset, 1, "7"));
+  EXPECT_EQ(parser.getLinesParsed(), 5);
+  EXPECT_EQ(functions[0].get(), first);
+  EXPECT_EQ(functions[2].get(), main);
+  EXPECT_EQ(dumpModule(parser.getModule()), dumpFull(parser.getSource()));
+
+  // new lines in first move the functions below
+  offset = parser.getSource().find("return a + a;");
+  ASSERT_TRUE(parser.applyEdit(offset, 0, "var d = a;\n\n  "));
+  EXPECT_EQ(parser.getLinesParsed(), 7);
+  EXPECT_EQ(functions[2].get(), main);
+  EXPECT_EQ(dumpModule(parser.getModule()), dumpFull(parser.getSource()));
+
+  // a new definition between two others
+  offset = parser.getSource().find("def main");
+  ASSERT_TRUE(parser.applyEdit(offset, 0, "def third() {\n  return 1;\n}\n"));
+  EXPECT_EQ(functions.size(), 4u);
+  EXPECT_EQ(dumpModule(parser.getModule()), dumpFull(parser.getSource()));
+}
+
+TEST(Incremental, PendingUntilItParses) {
+  parser::IncrementalParser parser(kSource);
+  auto offset = parser.getSource().find("b * c");
+  testing::internal::CaptureStdout();
+  EXPECT_FALSE(parser.applyEdit(offset + 4, 1, "* c\n\n"));
+  testing::internal::GetCapturedStdout();
+  EXPECT_EQ(parser.getModule(), nullptr);
+
+  // fixing it parses the pending lines with those of the new edit
+  offset = parser.getSource().find("* *");
+  ASSERT_TRUE(parser.applyEdit(offset, 2, ""));
+  EXPECT_EQ(dumpModule(parser.getModule()), dumpFull(parser.getSource()));
+  EXPECT_EQ(parser.getModule()->getFunctions().size(), 3u);
+
+  // outside the source
+  testing::internal::CaptureStdout();
+  EXPECT_FALSE(parser.applyEdit(parser.getSource().size(), 1, ""));
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "Edit error: range 160+1 is outside the source of 160 bytes\n");
+}
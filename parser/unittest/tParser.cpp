@@ -0,0 +1,194 @@
+#include "lexer/include/Lexer.hpp"
+#include "parser/include/Parser.hpp"
+#include "support/include/Statistics.hpp"
+#include <gtest/gtest.h>
+
+using namespace toy;
+
+// utility to parse a module from a string
+static std::unique_ptr<Module> parse(const char *aCode) {
+  auto lexer = std::make_unique<lexer::Lexer>(std::stringstream(aCode));
+  parser::Parser parser(std::move(lexer));
+  return parser.parseModule();
+}
+
+TEST(Parser, SimpleMain) {
+  auto module = parse(R"(
+    def main() {
+      var a<2, 2> = [[1, 2], [3.5, 4]];
+      print(transpose(a));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  auto &functions = module->getFunctions();
+  ASSERT_EQ(functions.size(), 1u);
+  EXPECT_EQ(functions[0]->getPrototype()->getName(), "main");
+
+  auto *body = functions[0]->getBody();
+  ASSERT_EQ(body->size(), 2u);
+
+  auto *decl = dynamic_cast<VarDeclExpr *>(body->at(0).get());
+  ASSERT_NE(decl, nullptr);
+  EXPECT_EQ(decl->getType().shape, (Shape{2, 2}));
+  auto *lit = dynamic_cast<LiteralExpr *>(decl->getInitValue());
+  ASSERT_NE(lit, nullptr);
+  EXPECT_EQ(lit->getDims(), (Shape{2, 2}));
+
+  auto *print = dynamic_cast<PrintExpr *>(body->at(1).get());
+  ASSERT_NE(print, nullptr);
+  auto *call = dynamic_cast<CallExpr *>(print->getArg());
+  ASSERT_NE(call, nullptr);
+  EXPECT_EQ(call->getCallee(), "transpose");
+
+  // numbers are dumped in their shortest form
+  std::ostringstream oss;
+  dump(*module, oss);
+  EXPECT_NE(oss.str().find("Literal: <2,2,>[<2,>[1,2,],<2,>[3.5,4,],]"),
+            std::string::npos);
+}
+
+TEST(Parser, DumpAndClone) {
+  auto module = parse(R"(
+    def multiply_transpose(a, b) {
+      return transpose(a) * transpose(b);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  std::ostringstream oss;
+  dump(*module, oss);
+  EXPECT_NE(oss.str().find("Proto 'multiply_transpose' @buffer:2:5"),
+            std::string::npos);
+
+  auto *ret = dynamic_cast<ReturnExpr *>(
+      module->getFunctions()[0]->getBody()->at(0).get());
+  ASSERT_NE(ret, nullptr);
+  auto copy = clone(*ret->getExpr());
+  auto *bin = dynamic_cast<BinaryExpr *>(copy.get());
+  ASSERT_NE(bin, nullptr);
+  EXPECT_EQ(bin->getOp(), '*');
+  EXPECT_NE(bin->getLHS(), dynamic_cast<BinaryExpr *>(*ret->getExpr())->getLHS());
+
+  // a cloned module dumps the same
+  auto moduleCopy = clone(*module);
+  std::ostringstream copyOss;
+  dump(*moduleCopy, copyOss);
+  EXPECT_EQ(copyOss.str(), oss.str());
+}
+
+TEST(Parser, Load) {
+  auto module = parse(R"(
+    def main() {
+      var w<2, 3> = load("data/w.bin");
+      var load = 1;
+      print(w + load);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+
+  auto *body = module->getFunctions()[0]->getBody();
+  auto *decl = dynamic_cast<VarDeclExpr *>(body->at(0).get());
+  ASSERT_NE(decl, nullptr);
+  auto *load = dynamic_cast<LoadExpr *>(decl->getInitValue());
+  ASSERT_NE(load, nullptr);
+  EXPECT_EQ(load->getPath(), "data/w.bin");
+
+  std::ostringstream oss;
+  dump(*module, oss);
+  EXPECT_NE(oss.str().find("Load: \"data/w.bin\" @buffer:3:21"),
+            std::string::npos);
+  std::ostringstream copyOss;
+  dump(*clone(*module), copyOss);
+  EXPECT_EQ(copyOss.str(), oss.str());
+
+  // the path is a single string
+  testing::internal::CaptureStdout();
+  EXPECT_EQ(parse("def main() { var w = load(w); }"), nullptr);
+  EXPECT_EQ(parse("def main() { var w = load(\"w.bin); }"), nullptr);
+  testing::internal::GetCapturedStdout();
+}
+
+TEST(Parser, InvalidNumber) {
+  testing::internal::CaptureStdout();
+  EXPECT_EQ(parse("def main() { print(.); }"), nullptr);
+  EXPECT_EQ(parse("def main() { print(1.2.3); }"), nullptr);
+  auto big = "def main() { print(1" + std::string(400, '0') + "); }";
+  EXPECT_EQ(parse(big.c_str()), nullptr);
+  EXPECT_EQ(parse("def main() { var a<99999999999> = [1]; }"), nullptr);
+  auto out = testing::internal::GetCapturedStdout();
+  EXPECT_NE(out.find("invalid number '.'"), std::string::npos);
+}
+
+TEST(Parser, SparseLiteral) {
+  // 64 elements, 3 of them nonzero
+  std::string rows;
+  for (int row = 0; row < 8; ++row) {
+    rows += row ? ", [" : "[";
+    for (int col = 0; col < 8; ++col) {
+      int value = row == col && row % 3 == 0 ? row + 1 : 0;
+      rows += (col ? ", " : "") + std::to_string(value);
+    }
+    rows += "]";
+  }
+  auto module = parse(("def main() { print([" + rows + "]); print([" +
+                       rows.substr(0, 24) + "]); }")
+                          .c_str());
+  ASSERT_NE(module, nullptr);
+
+  auto *body = module->getFunctions()[0]->getBody();
+  auto *print = dynamic_cast<PrintExpr *>(body->at(0).get());
+  ASSERT_NE(print, nullptr);
+  auto *sparse = dynamic_cast<SparseLiteralExpr *>(print->getArg());
+  ASSERT_NE(sparse, nullptr);
+  EXPECT_EQ(sparse->getDims(), (Shape{8, 8}));
+  EXPECT_EQ(sparse->getRowStarts(),
+            (std::vector<int>{0, 1, 1, 1, 2, 2, 2, 3, 3}));
+  EXPECT_EQ(sparse->getCols(), (std::vector<int>{0, 3, 6}));
+  EXPECT_EQ(sparse->getValues(), (std::vector<double>{1, 4, 7}));
+
+  // a small literal stays dense
+  print = dynamic_cast<PrintExpr *>(body->at(1).get());
+  EXPECT_NE(dynamic_cast<LiteralExpr *>(print->getArg()), nullptr);
+
+  std::ostringstream oss;
+  dump(*module, oss);
+  EXPECT_NE(oss.str().find("SparseLiteral: <8,8,> rows[0,1,1,1,2,2,2,3,3,] "
+                           "cols[0,3,6,] values[1,4,7,]"),
+            std::string::npos);
+  std::ostringstream copyOss;
+  dump(*clone(*module), copyOss);
+  EXPECT_EQ(copyOss.str(), oss.str());
+}
+
+// allocations of the front end on a fixed program, raise a budget only along
+// with a change that needs it
+TEST(Parser, AllocationBudget) {
+  const char *code = R"(
+    def multiply_transpose(a, b) {
+      return transpose(a) * transpose(b);
+    }
+
+    def main() {
+      var a<2, 3> = [[1, 2, 3], [4, 5, 6]];
+      var b<2, 3> = [1, 2, 3, 4, 5, 6];
+      var c = multiply_transpose(a, b);
+      print(c + a);
+    }
+  )";
+  support::setAllocationTracking(true);
+  support::resetReport();
+  support::setReportEnabled(true);
+  auto module = parse(code);
+  support::setReportEnabled(false);
+  support::setAllocationTracking(false);
+  ASSERT_NE(module, nullptr);
+
+  auto report = support::getReport();
+  std::stringstream err;
+  EXPECT_TRUE(support::checkBudgets(
+      report, {{"parse", 81, 4450}}, err))
+      << err.str();
+  EXPECT_EQ(report.counters["ast.NumberExpr"], 12u);
+  EXPECT_EQ(report.tags["ast.NumberExpr"].allocations, 12u);
+}
@@ -0,0 +1,372 @@
+#include "runtime/include/Kernels.hpp"
+#include "runtime/include/StaticKernels.hpp"
+#include "support/include/Trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+namespace toy::runtime {
+
+// number of elements a fused program processes at a time, small enough for
+// the intermediate values to stay in L1
+static constexpr size_t kBlockSize = 256;
+
+// apply aOp to aLen elements, aLHSStep / aRHSStep are 0 to broadcast a scalar
+template <typename T>
+static void apply(char aOp, const T *aLHS, size_t aLHSStep, const T *aRHS,
+                  size_t aRHSStep, T *aOut, size_t aLen) {
+  switch (aOp) {
+  case '+':
+    for (size_t i = 0; i < aLen; ++i) {
+      aOut[i] = aLHS[i * aLHSStep] + aRHS[i * aRHSStep];
+    }
+    break;
+  case '-':
+    for (size_t i = 0; i < aLen; ++i) {
+      aOut[i] = aLHS[i * aLHSStep] - aRHS[i * aRHSStep];
+    }
+    break;
+  case '*':
+    for (size_t i = 0; i < aLen; ++i) {
+      aOut[i] = aLHS[i * aLHSStep] * aRHS[i * aRHSStep];
+    }
+    break;
+  default:
+    assert(false && "unknown elementwise operator");
+  }
+}
+
+// aLHS op aRHS for a single pair of elements
+static double apply(char aOp, double aLHS, double aRHS) {
+  double out;
+  apply(aOp, &aLHS, 0, &aRHS, 0, &out, 1);
+  return out;
+}
+
+// the value a sparse tensor has wherever it stores nothing. -0 is not one, it
+// prints differently
+static bool isImplicitZero(double aValue) {
+  return aValue == 0 && !std::signbit(aValue);
+}
+
+// aLHS op aRHS with at least one sparse operand, computed over the stored
+// elements only. false if the result has nonzeros where neither operand
+// stores one, e.g. a sum with a dense tensor, then aOut is untouched
+static bool sparseElementwise(char aOp, const Tensor &aLHS, const Tensor &aRHS,
+                              Tensor &aOut) {
+  bool lhsSparse = aLHS.isSparse();
+  const Tensor &sparse = lhsSparse ? aLHS : aRHS;
+  const Tensor &other = lhsSparse ? aRHS : aLHS;
+  const CSR &nonZeros = sparse.getNonZeros();
+  // aOp on an element of each operand, in source order. a float32 result is
+  // rounded as if computed in float, which is exact for '+', '-' and '*'
+  bool isFloat32 = sparse.getElementType() == ElementType::Float32;
+  auto op = [&](double aSparse, double aOther) {
+    double value = lhsSparse ? apply(aOp, aSparse, aOther)
+                             : apply(aOp, aOther, aSparse);
+    return isFloat32 ? static_cast<float>(value) : value;
+  };
+
+  CSR out;
+  out.rowStarts.reserve(nonZeros.rowStarts.size());
+  auto store = [&](int aCol, double aValue) {
+    if (!isImplicitZero(aValue)) {
+      out.cols.push_back(aCol);
+      out.values.push_back(aValue);
+    }
+  };
+  int rows = nonZeros.rowStarts.size() - 1;
+
+  if (other.isScalar()) {
+    double scalar = other.getElement(0);
+    if (!isImplicitZero(op(0, scalar))) {
+      return false;
+    }
+    for (int row = 0; row < rows; ++row) {
+      out.rowStarts.push_back(out.cols.size());
+      for (int i = nonZeros.rowStarts[row]; i < nonZeros.rowStarts[row + 1];
+           ++i) {
+        store(nonZeros.cols[i], op(nonZeros.values[i], scalar));
+      }
+    }
+  } else if (other.isSparse()) {
+    // both operands are zero where neither stores an element, as is the
+    // result of '+', '-' and '*'
+    const CSR &otherNonZeros = other.getNonZeros();
+    for (int row = 0; row < rows; ++row) {
+      out.rowStarts.push_back(out.cols.size());
+      int i = nonZeros.rowStarts[row];
+      int j = otherNonZeros.rowStarts[row];
+      int end = nonZeros.rowStarts[row + 1];
+      int otherEnd = otherNonZeros.rowStarts[row + 1];
+      while (i < end || j < otherEnd) {
+        int col = i < end ? nonZeros.cols[i] : INT_MAX;
+        int otherCol = j < otherEnd ? otherNonZeros.cols[j] : INT_MAX;
+        if (col == otherCol) {
+          store(col, op(nonZeros.values[i++], otherNonZeros.values[j++]));
+        } else if (col < otherCol) {
+          store(col, op(nonZeros.values[i++], 0));
+        } else {
+          store(otherCol, op(0, otherNonZeros.values[j++]));
+        }
+      }
+    }
+  } else {
+    // a dense operand must give zeros wherever the sparse one has none, as
+    // it does for a product with finite non negative elements
+    Tensor dense = other.contiguous();
+    int cols = getNumCols(dense.getDims());
+    bool isSparse = visit(dense.getElementType(), [&](auto aZero) {
+      const auto *data = dense.getElements<decltype(aZero)>();
+      for (int row = 0; row < rows; ++row) {
+        out.rowStarts.push_back(out.cols.size());
+        const auto *rowData = data + size_t(row) * cols;
+        int i = nonZeros.rowStarts[row];
+        int end = nonZeros.rowStarts[row + 1];
+        for (int col = 0; col < cols; ++col) {
+          if (i < end && nonZeros.cols[i] == col) {
+            store(col, op(nonZeros.values[i++], rowData[col]));
+          } else if (!isImplicitZero(op(0, rowData[col]))) {
+            return false;
+          }
+        }
+      }
+      return true;
+    });
+    if (!isSparse) {
+      return false;
+    }
+  }
+  out.rowStarts.push_back(out.cols.size());
+  aOut = Tensor::sparse(sparse.getDims(), std::move(out),
+                        sparse.getElementType());
+  return true;
+}
+
+// true if the buffer of aTensor can be overwritten by a result of aDims
+static bool isReusable(const Tensor &aTensor, const Dims &aDims) {
+  return aTensor.isUnique() && aTensor.isContiguous() &&
+         aTensor.getDims() == aDims;
+}
+
+static void evaluate(const std::vector<FusedOp> &aProgram,
+                     const std::vector<const Tensor *> &aInputs, Tensor &aOut);
+
+Tensor elementwise(char aOp, const Tensor &aLHS, const Tensor &aRHS) {
+  TOY_TRACE_SCOPE("elementwise");
+  assert((aLHS.getDims() == aRHS.getDims() || aLHS.isScalar() ||
+          aRHS.isScalar()) &&
+         aLHS.getElementType() == aRHS.getElementType() &&
+         "incompatible elementwise operands");
+
+  if (aLHS.isSparse() || aRHS.isSparse()) {
+    TOY_TRACE_SCOPE("sparse elementwise");
+    Tensor result;
+    if (sparseElementwise(aOp, aLHS, aRHS, result)) {
+      return result;
+    }
+    return elementwise(aOp, aLHS.isSparse() ? aLHS.contiguous() : aLHS,
+                       aRHS.isSparse() ? aRHS.contiguous() : aRHS);
+  }
+
+  // small shapes known at build time have unrolled kernels
+  Tensor result;
+  if (staticElementwise(aOp, aLHS, aRHS, result)) {
+    return result;
+  }
+
+  // strided views, such as transposes, are read in place by the fused kernel
+  if (!aLHS.isContiguous() || !aRHS.isContiguous()) {
+    return fused({{0, 0}, {0, 1}, {aOp, 0}}, {&aLHS, &aRHS});
+  }
+
+  Tensor out(aLHS.isScalar() ? aRHS.getDims() : aLHS.getDims(),
+             aLHS.getElementType());
+  visit(out.getElementType(), [&](auto aZero) {
+    using T = decltype(aZero);
+    apply(aOp, aLHS.getElements<T>(), !aLHS.isScalar(),
+          aRHS.getElements<T>(), !aRHS.isScalar(),
+          out.getMutableElements<T>(), out.getNumElements());
+  });
+  return out;
+}
+
+Tensor elementwise(char aOp, Tensor &&aLHS, Tensor &&aRHS) {
+  TOY_TRACE_SCOPE("elementwise in place");
+  assert((aLHS.getDims() == aRHS.getDims() || aLHS.isScalar() ||
+          aRHS.isScalar()) &&
+         aLHS.getElementType() == aRHS.getElementType() &&
+         "incompatible elementwise operands");
+
+  if (aLHS.isSparse() || aRHS.isSparse()) {
+    return elementwise(aOp, std::as_const(aLHS), std::as_const(aRHS));
+  }
+
+  auto &dims = aLHS.isScalar() ? aRHS.getDims() : aLHS.getDims();
+  Tensor *reused = isReusable(aLHS, dims)   ? &aLHS
+                   : isReusable(aRHS, dims) ? &aRHS
+                                            : nullptr;
+  if (!reused) {
+    return elementwise(aOp, std::as_const(aLHS), std::as_const(aRHS));
+  }
+
+  // the result is written over the operand, element by element
+  Tensor out = std::move(*reused);
+  const Tensor &lhs = reused == &aLHS ? out : aLHS;
+  const Tensor &rhs = reused == &aRHS ? out : aRHS;
+  if (staticElementwise(aOp, lhs, rhs, out)) {
+    return out;
+  }
+  if (lhs.isContiguous() && rhs.isContiguous()) {
+    visit(out.getElementType(), [&](auto aZero) {
+      using T = decltype(aZero);
+      apply(aOp, lhs.getElements<T>(), !lhs.isScalar(), rhs.getElements<T>(),
+            !rhs.isScalar(), out.getMutableElements<T>(),
+            out.getNumElements());
+    });
+  } else {
+    evaluate({{0, 0}, {0, 1}, {aOp, 0}}, {&lhs, &rhs}, out);
+  }
+  return out;
+}
+
+Tensor transpose(const Tensor &aTensor) {
+  TOY_TRACE_SCOPE("transpose");
+  return aTensor.transposed();
+}
+
+// evaluate a fused program into aOut with elements of type T
+template <typename T>
+static void evaluate(const std::vector<FusedOp> &aProgram,
+                     const std::vector<const Tensor *> &aInputs, Tensor &aOut) {
+  // one block of scratch per stack slot
+  int depth = 0;
+  int maxDepth = 0;
+  for (auto &op : aProgram) {
+    depth += op.op == 0 ? 1 : -1;
+    maxDepth = std::max(maxDepth, depth);
+  }
+  assert(depth == 1 && "malformed fused program");
+  std::vector<T> stack(maxDepth * kBlockSize);
+
+  // strided inputs are gathered through a cursor that moves with the blocks
+  std::vector<std::unique_ptr<StridedCursor>> cursors(aInputs.size());
+  std::vector<std::vector<long>> offsets(aInputs.size());
+  for (size_t i = 0; i < aInputs.size(); ++i) {
+    if (!aInputs[i]->isScalar() && !aInputs[i]->isContiguous()) {
+      cursors[i] = std::make_unique<StridedCursor>(*aInputs[i]);
+      offsets[i].resize(kBlockSize);
+    }
+  }
+
+  T *out = aOut.getMutableElements<T>();
+  size_t size = aOut.getNumElements();
+  for (size_t begin = 0; begin < size; begin += kBlockSize) {
+    size_t len = std::min(kBlockSize, size - begin);
+    for (size_t i = 0; i < aInputs.size(); ++i) {
+      if (cursors[i]) {
+        for (size_t j = 0; j < len; ++j) {
+          offsets[i][j] = cursors[i]->next();
+        }
+      }
+    }
+
+    int top = 0;
+    for (auto &op : aProgram) {
+      if (op.op == 0) {
+        T *slot = &stack[top++ * kBlockSize];
+        const Tensor *input = aInputs[op.input];
+        const T *data = input->getElements<T>();
+        if (input->isScalar()) {
+          std::fill(slot, slot + len, data[0]);
+        } else if (cursors[op.input]) {
+          auto &inputOffsets = offsets[op.input];
+          for (size_t j = 0; j < len; ++j) {
+            slot[j] = data[inputOffsets[j]];
+          }
+        } else {
+          std::copy(data + begin, data + begin + len, slot);
+        }
+        continue;
+      }
+      --top;
+      T *lhs = &stack[(top - 1) * kBlockSize];
+      T *rhs = &stack[top * kBlockSize];
+      apply(op.op, lhs, 1, rhs, 1, lhs, len);
+    }
+    std::copy(stack.begin(), stack.begin() + len, out + begin);
+  }
+}
+
+// evaluate a fused program into aOut, which is already shaped for the result.
+// aOut may be one of the inputs, a block is loaded before it is written
+static void evaluate(const std::vector<FusedOp> &aProgram,
+                     const std::vector<const Tensor *> &aInputs, Tensor &aOut) {
+  visit(aOut.getElementType(), [&](auto aZero) {
+    evaluate<decltype(aZero)>(aProgram, aInputs, aOut);
+  });
+}
+
+// dims of the result of a fused program over the inputs
+static const Dims &getResultDims(const std::vector<const Tensor *> &aInputs) {
+  static const Dims scalar;
+  const Dims *dims = &scalar;
+  for (auto *input : aInputs) {
+    assert(input->getElementType() == aInputs[0]->getElementType() &&
+           "fused operands of different element types");
+    if (!input->isScalar()) {
+      assert((dims->empty() || *dims == input->getDims()) &&
+             "incompatible fused operands");
+      dims = &input->getDims();
+    }
+  }
+  return *dims;
+}
+
+Tensor fused(const std::vector<FusedOp> &aProgram,
+             const std::vector<const Tensor *> &aInputs) {
+  TOY_TRACE_SCOPE("fused");
+  // a fused program reads every element, sparse inputs are expanded first
+  std::vector<Tensor> expanded;
+  expanded.reserve(aInputs.size());
+  std::vector<const Tensor *> inputs = aInputs;
+  for (auto &input : inputs) {
+    if (input->isSparse()) {
+      expanded.push_back(input->contiguous());
+      input = &expanded.back();
+    }
+  }
+  Tensor out(getResultDims(inputs), inputs[0]->getElementType());
+  evaluate(aProgram, inputs, out);
+  return out;
+}
+
+Tensor fusedReusing(const std::vector<FusedOp> &aProgram,
+                    std::vector<Tensor> &&aInputs) {
+  TOY_TRACE_SCOPE("fused in place");
+  std::vector<const Tensor *> inputs;
+  for (auto &input : aInputs) {
+    if (input.isSparse()) {
+      input = input.contiguous();
+    }
+    inputs.push_back(&input);
+  }
+  auto &dims = getResultDims(inputs);
+  for (size_t i = 0; i < aInputs.size(); ++i) {
+    if (isReusable(aInputs[i], dims)) {
+      Tensor out = std::move(aInputs[i]);
+      inputs[i] = &out;
+      evaluate(aProgram, inputs, out);
+      return out;
+    }
+  }
+  Tensor out(dims, inputs[0]->getElementType());
+  evaluate(aProgram, inputs, out);
+  return out;
+}
+
+} // namespace toy::runtime
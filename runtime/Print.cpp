@@ -0,0 +1,67 @@
+#include "runtime/include/Print.hpp"
+#include "support/include/Format.hpp"
+
+namespace toy::runtime {
+
+// print a dense tensor with elements of type T, each in the shortest form that
+// reads back as the same T
+template <typename T>
+static void printElements(std::ostream &aOs, const Tensor &aTensor) {
+  support::OutputBuffer out(aOs);
+  auto &dims = aTensor.getDims();
+  int rank = dims.size();
+  if (rank == 0) {
+    out.appendNumber(aTensor.getElements<T>()[0]);
+    out.append('\n');
+    return;
+  }
+
+  StridedCursor cursor(aTensor);
+  const T *data = aTensor.getElements<T>();
+  std::vector<int> index(rank, 0);
+  size_t size = aTensor.getNumElements();
+
+  for (int i = 0; i < rank; ++i) {
+    out.append('[');
+  }
+  for (size_t n = 0; n < size; ++n) {
+    out.appendNumber(data[cursor.next()]);
+    // close the dims that wrapped around, then reopen them
+    int closed = 0;
+    for (int i = rank - 1; i >= 0; --i) {
+      if (++index[i] < dims[i]) {
+        break;
+      }
+      index[i] = 0;
+      ++closed;
+    }
+    for (int i = 0; i < closed; ++i) {
+      out.append(']');
+    }
+    if (n + 1 < size) {
+      out.append(", ");
+      for (int i = 0; i < closed; ++i) {
+        out.append('[');
+      }
+    }
+  }
+  if (size == 0) {
+    for (int i = 0; i < rank; ++i) {
+      out.append(']');
+    }
+  }
+  out.append('\n');
+}
+
+void print(std::ostream &aOs, const Tensor &aTensor) {
+  // every element is printed, zeros included
+  if (aTensor.isSparse()) {
+    print(aOs, aTensor.contiguous());
+    return;
+  }
+  visit(aTensor.getElementType(), [&](auto aZero) {
+    printElements<decltype(aZero)>(aOs, aTensor);
+  });
+}
+
+} // namespace toy::runtime
@@ -0,0 +1,135 @@
+#include "runtime/include/StaticKernels.hpp"
+
+#include "runtime/include/StaticShapes.inc"
+
+namespace toy::runtime {
+
+// true if the tensor is the transpose of a contiguous C x R tensor
+template <int R, int C> static bool isTransposed(const Tensor &aTensor) {
+  auto &strides = aTensor.getStrides();
+  return strides[0] == 1 && strides[1] == R;
+}
+
+// contiguous data of an R x C operand, transposed views are materialized in
+// aScratch. nullptr if the layout has no kernel
+template <int R, int C>
+static const double *load(const Tensor &aTensor, double *aScratch) {
+  if (aTensor.isScalar() || aTensor.isContiguous()) {
+    return aTensor.getData();
+  }
+  if (isTransposed<R, C>(aTensor)) {
+    staticTranspose<C, R>(aTensor.getData(), aScratch);
+    return aScratch;
+  }
+  return nullptr;
+}
+
+template <int N, char Op>
+static void apply(const double *aLHS, bool aLHSScalar, const double *aRHS,
+                  bool aRHSScalar, double *aOut) {
+  if (aLHSScalar) {
+    staticApply<N, Op, 0, 1>(aLHS, aRHS, aOut);
+  } else if (aRHSScalar) {
+    staticApply<N, Op, 1, 0>(aLHS, aRHS, aOut);
+  } else {
+    staticApply<N, Op, 1, 1>(aLHS, aRHS, aOut);
+  }
+}
+
+template <int R, int C>
+static bool elementwise(char aOp, const Tensor &aLHS, const Tensor &aRHS,
+                        Tensor &aOut) {
+  double lhsScratch[R * C];
+  double rhsScratch[R * C];
+  const double *lhs = load<R, C>(aLHS, lhsScratch);
+  const double *rhs = load<R, C>(aRHS, rhsScratch);
+  if (!lhs || !rhs) {
+    return false;
+  }
+
+  // aOut may be one of the operands, it is only replaced once the result is
+  // computed
+  bool reuse = aOut.isUnique() &&
+               aOut.getElementType() == ElementType::Float64 &&
+               aOut.isContiguous() &&
+               aOut.getRank() == 2 && aOut.getDims()[0] == R &&
+               aOut.getDims()[1] == C;
+  Tensor fresh;
+  if (!reuse) {
+    fresh = Tensor(Dims{R, C});
+  }
+  double *out = reuse ? aOut.getMutableData() : fresh.getMutableData();
+  switch (aOp) {
+  case '+':
+    apply<R * C, '+'>(lhs, aLHS.isScalar(), rhs, aRHS.isScalar(), out);
+    break;
+  case '-':
+    apply<R * C, '-'>(lhs, aLHS.isScalar(), rhs, aRHS.isScalar(), out);
+    break;
+  case '*':
+    apply<R * C, '*'>(lhs, aLHS.isScalar(), rhs, aRHS.isScalar(), out);
+    break;
+  default:
+    return false;
+  }
+  if (!reuse) {
+    aOut = std::move(fresh);
+  }
+  return true;
+}
+
+template <int R, int C>
+static bool contiguous(const Tensor &aTensor, Tensor &aOut) {
+  if (!isTransposed<R, C>(aTensor)) {
+    return false;
+  }
+  Tensor out(Dims{R, C});
+  staticTranspose<C, R>(aTensor.getData(), out.getMutableData());
+  aOut = std::move(out);
+  return true;
+}
+
+bool hasStaticKernels(const Dims &aDims) {
+  if (aDims.size() != 2) {
+    return false;
+  }
+#define TOY_STATIC_HAS(R, C)                                                   \
+  if (aDims[0] == R && aDims[1] == C) {                                        \
+    return true;                                                               \
+  }
+  TOY_STATIC_SHAPES(TOY_STATIC_HAS)
+#undef TOY_STATIC_HAS
+  return false;
+}
+
+bool staticElementwise(char aOp, const Tensor &aLHS, const Tensor &aRHS,
+                       Tensor &aOut) {
+  auto &dims = aLHS.isScalar() ? aRHS.getDims() : aLHS.getDims();
+  if (dims.size() != 2 || aLHS.getElementType() != ElementType::Float64 ||
+      aRHS.getElementType() != ElementType::Float64) {
+    return false;
+  }
+#define TOY_STATIC_ELEMENTWISE(R, C)                                           \
+  if (dims[0] == R && dims[1] == C) {                                          \
+    return elementwise<R, C>(aOp, aLHS, aRHS, aOut);                           \
+  }
+  TOY_STATIC_SHAPES(TOY_STATIC_ELEMENTWISE)
+#undef TOY_STATIC_ELEMENTWISE
+  return false;
+}
+
+bool staticContiguous(const Tensor &aTensor, Tensor &aOut) {
+  auto &dims = aTensor.getDims();
+  if (dims.size() != 2 || aTensor.getElementType() != ElementType::Float64) {
+    return false;
+  }
+#define TOY_STATIC_CONTIGUOUS(R, C)                                            \
+  if (dims[0] == R && dims[1] == C) {                                          \
+    return contiguous<R, C>(aTensor, aOut);                                    \
+  }
+  TOY_STATIC_SHAPES(TOY_STATIC_CONTIGUOUS)
+#undef TOY_STATIC_CONTIGUOUS
+  return false;
+}
+
+} // namespace toy::runtime
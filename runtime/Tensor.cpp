@@ -0,0 +1,361 @@
+#include "runtime/include/Tensor.hpp"
+#include "runtime/include/StaticKernels.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace toy::runtime {
+
+size_t getNumElements(const Dims &aDims) {
+  size_t count = 1;
+  for (auto dim : aDims) {
+    count *= dim;
+  }
+  return count;
+}
+
+Strides getContiguousStrides(const Dims &aDims) {
+  Strides strides(aDims.size(), 1);
+  for (int i = static_cast<int>(aDims.size()) - 2; i >= 0; --i) {
+    strides[i] = strides[i + 1] * aDims[i + 1];
+  }
+  return strides;
+}
+
+int getNumCols(const Dims &aDims) { return aDims.empty() ? 1 : aDims.back(); }
+
+int getNumRows(const Dims &aDims) {
+  int rows = 1;
+  for (size_t i = 0; i + 1 < aDims.size(); ++i) {
+    rows *= aDims[i];
+  }
+  return rows;
+}
+
+size_t getElementSize(ElementType aType) {
+  return aType == ElementType::Float32 ? sizeof(float) : sizeof(double);
+}
+
+const char *getElementTypeName(ElementType aType) {
+  return aType == ElementType::Float32 ? "float32" : "float64";
+}
+
+// the elements of aData, owned by the returned pointer
+template <typename T>
+static std::shared_ptr<void> makeBuffer(std::vector<T> aData) {
+  auto data = std::make_shared<std::vector<T>>(std::move(aData));
+  return std::shared_ptr<void>(data, data->data());
+}
+
+// default tensors share one buffer so empty registers do not allocate
+Tensor::Tensor() {
+  static const auto zero = makeBuffer(std::vector<double>{0.0});
+  fBuffer = zero;
+}
+
+Tensor::Tensor(Dims aDims, ElementType aType)
+    : fType(aType), fDims(std::move(aDims)),
+      fStrides(getContiguousStrides(fDims)),
+      fNumElements(runtime::getNumElements(fDims)) {
+  fBuffer = visit(fType, [&](auto aZero) {
+    return makeBuffer(std::vector<decltype(aZero)>(fNumElements, aZero));
+  });
+}
+
+Tensor::Tensor(Dims aDims, std::vector<double> aData)
+    : fDims(std::move(aDims)), fStrides(getContiguousStrides(fDims)),
+      fNumElements(runtime::getNumElements(fDims)) {
+  assert(aData.size() == fNumElements && "tensor data size mismatch");
+  fBuffer = makeBuffer(std::move(aData));
+}
+
+Tensor Tensor::float32(Dims aDims, std::vector<float> aData) {
+  Tensor tensor;
+  tensor.fType = ElementType::Float32;
+  tensor.fNumElements = runtime::getNumElements(aDims);
+  assert(aData.size() == tensor.fNumElements && "tensor data size mismatch");
+  tensor.fStrides = getContiguousStrides(aDims);
+  tensor.fDims = std::move(aDims);
+  tensor.fBuffer = makeBuffer(std::move(aData));
+  return tensor;
+}
+
+Tensor Tensor::scalar(double aValue, ElementType aType) {
+  if (aType == ElementType::Float32) {
+    return float32(Dims(), {static_cast<float>(aValue)});
+  }
+  return Tensor(Dims(), std::vector<double>{aValue});
+}
+
+Tensor Tensor::external(Dims aDims, ElementType aType, const void *aData,
+                        std::shared_ptr<const void> aOwner) {
+  Tensor tensor;
+  tensor.fType = aType;
+  tensor.fNumElements = runtime::getNumElements(aDims);
+  tensor.fStrides = getContiguousStrides(aDims);
+  tensor.fDims = std::move(aDims);
+  // never written through, isUnique() is false for read only buffers
+  tensor.fBuffer =
+      std::shared_ptr<void>(std::move(aOwner), const_cast<void *>(aData));
+  tensor.fReadOnly = true;
+  return tensor;
+}
+
+Tensor Tensor::sparse(Dims aDims, CSR aNonZeros, ElementType aType) {
+  assert(!aDims.empty() && "a scalar is never sparse");
+  assert(aNonZeros.rowStarts.size() == size_t(getNumRows(aDims)) + 1 &&
+         aNonZeros.cols.size() == aNonZeros.values.size() &&
+         "malformed sparse tensor");
+  if (aType == ElementType::Float32) {
+    for (auto &value : aNonZeros.values) {
+      value = static_cast<float>(value);
+    }
+  }
+  Tensor tensor;
+  tensor.fType = aType;
+  tensor.fNumElements = runtime::getNumElements(aDims);
+  tensor.fStrides = getContiguousStrides(aDims);
+  tensor.fDims = std::move(aDims);
+  tensor.fSparse = std::make_shared<const CSR>(std::move(aNonZeros));
+  return tensor;
+}
+
+Tensor Tensor::toSparse(const Tensor &aTensor) {
+  if (aTensor.isSparse()) {
+    return aTensor;
+  }
+  Tensor dense = aTensor.contiguous();
+  int rows = getNumRows(dense.fDims);
+  int cols = getNumCols(dense.fDims);
+  CSR nonZeros;
+  nonZeros.rowStarts.reserve(rows + 1);
+  visit(dense.fType, [&](auto aZero) {
+    const auto *data = dense.getElements<decltype(aZero)>();
+    for (int row = 0; row < rows; ++row) {
+      nonZeros.rowStarts.push_back(nonZeros.cols.size());
+      for (int col = 0; col < cols; ++col) {
+        double value = data[size_t(row) * cols + col];
+        if (value != 0) {
+          nonZeros.cols.push_back(col);
+          nonZeros.values.push_back(value);
+        }
+      }
+    }
+  });
+  nonZeros.rowStarts.push_back(nonZeros.cols.size());
+  return sparse(dense.fDims, std::move(nonZeros), dense.fType);
+}
+
+Tensor Tensor::converted(ElementType aType) const {
+  if (aType == fType) {
+    return *this;
+  }
+  if (fSparse) {
+    return sparse(fDims, *fSparse, aType);
+  }
+  Tensor out(fDims, aType);
+  visit(aType, [&](auto aZero) {
+    auto *data = out.getMutableElements<decltype(aZero)>();
+    for (size_t i = 0; i < fNumElements; ++i) {
+      data[i] = getElement(i);
+    }
+  });
+  return out;
+}
+
+bool Tensor::isContiguous() const {
+  // a sparse tensor has no layout to read in place
+  if (fSparse) {
+    return false;
+  }
+  long expected = 1;
+  for (int i = getRank() - 1; i >= 0; --i) {
+    // the stride of a dim of one element never matters
+    if (fDims[i] != 1 && fStrides[i] != expected) {
+      return false;
+    }
+    expected *= fDims[i];
+  }
+  return true;
+}
+
+double Tensor::getElement(size_t aIndex) const {
+  if (fSparse) {
+    size_t cols = getNumCols(fDims);
+    size_t row = aIndex / cols;
+    int col = aIndex % cols;
+    auto first = fSparse->cols.begin() + fSparse->rowStarts[row];
+    auto last = fSparse->cols.begin() + fSparse->rowStarts[row + 1];
+    auto it = std::lower_bound(first, last, col);
+    return it != last && *it == col
+               ? fSparse->values[it - fSparse->cols.begin()]
+               : 0.0;
+  }
+  long offset = 0;
+  for (int i = getRank() - 1; i >= 0; --i) {
+    offset += (aIndex % fDims[i]) * fStrides[i];
+    aIndex /= fDims[i];
+  }
+  if (fType == ElementType::Float32) {
+    return getElements<float>()[offset];
+  }
+  return getData()[offset];
+}
+
+Tensor Tensor::transposed() const {
+  if (fSparse) {
+    if (getRank() == 1) {
+      return *this;
+    }
+    if (getRank() > 2) {
+      return contiguous().transposed();
+    }
+    // count the nonzeros of each column, then place them column by column
+    int rows = fDims[0];
+    int cols = fDims[1];
+    CSR out;
+    out.rowStarts.assign(cols + 1, 0);
+    for (int col : fSparse->cols) {
+      ++out.rowStarts[col + 1];
+    }
+    for (int col = 0; col < cols; ++col) {
+      out.rowStarts[col + 1] += out.rowStarts[col];
+    }
+    out.cols.resize(fSparse->cols.size());
+    out.values.resize(fSparse->values.size());
+    std::vector<int> next(out.rowStarts.begin(), out.rowStarts.end() - 1);
+    for (int row = 0; row < rows; ++row) {
+      for (int i = fSparse->rowStarts[row]; i < fSparse->rowStarts[row + 1];
+           ++i) {
+        int pos = next[fSparse->cols[i]]++;
+        out.cols[pos] = row;
+        out.values[pos] = fSparse->values[i];
+      }
+    }
+    return sparse({cols, rows}, std::move(out), fType);
+  }
+  Tensor view = *this;
+  view.fDims.assign(fDims.rbegin(), fDims.rend());
+  view.fStrides.assign(fStrides.rbegin(), fStrides.rend());
+  return view;
+}
+
+Tensor Tensor::reshaped(Dims aDims) const {
+  assert(runtime::getNumElements(aDims) == fNumElements &&
+         "reshape changes the number of elements");
+  if (fSparse && !aDims.empty()) {
+    int cols = getNumCols(aDims);
+    if (cols == getNumCols(fDims)) {
+      Tensor view = *this;
+      view.fStrides = getContiguousStrides(aDims);
+      view.fDims = std::move(aDims);
+      return view;
+    }
+    // the row major position of every nonzero stays, only rows and columns
+    // are counted differently
+    int oldCols = getNumCols(fDims);
+    CSR out;
+    out.rowStarts.assign(getNumRows(aDims) + 1, 0);
+    out.cols.reserve(fSparse->cols.size());
+    out.values = fSparse->values;
+    for (size_t row = 0; row + 1 < fSparse->rowStarts.size(); ++row) {
+      for (int i = fSparse->rowStarts[row]; i < fSparse->rowStarts[row + 1];
+           ++i) {
+        size_t pos = row * oldCols + fSparse->cols[i];
+        ++out.rowStarts[pos / cols + 1];
+        out.cols.push_back(pos % cols);
+      }
+    }
+    for (size_t row = 1; row < out.rowStarts.size(); ++row) {
+      out.rowStarts[row] += out.rowStarts[row - 1];
+    }
+    return sparse(std::move(aDims), std::move(out), fType);
+  }
+  Tensor view = contiguous();
+  view.fStrides = getContiguousStrides(aDims);
+  view.fDims = std::move(aDims);
+  return view;
+}
+
+Tensor Tensor::contiguous() const {
+  if (fSparse) {
+    Tensor dense(fDims, fType);
+    visit(fType, [&](auto aZero) {
+      using T = decltype(aZero);
+      T *out = dense.getMutableElements<T>();
+      size_t cols = getNumCols(fDims);
+      for (size_t row = 0; row + 1 < fSparse->rowStarts.size(); ++row) {
+        for (int i = fSparse->rowStarts[row]; i < fSparse->rowStarts[row + 1];
+             ++i) {
+          out[row * cols + fSparse->cols[i]] = fSparse->values[i];
+        }
+      }
+    });
+    return dense;
+  }
+  if (isContiguous()) {
+    return *this;
+  }
+  Tensor copy;
+  if (staticContiguous(*this, copy)) {
+    return copy;
+  }
+  copy = Tensor(fDims, fType);
+  visit(fType, [&](auto aZero) {
+    using T = decltype(aZero);
+    StridedCursor cursor(*this);
+    const T *in = getElements<T>();
+    T *out = copy.getMutableElements<T>();
+    for (size_t i = 0; i < fNumElements; ++i) {
+      out[i] = in[cursor.next()];
+    }
+  });
+  return copy;
+}
+
+void Tensor::makeUnique() {
+  if (fSparse) {
+    *this = contiguous();
+    return;
+  }
+  Tensor copy(fDims, fType);
+  visit(fType, [&](auto aZero) {
+    using T = decltype(aZero);
+    const T *in = getElements<T>();
+    T *out = copy.getMutableElements<T>();
+    if (isContiguous()) {
+      std::copy(in, in + fNumElements, out);
+    } else {
+      StridedCursor cursor(*this);
+      for (size_t i = 0; i < fNumElements; ++i) {
+        out[i] = in[cursor.next()];
+      }
+    }
+  });
+  *this = std::move(copy);
+}
+
+StridedCursor::StridedCursor(const Tensor &aTensor, size_t aStart)
+    : fDims(aTensor.getDims()), fStrides(aTensor.getStrides()),
+      fIndex(fDims.size(), 0) {
+  for (int i = static_cast<int>(fDims.size()) - 1; i >= 0; --i) {
+    fIndex[i] = aStart % fDims[i];
+    aStart /= fDims[i];
+    fOffset += fIndex[i] * fStrides[i];
+  }
+}
+
+long StridedCursor::next() {
+  long offset = fOffset;
+  for (int i = static_cast<int>(fDims.size()) - 1; i >= 0; --i) {
+    fOffset += fStrides[i];
+    if (++fIndex[i] < fDims[i]) {
+      break;
+    }
+    fOffset -= fStrides[i] * fDims[i];
+    fIndex[i] = 0;
+  }
+  return offset;
+}
+
+} // namespace toy::runtime
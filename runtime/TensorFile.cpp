@@ -0,0 +1,191 @@
+#include "runtime/include/TensorFile.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace toy::runtime {
+
+namespace {
+
+struct Header {
+  char magic[4];
+  uint32_t dtype;
+  uint32_t rank;
+  uint32_t dataOffset;
+};
+
+// closes the descriptor when it goes out of scope
+struct FileCloser {
+  int fd;
+  ~FileCloser() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+// read exactly aSize bytes at aOffset
+bool readAt(int aFd, void *aData, size_t aSize, off_t aOffset) {
+  auto *out = static_cast<char *>(aData);
+  while (aSize > 0) {
+    ssize_t n = pread(aFd, out, aSize, aOffset);
+    if (n <= 0) {
+      return false;
+    }
+    out += n;
+    aSize -= n;
+    aOffset += n;
+  }
+  return true;
+}
+
+// validate the header of the open file aFd and read its dims and element
+// type. aDataOffset is where the elements start
+bool readHeader(int aFd, const std::string &aPath, Dims &aDims,
+                ElementType &aType, size_t &aDataOffset, std::string &aError) {
+  struct stat info;
+  if (fstat(aFd, &info) != 0) {
+    aError = "cannot stat '" + aPath + "'";
+    return false;
+  }
+  Header header;
+  if (!readAt(aFd, &header, sizeof(header), 0) ||
+      std::memcmp(header.magic, kTensorFileMagic, 4) != 0) {
+    aError = "'" + aPath + "' is not a tensor file";
+    return false;
+  }
+  if (header.dtype == kTensorFileFloat64) {
+    aType = ElementType::Float64;
+  } else if (header.dtype == kTensorFileFloat32) {
+    aType = ElementType::Float32;
+  } else {
+    aError = "'" + aPath + "' has unsupported element type " +
+             std::to_string(header.dtype);
+    return false;
+  }
+  // a larger rank is a corrupt header, not a tensor
+  if (header.rank > 64) {
+    aError = "'" + aPath + "' has invalid rank " + std::to_string(header.rank);
+    return false;
+  }
+  std::vector<int64_t> dims(header.rank);
+  if (!readAt(aFd, dims.data(), dims.size() * sizeof(int64_t),
+              sizeof(header))) {
+    aError = "'" + aPath + "' has a truncated header";
+    return false;
+  }
+  aDims.clear();
+  size_t count = 1;
+  for (auto dim : dims) {
+    if (dim <= 0 || dim > INT32_MAX) {
+      aError = "'" + aPath + "' has invalid dim " + std::to_string(dim);
+      return false;
+    }
+    aDims.push_back(static_cast<int>(dim));
+    // a wrapped size could match a small file and map too little
+    if (__builtin_mul_overflow(count, static_cast<size_t>(dim), &count)) {
+      aError = "'" + aPath + "' has too many elements";
+      return false;
+    }
+  }
+  size_t headerSize = sizeof(header) + dims.size() * sizeof(int64_t);
+  aDataOffset = header.dataOffset;
+  size_t fileSize = info.st_size;
+  size_t dataSize;
+  if (__builtin_mul_overflow(count, getElementSize(aType), &dataSize) ||
+      __builtin_add_overflow(dataSize, aDataOffset, &dataSize)) {
+    aError = "'" + aPath + "' has too many elements";
+    return false;
+  }
+  if (aDataOffset < headerSize || aDataOffset % kTensorFileAlignment != 0 ||
+      fileSize != dataSize) {
+    aError = "'" + aPath + "' does not hold the elements its header describes";
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool readTensorFileDims(const std::string &aPath, Dims &aDims,
+                        std::string &aError) {
+  ElementType type;
+  return readTensorFileHeader(aPath, aDims, type, aError);
+}
+
+bool readTensorFileHeader(const std::string &aPath, Dims &aDims,
+                          ElementType &aType, std::string &aError) {
+  FileCloser file{open(aPath.c_str(), O_RDONLY)};
+  if (file.fd < 0) {
+    aError = "cannot open '" + aPath + "'";
+    return false;
+  }
+  size_t dataOffset;
+  return readHeader(file.fd, aPath, aDims, aType, dataOffset, aError);
+}
+
+bool mapTensorFile(const std::string &aPath, Tensor &aTensor,
+                   std::string &aError) {
+  FileCloser file{open(aPath.c_str(), O_RDONLY)};
+  if (file.fd < 0) {
+    aError = "cannot open '" + aPath + "'";
+    return false;
+  }
+  Dims dims;
+  ElementType type;
+  size_t dataOffset;
+  if (!readHeader(file.fd, aPath, dims, type, dataOffset, aError)) {
+    return false;
+  }
+  size_t size = dataOffset + getNumElements(dims) * getElementSize(type);
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+  if (mapped == MAP_FAILED) {
+    aError = "cannot map '" + aPath + "'";
+    return false;
+  }
+  // the mapping outlives the descriptor and goes away with the last tensor
+  std::shared_ptr<const void> owner(mapped, [size](const void *aData) {
+    munmap(const_cast<void *>(aData), size);
+  });
+  const void *data = static_cast<const char *>(mapped) + dataOffset;
+  aTensor = Tensor::external(std::move(dims), type, data, std::move(owner));
+  return true;
+}
+
+bool writeTensorFile(const std::string &aPath, const Tensor &aTensor) {
+  std::ofstream file(aPath, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  Header header;
+  std::memcpy(header.magic, kTensorFileMagic, 4);
+  header.dtype = aTensor.getElementType() == ElementType::Float32
+                     ? kTensorFileFloat32
+                     : kTensorFileFloat64;
+  header.rank = aTensor.getRank();
+  size_t headerSize = sizeof(header) + header.rank * sizeof(int64_t);
+  header.dataOffset = (headerSize + kTensorFileAlignment - 1) /
+                      kTensorFileAlignment * kTensorFileAlignment;
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (auto dim : aTensor.getDims()) {
+    int64_t value = dim;
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+  std::string padding(header.dataOffset - headerSize, '\0');
+  file.write(padding.data(), padding.size());
+  auto contiguous = aTensor.contiguous();
+  const void *data = visit(contiguous.getElementType(), [&](auto aZero) {
+    return static_cast<const void *>(
+        contiguous.getElements<decltype(aZero)>());
+  });
+  file.write(static_cast<const char *>(data),
+             contiguous.getNumElements() *
+                 getElementSize(contiguous.getElementType()));
+  return static_cast<bool>(file);
+}
+
+} // namespace toy::runtime
@@ -0,0 +1,45 @@
+/*
+ *
+ * Tensor kernels of the toy runtime
+ *
+ */
+
+#pragma once
+
+#include "runtime/include/Tensor.hpp"
+
+namespace toy::runtime {
+
+// one step of a fused elementwise program, either a load of an input or an
+// operator applied to the two values on top of the stack
+struct FusedOp {
+  // '+', '-', '*', or 0 for a load
+  char op;
+  // index of the loaded input
+  int input;
+};
+
+// apply '+', '-' or '*' elementwise, a scalar operand is broadcast. the result
+// for a sparse operand is sparse, unless it has nonzeros where no operand
+// stores one
+Tensor elementwise(char aOp, const Tensor &aLHS, const Tensor &aRHS);
+
+// same as above, the buffer of an operand that is not shared and has the
+// layout of the result is reused for it. pass the operands at their last use
+Tensor elementwise(char aOp, Tensor &&aLHS, Tensor &&aRHS);
+
+// reverse the dims of the tensor, this is a view and never copies
+Tensor transpose(const Tensor &aTensor);
+
+// evaluate a postfix elementwise program over the inputs. the result is
+// computed in a single pass over memory, block by block, and only the output
+// tensor is allocated. strided inputs are read in place, sparse ones expanded
+Tensor fused(const std::vector<FusedOp> &aProgram,
+             const std::vector<const Tensor *> &aInputs);
+
+// same as fused, consuming the inputs. the buffer of an input that is not
+// shared and has the layout of the result is reused for it
+Tensor fusedReusing(const std::vector<FusedOp> &aProgram,
+                    std::vector<Tensor> &&aInputs);
+
+} // namespace toy::runtime
@@ -0,0 +1,19 @@
+/*
+ *
+ * Printing of tensors for the print builtin
+ *
+ */
+
+#pragma once
+
+#include "runtime/include/Tensor.hpp"
+
+#include <ostream>
+
+namespace toy::runtime {
+
+// print the tensor as nested brackets, e.g. [[1, 2.5], [3, 4]], followed by a
+// newline. numbers take their shortest form that reads back exactly
+void print(std::ostream &aOs, const Tensor &aTensor);
+
+} // namespace toy::runtime
@@ -0,0 +1,67 @@
+/*
+ *
+ * Shape specialized kernels for small tensors.
+ *
+ * Most tensors of toy programs are tiny, where the loops and strided cursors
+ * of the generic kernels cost more than the arithmetic. The shapes listed in
+ * TOY_STATIC_SHAPES at build time get fully unrolled kernels instantiated for
+ * their rows and columns, with scratch on the stack.
+ *
+ */
+
+#pragma once
+
+#include "runtime/include/Tensor.hpp"
+
+#include <utility>
+
+namespace toy::runtime {
+
+namespace detail {
+
+// call aFn with every index of the sequence, the calls are expanded at compile
+// time
+template <typename Fn, size_t... Is>
+inline void unroll(Fn &&aFn, std::index_sequence<Is...>) {
+  (aFn(Is), ...);
+}
+
+} // namespace detail
+
+// aOut = aLHS op aRHS over N elements, a step of 0 broadcasts a scalar
+template <int N, char Op, int LHSStep, int RHSStep>
+inline void staticApply(const double *aLHS, const double *aRHS,
+                        double *aOut) {
+  detail::unroll(
+      [&](size_t aIndex) {
+        double lhs = aLHS[aIndex * LHSStep];
+        double rhs = aRHS[aIndex * RHSStep];
+        aOut[aIndex] = Op == '+' ? lhs + rhs : Op == '-' ? lhs - rhs : lhs * rhs;
+      },
+      std::make_index_sequence<N>());
+}
+
+// write the transpose of the row major R x C matrix aIn to aOut
+template <int R, int C>
+inline void staticTranspose(const double *aIn, double *aOut) {
+  detail::unroll(
+      [&](size_t aIndex) { aOut[aIndex % C * R + aIndex / C] = aIn[aIndex]; },
+      std::make_index_sequence<R * C>());
+}
+
+// true if kernels are instantiated for the dims
+bool hasStaticKernels(const Dims &aDims);
+
+// apply '+', '-' or '*' with the kernel of the result shape. operands are
+// contiguous, scalars or transposed views of contiguous tensors. aOut is
+// written in place if it is uniquely owned with the result shape, it may be
+// one of the operands. returns false and leaves aOut alone if there is no
+// kernel for them. kernels exist for float64 operands only
+bool staticElementwise(char aOp, const Tensor &aLHS, const Tensor &aRHS,
+                       Tensor &aOut);
+
+// materialize a transposed view of a contiguous tensor into aOut, false if
+// there is no kernel for it
+bool staticContiguous(const Tensor &aTensor, Tensor &aOut);
+
+} // namespace toy::runtime
@@ -0,0 +1,215 @@
+/*
+ *
+ * Tensor value used by the toy runtime.
+ *
+ * A tensor is a strided view over a shared buffer, so transposes and reshapes
+ * of contiguous tensors never copy. Freshly created tensors are contiguous and
+ * row major, a tensor without dims is a scalar holding a single element.
+ *
+ * Copies share the buffer by reference count. Writes go through
+ * getMutableData(), which copies a shared buffer first, and kernels reuse the
+ * buffer of an operand that nothing else refers to. External buffers, such
+ * as a mapped tensor file, are read only and copied on the first write.
+ *
+ * A sparse tensor holds only its nonzero elements, in compressed sparse row
+ * form. It has no buffer: getData() is only valid for dense tensors, and
+ * contiguous() turns a sparse tensor into a dense one.
+ *
+ * The elements are float64 unless a tensor is created as float32. Kernels
+ * never mix the two, a program uses a single element type.
+ *
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace toy::runtime {
+
+using Dims = std::vector<int>;
+using Strides = std::vector<long>;
+
+enum class ElementType { Float64, Float32 };
+
+// bytes of an element of the type
+size_t getElementSize(ElementType aType);
+
+// "float64" or "float32"
+const char *getElementTypeName(ElementType aType);
+
+// the element type of the C++ type T, double or float
+template <typename T> constexpr ElementType getElementType() {
+  static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>,
+                "tensor elements are double or float");
+  return std::is_same_v<T, float> ? ElementType::Float32
+                                  : ElementType::Float64;
+}
+
+// call aFn with a value of the C++ type of aType, to instantiate code for
+// each element type
+template <typename Fn> decltype(auto) visit(ElementType aType, Fn &&aFn) {
+  if (aType == ElementType::Float32) {
+    return aFn(float());
+  }
+  return aFn(double());
+}
+
+// the nonzero elements of a sparse tensor in compressed sparse row form. the
+// rows are the positions of all but the last dim, the columns those of the
+// last dim
+struct CSR {
+  // the first nonzero of each row, then the number of nonzeros
+  std::vector<int> rowStarts;
+  // column of each nonzero, ascending within a row
+  std::vector<int> cols;
+  std::vector<double> values;
+};
+
+// number of rows and columns of a sparse tensor of the given dims
+int getNumRows(const Dims &aDims);
+int getNumCols(const Dims &aDims);
+
+class Tensor {
+public:
+  // scalar zero, the buffer is shared between all default tensors
+  Tensor();
+
+  // zero filled tensor of the given dims
+  explicit Tensor(Dims aDims, ElementType aType = ElementType::Float64);
+
+  // tensor of the given dims holding aData in row major order
+  Tensor(Dims aDims, std::vector<double> aData);
+
+  // float32 tensor of the given dims holding aData in row major order
+  static Tensor float32(Dims aDims, std::vector<float> aData);
+
+  // aValue rounded to aType
+  static Tensor scalar(double aValue,
+                       ElementType aType = ElementType::Float64);
+
+  // read only tensor over aData in row major order, used in place. aOwner
+  // keeps the elements alive as long as a tensor refers to them
+  static Tensor external(Dims aDims, ElementType aType, const void *aData,
+                         std::shared_ptr<const void> aOwner);
+
+  // sparse tensor of the given dims and nonzeros, which must not be a scalar.
+  // the values of a float32 tensor are rounded to float
+  static Tensor sparse(Dims aDims, CSR aNonZeros,
+                       ElementType aType = ElementType::Float64);
+
+  // sparse tensor with the nonzero elements of aTensor
+  static Tensor toSparse(const Tensor &aTensor);
+
+  const Dims &getDims() const { return fDims; }
+
+  // distance in elements between neighbours along each dim
+  const Strides &getStrides() const { return fStrides; }
+
+  int getRank() const { return fDims.size(); }
+
+  bool isScalar() const { return fDims.empty(); }
+
+  size_t getNumElements() const { return fNumElements; }
+
+  ElementType getElementType() const { return fType; }
+
+  // this tensor if its elements are of aType, otherwise a copy converted to
+  // it. a sparse tensor stays sparse
+  Tensor converted(ElementType aType) const;
+
+  // true if the elements are laid out row major without gaps
+  bool isContiguous() const;
+
+  bool isSparse() const { return fSparse != nullptr; }
+
+  // the nonzeros of a sparse tensor
+  const CSR &getNonZeros() const {
+    assert(isSparse() && "dense tensor has no nonzeros");
+    return *fSparse;
+  }
+
+  // the first element, the others are reached through the strides. T is the
+  // C++ type of the elements
+  template <typename T> const T *getElements() const {
+    assert(!isSparse() && "sparse tensor has no buffer");
+    assert(runtime::getElementType<T>() == fType && "wrong element type");
+    return static_cast<const T *>(fBuffer.get()) + fOffset;
+  }
+
+  // the first element for writing. a shared buffer is copied first, so the
+  // write is never seen by other tensors
+  template <typename T> T *getMutableElements() {
+    assert(runtime::getElementType<T>() == fType && "wrong element type");
+    if (!isUnique()) {
+      makeUnique();
+    }
+    return static_cast<T *>(fBuffer.get()) + fOffset;
+  }
+
+  // the elements of a float64 tensor
+  const double *getData() const { return getElements<double>(); }
+  double *getMutableData() { return getMutableElements<double>(); }
+
+  // true if no other tensor or view shares the buffer and it is writable
+  bool isUnique() const {
+    return !fReadOnly && !fSparse && fBuffer.use_count() == 1;
+  }
+
+  // element at the given row major position
+  double getElement(size_t aIndex) const;
+
+  // view with the dims and strides reversed. a sparse tensor of up to two
+  // dims stays sparse, its nonzeros are reordered by column
+  Tensor transposed() const;
+
+  // view with new dims, copies only if the tensor is not contiguous. a sparse
+  // tensor stays sparse
+  Tensor reshaped(Dims aDims) const;
+
+  // this tensor if it is contiguous, otherwise a contiguous copy. a sparse
+  // tensor is expanded into a dense one
+  Tensor contiguous() const;
+
+private:
+  // replace the buffer with a contiguous copy owned by this tensor
+  void makeUnique();
+
+  // the elements, sharing ownership with whatever holds them
+  std::shared_ptr<void> fBuffer;
+  ElementType fType = ElementType::Float64;
+  bool fReadOnly = false;
+  // the nonzeros of a sparse tensor, shared by its copies
+  std::shared_ptr<const CSR> fSparse;
+  Dims fDims;
+  Strides fStrides;
+  size_t fOffset = 0;
+  size_t fNumElements = 1;
+};
+
+// number of elements in a tensor of the given dims
+size_t getNumElements(const Dims &aDims);
+
+// row major strides for the given dims
+Strides getContiguousStrides(const Dims &aDims);
+
+// walks the elements of a strided tensor in row major order, yielding the
+// buffer offset of each one relative to the first element
+class StridedCursor {
+public:
+  StridedCursor(const Tensor &aTensor, size_t aStart = 0);
+
+  // offset of the current element, then move to the next one
+  long next();
+
+private:
+  const Dims &fDims;
+  const Strides &fStrides;
+  std::vector<int> fIndex;
+  long fOffset = 0;
+};
+
+} // namespace toy::runtime
@@ -0,0 +1,49 @@
+/*
+ *
+ * Binary tensor files, referenced from Toy with load("path")
+ *
+ * A file is a header followed by the elements in row major order:
+ *
+ *   char     magic[4]     "TOYT"
+ *   uint32   dtype        0 for float64, 1 for float32
+ *   uint32   rank
+ *   uint32   data offset  from the start of the file, a multiple of 64
+ *   int64    dims[rank]
+ *
+ * all in host byte order. Mapping a file gives a read only tensor over the
+ * mapped pages, nothing is copied until a kernel needs to write.
+ *
+ */
+
+#pragma once
+
+#include "runtime/include/Tensor.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace toy::runtime {
+
+constexpr char kTensorFileMagic[4] = {'T', 'O', 'Y', 'T'};
+constexpr uint32_t kTensorFileFloat64 = 0;
+constexpr uint32_t kTensorFileFloat32 = 1;
+constexpr uint32_t kTensorFileAlignment = 64;
+
+// read only the header of aPath. on failure aError says why
+bool readTensorFileDims(const std::string &aPath, Dims &aDims,
+                        std::string &aError);
+
+// read only the header of aPath, with the element type of the file
+bool readTensorFileHeader(const std::string &aPath, Dims &aDims,
+                          ElementType &aType, std::string &aError);
+
+// map aPath into a read only tensor with the element type of the file. on
+// failure aError says why
+bool mapTensorFile(const std::string &aPath, Tensor &aTensor,
+                   std::string &aError);
+
+// write aTensor to aPath with its element type, false if the file cannot be
+// written
+bool writeTensorFile(const std::string &aPath, const Tensor &aTensor);
+
+} // namespace toy::runtime
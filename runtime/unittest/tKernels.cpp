@@ -0,0 +1,109 @@
+#include "runtime/include/Kernels.hpp"
+#include <gtest/gtest.h>
+
+using namespace toy::runtime;
+
+// utility to copy the tensor elements out in row major order
+static std::vector<double> toVector(const Tensor &aTensor) {
+  auto contiguous = aTensor.contiguous();
+  return std::vector<double>(contiguous.getData(),
+                             contiguous.getData() + contiguous.getNumElements());
+}
+
+TEST(Kernels, Elementwise) {
+  Tensor a({2, 2}, {1, 2, 3, 4});
+  Tensor b({2, 2}, {5, 6, 7, 8});
+
+  EXPECT_EQ(toVector(elementwise('+', a, b)), (std::vector<double>{6, 8, 10, 12}));
+  EXPECT_EQ(toVector(elementwise('-', a, b)), (std::vector<double>{-4, -4, -4, -4}));
+  auto scaled = elementwise('*', Tensor::scalar(2), a);
+  EXPECT_EQ(scaled.getDims(), (Dims{2, 2}));
+  EXPECT_EQ(toVector(scaled), (std::vector<double>{2, 4, 6, 8}));
+}
+
+TEST(Kernels, Transpose) {
+  Tensor a({2, 3}, {1, 2, 3, 4, 5, 6});
+  auto t = transpose(a);
+  EXPECT_EQ(t.getDims(), (Dims{3, 2}));
+  EXPECT_EQ(toVector(t), (std::vector<double>{1, 4, 2, 5, 3, 6}));
+  EXPECT_EQ(toVector(transpose(t)), toVector(a));
+}
+
+TEST(Kernels, SparseElementwise) {
+  auto a = Tensor::toSparse(Tensor({2, 3}, {0, 2, 0, 4, 0, 0}));
+  auto b = Tensor::toSparse(Tensor({2, 3}, {1, 3, 0, 0, 0, 5}));
+  Tensor dense({2, 3}, {1, 2, 3, 4, 5, 6});
+  Tensor negative({2, 3}, {1, 2, -3, 4, 5, 6});
+
+  // each result matches the dense kernels, and is sparse where it can be
+  auto check = [&](char aOp, const Tensor &aLHS, const Tensor &aRHS,
+                   bool aSparse) {
+    auto result = elementwise(aOp, aLHS, aRHS);
+    EXPECT_EQ(result.isSparse(), aSparse) << aOp;
+    auto expected = elementwise(aOp, aLHS.contiguous(), aRHS.contiguous());
+    EXPECT_EQ(toVector(result), toVector(expected)) << aOp;
+    return result;
+  };
+  auto product = check('*', a, b, true);
+  EXPECT_EQ(product.getNonZeros().values, (std::vector<double>{6}));
+  EXPECT_EQ(check('+', a, b, true).getNonZeros().values.size(), 4u);
+  check('-', b, a, true);
+  check('*', a, dense, true);
+  check('*', Tensor::scalar(0.5), a, true);
+  check('+', a, Tensor::scalar(0), true);
+  check('+', a, dense, false);
+  check('-', Tensor::scalar(1), a, false);
+  // 0 * -3 is -0, which a sparse tensor cannot hold
+  check('*', a, negative, false);
+  check('*', transpose(dense), transpose(a), true);
+}
+
+TEST(Kernels, FusedMatchesUnfused) {
+  // larger than a block to cover the block loop and its remainder
+  size_t size = 1000;
+  std::vector<double> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = i * 0.5;
+  }
+  Tensor a({10, 100}, data);
+  Tensor b = elementwise('+', a, Tensor::scalar(1));
+  Tensor c = Tensor::scalar(3);
+
+  // a * b + c - b
+  std::vector<FusedOp> program = {{0, 0}, {0, 1}, {'*', 0}, {0, 2},
+                                  {'+', 0}, {0, 1}, {'-', 0}};
+  auto result = fused(program, {&a, &b, &c});
+  auto expected = elementwise('-', elementwise('+', elementwise('*', a, b), c), b);
+  EXPECT_EQ(result.getDims(), (Dims{10, 100}));
+  EXPECT_EQ(toVector(result), toVector(expected));
+}
+
+TEST(Kernels, Float32) {
+  auto a = Tensor({2, 2}, {0.1, 0.2, 0.3, 0.4}).converted(ElementType::Float32);
+  auto b = Tensor::scalar(0.2, ElementType::Float32);
+
+  // computed in float, not in double and rounded
+  auto sum = elementwise('+', a, b);
+  ASSERT_EQ(sum.getElementType(), ElementType::Float32);
+  EXPECT_EQ(sum.getElements<float>()[0], 0.1f + 0.2f);
+  auto product = elementwise('*', transpose(a), a);
+  ASSERT_EQ(product.getElementType(), ElementType::Float32);
+  EXPECT_EQ(product.getElements<float>()[1], 0.3f * 0.2f);
+
+  // fused and in place kernels agree
+  auto fusedSum = fused({{0, 0}, {0, 1}, {'+', 0}}, {&a, &b});
+  ASSERT_EQ(fusedSum.getElementType(), ElementType::Float32);
+  EXPECT_EQ(toVector(fusedSum.converted(ElementType::Float64)),
+            toVector(sum.converted(ElementType::Float64)));
+  auto inPlace = elementwise('+', Tensor(a).contiguous(), Tensor(b));
+  EXPECT_EQ(inPlace.getElements<float>()[3], 0.4f + 0.2f);
+
+  // sparse results are rounded to float as well
+  auto sparse = Tensor::toSparse(
+      Tensor({1, 4}, {0.1, 0, 0, 0}).converted(ElementType::Float32));
+  auto scaled =
+      elementwise('*', sparse, Tensor::scalar(3, ElementType::Float32));
+  ASSERT_TRUE(scaled.isSparse());
+  EXPECT_EQ(scaled.getElementType(), ElementType::Float32);
+  EXPECT_EQ(scaled.getElement(0), double(0.1f * 3.0f));
+}
@@ -0,0 +1,40 @@
+#include "runtime/include/Kernels.hpp"
+#include "runtime/include/Print.hpp"
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace toy::runtime;
+
+TEST(Print, NestedBrackets) {
+  std::stringstream out;
+  print(out, Tensor::scalar(2.5));
+  print(out, Tensor({3}, {1, 2, 3}));
+  print(out, Tensor({2, 2}, {1, 2, 3, 4}));
+  // views are printed in their logical order
+  print(out, transpose(Tensor({2, 2}, {1, 2, 3, 4})));
+  EXPECT_EQ(out.str(), "2.5\n[1, 2, 3]\n[[1, 2], [3, 4]]\n[[1, 3], [2, 4]]\n");
+}
+
+TEST(Print, ShortestRoundTrip) {
+  std::stringstream out;
+  print(out, Tensor({5}, {0.1, 1.0 / 3, 1234567, 1e21, -0.5}));
+  EXPECT_EQ(out.str(),
+            "[0.1, 0.3333333333333333, 1234567, 1e+21, -0.5]\n");
+
+  // floats in the shortest form that reads back as the same float
+  out.str("");
+  print(out, Tensor::float32({3}, {0.1f, 1.0f / 3, -0.5f}));
+  EXPECT_EQ(out.str(), "[0.1, 0.33333334, -0.5]\n");
+}
+
+TEST(Print, LargeTensor) {
+  // larger than the output buffer, so it is written in several pieces
+  std::vector<double> data(100000, 0.25);
+  std::stringstream out;
+  print(out, Tensor({100, 1000}, std::move(data)));
+  auto text = out.str();
+  EXPECT_EQ(text.size(), 100000 * 6 + 2 * 100 + 1);
+  EXPECT_EQ(text.substr(0, 14), "[[0.25, 0.25, ");
+  EXPECT_EQ(text.substr(text.size() - 7), "0.25]]\n");
+}
@@ -0,0 +1,46 @@
+#include "runtime/include/Kernels.hpp"
+#include "runtime/include/StaticKernels.hpp"
+#include <gtest/gtest.h>
+
+using namespace toy::runtime;
+
+TEST(StaticKernels, Unrolled) {
+  double lhs[6] = {1, 2, 3, 4, 5, 6};
+  double rhs[6] = {6, 5, 4, 3, 2, 1};
+  double out[6];
+  staticApply<6, '-', 1, 1>(lhs, rhs, out);
+  EXPECT_EQ(std::vector<double>(out, out + 6),
+            (std::vector<double>{-5, -3, -1, 1, 3, 5}));
+  staticApply<6, '*', 1, 0>(lhs, rhs, out);
+  EXPECT_EQ(std::vector<double>(out, out + 6),
+            (std::vector<double>{6, 12, 18, 24, 30, 36}));
+  staticTranspose<2, 3>(lhs, out);
+  EXPECT_EQ(std::vector<double>(out, out + 6),
+            (std::vector<double>{1, 4, 2, 5, 3, 6}));
+}
+
+TEST(StaticKernels, MatchGenericKernels) {
+  if (!hasStaticKernels({2, 3}) || !hasStaticKernels({3, 2})) {
+    GTEST_SKIP() << "2x3 and 3x2 are not in TOY_STATIC_SHAPES";
+  }
+  Tensor a({2, 3}, {1, 2, 3, 4, 5, 6});
+  Tensor b({3, 2}, {1, 2, 3, 4, 5, 6});
+  auto bt = transpose(b);
+
+  Tensor out;
+  ASSERT_TRUE(staticElementwise('*', a, bt, out));
+  EXPECT_EQ(out.getDims(), (Dims{2, 3}));
+  EXPECT_EQ(std::vector<double>(out.getData(), out.getData() + 6),
+            (std::vector<double>{1, 6, 15, 8, 20, 36}));
+  ASSERT_TRUE(staticElementwise('+', Tensor::scalar(1), a, out));
+  EXPECT_EQ(out.getElement(5), 7);
+
+  ASSERT_TRUE(staticContiguous(bt, out));
+  EXPECT_TRUE(out.isContiguous());
+  EXPECT_EQ(std::vector<double>(out.getData(), out.getData() + 6),
+            (std::vector<double>{1, 3, 5, 2, 4, 6}));
+
+  // shapes without kernels are left to the generic ones
+  EXPECT_FALSE(hasStaticKernels({7, 5}));
+  EXPECT_FALSE(staticElementwise('+', Tensor({7, 5}), Tensor({7, 5}), out));
+}
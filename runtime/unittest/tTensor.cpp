@@ -0,0 +1,159 @@
+#include "runtime/include/Kernels.hpp"
+#include <gtest/gtest.h>
+
+using namespace toy::runtime;
+
+TEST(Tensor, TransposeIsAView) {
+  Tensor a({2, 3}, {1, 2, 3, 4, 5, 6});
+  auto t = transpose(a);
+  EXPECT_EQ(t.getData(), a.getData());
+  EXPECT_FALSE(t.isContiguous());
+  EXPECT_EQ(t.getDims(), (Dims{3, 2}));
+  EXPECT_EQ(t.getStrides(), (Strides{1, 3}));
+  EXPECT_EQ(t.getElement(1), 4);
+
+  // transposing back gives the original layout
+  EXPECT_TRUE(transpose(t).isContiguous());
+
+  // a contiguous layout is only materialized on request
+  auto c = t.contiguous();
+  EXPECT_TRUE(c.isContiguous());
+  EXPECT_NE(c.getData(), a.getData());
+  EXPECT_EQ(std::vector<double>(c.getData(), c.getData() + 6),
+            (std::vector<double>{1, 4, 2, 5, 3, 6}));
+}
+
+TEST(Tensor, Reshape) {
+  Tensor a({2, 3}, {1, 2, 3, 4, 5, 6});
+  auto r = a.reshaped({3, 2});
+  EXPECT_EQ(r.getData(), a.getData());
+  EXPECT_EQ(r.getElement(2), 3);
+
+  // a strided view needs a copy to be reshaped
+  auto rt = transpose(a).reshaped({6});
+  EXPECT_NE(rt.getData(), a.getData());
+  EXPECT_EQ(rt.getElement(1), 4);
+}
+
+TEST(Tensor, StridedElementwise) {
+  Tensor a({2, 3}, {1, 2, 3, 4, 5, 6});
+  Tensor b({3, 2}, {1, 1, 1, 1, 1, 1});
+  auto sum = elementwise('+', transpose(a), b);
+  EXPECT_TRUE(sum.isContiguous());
+  EXPECT_EQ(std::vector<double>(sum.getData(), sum.getData() + 6),
+            (std::vector<double>{2, 5, 3, 6, 4, 7}));
+
+  auto prod = fused({{0, 0}, {0, 0}, {'*', 0}}, {&sum});
+  EXPECT_EQ(prod.getElement(5), 49);
+}
+
+TEST(Tensor, CopyOnWrite) {
+  Tensor a({2, 2}, {1, 2, 3, 4});
+  Tensor b = a;
+  EXPECT_FALSE(a.isUnique());
+  EXPECT_EQ(b.getData(), a.getData());
+
+  // writing through a copy leaves the other tensor alone
+  b.getMutableData()[0] = 9;
+  EXPECT_NE(b.getData(), a.getData());
+  EXPECT_EQ(a.getElement(0), 1);
+  EXPECT_EQ(b.getElement(0), 9);
+  EXPECT_TRUE(a.isUnique());
+
+  // a shared view is copied in its logical order
+  auto t = transpose(a);
+  t.getMutableData()[1] = 7;
+  EXPECT_TRUE(t.isContiguous());
+  EXPECT_EQ(t.getElement(1), 7);
+  EXPECT_EQ(t.getElement(2), 2);
+  EXPECT_EQ(a.getElement(1), 2);
+
+  Tensor zero;
+  zero.getMutableData()[0] = 1;
+  EXPECT_EQ(Tensor().getElement(0), 0);
+}
+
+TEST(Tensor, ReuseUniqueOperands) {
+  Tensor a({3}, {1, 2, 3});
+  const double *data = a.getData();
+  auto sum = elementwise('+', std::move(a), Tensor::scalar(1));
+  EXPECT_EQ(sum.getData(), data);
+  EXPECT_EQ(sum.getElement(2), 4);
+
+  // a shared operand is never overwritten
+  Tensor shared = sum;
+  auto prod = elementwise('*', Tensor(shared), Tensor(shared));
+  EXPECT_NE(prod.getData(), data);
+  EXPECT_EQ(shared.getElement(2), 4);
+  EXPECT_EQ(prod.getElement(2), 16);
+
+  // the same for fused programs, on the static kernels too
+  std::vector<Tensor> inputs;
+  inputs.push_back(Tensor({2, 2}, {1, 2, 3, 4}));
+  inputs.push_back(Tensor::scalar(2));
+  data = inputs[0].getData();
+  auto result = fusedReusing({{0, 0}, {0, 1}, {'*', 0}}, std::move(inputs));
+  EXPECT_EQ(result.getData(), data);
+  EXPECT_EQ(result.getElement(3), 8);
+  Tensor b({2, 2}, {1, 2, 3, 4});
+  auto scaled = elementwise('*', std::move(result), transpose(b));
+  EXPECT_EQ(scaled.getData(), data);
+  EXPECT_EQ(scaled.getElement(1), 12);
+}
+
+TEST(Tensor, Sparse) {
+  Tensor dense({2, 3}, {0, 2, 0, 4, 0, 6});
+  auto s = Tensor::toSparse(dense);
+  ASSERT_TRUE(s.isSparse());
+  EXPECT_FALSE(s.isContiguous());
+  EXPECT_FALSE(s.isUnique());
+  EXPECT_EQ(s.getNonZeros().rowStarts, (std::vector<int>{0, 1, 3}));
+  EXPECT_EQ(s.getNonZeros().cols, (std::vector<int>{1, 0, 2}));
+  EXPECT_EQ(s.getElement(3), 4);
+  EXPECT_EQ(s.getElement(4), 0);
+
+  // transposes and reshapes keep only the nonzeros
+  auto t = s.transposed();
+  ASSERT_TRUE(t.isSparse());
+  EXPECT_EQ(t.getDims(), (Dims{3, 2}));
+  EXPECT_EQ(t.getNonZeros().rowStarts, (std::vector<int>{0, 1, 2, 3}));
+  auto c = t.contiguous();
+  EXPECT_FALSE(c.isSparse());
+  EXPECT_EQ(std::vector<double>(c.getData(), c.getData() + 6),
+            (std::vector<double>{0, 4, 2, 0, 0, 6}));
+
+  auto r = s.reshaped({3, 2});
+  ASSERT_TRUE(r.isSparse());
+  EXPECT_EQ(r.getNonZeros().rowStarts, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(r.getNonZeros().cols, (std::vector<int>{1, 1, 1}));
+  EXPECT_EQ(r.getElement(5), 6);
+  EXPECT_TRUE(s.reshaped({1, 2, 3}).isSparse());
+
+  // a write expands the tensor first
+  double *data = r.getMutableData();
+  EXPECT_FALSE(r.isSparse());
+  EXPECT_EQ(data[3], 4);
+}
+
+TEST(Tensor, Float32) {
+  auto a = Tensor({2, 3}, {0.1, 0, 3, 0, 5, 0}).converted(ElementType::Float32);
+  ASSERT_EQ(a.getElementType(), ElementType::Float32);
+  EXPECT_EQ(a.getElements<float>()[0], 0.1f);
+  EXPECT_EQ(a.getElement(0), double(0.1f));
+
+  // views, copies and sparse tensors keep the element type
+  auto t = a.transposed().contiguous();
+  EXPECT_EQ(t.getElementType(), ElementType::Float32);
+  EXPECT_EQ(t.getElements<float>()[4], 3.0f);
+  auto s = Tensor::toSparse(a);
+  EXPECT_EQ(s.getElementType(), ElementType::Float32);
+  EXPECT_EQ(s.getNonZeros().values[0], double(0.1f));
+  EXPECT_EQ(s.contiguous().getElementType(), ElementType::Float32);
+
+  Tensor b = a;
+  b.getMutableElements<float>()[0] = 2;
+  EXPECT_EQ(a.getElement(0), double(0.1f));
+  EXPECT_EQ(Tensor::scalar(0.1, ElementType::Float32).getElement(0),
+            double(0.1f));
+  EXPECT_EQ(a.converted(ElementType::Float64).getData()[0], double(0.1f));
+}
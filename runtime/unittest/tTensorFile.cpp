@@ -0,0 +1,103 @@
+#include "runtime/include/Kernels.hpp"
+#include "runtime/include/TensorFile.hpp"
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+using namespace toy::runtime;
+
+TEST(TensorFile, MapsWithoutCopying) {
+  auto path = testing::TempDir() + "map.toyt";
+  Tensor a({2, 3}, {1, 2, 3, 4, 5, 6});
+  // written in row major order whatever the layout
+  ASSERT_TRUE(writeTensorFile(path, transpose(a)));
+
+  Dims dims;
+  std::string error;
+  ASSERT_TRUE(readTensorFileDims(path, dims, error)) << error;
+  EXPECT_EQ(dims, (Dims{3, 2}));
+
+  Tensor mapped;
+  ASSERT_TRUE(mapTensorFile(path, mapped, error)) << error;
+  EXPECT_EQ(mapped.getDims(), (Dims{3, 2}));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped.getData()) %
+                kTensorFileAlignment,
+            0u);
+  EXPECT_EQ(std::vector<double>(mapped.getData(), mapped.getData() + 6),
+            (std::vector<double>{1, 4, 2, 5, 3, 6}));
+
+  // the mapping is never written, kernels and writes work on a copy
+  const double *data = mapped.getData();
+  EXPECT_FALSE(mapped.isUnique());
+  auto sum = elementwise('+', std::move(mapped), Tensor::scalar(1));
+  EXPECT_NE(sum.getData(), data);
+  EXPECT_EQ(sum.getElement(0), 2);
+  EXPECT_EQ(data[0], 1);
+
+  Tensor scalar;
+  ASSERT_TRUE(writeTensorFile(path, Tensor::scalar(2.5)));
+  ASSERT_TRUE(mapTensorFile(path, scalar, error)) << error;
+  EXPECT_TRUE(scalar.isScalar());
+  EXPECT_EQ(scalar.getData()[0], 2.5);
+}
+
+TEST(TensorFile, Float32) {
+  auto path = testing::TempDir() + "float32.toyt";
+  ASSERT_TRUE(
+      writeTensorFile(path, Tensor::float32({2, 2}, {1.5f, 2, 3, 0.1f})));
+  Dims dims;
+  ElementType type;
+  std::string error;
+  ASSERT_TRUE(readTensorFileHeader(path, dims, type, error)) << error;
+  EXPECT_EQ(type, ElementType::Float32);
+
+  Tensor mapped;
+  ASSERT_TRUE(mapTensorFile(path, mapped, error)) << error;
+  ASSERT_EQ(mapped.getElementType(), ElementType::Float32);
+  EXPECT_EQ(mapped.getElements<float>()[3], 0.1f);
+}
+
+TEST(TensorFile, RejectsBadFiles) {
+  auto path = testing::TempDir() + "bad.toyt";
+  Dims dims;
+  std::string error;
+  EXPECT_FALSE(readTensorFileDims(path + ".missing", dims, error));
+  EXPECT_NE(error.find("cannot open"), std::string::npos);
+
+  std::ofstream(path) << "[1, 2, 3]";
+  EXPECT_FALSE(readTensorFileDims(path, dims, error));
+  EXPECT_NE(error.find("is not a tensor file"), std::string::npos);
+
+  // a file cut short does not hold its elements
+  ASSERT_TRUE(writeTensorFile(path, Tensor({4}, {1, 2, 3, 4})));
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      << bytes.substr(0, bytes.size() - 8);
+  Tensor tensor;
+  EXPECT_FALSE(mapTensorFile(path, tensor, error));
+  EXPECT_NE(error.find("does not hold the elements"), std::string::npos);
+
+  // 2^61 doubles take 2^64 bytes, which would wrap to an empty file
+  struct {
+    char magic[4] = {'T', 'O', 'Y', 'T'};
+    uint32_t dtype = kTensorFileFloat64;
+    uint32_t rank = 3;
+    uint32_t dataOffset = 64;
+    int64_t dims[3] = {int64_t(1) << 30, int64_t(1) << 30, 2};
+    char padding[24] = {};
+  } header;
+  static_assert(sizeof(header) == 64, "the header fills the data offset");
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(reinterpret_cast<const char *>(&header), sizeof(header));
+  EXPECT_FALSE(mapTensorFile(path, tensor, error));
+  EXPECT_NE(error.find("has too many elements"), std::string::npos);
+  for (auto &dim : header.dims) {
+    dim = INT32_MAX;
+  }
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(reinterpret_cast<const char *>(&header), sizeof(header));
+  EXPECT_FALSE(readTensorFileDims(path, dims, error));
+  EXPECT_NE(error.find("has too many elements"), std::string::npos);
+}
@@ -0,0 +1,74 @@
+#include "support/include/Format.hpp"
+
+#include <cassert>
+#include <charconv>
+#include <cstring>
+
+namespace toy::support {
+
+char *formatNumber(char *aOut, double aValue) {
+  auto result = std::to_chars(aOut, aOut + kMaxNumberChars, aValue);
+  assert(result.ec == std::errc() && "number does not fit");
+  return result.ptr;
+}
+
+char *formatNumber(char *aOut, float aValue) {
+  auto result = std::to_chars(aOut, aOut + kMaxNumberChars, aValue);
+  assert(result.ec == std::errc() && "number does not fit");
+  return result.ptr;
+}
+
+std::string formatNumber(double aValue) {
+  char text[kMaxNumberChars];
+  return std::string(text, formatNumber(text, aValue));
+}
+
+std::string formatNumber(float aValue) {
+  char text[kMaxNumberChars];
+  return std::string(text, formatNumber(text, aValue));
+}
+
+// storage of the OutputBuffers of this thread, and whether one holds it
+static thread_local std::unique_ptr<char[]> tBuffer;
+static thread_local bool tBufferTaken = false;
+
+OutputBuffer::OutputBuffer(std::ostream &aOs) : fOs(aOs) {
+  if (tBufferTaken) {
+    fOwned = std::make_unique<char[]>(kCapacity);
+    fData = fOwned.get();
+    return;
+  }
+  if (!tBuffer) {
+    tBuffer = std::make_unique<char[]>(kCapacity);
+  }
+  fData = tBuffer.get();
+  tBufferTaken = true;
+}
+
+OutputBuffer::~OutputBuffer() {
+  flush();
+  if (!fOwned) {
+    tBufferTaken = false;
+  }
+}
+
+void OutputBuffer::append(std::string_view aText) {
+  if (fSize + aText.size() > kCapacity) {
+    flush();
+    if (aText.size() > kCapacity) {
+      fOs.write(aText.data(), aText.size());
+      return;
+    }
+  }
+  std::memcpy(fData + fSize, aText.data(), aText.size());
+  fSize += aText.size();
+}
+
+void OutputBuffer::flush() {
+  if (fSize) {
+    fOs.write(fData, fSize);
+    fSize = 0;
+  }
+}
+
+} // namespace toy::support
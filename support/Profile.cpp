@@ -0,0 +1,202 @@
+#include "support/include/Profile.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace toy::support {
+
+static constexpr const char *kProfileHeader = "toy-profile 1";
+
+void Profile::merge(const Profile &aOther) {
+  for (auto &[name, other] : aOther.functions) {
+    auto &function = functions[name];
+    function.calls += other.calls;
+    function.inclusiveNs += other.inclusiveNs;
+    function.exclusiveNs += other.exclusiveNs;
+    function.bytes += other.bytes;
+  }
+  for (auto &[site, other] : aOther.callSites) {
+    auto &callSite = callSites[site];
+    if (callSite.caller.empty()) {
+      callSite.caller = other.caller;
+    }
+    callSite.calls += other.calls;
+    callSite.inclusiveNs += other.inclusiveNs;
+    callSite.bytes += other.bytes;
+  }
+  for (auto &[name, other] : aOther.kernels) {
+    auto &kernel = kernels[name];
+    kernel.calls += other.calls;
+    kernel.ns += other.ns;
+    kernel.bytes += other.bytes;
+  }
+}
+
+uint64_t Profile::getTotalNs() const {
+  uint64_t total = 0;
+  for (auto &[name, function] : functions) {
+    total += function.exclusiveNs;
+  }
+  return total;
+}
+
+const CallSiteProfile *Profile::findCallSite(const std::string &aCallee,
+                                             int aLine, int aCol) const {
+  auto it = callSites.find(CallSite{aCallee, aLine, aCol});
+  return it == callSites.end() ? nullptr : &it->second;
+}
+
+// the entries of aMap, hottest first by aKey, at most aLimit of them
+template <typename Map, typename Key>
+static std::vector<typename Map::const_pointer>
+getHottest(const Map &aMap, Key aKey, size_t aLimit) {
+  std::vector<typename Map::const_pointer> entries;
+  for (auto &entry : aMap) {
+    entries.push_back(&entry);
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [&](auto aLHS, auto aRHS) {
+                     return aKey(aLHS->second) > aKey(aRHS->second);
+                   });
+  if (entries.size() > aLimit) {
+    entries.resize(aLimit);
+  }
+  return entries;
+}
+
+void printProfile(const Profile &aProfile, std::ostream &aOs, size_t aLimit) {
+  double total = aProfile.getTotalNs();
+  auto percent = [&](uint64_t aNs) {
+    return total > 0 ? 100 * aNs / total : 0;
+  };
+
+  auto flags = aOs.flags();
+  aOs << std::fixed << std::setprecision(3);
+  aOs << std::left << std::setw(32) << "function" << std::right
+      << std::setw(10) << "calls" << std::setw(12) << "incl ms"
+      << std::setw(12) << "excl ms" << std::setw(8) << "excl %"
+      << std::setw(12) << "kb" << "\n";
+  auto byExclusive = [](const FunctionProfile &aFunction) {
+    return aFunction.exclusiveNs;
+  };
+  for (auto *entry : getHottest(aProfile.functions, byExclusive, aLimit)) {
+    auto &function = entry->second;
+    aOs << std::left << std::setw(32) << entry->first << std::right
+        << std::setw(10) << function.calls << std::setw(12)
+        << function.inclusiveNs / 1e6 << std::setw(12)
+        << function.exclusiveNs / 1e6 << std::setw(8) << std::setprecision(1)
+        << percent(function.exclusiveNs) << std::setprecision(3)
+        << std::setw(12) << function.bytes / 1024.0 << "\n";
+  }
+
+  aOs << "\n"
+      << std::left << std::setw(32) << "call site" << std::right
+      << std::setw(10) << "calls" << std::setw(12) << "incl ms"
+      << std::setw(8) << "incl %" << std::setw(12) << "kb" << "\n";
+  for (auto *entry : getHottest(
+           aProfile.callSites,
+           [](const CallSiteProfile &aSite) { return aSite.inclusiveNs; },
+           aLimit)) {
+    auto &site = entry->first;
+    auto &stats = entry->second;
+    std::string name = stats.caller + " -> " + site.callee + " (" +
+                       std::to_string(site.line) + ":" +
+                       std::to_string(site.col) + ")";
+    aOs << std::left << std::setw(32) << name << std::right << std::setw(10)
+        << stats.calls << std::setw(12) << stats.inclusiveNs / 1e6
+        << std::setw(8) << std::setprecision(1) << percent(stats.inclusiveNs)
+        << std::setprecision(3) << std::setw(12) << stats.bytes / 1024.0
+        << "\n";
+  }
+
+  aOs << "\n"
+      << std::left << std::setw(32) << "kernel" << std::right << std::setw(10)
+      << "calls" << std::setw(12) << "ms" << std::setw(8) << "%"
+      << std::setw(12) << "kb" << "\n";
+  for (auto *entry : getHottest(
+           aProfile.kernels,
+           [](const KernelProfile &aKernel) { return aKernel.ns; }, aLimit)) {
+    auto &kernel = entry->second;
+    aOs << std::left << std::setw(32) << entry->first << std::right
+        << std::setw(10) << kernel.calls << std::setw(12) << kernel.ns / 1e6
+        << std::setw(8) << std::setprecision(1) << percent(kernel.ns)
+        << std::setprecision(3) << std::setw(12) << kernel.bytes / 1024.0
+        << "\n";
+  }
+  aOs.flags(flags);
+}
+
+bool writeProfile(const Profile &aProfile, const std::string &aPath) {
+  std::ofstream file(aPath, std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  file << kProfileHeader << "\n";
+  for (auto &[name, function] : aProfile.functions) {
+    file << "function " << name << " " << function.calls << " "
+         << function.inclusiveNs << " " << function.exclusiveNs << " "
+         << function.bytes << "\n";
+  }
+  for (auto &[site, stats] : aProfile.callSites) {
+    file << "call " << site.callee << " " << site.line << " " << site.col
+         << " " << stats.caller << " " << stats.calls << " "
+         << stats.inclusiveNs << " " << stats.bytes << "\n";
+  }
+  for (auto &[name, kernel] : aProfile.kernels) {
+    file << "kernel " << name << " " << kernel.calls << " " << kernel.ns << " "
+         << kernel.bytes << "\n";
+  }
+  return static_cast<bool>(file);
+}
+
+bool readProfile(const std::string &aPath, Profile &aProfile,
+                 std::string &aError) {
+  std::ifstream file(aPath);
+  if (!file) {
+    aError = "cannot open '" + aPath + "'";
+    return false;
+  }
+  std::string line;
+  if (!std::getline(file, line) || line != kProfileHeader) {
+    aError = "'" + aPath + "' is not a toy profile";
+    return false;
+  }
+  Profile profile;
+  int number = 1;
+  while (std::getline(file, line)) {
+    ++number;
+    std::istringstream fields(line);
+    std::string kind, name;
+    fields >> kind >> name;
+    bool ok = false;
+    if (kind == "function") {
+      auto &function = profile.functions[name];
+      ok = static_cast<bool>(fields >> function.calls >> function.inclusiveNs >>
+                             function.exclusiveNs >> function.bytes);
+    } else if (kind == "call") {
+      CallSite site{name};
+      CallSiteProfile stats;
+      ok = static_cast<bool>(fields >> site.line >> site.col >> stats.caller >>
+                             stats.calls >> stats.inclusiveNs >> stats.bytes);
+      profile.callSites[site] = stats;
+    } else if (kind == "kernel") {
+      auto &kernel = profile.kernels[name];
+      ok = static_cast<bool>(fields >> kernel.calls >> kernel.ns >>
+                             kernel.bytes);
+    } else if (kind.empty()) {
+      continue;
+    }
+    if (!ok) {
+      aError = "'" + aPath + "' has a malformed entry on line " +
+               std::to_string(number);
+      return false;
+    }
+  }
+  aProfile = std::move(profile);
+  return true;
+}
+
+} // namespace toy::support
@@ -0,0 +1,432 @@
+#include "support/include/Statistics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <malloc.h>
+#include <mutex>
+#include <new>
+#include <set>
+#include <sys/resource.h>
+
+namespace toy::support {
+
+std::atomic<bool> detail::sReportEnabled{false};
+std::atomic<bool> detail::sAllocationTracking{false};
+
+static std::atomic<uint64_t> sBytesAllocated{0};
+static std::atomic<bool> sAllocationsTracked{false};
+
+namespace {
+
+// what a thread recorded, locked by the thread and by whoever takes a report
+struct ThreadRecord {
+  std::mutex mutex;
+  std::map<const char *, PhaseStats> phases;
+  std::map<const char *, uint64_t> counters;
+  std::map<const char *, AllocationStats> tags;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::set<ThreadRecord *> threads;
+  // what exited threads recorded
+  Report retired;
+};
+
+// never destroyed, threads may exit after static destructors ran
+Registry &getRegistry() {
+  static Registry *sRegistry = new Registry;
+  return *sRegistry;
+}
+
+void merge(Report &aReport, ThreadRecord &aRecord) {
+  for (auto &[name, times] : aRecord.phases) {
+    auto &total = aReport.phases[name];
+    total.calls += times.calls;
+    total.wall += times.wall;
+    total.cpu += times.cpu;
+    total.allocations += times.allocations;
+    total.allocatedBytes += times.allocatedBytes;
+    total.peakLiveBytes = std::max(total.peakLiveBytes, times.peakLiveBytes);
+  }
+  for (auto &[name, value] : aRecord.counters) {
+    aReport.counters[name] += value;
+  }
+  for (auto &[name, stats] : aRecord.tags) {
+    aReport.tags[name].allocations += stats.allocations;
+    aReport.tags[name].bytes += stats.bytes;
+  }
+}
+
+// registers the record of the thread for its lifetime
+struct ThreadOwner {
+  ThreadOwner() {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.insert(&record);
+  }
+  ~ThreadOwner() {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.erase(&record);
+    merge(registry.retired, record);
+  }
+  ThreadRecord record;
+};
+
+ThreadRecord &getThreadRecord() {
+  thread_local ThreadOwner tOwner;
+  return tOwner.record;
+}
+
+thread_local PhaseScope *tCurrentScope = nullptr;
+thread_local AllocationTag *tCurrentTag = nullptr;
+
+// the allocations of the bookkeeping are not charged to any phase or tag
+struct Untracked {
+  Untracked() : scope(tCurrentScope), tag(tCurrentTag) {
+    tCurrentScope = nullptr;
+    tCurrentTag = nullptr;
+  }
+  ~Untracked() {
+    tCurrentScope = scope;
+    tCurrentTag = tag;
+  }
+  PhaseScope *scope;
+  AllocationTag *tag;
+};
+// bytes allocated minus bytes freed while tracking, by every thread. a block
+// may be freed by another thread than the one that allocated it
+std::atomic<int64_t> sLiveBytes{0};
+
+double getWallTime() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+double getCpuTime() {
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+} // namespace
+
+void setReportEnabled(bool aEnabled) {
+  detail::sReportEnabled.store(aEnabled, std::memory_order_relaxed);
+}
+
+void setAllocationTracking(bool aEnabled) {
+  if (aEnabled) {
+    sAllocationsTracked = true;
+  }
+  detail::sAllocationTracking.store(aEnabled, std::memory_order_relaxed);
+}
+
+void detail::recordAllocation(size_t aBytes, size_t aUsable) {
+  int64_t live =
+      sLiveBytes.fetch_add(aUsable, std::memory_order_relaxed) + aUsable;
+  if (auto *tag = tCurrentTag) {
+    ++tag->fAllocations;
+    tag->fAllocatedBytes += aBytes;
+  }
+  if (auto *scope = tCurrentScope) {
+    ++scope->fAllocations;
+    scope->fAllocatedBytes += aBytes;
+    scope->fPeakLive =
+        std::max(scope->fPeakLive, live - scope->fStartLive);
+  }
+}
+
+void detail::recordFree(size_t aUsable) {
+  sLiveBytes.fetch_sub(aUsable, std::memory_order_relaxed);
+}
+
+void AllocationTag::begin(const char *aName) {
+  fName = aName;
+  fParent = tCurrentTag;
+  tCurrentTag = this;
+}
+
+void AllocationTag::end() {
+  tCurrentTag = fParent;
+  Untracked untracked;
+  auto &record = getThreadRecord();
+  std::lock_guard<std::mutex> lock(record.mutex);
+  auto &stats = record.tags[fName];
+  stats.allocations += fAllocations;
+  stats.bytes += fAllocatedBytes;
+}
+
+void resetReport() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.retired = Report();
+  for (auto *record : registry.threads) {
+    std::lock_guard<std::mutex> recordLock(record->mutex);
+    record->phases.clear();
+    record->counters.clear();
+    record->tags.clear();
+  }
+  sBytesAllocated = 0;
+  sAllocationsTracked = isAllocationTracking();
+}
+
+void addCount(const char *aName, uint64_t aValue) {
+  if (!isReportEnabled()) {
+    return;
+  }
+  Untracked untracked;
+  auto &record = getThreadRecord();
+  std::lock_guard<std::mutex> lock(record.mutex);
+  record.counters[aName] += aValue;
+}
+
+PhaseScope::PhaseScope(const char *aName, const std::string &aDetail)
+    : fTrace(aName, aDetail) {
+  if (!isReportEnabled()) {
+    return;
+  }
+  fName = aName;
+  fParent = tCurrentScope;
+  tCurrentScope = this;
+  fOuterTag = tCurrentTag;
+  tCurrentTag = nullptr;
+  fStartLive = sLiveBytes.load(std::memory_order_relaxed);
+  fStartWall = getWallTime();
+  fStartCpu = getCpuTime();
+}
+
+PhaseScope::~PhaseScope() {
+  if (!fName) {
+    return;
+  }
+  double wall = getWallTime() - fStartWall;
+  double cpu = getCpuTime() - fStartCpu;
+  tCurrentScope = fParent;
+  tCurrentTag = fOuterTag;
+  if (fParent) {
+    fParent->fChildWall += wall;
+    fParent->fChildCpu += cpu;
+    // the peak of a nested phase is also reached in its parent
+    fParent->fPeakLive = std::max(fParent->fPeakLive,
+                                  fStartLive - fParent->fStartLive + fPeakLive);
+  }
+
+  Untracked untracked;
+  auto &record = getThreadRecord();
+  std::lock_guard<std::mutex> lock(record.mutex);
+  auto &times = record.phases[fName];
+  ++times.calls;
+  times.wall += wall - fChildWall;
+  times.cpu += cpu - fChildCpu;
+  times.allocations += fAllocations;
+  times.allocatedBytes += fAllocatedBytes;
+  times.peakLiveBytes =
+      std::max<uint64_t>(times.peakLiveBytes, std::max<int64_t>(fPeakLive, 0));
+}
+
+Report getReport() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  Report report = registry.retired;
+  for (auto *record : registry.threads) {
+    std::lock_guard<std::mutex> recordLock(record->mutex);
+    merge(report, *record);
+  }
+  report.bytesAllocated = sBytesAllocated;
+  report.allocationsTracked = sAllocationsTracked;
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    report.peakRss = usage.ru_maxrss;
+  }
+  return report;
+}
+
+void printReport(const Report &aReport, std::ostream &aOs) {
+  PhaseStats total;
+  for (auto &[name, times] : aReport.phases) {
+    total.wall += times.wall;
+    total.cpu += times.cpu;
+    total.allocations += times.allocations;
+    total.allocatedBytes += times.allocatedBytes;
+  }
+  bool allocations = aReport.allocationsTracked;
+
+  auto flags = aOs.flags();
+  aOs << std::fixed << std::setprecision(3);
+  aOs << std::left << std::setw(24) << "phase" << std::right << std::setw(10)
+      << "calls" << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms"
+      << std::setw(8) << "wall %";
+  if (allocations) {
+    aOs << std::setw(10) << "allocs" << std::setw(12) << "alloc kb"
+        << std::setw(12) << "peak kb";
+  }
+  aOs << "\n";
+  for (auto &[name, times] : aReport.phases) {
+    aOs << std::left << std::setw(24) << name << std::right << std::setw(10)
+        << times.calls << std::setw(12) << times.wall * 1e3 << std::setw(12)
+        << times.cpu * 1e3 << std::setw(8) << std::setprecision(1)
+        << (total.wall > 0 ? 100 * times.wall / total.wall : 0)
+        << std::setprecision(3);
+    if (allocations) {
+      aOs << std::setw(10) << times.allocations << std::setw(12)
+          << times.allocatedBytes / 1024.0 << std::setw(12)
+          << times.peakLiveBytes / 1024.0;
+    }
+    aOs << "\n";
+  }
+  aOs << std::left << std::setw(24) << "total" << std::right << std::setw(10)
+      << "" << std::setw(12) << total.wall * 1e3 << std::setw(12)
+      << total.cpu * 1e3;
+  if (allocations) {
+    aOs << std::setw(8) << "" << std::setw(10) << total.allocations
+        << std::setw(12) << total.allocatedBytes / 1024.0;
+  }
+  aOs << "\n\n";
+
+  aOs << std::left << std::setw(24) << "counter" << std::right << std::setw(16)
+      << "value" << "\n";
+  for (auto &[name, value] : aReport.counters) {
+    aOs << std::left << std::setw(24) << name << std::right << std::setw(16)
+        << value << "\n";
+  }
+  aOs << std::left << std::setw(24) << "bytes allocated" << std::right
+      << std::setw(16) << aReport.bytesAllocated << "\n"
+      << std::left << std::setw(24) << "peak rss kb" << std::right
+      << std::setw(16) << aReport.peakRss << "\n";
+
+  if (allocations && !aReport.tags.empty()) {
+    aOs << "\n"
+        << std::left << std::setw(24) << "allocation tag" << std::right
+        << std::setw(16) << "allocs" << std::setw(12) << "kb" << "\n";
+    for (auto &[name, stats] : aReport.tags) {
+      aOs << std::left << std::setw(24) << name << std::right << std::setw(16)
+          << stats.allocations << std::setw(12) << stats.bytes / 1024.0 << "\n";
+    }
+  }
+  aOs.flags(flags);
+}
+
+void printReportJson(const Report &aReport, std::ostream &aOs) {
+  // phase and counter names are identifiers, nothing needs escaping
+  auto flags = aOs.flags();
+  aOs << std::fixed << std::setprecision(6) << "{\"phases\": {";
+  const char *sep = "";
+  for (auto &[name, times] : aReport.phases) {
+    aOs << sep << "\"" << name << "\": {\"calls\": " << times.calls
+        << ", \"wall\": " << times.wall << ", \"cpu\": " << times.cpu;
+    if (aReport.allocationsTracked) {
+      aOs << ", \"allocations\": " << times.allocations
+          << ", \"allocatedBytes\": " << times.allocatedBytes
+          << ", \"peakLiveBytes\": " << times.peakLiveBytes;
+    }
+    aOs << "}";
+    sep = ", ";
+  }
+  aOs << "}, \"counters\": {";
+  sep = "";
+  for (auto &[name, value] : aReport.counters) {
+    aOs << sep << "\"" << name << "\": " << value;
+    sep = ", ";
+  }
+  aOs << "}, \"tags\": {";
+  sep = "";
+  for (auto &[name, stats] : aReport.tags) {
+    aOs << sep << "\"" << name << "\": {\"allocations\": " << stats.allocations
+        << ", \"bytes\": " << stats.bytes << "}";
+    sep = ", ";
+  }
+  aOs << "}, \"bytesAllocated\": " << aReport.bytesAllocated
+      << ", \"peakRssKb\": " << aReport.peakRss << "}\n";
+  aOs.flags(flags);
+}
+
+bool checkBudgets(const Report &aReport,
+                  const std::vector<AllocationBudget> &aBudgets,
+                  std::ostream &aOs) {
+  bool ok = true;
+  for (auto &budget : aBudgets) {
+    auto it = aReport.phases.find(budget.phase);
+    if (it == aReport.phases.end()) {
+      continue;
+    }
+    auto &stats = it->second;
+    if (stats.allocations > budget.allocations) {
+      aOs << "phase '" << budget.phase << "' made " << stats.allocations
+          << " allocations, the budget is " << budget.allocations << "\n";
+      ok = false;
+    }
+    if (stats.allocatedBytes > budget.bytes) {
+      aOs << "phase '" << budget.phase << "' allocated "
+          << stats.allocatedBytes << " bytes, the budget is " << budget.bytes
+          << "\n";
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+} // namespace toy::support
+
+// count the bytes of every allocation while reporting is enabled and charge
+// it to the phase while tracking allocations. an alignment of 0 is the
+// default one of malloc
+static void *allocate(std::size_t aSize, std::size_t aAlignment) {
+  if (toy::support::isReportEnabled()) {
+    toy::support::sBytesAllocated.fetch_add(aSize, std::memory_order_relaxed);
+  }
+  for (;;) {
+    void *ptr = nullptr;
+    if (aAlignment) {
+      if (posix_memalign(&ptr, std::max(aAlignment, sizeof(void *)),
+                         aSize ? aSize : 1) != 0) {
+        ptr = nullptr;
+      }
+    } else {
+      ptr = std::malloc(aSize ? aSize : 1);
+    }
+    if (ptr) {
+      if (toy::support::isAllocationTracking()) {
+        toy::support::detail::recordAllocation(aSize, malloc_usable_size(ptr));
+      }
+      return ptr;
+    }
+    auto handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+// the other forms of operator new and delete end up in these
+void *operator new(std::size_t aSize) { return allocate(aSize, 0); }
+
+void *operator new(std::size_t aSize, std::align_val_t aAlignment) {
+  return allocate(aSize, static_cast<std::size_t>(aAlignment));
+}
+
+void operator delete(void *aPtr) noexcept {
+  if (aPtr && toy::support::isAllocationTracking()) {
+    toy::support::detail::recordFree(malloc_usable_size(aPtr));
+  }
+  std::free(aPtr);
+}
+
+void operator delete(void *aPtr, std::size_t) noexcept {
+  operator delete(aPtr);
+}
+
+void operator delete(void *aPtr, std::align_val_t) noexcept {
+  operator delete(aPtr);
+}
+
+void operator delete(void *aPtr, std::size_t, std::align_val_t) noexcept {
+  operator delete(aPtr);
+}
@@ -0,0 +1,140 @@
+#include "support/include/ThreadPool.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace toy::support {
+
+ThreadPool::ThreadPool(unsigned aNumThreads) {
+  for (unsigned i = 0; i < std::max(1u, aNumThreads); ++i) {
+    fWorkers.emplace_back([this] { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStopping = true;
+  }
+  fHasWork.notify_all();
+  for (auto &worker : fWorkers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> aTask) {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fTasks.push_back(std::move(aTask));
+    ++fPending;
+  }
+  fHasWork.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(fMutex);
+  fIdle.wait(lock, [this] { return fPending == 0; });
+}
+
+void ThreadPool::work() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fHasWork.wait(lock, [this] { return fStopping || !fTasks.empty(); });
+      if (fTasks.empty()) {
+        return;
+      }
+      task = std::move(fTasks.front());
+      fTasks.pop_front();
+    }
+    task();
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (--fPending == 0) {
+      fIdle.notify_all();
+    }
+  }
+}
+
+namespace {
+
+// tasks of a graph left to run, shared with the helpers queued on the pool,
+// which may only start after the graph finished
+struct GraphState {
+  std::mutex mutex;
+  // signaled when a task becomes ready or the last one finishes
+  std::condition_variable changed;
+  std::vector<size_t> ready;
+  // number of unfinished dependencies of each task
+  std::vector<size_t> waiting;
+  std::vector<std::vector<size_t>> dependents;
+  size_t left = 0;
+  ThreadPool *pool = nullptr;
+  const std::function<void(size_t)> *task = nullptr;
+};
+
+// run ready tasks, the caller also waits for the tasks running elsewhere
+void runReady(const std::shared_ptr<GraphState> &aState, bool aIsCaller) {
+  std::unique_lock<std::mutex> lock(aState->mutex);
+  for (;;) {
+    if (aState->ready.empty()) {
+      if (!aIsCaller || aState->left == 0) {
+        return;
+      }
+      aState->changed.wait(lock);
+      continue;
+    }
+    size_t index = aState->ready.back();
+    aState->ready.pop_back();
+    lock.unlock();
+    (*aState->task)(index);
+    lock.lock();
+
+    size_t unblocked = 0;
+    for (auto dependent : aState->dependents[index]) {
+      if (--aState->waiting[dependent] == 0) {
+        aState->ready.push_back(dependent);
+        ++unblocked;
+      }
+    }
+    if (--aState->left == 0 || unblocked) {
+      aState->changed.notify_all();
+    }
+    // this thread takes one of the new tasks, helpers take the others
+    for (size_t i = 1; i < unblocked && aState->pool; ++i) {
+      aState->pool->submit([aState] { runReady(aState, false); });
+    }
+  }
+}
+
+} // namespace
+
+void runTaskGraph(ThreadPool *aPool,
+                  const std::vector<std::vector<size_t>> &aDeps,
+                  const std::function<void(size_t)> &aTask) {
+  auto state = std::make_shared<GraphState>();
+  state->pool = aPool;
+  state->task = &aTask;
+  state->left = aDeps.size();
+  state->waiting.resize(aDeps.size());
+  state->dependents.resize(aDeps.size());
+  for (size_t i = 0; i < aDeps.size(); ++i) {
+    state->waiting[i] = aDeps[i].size();
+    for (auto dep : aDeps[i]) {
+      state->dependents[dep].push_back(i);
+    }
+    if (aDeps[i].empty()) {
+      state->ready.push_back(i);
+    }
+  }
+  // run in the order given when nothing is in the way
+  std::reverse(state->ready.begin(), state->ready.end());
+
+  size_t numReady = state->ready.size();
+  for (size_t i = 1; i < numReady && aPool; ++i) {
+    aPool->submit([state] { runReady(state, false); });
+  }
+  runReady(state, true);
+}
+
+} // namespace toy::support
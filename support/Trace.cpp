@@ -0,0 +1,222 @@
+#include "support/include/Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace toy::support {
+
+std::atomic<bool> detail::sTraceEnabled{false};
+
+namespace {
+
+constexpr size_t kChunkSize = 1024;
+
+struct Event {
+  const char *name = nullptr;
+  // nanoseconds of the steady clock
+  uint64_t time = 0;
+  std::string detail;
+  char phase = 'B';
+};
+
+struct Chunk {
+  Event events[kChunkSize];
+  // events published by the owner thread
+  std::atomic<size_t> size{0};
+  std::atomic<Chunk *> next{nullptr};
+};
+
+// events of one thread, appended by the thread and consumed by writeTrace
+struct ThreadBuffer {
+  long tid = 0;
+  // oldest chunk not freed yet and chunk appended to, owned by the thread
+  Chunk *head = nullptr;
+  Chunk *tail = nullptr;
+  // chunk the reader is in, the ones before it are freed by the thread
+  std::atomic<Chunk *> consumed{nullptr};
+  // next event the reader takes from the consumed chunk
+  size_t readIndex = 0;
+  // set when the thread exits, the reader frees the buffer once drained
+  std::atomic<bool> exited{false};
+};
+
+struct Registry {
+  // serializes the readers and the registration of threads
+  std::mutex mutex;
+  std::vector<ThreadBuffer *> buffers;
+  uint64_t start = 0;
+};
+
+// never destroyed, threads may exit after static destructors ran
+Registry &getRegistry() {
+  static Registry *sRegistry = new Registry;
+  return *sRegistry;
+}
+
+uint64_t getTime() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// creates the buffer of the thread on first use and hands it to the reader
+// when the thread exits
+struct BufferOwner {
+  ~BufferOwner() {
+    if (buffer) {
+      buffer->exited.store(true, std::memory_order_release);
+    }
+  }
+  ThreadBuffer *buffer = nullptr;
+};
+
+ThreadBuffer &getThreadBuffer() {
+  thread_local BufferOwner tOwner;
+  if (!tOwner.buffer) {
+    auto *buffer = new ThreadBuffer;
+    buffer->tid = syscall(SYS_gettid);
+    buffer->head = buffer->tail = new Chunk;
+    buffer->consumed.store(buffer->head, std::memory_order_relaxed);
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.buffers.push_back(buffer);
+    tOwner.buffer = buffer;
+  }
+  return *tOwner.buffer;
+}
+
+void append(const char *aName, char aPhase, const std::string &aDetail) {
+  auto &buffer = getThreadBuffer();
+  Chunk *chunk = buffer.tail;
+  size_t size = chunk->size.load(std::memory_order_relaxed);
+  if (size == kChunkSize) {
+    // free the chunks the reader is done with
+    Chunk *consumed = buffer.consumed.load(std::memory_order_acquire);
+    while (buffer.head != consumed) {
+      Chunk *next = buffer.head->next.load(std::memory_order_relaxed);
+      delete buffer.head;
+      buffer.head = next;
+    }
+    auto *next = new Chunk;
+    chunk->next.store(next, std::memory_order_release);
+    buffer.tail = chunk = next;
+    size = 0;
+  }
+  auto &event = chunk->events[size];
+  event.name = aName;
+  event.time = getTime();
+  event.detail = aDetail;
+  event.phase = aPhase;
+  chunk->size.store(size + 1, std::memory_order_release);
+}
+
+// hand the published events of the buffer to aSink, the registry is locked
+template <typename Sink> void consume(ThreadBuffer &aBuffer, Sink aSink) {
+  Chunk *chunk = aBuffer.consumed.load(std::memory_order_relaxed);
+  for (;;) {
+    size_t size = chunk->size.load(std::memory_order_acquire);
+    for (; aBuffer.readIndex < size; ++aBuffer.readIndex) {
+      aSink(chunk->events[aBuffer.readIndex]);
+    }
+    Chunk *next = chunk->next.load(std::memory_order_acquire);
+    if (size < kChunkSize || !next) {
+      return;
+    }
+    chunk = next;
+    aBuffer.readIndex = 0;
+    aBuffer.consumed.store(next, std::memory_order_release);
+  }
+}
+
+// consume every buffer and free the ones of exited threads
+template <typename Sink> void consumeAll(Registry &aRegistry, Sink aSink) {
+  auto &buffers = aRegistry.buffers;
+  for (size_t i = 0; i < buffers.size();) {
+    auto *buffer = buffers[i];
+    bool exited = buffer->exited.load(std::memory_order_acquire);
+    consume(*buffer, [&](const Event &aEvent) { aSink(*buffer, aEvent); });
+    if (!exited) {
+      ++i;
+      continue;
+    }
+    for (Chunk *chunk = buffer->head; chunk;) {
+      Chunk *next = chunk->next.load(std::memory_order_relaxed);
+      delete chunk;
+      chunk = next;
+    }
+    delete buffer;
+    buffers.erase(buffers.begin() + i);
+  }
+}
+
+void writeString(std::ostream &aOs, const std::string &aString) {
+  aOs << '"';
+  for (unsigned char c : aString) {
+    if (c == '"' || c == '\\') {
+      aOs << '\\' << c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      aOs << escaped;
+    } else {
+      aOs << c;
+    }
+  }
+  aOs << '"';
+}
+
+} // namespace
+
+void startTrace() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  consumeAll(registry, [](ThreadBuffer &, const Event &) {});
+  registry.start = getTime();
+  detail::sTraceEnabled.store(true, std::memory_order_relaxed);
+}
+
+bool writeTrace(const std::string &aPath) {
+  detail::sTraceEnabled.store(false, std::memory_order_relaxed);
+  std::ofstream file(aPath);
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  long pid = getpid();
+  const char *sep = "\n";
+  file << "{\"traceEvents\": [";
+  consumeAll(registry, [&](ThreadBuffer &aBuffer, const Event &aEvent) {
+    // the end of a scope begun before the trace started
+    if (aEvent.time < registry.start) {
+      return;
+    }
+    char time[32];
+    std::snprintf(time, sizeof(time), "%.3f",
+                  (aEvent.time - registry.start) / 1e3);
+    file << sep << "{\"name\": ";
+    writeString(file, aEvent.name);
+    file << ", \"ph\": \"" << aEvent.phase << "\", \"ts\": " << time
+         << ", \"pid\": " << pid << ", \"tid\": " << aBuffer.tid;
+    if (!aEvent.detail.empty()) {
+      file << ", \"args\": {\"detail\": ";
+      writeString(file, aEvent.detail);
+      file << "}";
+    }
+    file << "}";
+    sep = ",\n";
+  });
+  file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+  return bool(file.flush());
+}
+
+void TraceScope::begin(const char *aName, const std::string &aDetail) {
+  fName = aName;
+  append(aName, 'B', aDetail);
+}
+
+void TraceScope::end() { append(fName, 'E', std::string()); }
+
+} // namespace toy::support
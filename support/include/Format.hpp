@@ -0,0 +1,82 @@
+/*
+ *
+ * Fast, locale independent formatting of numbers.
+ *
+ * Doubles are written with std::to_chars in their shortest form that reads
+ * back as the same value, e.g. 0.1, 2.5 or 1e+21, so printed tensors and
+ * dumped literals lose nothing. Floats get the shortest form that reads back
+ * as the same float, 0.1f prints as 0.1 rather than 0.100000001. An
+ * OutputBuffer gathers text in a fixed size buffer and hands it to the
+ * stream in large writes, which keeps printing a tensor of millions of
+ * elements bound by formatting rather than by the stream. Each thread keeps
+ * one buffer for its OutputBuffers, so a print of a scalar does not set up
+ * 64 KB of fresh storage.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace toy::support {
+
+// room enough for any number written by formatNumber
+constexpr size_t kMaxNumberChars = 32;
+
+// write the shortest round trip form of aValue at aOut, which has room for
+// kMaxNumberChars, and return the end of the text
+char *formatNumber(char *aOut, double aValue);
+char *formatNumber(char *aOut, float aValue);
+
+// the shortest round trip form of aValue
+std::string formatNumber(double aValue);
+std::string formatNumber(float aValue);
+
+class OutputBuffer {
+public:
+  static constexpr size_t kCapacity = 64 * 1024;
+
+  // takes the buffer of the thread, or one of its own if an OutputBuffer of
+  // the thread is still alive
+  explicit OutputBuffer(std::ostream &aOs);
+
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+  ~OutputBuffer();
+
+  void append(char aChar) {
+    if (fSize == kCapacity) {
+      flush();
+    }
+    fData[fSize++] = aChar;
+  }
+
+  void append(std::string_view aText);
+
+  void appendNumber(double aValue) { appendFormatted(aValue); }
+  void appendNumber(float aValue) { appendFormatted(aValue); }
+
+  // write the gathered text to the stream
+  void flush();
+
+private:
+  template <typename T> void appendFormatted(T aValue) {
+    if (fSize + kMaxNumberChars > kCapacity) {
+      flush();
+    }
+    fSize = formatNumber(fData + fSize, aValue) - fData;
+  }
+
+  std::ostream &fOs;
+  size_t fSize = 0;
+  char *fData;
+  // the storage if the buffer of the thread was taken
+  std::unique_ptr<char[]> fOwned;
+};
+
+} // namespace toy::support
@@ -0,0 +1,97 @@
+/*
+ *
+ * Execution profile of toy programs, for the hot spot report and profile
+ * guided optimization.
+ *
+ * The VM counts the calls, inclusive and exclusive time and tensor bytes of
+ * every function, the calls and inclusive time of every call site, and the
+ * time of every kernel by opcode. A call site is named by its callee and the
+ * source position of the call, which stays the same when the call is inlined
+ * into other functions or the program is recompiled with other options.
+ *
+ * A profile file is text, a header line then one line per entry:
+ *
+ *   toy-profile 1
+ *   function <name> <calls> <inclusive ns> <exclusive ns> <bytes>
+ *   call <callee> <line> <col> <caller> <calls> <inclusive ns> <bytes>
+ *   kernel <opcode> <calls> <ns> <bytes>
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+namespace toy::support {
+
+struct FunctionProfile {
+  uint64_t calls = 0;
+  // time until the calls returned, the time of recursive calls counted once
+  uint64_t inclusiveNs = 0;
+  // time spent in the function itself, without its callees
+  uint64_t exclusiveNs = 0;
+  // tensor bytes read and written by the kernels of the function itself
+  uint64_t bytes = 0;
+};
+
+struct CallSite {
+  std::string callee;
+  int line = 0;
+  int col = 0;
+
+  bool operator<(const CallSite &aOther) const {
+    return std::tie(callee, line, col) <
+           std::tie(aOther.callee, aOther.line, aOther.col);
+  }
+};
+
+struct CallSiteProfile {
+  // function holding the call when it was profiled
+  std::string caller;
+  uint64_t calls = 0;
+  uint64_t inclusiveNs = 0;
+  // tensor bytes of the kernels run by the calls, callees included
+  uint64_t bytes = 0;
+};
+
+struct KernelProfile {
+  uint64_t calls = 0;
+  uint64_t ns = 0;
+  uint64_t bytes = 0;
+};
+
+struct Profile {
+  std::map<std::string, FunctionProfile> functions;
+  // every call site of the program, also those that never ran
+  std::map<CallSite, CallSiteProfile> callSites;
+  // by opcode name
+  std::map<std::string, KernelProfile> kernels;
+
+  // add the counts of aOther, e.g. the profile of another run
+  void merge(const Profile &aOther);
+
+  // time of the whole run, the exclusive times of all functions
+  uint64_t getTotalNs() const;
+
+  // profile of a call site, nullptr if it was not in the profiled program
+  const CallSiteProfile *findCallSite(const std::string &aCallee, int aLine,
+                                      int aCol) const;
+};
+
+// print the functions, call sites and kernels, hottest first, at most aLimit
+// of each
+void printProfile(const Profile &aProfile, std::ostream &aOs,
+                  size_t aLimit = 20);
+
+// write aProfile to aPath, false if the file cannot be written
+bool writeProfile(const Profile &aProfile, const std::string &aPath);
+
+// read the profile file aPath into aProfile. on failure aError says why
+bool readProfile(const std::string &aPath, Profile &aProfile,
+                 std::string &aError);
+
+} // namespace toy::support
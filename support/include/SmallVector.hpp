@@ -0,0 +1,217 @@
+/*
+ *
+ * A vector keeping its first N elements inline, in the spirit of
+ * llvm::SmallVector.
+ *
+ * Shapes and argument lists almost always hold a handful of elements, so
+ * storing them in the object itself saves the heap allocation a std::vector
+ * pays for even one element. Past N elements the storage moves to the heap
+ * and grows like a std::vector. Moving a vector whose elements live on the
+ * heap steals the buffer, moving an inline one moves its elements.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace toy::support {
+
+template <typename T, size_t N> class SmallVector {
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  SmallVector() = default;
+
+  SmallVector(std::initializer_list<T> aInit) {
+    append(aInit.begin(), aInit.end());
+  }
+
+  template <typename It,
+            typename = std::enable_if_t<!std::is_integral_v<It>>>
+  SmallVector(It aFirst, It aLast) {
+    append(aFirst, aLast);
+  }
+
+  SmallVector(const SmallVector &aOther) {
+    append(aOther.begin(), aOther.end());
+  }
+
+  SmallVector(SmallVector &&aOther) noexcept { moveFrom(aOther); }
+
+  ~SmallVector() { release(); }
+
+  SmallVector &operator=(const SmallVector &aOther) {
+    if (this != &aOther) {
+      clear();
+      append(aOther.begin(), aOther.end());
+    }
+    return *this;
+  }
+
+  SmallVector &operator=(SmallVector &&aOther) noexcept {
+    if (this != &aOther) {
+      release();
+      fData = getInline();
+      fCapacity = N;
+      moveFrom(aOther);
+    }
+    return *this;
+  }
+
+  iterator begin() { return fData; }
+  iterator end() { return fData + fSize; }
+  const_iterator begin() const { return fData; }
+  const_iterator end() const { return fData + fSize; }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  size_t size() const { return fSize; }
+  size_t capacity() const { return fCapacity; }
+  bool empty() const { return fSize == 0; }
+  // true while the elements live in the object itself
+  bool isSmall() const { return fData == getInline(); }
+
+  T *data() { return fData; }
+  const T *data() const { return fData; }
+  T &operator[](size_t aIndex) { return fData[aIndex]; }
+  const T &operator[](size_t aIndex) const { return fData[aIndex]; }
+  T &front() { return fData[0]; }
+  const T &front() const { return fData[0]; }
+  T &back() { return fData[fSize - 1]; }
+  const T &back() const { return fData[fSize - 1]; }
+
+  void push_back(const T &aValue) { emplace_back(aValue); }
+  void push_back(T &&aValue) { emplace_back(std::move(aValue)); }
+
+  template <typename... Args> T &emplace_back(Args &&...aArgs) {
+    if (fSize == fCapacity) {
+      // build the element first, aArgs may refer into the old buffer
+      T value(std::forward<Args>(aArgs)...);
+      grow(fSize + 1);
+      return *new (fData + fSize++) T(std::move(value));
+    }
+    return *new (fData + fSize++) T(std::forward<Args>(aArgs)...);
+  }
+
+  template <typename It> void append(It aFirst, It aLast) {
+    if constexpr (std::is_base_of_v<
+                      std::forward_iterator_tag,
+                      typename std::iterator_traits<It>::iterator_category>) {
+      reserve(fSize + std::distance(aFirst, aLast));
+    }
+    for (; aFirst != aLast; ++aFirst) {
+      emplace_back(*aFirst);
+    }
+  }
+
+  void pop_back() { fData[--fSize].~T(); }
+
+  void clear() {
+    std::destroy(begin(), end());
+    fSize = 0;
+  }
+
+  void reserve(size_t aCapacity) {
+    if (aCapacity > fCapacity) {
+      grow(aCapacity);
+    }
+  }
+
+  void resize(size_t aSize) {
+    if (aSize < fSize) {
+      std::destroy(begin() + aSize, end());
+    } else {
+      reserve(aSize);
+      std::uninitialized_value_construct(end(), fData + aSize);
+    }
+    fSize = aSize;
+  }
+
+private:
+  T *getInline() { return reinterpret_cast<T *>(fInline); }
+  const T *getInline() const { return reinterpret_cast<const T *>(fInline); }
+
+  // move to a heap buffer of at least aMinCapacity elements
+  void grow(size_t aMinCapacity) {
+    size_t capacity = std::max(aMinCapacity, fCapacity * 2);
+    auto *data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+    std::uninitialized_move(begin(), end(), data);
+    std::destroy(begin(), end());
+    if (!isSmall()) {
+      ::operator delete(fData);
+    }
+    fData = data;
+    fCapacity = capacity;
+  }
+
+  // destroy the elements and free a heap buffer, leaves the vector invalid
+  void release() {
+    clear();
+    if (!isSmall()) {
+      ::operator delete(fData);
+    }
+  }
+
+  // take the elements of aOther, an empty inline vector
+  void moveFrom(SmallVector &aOther) {
+    if (aOther.isSmall()) {
+      std::uninitialized_move(aOther.begin(), aOther.end(), fData);
+      fSize = aOther.fSize;
+      aOther.clear();
+      return;
+    }
+    fData = aOther.fData;
+    fSize = aOther.fSize;
+    fCapacity = aOther.fCapacity;
+    aOther.fData = aOther.getInline();
+    aOther.fSize = 0;
+    aOther.fCapacity = N;
+  }
+
+  T *fData = getInline();
+  size_t fSize = 0;
+  size_t fCapacity = N;
+  alignas(T) unsigned char fInline[N * sizeof(T)];
+};
+
+template <typename T, size_t N>
+bool operator==(const SmallVector<T, N> &aLHS, const SmallVector<T, N> &aRHS) {
+  return std::equal(aLHS.begin(), aLHS.end(), aRHS.begin(), aRHS.end());
+}
+
+template <typename T, size_t N>
+bool operator!=(const SmallVector<T, N> &aLHS, const SmallVector<T, N> &aRHS) {
+  return !(aLHS == aRHS);
+}
+
+template <typename T, size_t N>
+bool operator<(const SmallVector<T, N> &aLHS, const SmallVector<T, N> &aRHS) {
+  return std::lexicographical_compare(aLHS.begin(), aLHS.end(), aRHS.begin(),
+                                      aRHS.end());
+}
+
+} // namespace toy::support
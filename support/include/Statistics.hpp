@@ -0,0 +1,176 @@
+/*
+ *
+ * Per phase timing and counters of the compiler, in the spirit of
+ * -ftime-report.
+ *
+ * A PhaseScope charges the wall and cpu time of its lifetime to a phase,
+ * minus the time of the scopes nested in it on the same thread, so no time is
+ * counted twice. Opening a scope reads the clocks and closing it takes a lock,
+ * so phases are coarse, a file or a pass and never a token. Counters add up
+ * events such as tokens or AST nodes. Everything is recorded per thread and
+ * merged when the report is taken, and nothing is recorded while reporting is
+ * disabled. A phase is also a trace scope, one span per file or pass.
+ *
+ * With allocation tracking on, the replacement operator new and delete, the
+ * aligned forms included, charge every allocation to the innermost phase of
+ * the thread. Live bytes are counted for the whole process, as a block may be
+ * freed on another thread, and each phase keeps the peak of the live bytes
+ * above the start of the phase. An AllocationTag further charges the
+ * allocations of a block to a name, such as the kind of AST node being built.
+ * Tests compare the result against allocation budgets.
+ *
+ */
+
+#pragma once
+
+#include "support/include/Trace.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace toy::support {
+
+namespace detail {
+extern std::atomic<bool> sReportEnabled;
+extern std::atomic<bool> sAllocationTracking;
+
+// called by operator new and delete with the requested and usable size
+void recordAllocation(size_t aBytes, size_t aUsable);
+void recordFree(size_t aUsable);
+} // namespace detail
+
+// whether phases and counters are recorded
+inline bool isReportEnabled() {
+  return detail::sReportEnabled.load(std::memory_order_relaxed);
+}
+void setReportEnabled(bool aEnabled);
+
+// whether allocations are charged to phases, only while reporting is enabled
+inline bool isAllocationTracking() {
+  return detail::sAllocationTracking.load(std::memory_order_relaxed);
+}
+void setAllocationTracking(bool aEnabled);
+
+// drop everything recorded so far
+void resetReport();
+
+// add aValue to the counter aName, the name must outlive the process
+void addCount(const char *aName, uint64_t aValue = 1);
+
+// times the enclosing block as the phase aName, the name must outlive the
+// process. aDetail, such as the file, only shows in the trace
+class PhaseScope {
+public:
+  explicit PhaseScope(const char *aName,
+                      const std::string &aDetail = std::string());
+  ~PhaseScope();
+
+  PhaseScope(const PhaseScope &) = delete;
+  PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+  friend void detail::recordAllocation(size_t aBytes, size_t aUsable);
+
+  TraceScope fTrace;
+  const char *fName = nullptr;
+  // tag of the enclosing phase, a phase starts untagged
+  class AllocationTag *fOuterTag = nullptr;
+  PhaseScope *fParent = nullptr;
+  double fStartWall = 0;
+  double fStartCpu = 0;
+  // time of the nested scopes
+  double fChildWall = 0;
+  double fChildCpu = 0;
+  // allocations made in the scope itself
+  uint64_t fAllocations = 0;
+  uint64_t fAllocatedBytes = 0;
+  // live bytes when the scope began, and the peak above them
+  int64_t fStartLive = 0;
+  int64_t fPeakLive = 0;
+};
+
+// charges the allocations of the enclosing block, without those of nested
+// tags and phases, to aName while tracking allocations. aName must outlive the
+// process
+class AllocationTag {
+public:
+  explicit AllocationTag(const char *aName) {
+    if (isAllocationTracking()) {
+      begin(aName);
+    }
+  }
+  ~AllocationTag() {
+    if (fName) {
+      end();
+    }
+  }
+
+  AllocationTag(const AllocationTag &) = delete;
+  AllocationTag &operator=(const AllocationTag &) = delete;
+
+private:
+  friend void detail::recordAllocation(size_t aBytes, size_t aUsable);
+
+  void begin(const char *aName);
+  void end();
+
+  const char *fName = nullptr;
+  AllocationTag *fParent = nullptr;
+  uint64_t fAllocations = 0;
+  uint64_t fAllocatedBytes = 0;
+};
+
+struct AllocationStats {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+struct PhaseStats {
+  uint64_t calls = 0;
+  // seconds spent in the phase itself
+  double wall = 0;
+  double cpu = 0;
+  // allocations made in the phase itself, when tracked
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+  // most bytes live at once during a call, nested phases included
+  uint64_t peakLiveBytes = 0;
+};
+
+struct Report {
+  std::map<std::string, PhaseStats> phases;
+  std::map<std::string, uint64_t> counters;
+  // allocations by tag, when tracked
+  std::map<std::string, AllocationStats> tags;
+  // bytes requested from operator new while reporting was enabled
+  uint64_t bytesAllocated = 0;
+  // peak resident set size of the process in kilobytes
+  uint64_t peakRss = 0;
+  // whether the phases carry allocation numbers
+  bool allocationsTracked = false;
+};
+
+// everything recorded by every thread since the last reset
+Report getReport();
+
+// print the report as aligned columns, or as a JSON object
+void printReport(const Report &aReport, std::ostream &aOs);
+void printReportJson(const Report &aReport, std::ostream &aOs);
+
+// most a phase may allocate, in number of allocations and in bytes
+struct AllocationBudget {
+  std::string phase;
+  uint64_t allocations;
+  uint64_t bytes;
+};
+
+// print every phase of the report over its budget, false if there is one
+bool checkBudgets(const Report &aReport,
+                  const std::vector<AllocationBudget> &aBudgets,
+                  std::ostream &aOs);
+
+} // namespace toy::support
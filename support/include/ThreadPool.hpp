@@ -0,0 +1,65 @@
+/*
+ *
+ * Fixed size pool of worker threads.
+ *
+ * Tasks are taken from a single queue in submission order.
+ *
+ * runTaskGraph runs tasks that depend on each other, such as the functions of
+ * a module callees first. The calling thread runs tasks as well and the
+ * workers never block on the graph, so a task of the pool may run a graph on
+ * the same pool without tying up its workers.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace toy::support {
+
+class ThreadPool {
+public:
+  // start aNumThreads workers, at least one
+  explicit ThreadPool(unsigned aNumThreads);
+
+  // finish the queued tasks and join the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void submit(std::function<void()> aTask);
+
+  // block until every submitted task has finished
+  void wait();
+
+  unsigned getNumThreads() const { return fWorkers.size(); }
+
+private:
+  void work();
+
+  std::vector<std::thread> fWorkers;
+  std::deque<std::function<void()>> fTasks;
+  std::mutex fMutex;
+  // signaled when a task is queued or the pool stops
+  std::condition_variable fHasWork;
+  // signaled when the last pending task finishes
+  std::condition_variable fIdle;
+  // tasks queued or running
+  size_t fPending = 0;
+  bool fStopping = false;
+};
+
+// run aTask(i) for every task i once the tasks in aDeps[i] have finished,
+// on aPool and the calling thread, or on the calling thread alone if aPool is
+// nullptr. returns once every task has finished
+void runTaskGraph(ThreadPool *aPool,
+                  const std::vector<std::vector<size_t>> &aDeps,
+                  const std::function<void(size_t)> &aTask);
+
+} // namespace toy::support
@@ -0,0 +1,74 @@
+/*
+ *
+ * Chrome trace event recording, the output loads in chrome://tracing and
+ * Perfetto.
+ *
+ * A TraceScope records a begin event when it is created and an end event
+ * when it is destroyed, stamped with the id of the thread. Every thread
+ * appends to its own buffer of fixed size chunks and publishes each event
+ * with a release store, so recording takes no lock; writeTrace consumes the
+ * buffers of all threads. While tracing is off a scope costs one relaxed load.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace toy::support {
+
+namespace detail {
+extern std::atomic<bool> sTraceEnabled;
+} // namespace detail
+
+inline bool isTraceEnabled() {
+  return detail::sTraceEnabled.load(std::memory_order_relaxed);
+}
+
+// record events from now on, the ones recorded before are dropped
+void startTrace();
+
+// stop recording and write the events as a trace.json file, false if the
+// file cannot be written
+bool writeTrace(const std::string &aPath);
+
+// records the enclosing block, aName must outlive the trace and aDetail is
+// shown as an argument of the event
+class TraceScope {
+public:
+  explicit TraceScope(const char *aName) {
+    if (isTraceEnabled()) {
+      begin(aName, std::string());
+    }
+  }
+  TraceScope(const char *aName, const std::string &aDetail) {
+    if (isTraceEnabled()) {
+      begin(aName, aDetail);
+    }
+  }
+  ~TraceScope() {
+    if (fName) {
+      end();
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  void begin(const char *aName, const std::string &aDetail);
+  void end();
+
+  const char *fName = nullptr;
+};
+
+#define TOY_TRACE_CONCAT_IMPL(a, b) a##b
+#define TOY_TRACE_CONCAT(a, b) TOY_TRACE_CONCAT_IMPL(a, b)
+
+// trace the enclosing block as aName, with an optional detail string
+#define TOY_TRACE_SCOPE(...)                                                   \
+  ::toy::support::TraceScope TOY_TRACE_CONCAT(toyTraceScope, __LINE__)(        \
+      __VA_ARGS__)
+
+} // namespace toy::support
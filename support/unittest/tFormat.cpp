@@ -0,0 +1,51 @@
+#include "support/include/Format.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <sstream>
+
+using namespace toy::support;
+
+TEST(Format, ShortestRoundTrip) {
+  EXPECT_EQ(formatNumber(1.0), "1");
+  EXPECT_EQ(formatNumber(2.5), "2.5");
+  EXPECT_EQ(formatNumber(0.1), "0.1");
+  EXPECT_EQ(formatNumber(-0.0), "-0");
+  EXPECT_EQ(formatNumber(1e21), "1e+21");
+  for (double value : {1.0 / 3, 2.0 / 3, 1e-300, 123456.789, 5e-324}) {
+    EXPECT_EQ(std::strtod(formatNumber(value).c_str(), nullptr), value);
+  }
+  // floats are as short as their own precision allows
+  EXPECT_EQ(formatNumber(0.1f), "0.1");
+  EXPECT_EQ(formatNumber(1.0f / 3), "0.33333334");
+}
+
+TEST(Format, OutputBufferFlushes) {
+  std::stringstream out;
+  {
+    OutputBuffer buffer(out);
+    for (size_t i = 0; i < OutputBuffer::kCapacity; ++i) {
+      buffer.appendNumber(7.0);
+    }
+    buffer.append(std::string(OutputBuffer::kCapacity + 1, 'x'));
+    buffer.append('\n');
+  }
+  auto text = out.str();
+  ASSERT_EQ(text.size(), 2 * OutputBuffer::kCapacity + 2);
+  EXPECT_EQ(text.substr(0, 4), "7777");
+  EXPECT_EQ(text.substr(text.size() - 3), "xx\n");
+
+  // buffers alive at the same time on a thread do not share storage
+  std::stringstream first, second;
+  {
+    OutputBuffer outer(first);
+    outer.append("outer");
+    {
+      OutputBuffer inner(second);
+      inner.append("inner");
+    }
+    outer.append('\n');
+  }
+  EXPECT_EQ(first.str(), "outer\n");
+  EXPECT_EQ(second.str(), "inner");
+}
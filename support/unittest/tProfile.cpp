@@ -0,0 +1,83 @@
+#include "support/include/Profile.hpp"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace toy::support;
+
+// utility to build a small profile
+static Profile makeProfile() {
+  Profile profile;
+  profile.functions["main"] = FunctionProfile{1, 1000, 100, 64};
+  profile.functions["hot"] = FunctionProfile{10, 900, 900, 4096};
+  profile.callSites[CallSite{"hot", 7, 12}] = CallSiteProfile{"main", 10, 900,
+                                                              4096};
+  profile.callSites[CallSite{"cold", 8, 12}] = CallSiteProfile{"main"};
+  profile.kernels["Mul"] = KernelProfile{10, 800, 4096};
+  return profile;
+}
+
+TEST(Profile, RoundTrip) {
+  std::string path = testing::TempDir() + "round.prof";
+  ASSERT_TRUE(writeProfile(makeProfile(), path));
+
+  Profile profile;
+  std::string error;
+  ASSERT_TRUE(readProfile(path, profile, error)) << error;
+  EXPECT_EQ(profile.functions["hot"].calls, 10u);
+  EXPECT_EQ(profile.functions["main"].bytes, 64u);
+  EXPECT_EQ(profile.getTotalNs(), 1000u);
+  auto *site = profile.findCallSite("hot", 7, 12);
+  ASSERT_NE(site, nullptr);
+  EXPECT_EQ(site->caller, "main");
+  EXPECT_EQ(site->inclusiveNs, 900u);
+  // a site that never ran is still known
+  site = profile.findCallSite("cold", 8, 12);
+  ASSERT_NE(site, nullptr);
+  EXPECT_EQ(site->calls, 0u);
+  EXPECT_EQ(profile.findCallSite("hot", 7, 13), nullptr);
+  EXPECT_EQ(profile.kernels["Mul"].ns, 800u);
+}
+
+TEST(Profile, Merge) {
+  Profile profile = makeProfile();
+  profile.merge(makeProfile());
+  EXPECT_EQ(profile.functions["hot"].calls, 20u);
+  EXPECT_EQ(profile.findCallSite("hot", 7, 12)->bytes, 8192u);
+  EXPECT_EQ(profile.kernels["Mul"].calls, 20u);
+  EXPECT_EQ(profile.getTotalNs(), 2000u);
+}
+
+TEST(Profile, Errors) {
+  Profile profile;
+  std::string error;
+  EXPECT_FALSE(readProfile(testing::TempDir() + "missing.prof", profile,
+                           error));
+  EXPECT_NE(error.find("cannot open"), std::string::npos);
+
+  std::string path = testing::TempDir() + "bad.prof";
+  std::ofstream(path) << "not a profile\n";
+  EXPECT_FALSE(readProfile(path, profile, error));
+  EXPECT_NE(error.find("is not a toy profile"), std::string::npos);
+
+  std::ofstream(path) << "toy-profile 1\nfunction main 1 2 3 4\n"
+                      << "call hot 7 x main 1 2 3\n";
+  EXPECT_FALSE(readProfile(path, profile, error));
+  EXPECT_NE(error.find("malformed entry on line 3"), std::string::npos);
+}
+
+TEST(Profile, ReportIsHottestFirst) {
+  std::stringstream out;
+  printProfile(makeProfile(), out);
+  auto text = out.str();
+  EXPECT_LT(text.find("hot "), text.find("main "));
+  EXPECT_NE(text.find("main -> hot (7:12)"), std::string::npos);
+  EXPECT_LT(text.find("main -> hot"), text.find("main -> cold"));
+  EXPECT_NE(text.find("90.0"), std::string::npos);
+
+  // the limit applies to each table
+  out.str("");
+  printProfile(makeProfile(), out, 1);
+  EXPECT_EQ(out.str().find("main -> cold"), std::string::npos);
+}
@@ -0,0 +1,59 @@
+#include "support/include/SmallVector.hpp"
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+using namespace toy::support;
+
+TEST(SmallVector, StaysInlineUpToCapacity) {
+  SmallVector<int, 4> vec{1, 2, 3};
+  vec.push_back(4);
+  EXPECT_TRUE(vec.isSmall());
+  EXPECT_EQ(vec.size(), 4u);
+
+  vec.push_back(5);
+  EXPECT_FALSE(vec.isSmall());
+  EXPECT_GE(vec.capacity(), 5u);
+  EXPECT_EQ(vec, (SmallVector<int, 4>{1, 2, 3, 4, 5}));
+  SmallVector<int, 4> reversed(vec.rbegin(), vec.rend());
+  EXPECT_EQ(reversed, (SmallVector<int, 4>{5, 4, 3, 2, 1}));
+}
+
+TEST(SmallVector, MovesElementsOrBuffer) {
+  SmallVector<std::unique_ptr<std::string>, 2> small;
+  small.push_back(std::make_unique<std::string>("a"));
+  auto movedSmall = std::move(small);
+  EXPECT_TRUE(small.empty());
+  ASSERT_EQ(movedSmall.size(), 1u);
+  EXPECT_EQ(*movedSmall[0], "a");
+
+  SmallVector<std::unique_ptr<std::string>, 2> large;
+  for (int i = 0; i < 3; ++i) {
+    large.push_back(std::make_unique<std::string>(std::to_string(i)));
+  }
+  auto *data = large.data();
+  SmallVector<std::unique_ptr<std::string>, 2> movedLarge;
+  movedLarge = std::move(large);
+  // the heap buffer changes hands, nothing is reallocated
+  EXPECT_EQ(movedLarge.data(), data);
+  EXPECT_TRUE(large.empty());
+  EXPECT_TRUE(large.isSmall());
+  EXPECT_EQ(*movedLarge.back(), "2");
+}
+
+TEST(SmallVector, CopyAppendAndCompare) {
+  SmallVector<int, 2> dims{2};
+  SmallVector<int, 2> nested{3, 4};
+  dims.append(nested.begin(), nested.end());
+  auto copy = dims;
+  EXPECT_EQ(copy, (SmallVector<int, 2>{2, 3, 4}));
+  EXPECT_NE(copy, nested);
+  EXPECT_LT(copy, nested);
+
+  copy.pop_back();
+  copy.resize(4);
+  EXPECT_EQ(copy, (SmallVector<int, 2>{2, 3, 0, 0}));
+  copy.clear();
+  EXPECT_TRUE(copy.empty());
+}
@@ -0,0 +1,105 @@
+#include "support/include/Statistics.hpp"
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace toy::support;
+
+TEST(Statistics, NestedPhasesAreExclusive) {
+  resetReport();
+  setReportEnabled(true);
+  {
+    PhaseScope outer("outer");
+    for (int i = 0; i < 3; ++i) {
+      PhaseScope inner("inner");
+      addCount("items", 2);
+      std::vector<int> buffer(1000);
+    }
+  }
+  // worker threads are merged too, also after they exit
+  std::thread([] { addCount("items"); }).join();
+  setReportEnabled(false);
+  addCount("items");
+
+  auto report = getReport();
+  EXPECT_EQ(report.phases["outer"].calls, 1u);
+  EXPECT_EQ(report.phases["inner"].calls, 3u);
+  EXPECT_GE(report.phases["outer"].wall, 0);
+  EXPECT_EQ(report.counters["items"], 7u);
+  EXPECT_GE(report.bytesAllocated, 3 * 1000 * sizeof(int));
+  EXPECT_GT(report.peakRss, 0u);
+
+  std::stringstream table, json;
+  printReport(report, table);
+  printReportJson(report, json);
+  EXPECT_NE(table.str().find("inner"), std::string::npos);
+  EXPECT_EQ(json.str().rfind("{\"phases\": {\"inner\": {\"calls\": 3", 0), 0u);
+
+  resetReport();
+  EXPECT_TRUE(getReport().phases.empty());
+}
+
+TEST(Statistics, AllocationsByPhaseAndTag) {
+  setAllocationTracking(true);
+  resetReport();
+  setReportEnabled(true);
+  {
+    PhaseScope outer("outer");
+    auto *kept = new std::vector<char>(1000);
+    {
+      AllocationTag tag("tagged");
+      std::vector<char> scratch(100);
+      {
+        // a phase is not part of the tag it is nested in
+        PhaseScope inner("inner");
+        std::vector<char> big(4000);
+      }
+    }
+    delete kept;
+  }
+  setReportEnabled(false);
+  setAllocationTracking(false);
+
+  auto report = getReport();
+  ASSERT_TRUE(report.allocationsTracked);
+  auto &outer = report.phases["outer"];
+  EXPECT_EQ(outer.allocations, 3u);
+  EXPECT_EQ(outer.allocatedBytes, sizeof(std::vector<char>) + 1000 + 100);
+  // the vector of the inner phase was live on top of the outer ones
+  EXPECT_GE(outer.peakLiveBytes, 5100u);
+  EXPECT_EQ(report.phases["inner"].allocatedBytes, 4000u);
+  EXPECT_EQ(report.tags["tagged"].allocations, 1u);
+  EXPECT_EQ(report.tags["tagged"].bytes, 100u);
+
+  std::stringstream err;
+  EXPECT_TRUE(checkBudgets(report, {{"outer", 3, 2000}, {"missing", 0, 0}},
+                           err));
+  EXPECT_FALSE(checkBudgets(report, {{"inner", 0, 4000}}, err));
+  EXPECT_EQ(err.str(), "phase 'inner' made 1 allocations, the budget is 0\n");
+}
+
+TEST(Statistics, AlignedAndCrossThreadAllocations) {
+  struct alignas(64) Block {
+    char bytes[4096];
+  };
+  setAllocationTracking(true);
+  resetReport();
+  setReportEnabled(true);
+  {
+    PhaseScope phase("phase");
+    auto *block = new Block;
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % 64, 0u);
+    // freed by another thread, the bytes are no longer live
+    std::thread([block] { delete block; }).join();
+    delete new Block;
+  }
+  setReportEnabled(false);
+  setAllocationTracking(false);
+
+  auto &phase = getReport().phases["phase"];
+  EXPECT_GE(phase.allocations, 2u);
+  EXPECT_GE(phase.allocatedBytes, 2 * sizeof(Block));
+  EXPECT_LT(phase.peakLiveBytes, 2 * sizeof(Block));
+}
@@ -0,0 +1,74 @@
+#include "support/include/ThreadPool.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace toy::support;
+
+TEST(ThreadPool, RunsEveryTask) {
+  std::atomic<int> sum{0};
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.getNumThreads(), 4u);
+  for (int i = 1; i <= 100; ++i) {
+    pool.submit([&sum, i] { sum += i; });
+  }
+  pool.wait();
+  EXPECT_EQ(sum, 5050);
+
+  // the pool can be reused after waiting
+  pool.submit([&sum] { sum = 0; });
+  pool.wait();
+  EXPECT_EQ(sum, 0);
+}
+
+TEST(ThreadPool, AtLeastOneWorker) {
+  ThreadPool pool(0);
+  EXPECT_EQ(pool.getNumThreads(), 1u);
+  bool ran = false;
+  pool.submit([&ran] { ran = true; });
+  pool.wait();
+  EXPECT_TRUE(ran);
+}
+
+TEST(ThreadPool, TaskGraphRunsDependenciesFirst) {
+  // a diamond repeated, task i waits for the two tasks of the level before
+  std::vector<std::vector<size_t>> deps(200);
+  for (size_t i = 2; i < deps.size(); ++i) {
+    deps[i] = {i - 2 - i % 2, i - 1 - i % 2};
+  }
+  std::vector<std::atomic<bool>> finished(deps.size());
+  std::atomic<bool> ordered{true};
+  ThreadPool pool(4);
+  runTaskGraph(&pool, deps, [&](size_t aIndex) {
+    for (auto dep : deps[aIndex]) {
+      ordered = ordered && finished[dep];
+    }
+    finished[aIndex] = true;
+  });
+  EXPECT_TRUE(ordered);
+  for (auto &done : finished) {
+    EXPECT_TRUE(done);
+  }
+}
+
+TEST(ThreadPool, TaskGraphInsideWorker) {
+  // every worker runs a graph on its own pool, the callers do the work
+  ThreadPool pool(2);
+  std::atomic<int> sum{0};
+  for (int i = 0; i < 4; ++i) {
+    pool.submit([&] {
+      runTaskGraph(&pool, std::vector<std::vector<size_t>>(50),
+                   [&](size_t aIndex) { sum += aIndex; });
+    });
+  }
+  pool.wait();
+  EXPECT_EQ(sum, 4 * 1225);
+
+  // without a pool everything runs on the calling thread
+  std::vector<size_t> order;
+  runTaskGraph(nullptr, {{}, {0}, {1}}, [&](size_t aIndex) {
+    order.push_back(aIndex);
+  });
+  EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2}));
+}
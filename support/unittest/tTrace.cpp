@@ -0,0 +1,58 @@
+#include "support/include/Trace.hpp"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace toy::support;
+
+static std::string readTrace(const std::string &aPath) {
+  std::ifstream file(aPath);
+  std::stringstream data;
+  data << file.rdbuf();
+  return data.str();
+}
+
+static size_t countOf(const std::string &aText, const std::string &aWord) {
+  size_t count = 0;
+  for (auto pos = aText.find(aWord); pos != std::string::npos;
+       pos = aText.find(aWord, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(Trace, WritesScopesOfEveryThread) {
+  std::string path = testing::TempDir() + "toy-trace.json";
+  { TOY_TRACE_SCOPE("before"); }
+
+  startTrace();
+  {
+    TOY_TRACE_SCOPE("outer", "a \"quoted\" detail");
+    // enough events to fill several chunks
+    for (int i = 0; i < 3000; ++i) {
+      TOY_TRACE_SCOPE("inner");
+    }
+  }
+  std::thread([] { TOY_TRACE_SCOPE("worker"); }).join();
+  ASSERT_TRUE(writeTrace(path));
+  { TOY_TRACE_SCOPE("after"); }
+
+  auto trace = readTrace(path);
+  EXPECT_EQ(trace.rfind("{\"traceEvents\": [", 0), 0u);
+  EXPECT_EQ(countOf(trace, "\"inner\""), 6000u);
+  EXPECT_EQ(countOf(trace, "\"worker\""), 2u);
+  EXPECT_NE(trace.find("{\"detail\": \"a \\\"quoted\\\" detail\"}"),
+            std::string::npos);
+  EXPECT_EQ(trace.find("before"), std::string::npos);
+
+  // a new trace only holds what follows it
+  startTrace();
+  { TOY_TRACE_SCOPE("second"); }
+  ASSERT_TRUE(writeTrace(path));
+  trace = readTrace(path);
+  EXPECT_EQ(countOf(trace, "\"second\""), 2u);
+  EXPECT_EQ(trace.find("inner"), std::string::npos);
+  EXPECT_EQ(trace.find("after"), std::string::npos);
+}
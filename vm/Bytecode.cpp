@@ -0,0 +1,42 @@
+#include "vm/include/Bytecode.hpp"
+
+namespace toy::vm {
+
+const char *getOpcodeName(Opcode aOp) {
+  switch (aOp) {
+#define TOY_OPCODE_NAME(name, desc)                                            \
+  case Opcode::name:                                                           \
+    return #name;
+    TOY_OPCODES(TOY_OPCODE_NAME)
+#undef TOY_OPCODE_NAME
+  }
+  return "unknown";
+}
+
+int Program::getFunction(const std::string &aName) const {
+  auto it = functionIndex.find(aName);
+  return it == functionIndex.end() ? -1 : it->second;
+}
+
+void Program::dump(std::ostream &aOs) const {
+  for (auto &chunk : functions) {
+    aOs << chunk.name << " (params " << chunk.numParams << ", regs "
+        << chunk.numRegs << ")\n";
+    for (auto &instr : chunk.code) {
+      aOs << "  " << getOpcodeName(instr.op) << " " << instr.a << " "
+          << instr.b << " " << instr.c;
+      if (instr.flags & kMoveA) {
+        aOs << " move a";
+      }
+      if (instr.flags & kMoveB) {
+        aOs << " move b";
+      }
+      if (instr.flags & kMoveC) {
+        aOs << " move c";
+      }
+      aOs << "\n";
+    }
+  }
+}
+
+} // namespace toy::vm
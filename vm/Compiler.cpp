@@ -0,0 +1,508 @@
+#include "vm/include/Compiler.hpp"
+#include "runtime/include/TensorFile.hpp"
+#include "support/include/Statistics.hpp"
+#include "support/include/Trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+
+namespace toy::vm {
+
+// collect the variables read by the tree
+static void collectUses(Expr *aExpr, std::set<std::string> &aUses) {
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    aUses.insert(var->getName());
+  } else if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    collectUses(decl->getInitValue(), aUses);
+  } else if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (ret->getExpr().has_value()) {
+      collectUses(*ret->getExpr(), aUses);
+    }
+  } else if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+    collectUses(print->getArg(), aUses);
+  } else if (auto *bin = dynamic_cast<BinaryExpr *>(aExpr)) {
+    collectUses(bin->getLHS(), aUses);
+    collectUses(bin->getRHS(), aUses);
+  } else if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    for (auto &arg : call->getArgs()) {
+      collectUses(arg.get(), aUses);
+    }
+  } else if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    for (auto &input : fused->getInputs()) {
+      collectUses(input.get(), aUses);
+    }
+  }
+}
+
+// whether a call to aFunction yields a value, the body is straight line so
+// its first return decides
+static bool returnsValue(Function *aFunction) {
+  for (auto &expr : *aFunction->getBody()) {
+    if (auto *ret = dynamic_cast<ReturnExpr *>(expr.get())) {
+      return ret->getExpr().has_value();
+    }
+  }
+  return false;
+}
+
+std::unique_ptr<Program> Compiler::compile(Module &aModule) {
+  support::PhaseScope scope("bytecode");
+  auto program = std::make_unique<Program>();
+  fProgram = program.get();
+  fReturnsValue.clear();
+
+  // number the functions first so calls can be forward references
+  for (auto &func : aModule) {
+    auto &name = func->getPrototype()->getName();
+    fProgram->functionIndex[name] = fProgram->functions.size();
+    fProgram->functions.emplace_back();
+    fProgram->functions.back().name = name;
+    fReturnsValue.push_back(returnsValue(func.get()));
+  }
+
+  int index = 0;
+  for (auto &func : aModule) {
+    if (!compileFunction(func.get(), fProgram->functions[index++])) {
+      return nullptr;
+    }
+  }
+  return program;
+}
+
+bool Compiler::compileFunction(Function *aFunction, Chunk &aChunk) {
+  TOY_TRACE_SCOPE("compile function", aFunction->getPrototype()->getName());
+  fChunk = &aChunk;
+  fVars.clear();
+  fFreeRegs.clear();
+  fFailed = false;
+
+  auto &params = aFunction->getPrototype()->getArgs();
+  aChunk.numParams = params.size();
+  for (auto &param : params) {
+    fVars[param->getName()] = allocReg();
+  }
+
+  // variables to release after each statement, the statement holding the
+  // last use of their binding. a binding ends at the next declaration of the
+  // same name
+  auto *body = aFunction->getBody();
+  std::vector<std::vector<std::string>> namesAfter(body->size());
+  std::map<std::string, int> pending;
+  for (size_t i = 0; i < body->size(); ++i) {
+    std::set<std::string> uses;
+    collectUses((*body)[i].get(), uses);
+    for (auto &name : uses) {
+      pending[name] = i;
+    }
+    if (auto *decl = dynamic_cast<VarDeclExpr *>((*body)[i].get())) {
+      auto it = pending.find(decl->getName());
+      if (it != pending.end() && it->second < static_cast<int>(i)) {
+        namesAfter[it->second].push_back(decl->getName());
+      }
+      // a declaration without uses is released right away
+      pending[decl->getName()] = i;
+    }
+  }
+  for (auto &[name, last] : pending) {
+    namesAfter[last].push_back(name);
+  }
+
+  for (size_t i = 0; i < body->size(); ++i) {
+    Expr *expr = (*body)[i].get();
+    if (!compileStatement(expr)) {
+      return false;
+    }
+    if (dynamic_cast<ReturnExpr *>(expr)) {
+      markLastUses(aChunk);
+      return true;
+    }
+    for (auto &name : namesAfter[i]) {
+      auto it = fVars.find(name);
+      if (it == fVars.end()) {
+        continue;
+      }
+      emit(Opcode::Free, it->second);
+      freeReg(it->second);
+      fVars.erase(it);
+    }
+  }
+
+  emit(Opcode::ReturnVoid, 0);
+  markLastUses(aChunk);
+  return true;
+}
+
+void Compiler::markLastUses(Chunk &aChunk) {
+  // chunks are straight line code, so a backward walk sees every later read
+  std::vector<bool> live(aChunk.numRegs, false);
+  // Free still ahead of each register, dropped if a read moves the value
+  std::vector<int> pendingFree(aChunk.numRegs, -1);
+  std::vector<bool> removed(aChunk.code.size(), false);
+
+  // record a read of aReg, true if it is the last one
+  auto use = [&](int aReg) {
+    if (live[aReg]) {
+      return false;
+    }
+    live[aReg] = true;
+    if (pendingFree[aReg] >= 0) {
+      removed[pendingFree[aReg]] = true;
+      pendingFree[aReg] = -1;
+    }
+    return true;
+  };
+
+  for (size_t i = aChunk.code.size(); i-- > 0;) {
+    auto &instr = aChunk.code[i];
+    if (instr.op == Opcode::Free) {
+      pendingFree[instr.a] = i;
+      live[instr.a] = false;
+      continue;
+    }
+    if (instr.op != Opcode::Print && instr.op != Opcode::Return &&
+        instr.op != Opcode::ReturnVoid) {
+      // the value written here is another one than the value read, its Free
+      // stays if nothing reads it
+      live[instr.a] = false;
+      pendingFree[instr.a] = -1;
+    }
+
+    switch (instr.op) {
+    case Opcode::Move:
+    case Opcode::Transpose:
+    case Opcode::Reshape:
+      if (use(instr.b)) {
+        instr.flags |= kMoveB;
+      }
+      break;
+    case Opcode::Add:
+    case Opcode::Sub:
+    case Opcode::Mul:
+      // a register read twice is never moved
+      if (instr.b == instr.c) {
+        use(instr.b);
+        break;
+      }
+      if (use(instr.b)) {
+        instr.flags |= kMoveB;
+      }
+      if (use(instr.c)) {
+        instr.flags |= kMoveC;
+      }
+      break;
+    case Opcode::Fused:
+    case Opcode::Call:
+      // only the last read of a register in the list may move it
+      for (auto it = fProgram->operands[instr.c].rbegin();
+           it != fProgram->operands[instr.c].rend(); ++it) {
+        if (use(*it)) {
+          *it |= kMoveOperand;
+        }
+      }
+      break;
+    case Opcode::Print:
+    case Opcode::Return:
+      if (use(instr.a)) {
+        instr.flags |= kMoveA;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  // drop the releases made redundant by moves
+  size_t kept = 0;
+  for (size_t i = 0; i < aChunk.code.size(); ++i) {
+    if (!removed[i]) {
+      aChunk.code[kept] = aChunk.code[i];
+      aChunk.lines[kept] = aChunk.lines[i];
+      ++kept;
+    }
+  }
+  aChunk.code.resize(kept);
+  aChunk.lines.resize(kept);
+}
+
+bool Compiler::compileStatement(Expr *aExpr) {
+  fCurrent = aExpr;
+
+  if (auto *decl = dynamic_cast<VarDeclExpr *>(aExpr)) {
+    auto init = compileExpr(decl->getInitValue());
+    if (fFailed) {
+      return false;
+    }
+    auto &declared = decl->getType().shape;
+    if (dynamic_cast<LoadExpr *>(decl->getInitValue()) && !declared.empty()) {
+      // a loaded tensor must already have the declared shape
+      auto &dims = fProgram->constants.back().getDims();
+      if (!std::equal(declared.begin(), declared.end(), dims.begin(),
+                      dims.end())) {
+        error(aExpr, "declared shape of '" + decl->getName() +
+                         "' does not match the tensor file");
+        return false;
+      }
+    }
+    int reg = init.reg;
+    if (!init.temp) {
+      // bind a copy of the other variable's tensor, buffers are shared
+      reg = allocReg();
+      emit(Opcode::Move, reg, init.reg);
+    }
+    if (!decl->getType().shape.empty()) {
+      auto &shape = decl->getType().shape;
+      fProgram->dims.emplace_back(shape.begin(), shape.end());
+      emit(Opcode::Reshape, reg, reg, fProgram->dims.size() - 1);
+    }
+    auto old = fVars.find(decl->getName());
+    if (old != fVars.end()) {
+      emit(Opcode::Free, old->second);
+      freeReg(old->second);
+    }
+    fVars[decl->getName()] = reg;
+    return true;
+  }
+
+  if (auto *ret = dynamic_cast<ReturnExpr *>(aExpr)) {
+    if (!ret->getExpr().has_value()) {
+      emit(Opcode::ReturnVoid, 0);
+      return true;
+    }
+    auto value = compileExpr(*ret->getExpr());
+    if (fFailed) {
+      return false;
+    }
+    emit(Opcode::Return, value.reg);
+    return true;
+  }
+
+  if (auto *print = dynamic_cast<PrintExpr *>(aExpr)) {
+    auto value = compileExpr(print->getArg());
+    if (fFailed) {
+      return false;
+    }
+    emit(Opcode::Print, value.reg);
+    release(value);
+    return true;
+  }
+
+  // expression statement, the value is dropped
+  auto value = compileExpr(aExpr);
+  if (fFailed) {
+    return false;
+  }
+  if (value.reg >= 0) {
+    release(value);
+  }
+  return true;
+}
+
+runtime::Tensor Compiler::buildConstant(Expr *aExpr) {
+  if (auto *num = dynamic_cast<NumberExpr *>(aExpr)) {
+    return runtime::Tensor::scalar(num->getValue(), fElementType);
+  }
+  if (auto *lit = dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+    // kept sparse, the kernels work on the nonzeros
+    auto &dims = lit->getDims();
+    return runtime::Tensor::sparse(
+        runtime::Dims(dims.begin(), dims.end()),
+        runtime::CSR{lit->getRowStarts(), lit->getCols(), lit->getValues()},
+        fElementType);
+  }
+  auto *lit = static_cast<LiteralExpr *>(aExpr);
+  std::vector<double> data;
+  std::function<void(Expr *)> flatten = [&](Expr *aElem) {
+    if (auto *num = dynamic_cast<NumberExpr *>(aElem)) {
+      data.push_back(num->getValue());
+      return;
+    }
+    for (auto &val : static_cast<LiteralExpr *>(aElem)->getValues()) {
+      flatten(val.get());
+    }
+  };
+  flatten(lit);
+  auto &dims = lit->getDims();
+  return runtime::Tensor(runtime::Dims(dims.begin(), dims.end()),
+                         std::move(data))
+      .converted(fElementType);
+}
+
+Compiler::Operand Compiler::compileExpr(Expr *aExpr) {
+  if (aExpr == nullptr) {
+    return error(fCurrent, "missing expression");
+  }
+
+  if (dynamic_cast<NumberExpr *>(aExpr) || dynamic_cast<LiteralExpr *>(aExpr) ||
+      dynamic_cast<SparseLiteralExpr *>(aExpr)) {
+    fProgram->constants.push_back(buildConstant(aExpr));
+    int reg = allocReg();
+    emit(Opcode::LoadConst, reg, fProgram->constants.size() - 1);
+    return {reg, true};
+  }
+
+  if (auto *load = dynamic_cast<LoadExpr *>(aExpr)) {
+    // mapped once here, every run of the program reads the same pages
+    runtime::Tensor tensor;
+    std::string message;
+    if (!runtime::mapTensorFile(load->getPath(), tensor, message)) {
+      return error(aExpr, message);
+    }
+    // converting would copy the whole file, the file is written in the
+    // element type of the program instead
+    if (tensor.getElementType() != fElementType) {
+      return error(aExpr,
+                   "'" + load->getPath() + "' holds " +
+                       runtime::getElementTypeName(tensor.getElementType()) +
+                       " elements, the program uses " +
+                       runtime::getElementTypeName(fElementType));
+    }
+    fProgram->constants.push_back(std::move(tensor));
+    int reg = allocReg();
+    emit(Opcode::LoadConst, reg, fProgram->constants.size() - 1);
+    return {reg, true};
+  }
+
+  if (auto *var = dynamic_cast<VarExpr *>(aExpr)) {
+    auto it = fVars.find(var->getName());
+    if (it == fVars.end()) {
+      return error(aExpr, "unknown variable '" + var->getName() + "'");
+    }
+    return {it->second, false};
+  }
+
+  if (auto *bin = dynamic_cast<BinaryExpr *>(aExpr)) {
+    auto lhs = compileExpr(bin->getLHS());
+    if (fFailed) {
+      return lhs;
+    }
+    auto rhs = compileExpr(bin->getRHS());
+    if (fFailed) {
+      return rhs;
+    }
+    Opcode op;
+    switch (bin->getOp()) {
+    case '+':
+      op = Opcode::Add;
+      break;
+    case '-':
+      op = Opcode::Sub;
+      break;
+    case '*':
+      op = Opcode::Mul;
+      break;
+    default:
+      return error(aExpr, std::string("unknown operator '") + bin->getOp() + "'");
+    }
+    release(rhs);
+    release(lhs);
+    int reg = allocReg();
+    emit(op, reg, lhs.reg, rhs.reg);
+    return {reg, true};
+  }
+
+  if (auto *fused = dynamic_cast<FusedExpr *>(aExpr)) {
+    std::vector<Operand> inputs;
+    for (auto &input : fused->getInputs()) {
+      inputs.push_back(compileExpr(input.get()));
+      if (fFailed) {
+        return inputs.back();
+      }
+    }
+    std::vector<runtime::FusedOp> program;
+    for (auto &op : fused->getProgram()) {
+      program.push_back(runtime::FusedOp{op.op, op.input});
+    }
+    fProgram->programs.push_back(std::move(program));
+    uint32_t operands = addOperands(inputs);
+    for (auto &input : inputs) {
+      release(input);
+    }
+    int reg = allocReg();
+    emit(Opcode::Fused, reg, fProgram->programs.size() - 1, operands);
+    return {reg, true};
+  }
+
+  if (auto *call = dynamic_cast<CallExpr *>(aExpr)) {
+    std::vector<Operand> args;
+    for (auto &arg : call->getArgs()) {
+      args.push_back(compileExpr(arg.get()));
+      if (fFailed) {
+        return args.back();
+      }
+    }
+
+    if (call->getCallee() == "transpose") {
+      if (args.size() != 1) {
+        return error(aExpr, "transpose takes a single argument");
+      }
+      release(args[0]);
+      int reg = allocReg();
+      emit(Opcode::Transpose, reg, args[0].reg);
+      return {reg, true};
+    }
+
+    int callee = fProgram->getFunction(call->getCallee());
+    if (callee < 0) {
+      return error(aExpr, "unknown function '" + call->getCallee() + "'");
+    }
+    // only a statement of its own may drop the missing value
+    if (!fReturnsValue[callee] && aExpr != fCurrent) {
+      return error(aExpr, "expression does not produce a value");
+    }
+    uint32_t operands = addOperands(args);
+    fProgram->callPositions[operands] = {aExpr->getLoc().line,
+                                         aExpr->getLoc().col};
+    for (auto &arg : args) {
+      release(arg);
+    }
+    int reg = allocReg();
+    emit(Opcode::Call, reg, callee, operands);
+    return {reg, true};
+  }
+
+  return error(aExpr, "expression does not produce a value");
+}
+
+int Compiler::allocReg() {
+  if (!fFreeRegs.empty()) {
+    int reg = fFreeRegs.back();
+    fFreeRegs.pop_back();
+    return reg;
+  }
+  assert(fChunk->numRegs < kMoveOperand && "too many registers");
+  return fChunk->numRegs++;
+}
+
+void Compiler::freeReg(int aReg) { fFreeRegs.push_back(aReg); }
+
+void Compiler::release(Operand aOperand) {
+  if (aOperand.temp) {
+    freeReg(aOperand.reg);
+  }
+}
+
+void Compiler::emit(Opcode aOp, int aA, uint32_t aB, uint32_t aC) {
+  fChunk->code.push_back(Instr{aOp, 0, static_cast<uint16_t>(aA), aB, aC});
+  fChunk->lines.push_back(fCurrent ? fCurrent->getLoc().line : 0);
+}
+
+uint32_t Compiler::addOperands(const std::vector<Operand> &aOperands) {
+  std::vector<uint16_t> regs;
+  for (auto &operand : aOperands) {
+    regs.push_back(operand.reg);
+  }
+  fProgram->operands.push_back(std::move(regs));
+  return fProgram->operands.size() - 1;
+}
+
+Compiler::Operand Compiler::error(Expr *aExpr, const std::string &aMsg) {
+  auto &loc = aExpr->getLoc();
+  std::cout << "Compile error (" << loc.line << ", " << loc.col << "): " << aMsg
+            << "\n";
+  fFailed = true;
+  return {-1, false};
+}
+
+} // namespace toy::vm
@@ -0,0 +1,127 @@
+#include "vm/include/Profiler.hpp"
+
+#include <chrono>
+
+namespace toy::vm {
+
+static constexpr size_t kNumOpcodes = 0
+#define TOY_OPCODE_COUNT(name, desc) +1
+    TOY_OPCODES(TOY_OPCODE_COUNT)
+#undef TOY_OPCODE_COUNT
+    ;
+
+Profiler::Profiler(const Program &aProgram)
+    : fProgram(aProgram), fFunctions(aProgram.functions.size()),
+      fSiteOf(aProgram.operands.size(), -1), fKernels(kNumOpcodes) {
+  for (uint32_t caller = 0; caller < aProgram.functions.size(); ++caller) {
+    for (auto &instr : aProgram.functions[caller].code) {
+      if (instr.op != Opcode::Call) {
+        continue;
+      }
+      fSiteOf[instr.c] = fSites.size();
+      fSites.emplace_back();
+      fSiteCallees.push_back(instr.b);
+      fSiteCallers.push_back(caller);
+      auto it = aProgram.callPositions.find(instr.c);
+      fSitePositions.push_back(it == aProgram.callPositions.end()
+                                   ? SourcePosition()
+                                   : it->second);
+    }
+  }
+}
+
+uint64_t Profiler::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t Profiler::getBytes(const runtime::Tensor &aTensor) {
+  if (aTensor.isSparse()) {
+    auto &nonZeros = aTensor.getNonZeros();
+    return nonZeros.values.size() * (sizeof(double) + sizeof(int));
+  }
+  return aTensor.getNumElements() *
+         runtime::getElementSize(aTensor.getElementType());
+}
+
+void Profiler::enter(uint32_t aFunction, int64_t aSite) {
+  int site = aSite < 0 ? -1 : fSiteOf[aSite];
+  ++fFunctions[aFunction].calls;
+  ++fFunctions[aFunction].depth;
+  if (site >= 0) {
+    ++fSites[site].calls;
+    ++fSites[site].depth;
+  }
+  fStack.push_back(Active{aFunction, site, now(), 0, fBytes});
+}
+
+void Profiler::leave() { leave(now()); }
+
+void Profiler::leave(uint64_t aNow) {
+  Active call = fStack.back();
+  fStack.pop_back();
+  uint64_t inclusive = aNow - call.start;
+  auto &function = fFunctions[call.function];
+  function.exclusiveNs += inclusive - call.childNs;
+  if (--function.depth == 0) {
+    function.inclusiveNs += inclusive;
+  }
+  if (call.site >= 0) {
+    auto &site = fSites[call.site];
+    if (--site.depth == 0) {
+      site.inclusiveNs += inclusive;
+      site.bytes += fBytes - call.startBytes;
+    }
+  }
+  if (!fStack.empty()) {
+    fStack.back().childNs += inclusive;
+  }
+}
+
+void Profiler::kernel(Opcode aOp, uint64_t aStart, uint64_t aBytes) {
+  auto &kernel = fKernels[static_cast<int>(aOp)];
+  ++kernel.calls;
+  kernel.ns += now() - aStart;
+  kernel.bytes += aBytes;
+  fBytes += aBytes;
+  if (!fStack.empty()) {
+    fFunctions[fStack.back().function].bytes += aBytes;
+  }
+}
+
+support::Profile Profiler::getProfile() const {
+  Profiler closed(*this);
+  uint64_t end = now();
+  while (!closed.fStack.empty()) {
+    closed.leave(end);
+  }
+
+  support::Profile profile;
+  for (size_t i = 0; i < fFunctions.size(); ++i) {
+    auto &counts = closed.fFunctions[i];
+    profile.functions[fProgram.functions[i].name] = support::FunctionProfile{
+        counts.calls, counts.inclusiveNs, counts.exclusiveNs, counts.bytes};
+  }
+  // a call inlined into several functions is one site of the source
+  for (size_t i = 0; i < fSites.size(); ++i) {
+    auto &counts = closed.fSites[i];
+    auto &site = profile.callSites[support::CallSite{
+        fProgram.functions[fSiteCallees[i]].name, fSitePositions[i].line,
+        fSitePositions[i].col}];
+    if (site.caller.empty()) {
+      site.caller = fProgram.functions[fSiteCallers[i]].name;
+    }
+    site.calls += counts.calls;
+    site.inclusiveNs += counts.inclusiveNs;
+    site.bytes += counts.bytes;
+  }
+  for (size_t op = 0; op < fKernels.size(); ++op) {
+    if (fKernels[op].calls) {
+      profile.kernels[getOpcodeName(static_cast<Opcode>(op))] = fKernels[op];
+    }
+  }
+  return profile;
+}
+
+} // namespace toy::vm
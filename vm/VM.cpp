@@ -0,0 +1,288 @@
+#include "vm/include/VM.hpp"
+
+#include "runtime/include/Print.hpp"
+#include "support/include/Statistics.hpp"
+
+#include <string>
+
+namespace toy::vm {
+
+// dims of an elementwise result, null if the shapes do not broadcast
+static const runtime::Dims *broadcast(const runtime::Tensor &aLHS,
+                                      const runtime::Tensor &aRHS) {
+  if (aRHS.isScalar() || aLHS.getDims() == aRHS.getDims()) {
+    return &aLHS.getDims();
+  }
+  if (aLHS.isScalar()) {
+    return &aRHS.getDims();
+  }
+  return nullptr;
+}
+
+VM::VM(const Program &aProgram, std::ostream &aOut, std::ostream &aErr,
+       Profiler *aProfiler)
+    : fProgram(aProgram), fOut(aOut), fErr(aErr), fProfiler(aProfiler) {}
+
+bool VM::run(const std::string &aEntry) {
+  support::PhaseScope scope("execute");
+  int entry = fProgram.getFunction(aEntry);
+  if (entry < 0) {
+    fErr << "Runtime error: no entry function '" << aEntry << "'\n";
+    return false;
+  }
+  const Chunk *entryChunk = &fProgram.functions[entry];
+  if (entryChunk->numParams != 0) {
+    fErr << "Runtime error: entry function takes no arguments\n";
+    return false;
+  }
+  return fProfiler ? execute<true>(entry) : execute<false>(entry);
+}
+
+template <bool Profiling> bool VM::execute(int aEntry) {
+  const Chunk *entryChunk = &fProgram.functions[aEntry];
+  if constexpr (Profiling) {
+    fProfiler->enter(aEntry, -1);
+  }
+  fRegs.assign(entryChunk->numRegs, runtime::Tensor());
+  fFrames.clear();
+  fFrames.push_back(Frame{entryChunk, entryChunk->code.data(), 0, 0});
+
+  Frame *frame = &fFrames.back();
+  runtime::Tensor *regs = fRegs.data();
+  const Instr *ip = frame->ip;
+  const Instr *instr = nullptr;
+
+  // value of a register, moved out at its last read
+  auto take = [&](uint32_t aReg, bool aMove) -> runtime::Tensor {
+    return aMove ? std::move(regs[aReg]) : regs[aReg];
+  };
+
+  // the register file may grow on a call, reload the cached pointers after
+  auto enter = [&]() {
+    frame = &fFrames.back();
+    regs = fRegs.data() + frame->base;
+    ip = frame->ip;
+  };
+  enter();
+
+#if defined(__GNUC__)
+  static const void *labels[] = {
+#define TOY_OPCODE_LABEL(name, desc) &&op_##name,
+      TOY_OPCODES(TOY_OPCODE_LABEL)
+#undef TOY_OPCODE_LABEL
+  };
+#define DISPATCH()                                                             \
+  instr = ip++;                                                                \
+  goto *labels[static_cast<int>(instr->op)]
+#define CASE(name) op_##name:
+#define NEXT() DISPATCH()
+  DISPATCH();
+#else
+#define CASE(name) case Opcode::name:
+#define NEXT() continue
+  for (;;) {
+    instr = ip++;
+    switch (instr->op) {
+#endif
+
+  CASE(LoadConst) {
+    regs[instr->a] = fProgram.constants[instr->b];
+    NEXT();
+  }
+
+  CASE(Move) {
+    regs[instr->a] = take(instr->b, instr->flags & kMoveB);
+    NEXT();
+  }
+
+  CASE(Add) CASE(Sub) CASE(Mul) {
+    auto &lhs = regs[instr->b];
+    auto &rhs = regs[instr->c];
+    if (!broadcast(lhs, rhs)) {
+      frame->ip = ip;
+      return error(*frame, "incompatible shapes for elementwise operation");
+    }
+    char op = instr->op == Opcode::Add   ? '+'
+              : instr->op == Opcode::Sub ? '-'
+                                         : '*';
+    [[maybe_unused]] uint64_t start = 0;
+    [[maybe_unused]] uint64_t bytes = 0;
+    if constexpr (Profiling) {
+      start = Profiler::now();
+      bytes = Profiler::getBytes(lhs) + Profiler::getBytes(rhs);
+    }
+    if (instr->flags & (kMoveB | kMoveC)) {
+      // a dying operand lends its buffer to the result
+      regs[instr->a] =
+          runtime::elementwise(op, take(instr->b, instr->flags & kMoveB),
+                               take(instr->c, instr->flags & kMoveC));
+    } else {
+      regs[instr->a] = runtime::elementwise(op, lhs, rhs);
+    }
+    if constexpr (Profiling) {
+      fProfiler->kernel(instr->op, start,
+                        bytes + Profiler::getBytes(regs[instr->a]));
+    }
+    NEXT();
+  }
+
+  CASE(Transpose) {
+    // a view, no elements are read or written
+    [[maybe_unused]] uint64_t start = Profiling ? Profiler::now() : 0;
+    // the view owns the buffer alone once a dying operand is dropped
+    regs[instr->a] =
+        runtime::transpose(take(instr->b, instr->flags & kMoveB));
+    if constexpr (Profiling) {
+      fProfiler->kernel(instr->op, start, 0);
+    }
+    NEXT();
+  }
+
+  CASE(Reshape) {
+    auto &dims = fProgram.dims[instr->c];
+    if (runtime::getNumElements(dims) != regs[instr->b].getNumElements()) {
+      frame->ip = ip;
+      return error(*frame, "cannot reshape, the number of elements differs");
+    }
+    [[maybe_unused]] uint64_t start = Profiling ? Profiler::now() : 0;
+    regs[instr->a] = take(instr->b, instr->flags & kMoveB).reshaped(dims);
+    if constexpr (Profiling) {
+      fProfiler->kernel(instr->op, start, 0);
+    }
+    NEXT();
+  }
+
+  CASE(Fused) {
+    auto &operands = fProgram.operands[instr->c];
+    const runtime::Tensor *shape = nullptr;
+    bool moves = false;
+    for (auto operand : operands) {
+      auto &reg = regs[operand & ~kMoveOperand];
+      moves |= (operand & kMoveOperand) != 0;
+      if (!shape || shape->isScalar()) {
+        shape = &reg;
+      } else if (!broadcast(*shape, reg)) {
+        frame->ip = ip;
+        return error(*frame, "incompatible shapes in fused operation");
+      }
+    }
+    [[maybe_unused]] uint64_t start = 0;
+    [[maybe_unused]] uint64_t bytes = 0;
+    if constexpr (Profiling) {
+      start = Profiler::now();
+      for (auto operand : operands) {
+        bytes += Profiler::getBytes(regs[operand & ~kMoveOperand]);
+      }
+    }
+    if (moves) {
+      // a dying input lends its buffer to the result
+      std::vector<runtime::Tensor> inputs;
+      inputs.reserve(operands.size());
+      for (auto operand : operands) {
+        inputs.push_back(
+            take(operand & ~kMoveOperand, operand & kMoveOperand));
+      }
+      regs[instr->a] =
+          runtime::fusedReusing(fProgram.programs[instr->b], std::move(inputs));
+    } else {
+      std::vector<const runtime::Tensor *> inputs;
+      inputs.reserve(operands.size());
+      for (auto operand : operands) {
+        inputs.push_back(&regs[operand]);
+      }
+      regs[instr->a] = runtime::fused(fProgram.programs[instr->b], inputs);
+    }
+    if constexpr (Profiling) {
+      fProfiler->kernel(instr->op, start,
+                        bytes + Profiler::getBytes(regs[instr->a]));
+    }
+    NEXT();
+  }
+
+  CASE(Call) {
+    const Chunk *callee = &fProgram.functions[instr->b];
+    auto &operands = fProgram.operands[instr->c];
+    if (static_cast<int>(operands.size()) != callee->numParams) {
+      frame->ip = ip;
+      return error(*frame, "wrong number of arguments to '" + callee->name +
+                               "'");
+    }
+    frame->ip = ip;
+    if (fFrames.size() >= kMaxCallDepth) {
+      return error(*frame, "call depth exceeds " +
+                               std::to_string(kMaxCallDepth) + " in '" +
+                               callee->name + "'");
+    }
+    size_t retDst = frame->base + instr->a;
+    size_t base = frame->base + frame->chunk->numRegs;
+    fRegs.resize(base + callee->numRegs);
+    // arguments at their last use are moved, so the callee may reuse them
+    for (size_t i = 0; i < operands.size(); ++i) {
+      auto &arg = fRegs[frame->base + (operands[i] & ~kMoveOperand)];
+      if (operands[i] & kMoveOperand) {
+        fRegs[base + i] = std::move(arg);
+      } else {
+        fRegs[base + i] = arg;
+      }
+    }
+    fFrames.push_back(Frame{callee, callee->code.data(), base, retDst});
+    if constexpr (Profiling) {
+      fProfiler->enter(instr->b, instr->c);
+    }
+    enter();
+    NEXT();
+  }
+
+  CASE(Print) {
+    [[maybe_unused]] uint64_t start = Profiling ? Profiler::now() : 0;
+    runtime::print(fOut, regs[instr->a]);
+    if constexpr (Profiling) {
+      fProfiler->kernel(instr->op, start, Profiler::getBytes(regs[instr->a]));
+    }
+    if (instr->flags & kMoveA) {
+      regs[instr->a] = runtime::Tensor();
+    }
+    NEXT();
+  }
+
+  CASE(Free) {
+    regs[instr->a] = runtime::Tensor();
+    NEXT();
+  }
+
+  CASE(Return) CASE(ReturnVoid) {
+    runtime::Tensor result;
+    if (instr->op == Opcode::Return) {
+      result = std::move(regs[instr->a]);
+    }
+    size_t retDst = frame->retDst;
+    fRegs.resize(frame->base);
+    fFrames.pop_back();
+    if constexpr (Profiling) {
+      fProfiler->leave();
+    }
+    if (fFrames.empty()) {
+      return true;
+    }
+    fRegs[retDst] = std::move(result);
+    enter();
+    NEXT();
+  }
+
+#if !defined(__GNUC__)
+    }
+  }
+#endif
+#undef CASE
+#undef NEXT
+#undef DISPATCH
+}
+
+bool VM::error(const Frame &aFrame, const std::string &aMsg) {
+  size_t index = aFrame.ip - aFrame.chunk->code.data() - 1;
+  fErr << "Runtime error (line " << aFrame.chunk->lines[index] << ", in '"
+       << aFrame.chunk->name << "'): " << aMsg << "\n";
+  return false;
+}
+
+} // namespace toy::vm
@@ -0,0 +1,97 @@
+/*
+ *
+ * Register based bytecode for the toy VM.
+ *
+ * Every function is a chunk of three address instructions over a window of
+ * tensor registers. Constants, reshape dims, fused programs and operand lists
+ * live in pools referenced by index from the instructions.
+ *
+ */
+
+#pragma once
+
+#include "runtime/include/Kernels.hpp"
+#include "runtime/include/Tensor.hpp"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace toy::vm {
+
+// X(name, description of the operands)
+#define TOY_OPCODES(X)                                                         \
+  X(LoadConst, "a = constants[b]")                                             \
+  X(Move, "a = b")                                                             \
+  X(Add, "a = b + c")                                                          \
+  X(Sub, "a = b - c")                                                          \
+  X(Mul, "a = b * c")                                                          \
+  X(Transpose, "a = transpose(b)")                                             \
+  X(Reshape, "a = reshape(b, dims[c])")                                        \
+  X(Fused, "a = fused programs[b] over operands[c]")                           \
+  X(Call, "a = functions[b] over operands[c]")                                 \
+  X(Print, "print(a)")                                                         \
+  X(Free, "release a")                                                         \
+  X(Return, "return a")                                                        \
+  X(ReturnVoid, "return")
+
+enum class Opcode : uint8_t {
+#define TOY_OPCODE_ENUM(name, desc) name,
+  TOY_OPCODES(TOY_OPCODE_ENUM)
+#undef TOY_OPCODE_ENUM
+};
+
+// name of the opcode
+const char *getOpcodeName(Opcode aOp);
+
+// the register read through a, b or c is not used afterwards, its tensor is
+// moved out so kernels can reuse a buffer nothing else refers to
+enum InstrFlags : uint8_t { kMoveA = 1, kMoveB = 2, kMoveC = 4 };
+
+// same for a register in an operand list, set in its top bit
+constexpr uint16_t kMoveOperand = 0x8000;
+
+struct Instr {
+  Opcode op;
+  uint8_t flags;
+  uint16_t a;
+  uint32_t b;
+  uint32_t c;
+};
+
+// where an expression is in the source
+struct SourcePosition {
+  int line = 0;
+  int col = 0;
+};
+
+// a compiled function
+struct Chunk {
+  std::string name;
+  int numParams = 0;
+  int numRegs = 0;
+  std::vector<Instr> code;
+  // source line of each instruction
+  std::vector<int> lines;
+};
+
+struct Program {
+  std::vector<Chunk> functions;
+  std::map<std::string, int> functionIndex;
+  std::vector<runtime::Tensor> constants;
+  std::vector<runtime::Dims> dims;
+  std::vector<std::vector<runtime::FusedOp>> programs;
+  std::vector<std::vector<uint16_t>> operands;
+  // position of each call, by the index of its operand list
+  std::map<uint32_t, SourcePosition> callPositions;
+
+  // index of the function, -1 if there is none
+  int getFunction(const std::string &aName) const;
+
+  // print a readable listing of the program
+  void dump(std::ostream &aOs) const;
+};
+
+} // namespace toy::vm
@@ -0,0 +1,72 @@
+/*
+ *
+ * Lowers a toy module to register based bytecode.
+ *
+ * Variables live in registers, temporaries are taken from a free list and
+ * returned as soon as they are consumed. The register of a variable is
+ * released after the statement holding its last use, so its tensor can be
+ * freed before the function returns. The instruction reading a register for
+ * the last time moves its tensor out, letting kernels and callees reuse
+ * buffers nothing else refers to.
+ *
+ * Constants are built with the element type the compiler is created with,
+ * so every tensor of the program has it.
+ *
+ */
+
+#pragma once
+
+#include "parser/include/AST.hpp"
+#include "vm/include/Bytecode.hpp"
+
+#include <memory>
+#include <set>
+
+namespace toy::vm {
+
+class Compiler {
+public:
+  explicit Compiler(
+      runtime::ElementType aElementType = runtime::ElementType::Float64)
+      : fElementType(aElementType) {}
+
+  // compile every function of the module, prints the error and returns
+  // nullptr on failure
+  std::unique_ptr<Program> compile(Module &aModule);
+
+private:
+  // a register holding a value, temporaries are released once consumed
+  struct Operand {
+    int reg;
+    bool temp;
+  };
+
+  bool compileFunction(Function *aFunction, Chunk &aChunk);
+  bool compileStatement(Expr *aExpr);
+  // flag the reads that are the last use of a register, so the VM moves the
+  // tensor instead of sharing it, and drop the Free instructions they replace
+  void markLastUses(Chunk &aChunk);
+  // compile aExpr and return the register holding its value, -1 on error
+  Operand compileExpr(Expr *aExpr);
+  // build the constant tensor of a number or literal
+  runtime::Tensor buildConstant(Expr *aExpr);
+  int allocReg();
+  void freeReg(int aReg);
+  void release(Operand aOperand);
+  void emit(Opcode aOp, int aA, uint32_t aB = 0, uint32_t aC = 0);
+  uint32_t addOperands(const std::vector<Operand> &aOperands);
+  Operand error(Expr *aExpr, const std::string &aMsg);
+
+  runtime::ElementType fElementType;
+  Program *fProgram = nullptr;
+  Chunk *fChunk = nullptr;
+  Expr *fCurrent = nullptr;
+  // register bound to each variable
+  std::map<std::string, int> fVars;
+  // whether each function returns a value, by function index
+  std::vector<bool> fReturnsValue;
+  std::vector<int> fFreeRegs;
+  bool fFailed = false;
+};
+
+} // namespace toy::vm
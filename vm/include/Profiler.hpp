@@ -0,0 +1,84 @@
+/*
+ *
+ * Collects the execution profile of a VM run.
+ *
+ * A VM given a profiler reports every call, return and kernel instruction to
+ * it. The clock is read at those points only, so the dispatch between
+ * kernels is charged to the function running it. A VM without a profiler
+ * runs its own instantiation of the dispatch loop, with no profiling code.
+ *
+ */
+
+#pragma once
+
+#include "support/include/Profile.hpp"
+#include "vm/include/Bytecode.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace toy::vm {
+
+class Profiler {
+public:
+  // every call site of aProgram is in the profile, also those that never run
+  explicit Profiler(const Program &aProgram);
+
+  // the clock in nanoseconds
+  static uint64_t now();
+
+  // bytes holding the elements of aTensor, only the nonzeros if it is sparse
+  static uint64_t getBytes(const runtime::Tensor &aTensor);
+
+  // a call of functions[aFunction] through the call whose operand list is
+  // aSite, -1 for the entry function
+  void enter(uint32_t aFunction, int64_t aSite);
+
+  // the innermost call returned
+  void leave();
+
+  // a kernel started at aStart reading and writing aBytes of tensors
+  void kernel(Opcode aOp, uint64_t aStart, uint64_t aBytes);
+
+  // the profile so far, calls still active are taken as returned now
+  support::Profile getProfile() const;
+
+private:
+  struct Counts {
+    uint64_t calls = 0;
+    uint64_t inclusiveNs = 0;
+    uint64_t exclusiveNs = 0;
+    uint64_t bytes = 0;
+    // active calls, recursive calls add their time to the outermost one
+    int depth = 0;
+  };
+
+  struct Active {
+    uint32_t function;
+    int site;
+    uint64_t start;
+    // inclusive time of the calls made from this one
+    uint64_t childNs;
+    // value of fBytes when the call began
+    uint64_t startBytes;
+  };
+
+  // charge the return of the innermost call at aNow
+  void leave(uint64_t aNow);
+
+  const Program &fProgram;
+  std::vector<Counts> fFunctions;
+  std::vector<Counts> fSites;
+  // callee and position of each site
+  std::vector<uint32_t> fSiteCallees;
+  std::vector<uint32_t> fSiteCallers;
+  std::vector<SourcePosition> fSitePositions;
+  // site of each operand list, -1 for those that are not calls
+  std::vector<int> fSiteOf;
+  std::vector<support::KernelProfile> fKernels;
+  std::vector<Active> fStack;
+  // bytes of every kernel so far
+  uint64_t fBytes = 0;
+};
+
+} // namespace toy::vm
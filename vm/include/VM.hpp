@@ -0,0 +1,65 @@
+/*
+ *
+ * Interpreter for toy bytecode.
+ *
+ * Registers of all active calls live in a single register file, each call
+ * owning a window starting at its base. Calls push a frame on an explicit
+ * stack instead of recursing on the native one. Dispatch is threaded through
+ * computed goto where the compiler supports it, a switch otherwise.
+ *
+ * Runtime errors are written to the error stream, apart from what the
+ * program prints. Calls nest at most kMaxCallDepth deep, so runaway
+ * recursion is a runtime error rather than an exhausted heap.
+ *
+ * Given a Profiler, the VM reports its calls and kernels to it, through a
+ * separate instantiation of the loop so unprofiled runs pay nothing.
+ *
+ */
+
+#pragma once
+
+#include "vm/include/Bytecode.hpp"
+#include "vm/include/Profiler.hpp"
+
+#include <ostream>
+
+namespace toy::vm {
+
+class VM {
+public:
+  static constexpr size_t kMaxCallDepth = 10000;
+
+  // prints go to aOut and errors to aErr, calls and kernels are reported to
+  // aProfiler if there is one
+  VM(const Program &aProgram, std::ostream &aOut, std::ostream &aErr,
+     Profiler *aProfiler = nullptr);
+
+  // run the entry function, prints the error and returns false on a runtime
+  // error
+  bool run(const std::string &aEntry = "main");
+
+private:
+  struct Frame {
+    const Chunk *chunk;
+    // next instruction
+    const Instr *ip;
+    // first register of the window
+    size_t base;
+    // register of the caller receiving the result
+    size_t retDst;
+  };
+
+  // run the function functions[aEntry] to completion
+  template <bool Profiling> bool execute(int aEntry);
+
+  bool error(const Frame &aFrame, const std::string &aMsg);
+
+  const Program &fProgram;
+  std::ostream &fOut;
+  std::ostream &fErr;
+  Profiler *fProfiler;
+  std::vector<runtime::Tensor> fRegs;
+  std::vector<Frame> fFrames;
+};
+
+} // namespace toy::vm
@@ -0,0 +1,304 @@
+#include "lexer/include/Lexer.hpp"
+#include "opt/include/Fusion.hpp"
+#include "opt/include/Inliner.hpp"
+#include "opt/include/TransposeElim.hpp"
+#include "parser/include/Parser.hpp"
+#include "vm/include/Compiler.hpp"
+#include "vm/include/VM.hpp"
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <sstream>
+
+using namespace toy;
+
+// utility to parse a module from a string
+static std::unique_ptr<Module> parse(const char *aCode) {
+  auto lexer = std::make_unique<lexer::Lexer>(std::stringstream(aCode));
+  parser::Parser parser(std::move(lexer));
+  return parser.parseModule();
+}
+
+// utility to compile and run a module, returns what it printed and stores
+// the errors in aErrors
+static std::string run(Module &aModule, bool aExpectSuccess = true,
+                       std::string *aErrors = nullptr) {
+  auto program = vm::Compiler().compile(aModule);
+  EXPECT_NE(program, nullptr);
+  if (!program) {
+    return "";
+  }
+  std::stringstream out;
+  std::stringstream err;
+  EXPECT_EQ(vm::VM(*program, out, err).run(), aExpectSuccess);
+  if (aErrors) {
+    *aErrors = err.str();
+  }
+  return out.str();
+}
+
+static const char *kTutorial = R"(
+  def multiply_transpose(a, b) {
+    return transpose(a) * transpose(b);
+  }
+
+  def main() {
+    var a = [[1, 2, 3], [4, 5, 6]];
+    var b<2, 3> = [1, 2, 3, 4, 5, 6];
+    var c = multiply_transpose(a, b);
+    var d = multiply_transpose(b, a);
+    var e = multiply_transpose(c, d);
+    print(e);
+  }
+)";
+
+TEST(VM, Tutorial) {
+  auto module = parse(kTutorial);
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(run(*module), "[[1, 16, 81], [256, 625, 1296]]\n");
+}
+
+TEST(VM, OptimizedMatchesUnoptimized) {
+  auto module = parse(kTutorial);
+  ASSERT_NE(module, nullptr);
+  opt::Inliner().run(*module);
+  opt::TransposeElim().run(*module);
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  opt::Fusion().run(*module, &shapes);
+  EXPECT_EQ(run(*module), "[[1, 16, 81], [256, 625, 1296]]\n");
+}
+
+TEST(VM, ScalarsAndFusion) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2, 3];
+      var b = 2;
+      print(b * 3 - 1);
+      print(a * b + a - 1);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  std::string expected = "5\n[2, 5, 8]\n";
+  EXPECT_EQ(run(*module), expected);
+
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  EXPECT_EQ(opt::Fusion().run(*module, &shapes), 1);
+  EXPECT_EQ(run(*module), expected);
+}
+
+TEST(VM, SparseLiterals) {
+  // a diagonal of 1 to 8, the rest zeros
+  std::string rows;
+  std::string expected = "[";
+  for (int row = 0; row < 8; ++row) {
+    rows += row ? ", [" : "[";
+    expected += row ? ", [" : "[";
+    for (int col = 0; col < 8; ++col) {
+      rows += (col ? ", " : "") + std::to_string(row == col ? row + 1 : 0);
+      expected += (col ? ", " : "") +
+                  std::to_string(row == col ? 2 * (row + 1) * (row + 1) : 0);
+    }
+    rows += "]";
+    expected += "]";
+  }
+  std::string code = "def main() { var a = [" + rows +
+                     "]; print(transpose(a) * a + a * a); }";
+  auto module = parse(code.c_str());
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(run(*module), expected + "]\n");
+
+  // fused kernels expand sparse operands and agree
+  opt::ShapeInference shapes;
+  ASSERT_TRUE(shapes.run(*module));
+  opt::Fusion().run(*module, &shapes);
+  EXPECT_EQ(run(*module), expected + "]\n");
+}
+
+TEST(VM, Float32) {
+  auto module = parse(R"(
+    def main() {
+      var a = [[0.1, 1], [2, 3]];
+      print(transpose(a) * a + 0.2);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(run(*module), "[[0.21000000000000002, 2.2], [2.2, 9.2]]\n");
+
+  // every constant is a float, the kernels compute in float
+  auto program = vm::Compiler(runtime::ElementType::Float32).compile(*module);
+  ASSERT_NE(program, nullptr);
+  std::stringstream out;
+  ASSERT_TRUE(vm::VM(*program, out, std::cerr).run());
+  EXPECT_EQ(out.str(), "[[0.21000001, 2.2], [2.2, 9.2]]\n");
+}
+
+TEST(VM, Profiler) {
+  auto module = parse(R"(
+    def square(x) {
+      return x * x;
+    }
+
+    def unused(x) {
+      return square(x);
+    }
+
+    def main() {
+      var a = [1, 2];
+      print(square(a));
+      print(square(a) + a);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  auto program = vm::Compiler().compile(*module);
+  ASSERT_NE(program, nullptr);
+  vm::Profiler profiler(*program);
+  std::stringstream out;
+  ASSERT_TRUE(vm::VM(*program, out, std::cerr, &profiler).run());
+  EXPECT_EQ(out.str(), "[1, 4]\n[2, 6]\n");
+
+  auto profile = profiler.getProfile();
+  EXPECT_EQ(profile.functions["main"].calls, 1u);
+  EXPECT_EQ(profile.functions["square"].calls, 2u);
+  EXPECT_EQ(profile.functions["unused"].calls, 0u);
+  // every call site is known, with its source position
+  ASSERT_EQ(profile.callSites.size(), 3u);
+  auto *site = profile.findCallSite("square", 13, 13);
+  ASSERT_NE(site, nullptr);
+  EXPECT_EQ(site->caller, "main");
+  EXPECT_EQ(site->calls, 1u);
+  site = profile.findCallSite("square", 7, 14);
+  ASSERT_NE(site, nullptr);
+  EXPECT_EQ(site->calls, 0u);
+  EXPECT_EQ(profile.kernels["Mul"].calls, 2u);
+  EXPECT_EQ(profile.kernels["Add"].calls, 1u);
+  // two operands and a result of two doubles
+  EXPECT_EQ(profile.kernels["Add"].bytes, 48u);
+}
+
+TEST(VM, DeepCalls) {
+  auto module = parse(R"(
+    def add(a, b) {
+      return a + b;
+    }
+
+    def twice(a) {
+      return add(a, a);
+    }
+
+    def main() {
+      var a = [1, 2];
+      var b = twice(twice(a));
+      var a = add(b, twice(a));
+      print(a);
+      print(twice(3));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(run(*module), "[6, 12]\n6\n");
+}
+
+TEST(VM, RegistersAreReused) {
+  auto module = parse(R"(
+    def main() {
+      var a = [1, 2];
+      var b = a + 1;
+      var c = b + 1;
+      var d = c + 1;
+      print(d);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  auto program = vm::Compiler().compile(*module);
+  ASSERT_NE(program, nullptr);
+  // every variable is released after its last use
+  EXPECT_LE(program->functions[0].numRegs, 3);
+}
+
+TEST(VM, Errors) {
+  auto module = parse(R"(
+    def main() {
+      print(x);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(vm::Compiler().compile(*module), nullptr);
+
+  module = parse(R"(
+    def main() {
+      var a = [1, 2];
+      var b = [1, 2, 3];
+      print(a);
+      print(a + b);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  std::string errors;
+  EXPECT_EQ(run(*module, false, &errors), "[1, 2]\n");
+  EXPECT_EQ(errors, "Runtime error (line 6, in 'main'): incompatible shapes "
+                    "for elementwise operation\n");
+
+  // a function without a return value is only called as a statement
+  module = parse(R"(
+    def show(a) {
+      print(a);
+    }
+
+    def main() {
+      show([1]);
+      print(show([2]));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  testing::internal::CaptureStdout();
+  EXPECT_EQ(vm::Compiler().compile(*module), nullptr);
+  EXPECT_NE(testing::internal::GetCapturedStdout().find(
+                "expression does not produce a value"),
+            std::string::npos);
+
+  // runaway recursion stops at the call depth limit
+  module = parse(R"(
+    def loop(a) {
+      return loop(a);
+    }
+
+    def main() {
+      print(loop(1));
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(run(*module, false, &errors), "");
+  EXPECT_NE(errors.find("call depth exceeds 10000 in 'loop'"),
+            std::string::npos);
+}
+
+TEST(VM, MovesAtLastUse) {
+  auto module = parse(R"(
+    def scale(a) {
+      return a * 2;
+    }
+
+    def main() {
+      var a = [1, 2, 3];
+      var b = scale(a);
+      var c = b + a;
+      print(c);
+      print(b);
+    }
+  )");
+  ASSERT_NE(module, nullptr);
+  auto program = vm::Compiler().compile(*module);
+  ASSERT_NE(program, nullptr);
+  std::stringstream listing;
+  program->dump(listing);
+  // a is moved into its last read, b is still printed after the sum
+  EXPECT_NE(listing.str().find("Add 2 1 0 move c"), std::string::npos)
+      << listing.str();
+  // the argument of scale gives its buffer to the product
+  EXPECT_NE(listing.str().find("Mul 1 0 1 move b move c"), std::string::npos)
+      << listing.str();
+  // the releases of a and c are done by the moves
+  EXPECT_EQ(listing.str().find("Free"), std::string::npos) << listing.str();
+  EXPECT_EQ(run(*module), "[3, 6, 9]\n[2, 4, 6]\n");
+}